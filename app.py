@@ -81,6 +81,17 @@ def index():
     response.headers['Content-Security-Policy'] = "script-src 'self' 'unsafe-inline' 'unsafe-eval' https://cdn.tailwindcss.com; default-src 'self'; connect-src 'self' wss: https:; style-src 'self' 'unsafe-inline' https://cdn.tailwindcss.com; img-src 'self' data:; font-src 'self' data:;"
     return response
 
+@app.after_request
+def add_isolation_headers(response):
+    """Cross-origin isolate every page and worker script, which makes
+    SharedArrayBuffer available to the -pthread WASM build (xmrig-adapter.js
+    pool mode).  'credentialless' rather than 'require-corp' keeps the
+    Tailwind CDN script loading; browsers without it fall back to one
+    module per worker."""
+    response.headers.setdefault('Cross-Origin-Opener-Policy', 'same-origin')
+    response.headers.setdefault('Cross-Origin-Embedder-Policy', 'credentialless')
+    return response
+
 @app.route('/api/stats', methods=['GET'])
 def get_stats():
     stats = Stats.query.first()
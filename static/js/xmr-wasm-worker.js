@@ -1,15 +1,90 @@
 /**
  * CryptoNight WASM Mining Worker
- * Loads CryptoNight WASM module, receives jobs from main thread,
- * computes hashes, and reports results back.
+ * Instantiates the WASM module the adapter compiled, receives jobs from
+ * main thread, computes hashes, and reports results back.
+ * rx/0 jobs load the RandomX module on first use; its per-seed cache is
+ * built by one worker and copied to the others through the adapter.
+ * On cross-origin isolated pages the adapter runs a single worker with the
+ * -pthread build instead ("pool mode"): cn_pool hashes on one thread per
+ * core inside that module and this worker only sets jobs and polls it.
+ * There the adapter also shares a control word (job generation, stop bit)
+ * that the kernel checks every few thousand main-loop iterations, so a new
+ * job or a pause ends the batch in flight, abandoning the hash, instead of
+ * waiting for it.
+ * Isolated pages also get the adapter's statistics counters: the kernel
+ * counts hashes, shares and hashing time straight into this worker's slot
+ * (or the pool's own block, in its shared memory) and the page samples
+ * them, so no per-batch stats messages are sent.
  */
 
 let cn = null;       // CryptoNight WASM module
-let cnHash = null;   // cwrap'd cn_hash function
-let tryHash = null;  // cwrap'd try_hash function
+let cnCtx = 0;       // cn_ctx* sized for hashWays scratchpads (0 on old builds)
+let ctxAlgo = 0;     // cnCtx's algorithm id (0 = cn/0, see cn_algo_by_name)
+let hashWays = 1;    // nonces hashed per WASM call (1, 2 or 4)
+let resultsPtr = 0;  // cn_ctx_scan() result records, allocated once
+let jobReady = false; // currentJob's blob is set on the engine's context
+let engine = null;    // { mod, ctx, scan, results, ways, msPerHash } currentJob hashes with
+let loopTimer = null; // pending mineLoop() timeout
+let lastLog = 0;      // performance.now() of the last hashrate log
+
+let rx = null;          // RandomX WASM module, loaded on the first rx/0 job
+let rxModuleName = 'randomx';
+let rxLoading = null;   // initRx() promise while the module loads
+let rxCache = 0;        // rx_cache* shared by rxCtx
+let rxCtx = 0;
+let rxResultsPtr = 0;
+let rxSeed = '';        // seed hash rxCache holds ('' = none)
+let rxRequested = '';   // seed hash asked of the adapter, not yet received
+let moduleWaiters = {};  // name → { resolve, reject } for wasm_module replies
+
+let pool = 0;           // cn_pool* in pool mode, 0 otherwise
+let poolJobId = 0;      // cn_pool_set_job() id of currentJob (0: not set)
+let poolResultsPtr = 0;
+let poolTimer = null;   // pending pollPool() timeout
+let poolHashes = 0;     // cn_pool_hashes() at the last poll
+let poolPolled = 0;     // performance.now() of the last poll
+let poolBusyNs = 0;     // cn_pool_busy_ns() at the last poll
+
+// Batches last about sliceMs: fewer, longer calls cost less.  Without the
+// control word a new job waits up to that long (the worker can't take
+// messages mid-batch).
+let sliceMs = 250;
+
+// Adapter's control word (Int32Array over a SharedArrayBuffer, null when
+// the page isn't cross-origin isolated): the job generation, with the
+// stop bit set on pause.  Scans are armed with jobGeneration and end
+// mid-hash once the word moves on.
+let control = null;
+let jobGeneration = 0;
+
+// Adapter's statistics counters (BigInt64Array over a SharedArrayBuffer,
+// null when the page isn't cross-origin isolated): CN_STATS_FIELDS words
+// per worker, this worker's at statsSlot.  Contexts armed with them count
+// every scan there, and mineLoop() leaves reporting to the adapter.
+let stats = null;
+let statsSlot = 0;
+
+// Duty-cycle governor: hash for `duty` of wall time, sleep the rest
+let duty = 1;           // requested fraction (the CPU slider)
+let owedMs = 0;         // sleep owed; negative after oversleeping
+let sleepStart = 0;     // performance.now() the pending sleep began, 0: none
+let usage = { start: 0, busy: 0, value: 0 };  // achieved-utilisation window
+
+const JOB_SLOT_TARGET = 256; // job slot: blob (up to CN_MAX_BLOB), then target bytes
+const JOB_SLOT_SIZE = JOB_SLOT_TARGET + 8;
+const SCAN_RESULT_SIZE = 36;  // nonce (4) + hash (32), see cn_ctx_scan()
+const SCAN_MAX_RESULTS = 16;
+const POOL_RESULT_SIZE = 40;  // job id (4) + scan record, see cn_pool_results()
+const POOL_MAX_RESULTS = 64;
+const POOL_POLL_MS = 500;
+const GOVERNOR_MIN_SLEEP_MS = 25;   // shortest sleep: well above timer granularity
+const MAX_BATCH = 4096;
+const USAGE_WINDOW_MS = 2000;
 let wasmReady = false; // Track WASM initialization status
 let mining = false;
-let currentJob = null;
+let currentJob = null; // job meta from the adapter; blob and target are Uint8Arrays
+let jobTarget64 = 0n;  // currentJob.target as the kernel's 64-bit threshold
+let algoIds = {};      // stratum algo name → cn_algo_by_name()
 let totalHashes = 0;
 let hashrate = 0;
 let acceptedShares = 0;
@@ -17,30 +92,145 @@ let workerId = 0;
 let totalWorkers = 1;
 let nonceCounter = 0;
 
-// Load WASM module
-importScripts('/static/wasm/cryptonight.js');
+// Emscripten hook: instantiate the WebAssembly.Module compiled by the
+// adapter instead of letting the glue code fetch and compile the .wasm
+function instantiateWith(wasm) {
+    return (imports, receiveInstance) => {
+        WebAssembly.instantiate(wasm, imports)
+            .then(instance => receiveInstance(instance, wasm))
+            .catch(e => postMessage({ type: 'error', error: 'WASM instantiation failed: ' + e.message }));
+        return {};
+    };
+}
 
-async function initWasm() {
+// Heap view of a module.  A -pthread module's memory can grow on another
+// thread, which leaves mod.HEAPU8 on the old, shorter buffer.
+function heapU8(mod) {
+    const memory = mod.wasmMemory;
+    if (memory && mod.HEAPU8.buffer !== memory.buffer) mod.HEAPU8 = new Uint8Array(memory.buffer);
+    return mod.HEAPU8;
+}
+
+// Compiled module `name` from the adapter (see WasmModuleCache)
+function requestModule(name) {
+    return new Promise((resolve, reject) => {
+        moduleWaiters[name] = { resolve, reject };
+        postMessage({ type: 'wasm_module_request', name });
+    });
+}
+
+// Load WASM module ('cryptonight' or 'cryptonight-simd', chosen and
+// compiled by the adapter).  With `threads` set it is a -pthread build
+// ('cryptonight-mt', 'cryptonight-mt-simd') and hashing runs on a cn_pool
+// of that many threads.
+async function initWasm(moduleName, wasm, threads) {
     try {
+        const url = '/static/wasm/' + moduleName + '.js';
+        rxModuleName = moduleName.replace('cryptonight', 'randomx');
+        importScripts(url);
         cn = await CryptoNight({
-            locateFile: (path) => '/static/wasm/' + path
+            instantiateWasm: instantiateWith(wasm),
+            // pthread workers load the glue and <name>.worker.js from here
+            mainScriptUrlOrBlob: url,
+            locateFile: path => '/static/wasm/' + path,
+            control,  // read by cn_ctx_set_host_control() scans
+            stats     // added to by cn_ctx_set_host_stats() scans
         });
-        cnHash = cn.cwrap('cn_hash', null, ['number', 'number', 'number']);
-        tryHash = cn.cwrap('try_hash', 'number', ['number', 'number', 'number', 'number', 'number']);
+        if (!cn._cn_ctx_set_job || !cn._cn_target_from_pool || !cn._cn_ctx_create_algo) {
+            throw new Error('WASM build is too old (no cn_ctx_set_job / cn_target_from_pool / cn_ctx_create_algo)');
+        }
+        pickHashWays();
+        if (!cnCtx) throw new Error('cannot allocate hashing context');
+        resultsPtr = cn._malloc(SCAN_RESULT_SIZE * SCAN_MAX_RESULTS);
+        if (threads) initPool(threads);
+        if (currentJob) setJob(currentJob);
         wasmReady = true;
         postMessage({ type: 'ready' });
-        console.log('[Worker] CryptoNight WASM initialized');
+        console.log(`[Worker] CryptoNight WASM initialized${pool ? ` (pool mode, ${threads} threads)` : ''}`);
         
         // Start mining if job was received during init
-        if (currentJob && !mining) {
+        if (currentJob) {
             mining = true;
-            mineLoop();
+            scheduleMining();
         }
     } catch (e) {
         postMessage({ type: 'error', error: 'Failed to init WASM: ' + e.message });
     }
 }
 
+// Pool mode: the pool threads hash with their own contexts, at the
+// way-count calibrated on this thread
+function initPool(threads) {
+    if (!cn._cn_pool_create) throw new Error('pool mode needs a -pthread build');
+    pool = cn._cn_pool_create(threads, hashWays, 0);
+    if (!pool) throw new Error('cannot start hashing threads');
+    cn._cn_ctx_destroy(cnCtx);
+    cnCtx = 0;
+    ctxAlgo = -1;
+    poolResultsPtr = cn._malloc(POOL_RESULT_SIZE * POOL_MAX_RESULTS);
+    setDuty(duty);
+    setSlice(sliceMs);
+    // The threads count into the pool's cn_stats, already in shared memory
+    if (stats && cn._cn_pool_stats) {
+        postMessage({ type: 'stats_memory', memory: cn.wasmMemory.buffer, offset: cn._cn_pool_stats(pool) });
+    }
+}
+
+// Batch duration in ms (10..5000)
+function setSlice(ms) {
+    sliceMs = Math.min(5000, Math.max(10, Number(ms) || 250));
+    if (pool) cn._cn_pool_set_slice(pool, sliceMs);
+}
+
+// Requested utilisation, 0.01..1.  The pool's threads govern themselves
+// (cn_pool_set_duty); otherwise mineLoop() does.
+function setDuty(value) {
+    duty = Math.min(1, Math.max(0.01, Number(value) || 1));
+    owedMs = 0;
+    if (pool) cn._cn_pool_set_duty(pool, Math.round(duty * 1000));
+}
+
+function hashFnForWays(ways) {
+    if (ways === 4) return cn._cn_hash_x4;
+    if (ways === 2) return cn._cn_hash_x2;
+    return cn._cn_ctx_hash;
+}
+
+// Time one call per way-count and keep the context with the best H/s.
+// Interleaving hides scratchpad latency until the lanes' 2 MB pads stop
+// fitting in cache, so the winner depends on the device.
+function pickHashWays() {
+    const blobLen = 76;
+    const inputPtr = cn._malloc(blobLen * 4);
+    const outputPtr = cn._malloc(32 * 4);
+    heapU8(cn).fill(0, inputPtr, inputPtr + blobLen * 4);
+
+    let best = { ways: 1, rate: 0, ctx: 0 };
+    for (const ways of [1, 2, 4]) {
+        const ctx = cn._cn_ctx_create_ways(ways);
+        if (!ctx) continue;
+        const fn = hashFnForWays(ways);
+        fn(ctx, inputPtr, blobLen, outputPtr);  // warm-up: touch the scratchpads
+        const t0 = performance.now();
+        fn(ctx, inputPtr, blobLen, outputPtr);
+        const rate = ways * 1000 / Math.max(performance.now() - t0, 0.001);
+        if (rate > best.rate) {
+            if (best.ctx) cn._cn_ctx_destroy(best.ctx);
+            best = { ways, rate, ctx };
+        } else {
+            cn._cn_ctx_destroy(ctx);
+        }
+    }
+
+    cn._free(inputPtr);
+    cn._free(outputPtr);
+    if (best.ctx) {
+        cnCtx = best.ctx;
+        hashWays = best.ways;
+    }
+    console.log(`[Worker] Using ${hashWays}-way hashing (${best.rate.toFixed(2)} H/s calibration)`);
+}
+
 function hexToBytes(hex) {
     const bytes = [];
     for (let i = 0; i < hex.length; i += 2) {
@@ -53,105 +243,431 @@ function bytesToHex(bytes) {
     return Array.from(bytes).map(b => b.toString(16).padStart(2, '0')).join('');
 }
 
-function parseTarget(targetHex) {
-    // Pool sends target as little-endian 32-bit hex (e.g. "b4b0bf00")
-    // Convert LE hex to uint32 value for comparison with hash's first 4 bytes
-    const bytes = hexToBytes(targetHex.padEnd(8, '0').slice(0, 8));
-    // Little-endian: first byte is lowest
-    return (bytes[0]) | (bytes[1] << 8) | (bytes[2] << 16) | ((bytes[3] << 24) >>> 0);
+// Job message from the adapter: the blob and target bytes it decoded
+// once (see encodeJob() there), as views of the transferred buffer
+function decodeJob(meta, buffer) {
+    const bytes = new Uint8Array(buffer);
+    return {
+        ...meta,
+        blob: bytes.subarray(0, meta.blobLength),
+        target: bytes.subarray(meta.blobLength)
+    };
 }
 
-function mineLoop() {
-    if (!mining || !currentJob || !wasmReady || !cn) return;
+// Copy a job's blob and target into the module's job slot, allocated on
+// first use and reused for every job, and return the blob's address.
+// Blobs too long for the slot stay out; the kernel refuses their length.
+function loadJob(mod, job) {
+    if (!mod.jobSlot) mod.jobSlot = mod._malloc(JOB_SLOT_SIZE);
+    const heap = heapU8(mod);
+    if (job.blob.length <= JOB_SLOT_TARGET) heap.set(job.blob, mod.jobSlot);
+    if (job.target.length <= 8) heap.set(job.target, mod.jobSlot + JOB_SLOT_TARGET);
+    return mod.jobSlot;
+}
 
-    const blob = hexToBytes(currentJob.blob);
-    const blobLen = blob.length;
-    const target = parseTarget(currentJob.target);
+// Slot target → 64-bit threshold via cn_target_from_pool(), the same rules
+// stratum_proxy.py uses to validate results.  Built with WASM_BIGINT, so
+// the uint64 comes back (and goes into cn_ctx_scan) as a BigInt.
+function slotTarget64(mod, job) {
+    const len = job.target.length <= 8 ? job.target.length : 0;
+    const target64 = len ? BigInt.asUintN(64, mod._cn_target_from_pool(mod.jobSlot + JOB_SLOT_TARGET, len)) : 0n;
+    if (target64 === 0n) console.warn(`[Worker] Unusable pool target (${job.target.length} bytes)`);
+    return target64;
+}
 
-    // Allocate WASM memory
-    const inputPtr = cn._malloc(blobLen);
-    const outputPtr = cn._malloc(32);
-    cn.HEAPU8.set(blob, inputPtr);
+// Stratum algo name → kernel algorithm id, -1 when this build can't hash
+// it.  Ids don't change, so each name goes through the heap once.
+function algoId(name) {
+    if (!(name in algoIds)) {
+        const bytes = new TextEncoder().encode(name + '\0');
+        algoIds[name] = withBytes(cn, bytes, ptr => cn._cn_algo_by_name(ptr));
+    }
+    return algoIds[name];
+}
 
-    const batchSize = 64;
-    // Use worker-specific nonce range to avoid collisions across workers
-    const nonceBase = (workerId * 0x10000000) + nonceCounter;
-    nonceCounter += batchSize;
-    const startTime = performance.now();
+// Swap cnCtx for one hashing `algo` with the same way-count
+function useAlgo(algo) {
+    if (algo === ctxAlgo) return true;
+    const ctx = cn._cn_ctx_create_algo(algo, hashWays);
+    if (!ctx) return false;
+    cn._cn_ctx_destroy(cnCtx);
+    cnCtx = ctx;
+    ctxAlgo = algo;
+    return true;
+}
+
+// Load the RandomX module (same scalar/SIMD flavour as cn) and create the
+// cache and context.  The cache stays empty until a seed hash arrives.
+function initRx() {
+    if (!rxLoading) {
+        rxLoading = (async () => {
+            const wasm = await requestModule(rxModuleName);
+            importScripts('/static/wasm/' + rxModuleName + '.js');
+            rx = await RandomX({ instantiateWasm: instantiateWith(wasm), control, stats });
+            rxCache = rx._rx_cache_create();
+            rxCtx = rxCache ? rx._rx_ctx_create(rxCache) : 0;
+            if (!rxCtx) throw new Error('cannot allocate RandomX cache/context');
+            rxResultsPtr = rx._malloc(SCAN_RESULT_SIZE * SCAN_MAX_RESULTS);
+            console.log(`[Worker ${workerId}] RandomX WASM initialized (light mode)`);
+        })();
+        rxLoading.catch(() => { rxLoading = null; });  // retry on the next rx/0 job
+    }
+    return rxLoading;
+}
 
-    for (let i = 0; i < batchSize; i++) {
-        if (!mining) break;
+// Copy `bytes` into a module's heap for the duration of fn(ptr, len)
+function withBytes(mod, bytes, fn) {
+    const ptr = mod._malloc(Math.max(bytes.length, 1));
+    heapU8(mod).set(bytes, ptr);
+    try {
+        return fn(ptr, bytes.length);
+    } finally {
+        mod._free(ptr);
+    }
+}
 
-        const nonce = (nonceBase + i) & 0xFFFFFFFF;
+// Build the cache for `seed` here and hand a copy to the adapter, which
+// passes it on to the workers waiting for the same seed: one
+// SharedArrayBuffer they all copy from on isolated pages, else a buffer
+// transferred to it.  A failure is reported so the adapter stops waiting.
+function buildRxCache(seed) {
+    const t0 = performance.now();
+    let error = `bad seed hash "${seed}"`;
+    let built = false;
+    try {
+        built = withBytes(rx, hexToBytes(seed), (p, n) => rx._rx_cache_init(rxCache, p, n));
+    } catch (e) {
+        error = e.message || String(e);
+    }
+    if (!built) {
+        postMessage({ type: 'rx_cache_failed', seed, error });
+        return;
+    }
+    console.log(`[Worker ${workerId}] RandomX cache built in ${((performance.now() - t0) / 1000).toFixed(1)} s`);
+    const mem = rx._rx_cache_memory(rxCache);
+    const cache = heapU8(rx).subarray(mem, mem + rx._rx_cache_size());
+    if (self.crossOriginIsolated && typeof SharedArrayBuffer === 'function') {
+        const shared = new SharedArrayBuffer(cache.length);
+        new Uint8Array(shared).set(cache);
+        postMessage({ type: 'rx_cache', seed, memory: shared });
+    } else {
+        const copy = cache.slice();
+        postMessage({ type: 'rx_cache', seed, memory: copy.buffer }, [copy.buffer]);
+    }
+    rxCacheReady(seed);
+}
 
-        // Set nonce in blob (offset 39, little-endian)
-        cn.HEAPU8[inputPtr + 39] = nonce & 0xFF;
-        cn.HEAPU8[inputPtr + 40] = (nonce >> 8) & 0xFF;
-        cn.HEAPU8[inputPtr + 41] = (nonce >> 16) & 0xFF;
-        cn.HEAPU8[inputPtr + 42] = (nonce >> 24) & 0xFF;
+// Cache memory built by another worker: only the programs are regenerated
+function importRxCache(seed, memory) {
+    heapU8(rx).set(new Uint8Array(memory), rx._rx_cache_memory(rxCache));
+    if (!withBytes(rx, hexToBytes(seed), (p, n) => rx._rx_cache_import(rxCache, p, n))) return;
+    rxCacheReady(seed);
+}
 
-        // Compute CryptoNight hash
-        cnHash(inputPtr, blobLen, outputPtr);
+function rxCacheReady(seed) {
+    rxSeed = seed;
+    if (rxRequested === seed) rxRequested = '';
+    if (currentJob && currentJob.algo === 'rx/0') {
+        setJob(currentJob);
+        scheduleMining();
+    }
+}
 
-        // Check hash against target
-        // Monero/CryptoNight: interpret hash as 256-bit LE number, compare with target
-        // Target from pool is 32-bit LE value - represents first 4 bytes of full 256-bit target
-        // For hash < target: bytes 4-31 must be zero, and bytes 0-3 (as uint32) must be <= target
-        const hashBytes = new Uint8Array(cn.HEAPU8.buffer, outputPtr, 32);
-        
-        // Check if bytes 4-31 are all zero (required for difficulty check)
-        let hashRest = 0;
-        for (let j = 4; j < 32; j++) {
-            hashRest |= hashBytes[j];
-        }
-        
-        // Compare first 4 bytes (as little-endian uint32) with target
-        const hashLow32 = (hashBytes[0]) | (hashBytes[1] << 8) | (hashBytes[2] << 16) | ((hashBytes[3] << 24) >>> 0);
-        
-        if (hashRest === 0 && hashLow32 <= target && target > 0) {
-            // Found valid share!
-            const nonceHex = [
-                (nonce & 0xFF).toString(16).padStart(2, '0'),
-                ((nonce >> 8) & 0xFF).toString(16).padStart(2, '0'),
-                ((nonce >> 16) & 0xFF).toString(16).padStart(2, '0'),
-                ((nonce >> 24) & 0xFF).toString(16).padStart(2, '0')
-            ].join('');
-
-            const resultHex = bytesToHex(hashBytes);
-
-            postMessage({
-                type: 'share',
-                nonce: nonceHex,
-                result: resultHex,
-                job_id: currentJob.job_id
-            });
-            acceptedShares++;
+// rx/0 job: hash with the RandomX context once the job's seed is cached
+function setRxJob(job) {
+    jobReady = false;
+    if (!rx) {
+        initRx().then(() => {
+            if (currentJob) setJob(currentJob);
+            scheduleMining();
+        }).catch(e => postMessage({ type: 'error', error: 'Failed to init RandomX WASM: ' + e.message }));
+        return;
+    }
+    const seed = job.seed_hash || '';
+    if (seed !== rxSeed) {
+        if (seed && seed !== rxRequested) {
+            rxRequested = seed;
+            postMessage({ type: 'rx_cache_request', seed });
         }
+        return;
     }
+    const slot = loadJob(rx, job);
+    jobTarget64 = slotTarget64(rx, job);
+    jobReady = rx._rx_ctx_set_job(rxCtx, slot, job.blob.length) !== 0;
+    armControl(rx._rx_ctx_set_host_control, rxCtx);
+    engine = newEngine(rx, rxCtx, rx._rx_ctx_scan, rxResultsPtr, 1, rx._rx_ctx_scanned,
+                       armStats(rx._rx_ctx_set_host_stats, rxCtx));
+    if (!jobReady) console.warn(`[Worker ${workerId}] Job ${job.job_id}: unusable blob`);
+}
 
-    totalHashes += batchSize;
-    const elapsed = (performance.now() - startTime) / 1000;
-    hashrate = elapsed > 0 ? (batchSize / elapsed) : 0;
+// What mineLoop() hashes with; `ways` nonces per kernel call, scanned()
+// tells how far a scan got (undefined on builds without a control word),
+// `counted` whether the scans count into the adapter's stats.
+// msPerHash, measured per batch, carries over while the module and
+// context (and so the algorithm) stay the same: cn and rx allocate their
+// contexts in separate heaps, so the same address can be in both.
+function newEngine(mod, ctx, scan, results, ways, scanned, counted) {
+    const msPerHash = engine && engine.mod === mod && engine.ctx === ctx ? engine.msPerHash : 0;
+    return { mod, ctx, scan, results, ways, scanned, counted, msPerHash };
+}
 
-    cn._free(inputPtr);
-    cn._free(outputPtr);
+// Arm a context's scans with the control word at this job's generation
+function armControl(setHostControl, ctx) {
+    if (control && jobGeneration && setHostControl) setHostControl(ctx, jobGeneration);
+}
 
-    // Report stats periodically (log every 10th batch to avoid console spam)
-    if (nonceCounter % 640 === 0) {
-        console.log(`[Worker ${workerId}] Hashrate: ${hashrate.toFixed(2)} H/s, Total: ${totalHashes}, Shares: ${acceptedShares}`);
+// Count a context's scans into this worker's stats slot; false when the
+// page or the build has no shared counters
+function armStats(setHostStats, ctx) {
+    if (!stats || !setHostStats) return false;
+    setHostStats(ctx, statsSlot);
+    return true;
+}
+
+// Hand a new job to the kernel: the blob goes through the job slot into
+// the context once (cn_ctx_set_job precomputes the nonce-independent
+// Keccak work) and the target becomes the 64-bit threshold cn_ctx_scan()
+// compares against.
+// Jobs without an "algo" field are cn/0.  cn/r jobs carry the block
+// height, which picks (and on first sight compiles) the program to run.
+function setJob(job) {
+    const algoName = job.algo || 'cn/0';
+    if (pool) {
+        setPoolJob(job, algoName);
+        return;
+    }
+    if (algoName === 'rx/0') {
+        setRxJob(job);
+        return;
+    }
+    if (!useAlgo(algoId(algoName))) {
+        jobReady = false;
+        console.warn(`[Worker ${workerId}] Job ${job.job_id}: unsupported algo ${algoName}`);
+        return;
+    }
+    if (job.height !== undefined && cn._cn_ctx_set_height) {
+        cn._cn_ctx_set_height(cnCtx, BigInt(job.height));
+    }
+    const slot = loadJob(cn, job);
+    jobTarget64 = slotTarget64(cn, job);
+    jobReady = cn._cn_ctx_set_job(cnCtx, slot, job.blob.length) !== 0;
+    armControl(cn._cn_ctx_set_host_control, cnCtx);
+    engine = newEngine(cn, cnCtx, cn._cn_ctx_scan, resultsPtr, hashWays, cn._cn_ctx_scanned,
+                       armStats(cn._cn_ctx_set_host_stats, cnCtx));
+    if (!jobReady) console.warn(`[Worker ${workerId}] Job ${job.job_id}: unusable blob (${job.blob.length} bytes)`);
+}
+
+// Pool mode: every thread drops its batch, mid-hash, and switches to the
+// job (cn_pool keeps its own control word).  rx/0 has no pooled build;
+// the adapter sends those jobs elsewhere.
+function setPoolJob(job, algoName) {
+    const algo = algoId(algoName);
+    const slot = loadJob(cn, job);
+    const target64 = algo < 0 ? 0n : slotTarget64(cn, job);
+    poolJobId = 0;
+    if (algo >= 0 && target64 !== 0n) {
+        poolJobId = cn._cn_pool_set_job(pool, algo, slot, job.blob.length, target64, BigInt(job.height || 0), 0);
+    }
+    jobReady = poolJobId !== 0;
+    if (!jobReady) {
+        cn._cn_pool_pause(pool);
+        console.warn(`[Worker ${workerId}] Job ${job.job_id}: unsupported algo ${algoName} or unusable blob`);
+    }
+}
+
+// Pool mode: forward the shares the threads queued and report the hash
+// count they reached since the last poll
+function pollPool() {
+    poolTimer = null;
+    if (!mining || !pool) return;
+
+    const found = cn._cn_pool_results(pool, poolResultsPtr, POOL_MAX_RESULTS);
+    const heap = heapU8(cn);
+    const view = new DataView(heap.buffer);
+    for (let r = 0; r < found; r++) {
+        const rec = poolResultsPtr + r * POOL_RESULT_SIZE;
+        if (view.getUint32(rec, true) !== poolJobId) continue;  // an earlier job's
+        postShare(view.getUint32(rec + 4, true), heap.slice(rec + 8, rec + 40));
+    }
+
+    const hashes = Number(cn._cn_pool_hashes(pool));
+    const busyNs = Number(cn._cn_pool_busy_ns(pool));
+    const now = performance.now();
+    const batchHashes = hashes - poolHashes;
+    if (poolPolled) {
+        const ms = Math.max(now - poolPolled, 1);
+        hashrate = batchHashes * 1000 / ms;
+        usage.value = (busyNs - poolBusyNs) / 1e6 / (ms * cn._cn_pool_threads(pool));
+    }
+    poolHashes = hashes;
+    poolBusyNs = busyNs;
+    poolPolled = now;
+    totalHashes += batchHashes;
+    if (stats && cn._cn_pool_stats) {
+        poolTimer = setTimeout(pollPool, POOL_POLL_MS);  // the adapter reads cn_pool_stats()
+        return;
     }
-    
     postMessage({
         type: 'stats',
         hashrate: hashrate,
         totalHashes: totalHashes,
         acceptedShares: acceptedShares,
-        batchHashes: batchSize
+        batchHashes: batchHashes,
+        duty: duty,
+        utilisation: usage.value
+    });
+    poolTimer = setTimeout(pollPool, POOL_POLL_MS);
+}
+
+function postShare(nonce, hashBytes) {
+    const nonceHex = [
+        (nonce & 0xFF).toString(16).padStart(2, '0'),
+        ((nonce >> 8) & 0xFF).toString(16).padStart(2, '0'),
+        ((nonce >> 16) & 0xFF).toString(16).padStart(2, '0'),
+        ((nonce >>> 24) & 0xFF).toString(16).padStart(2, '0')
+    ].join('');
+
+    postMessage({
+        type: 'share',
+        nonce: nonceHex,
+        result: bytesToHex(hashBytes),
+        job_id: currentJob.job_id
     });
+    acceptedShares++;
+}
 
-    // Continue mining with small delay to avoid UI freeze
+// One WASM call for the whole batch: nonce iteration, hashing and the
+// target check run in C, and only matching nonces/hashes come back.
+// Returns the nonces hashed: fewer than `count` when the control word
+// stopped the scan.
+function scanBatch(nonceBase, count) {
+    const { mod, ctx, scan, scanned, results } = engine;
+    let nonce = nonceBase >>> 0;
+    let done = 0;
+    while (done < count && mining) {
+        const left = count - done;
+        const found = scan(ctx, nonce, left, jobTarget64, results);
+        let last = -1;
+        for (let r = 0; r < found; r++) {
+            const rec = results + r * SCAN_RESULT_SIZE;
+            const heap = heapU8(mod);
+            last = new DataView(heap.buffer, rec, 4).getUint32(0, true);
+            postShare(last, heap.slice(rec + 4, rec + 36));
+        }
+        // Result buffer filled up: resume right after the last match
+        const full = found === SCAN_MAX_RESULTS;
+        const n = scanned ? scanned(ctx) : full ? ((last - nonce) >>> 0) + 1 : left;
+        done += n;
+        nonce = (nonce + n) >>> 0;
+        if (!full) break;
+    }
+    return done;
+}
+
+// Start mineLoop() unless a run is already pending.  The loop stops by
+// itself while the job can't be hashed (e.g. waiting for a RandomX cache).
+function scheduleMining() {
+    if (!mining) return;
+    if (pool) {
+        if (poolTimer === null) poolTimer = setTimeout(pollPool, 0);
+    } else if (loopTimer === null) {
+        loopTimer = setTimeout(mineLoop, 0);
+    }
+}
+
+// Nonces for the next batch: sliceMs at the measured hash rate, in whole
+// kernel calls; one call to measure it first.  Below 100% the governor
+// lengthens batches, to at most two slices, until the sleep after them is
+// at least GOVERNOR_MIN_SLEEP_MS, since setTimeout() is only accurate to
+// a few ms (more in background tabs).
+function nextBatch() {
+    const { ways, msPerHash } = engine;
+    if (!msPerHash) return ways;
+    let busyMs = sliceMs;
+    if (duty < 1) {
+        busyMs = Math.max(busyMs, Math.min(2 * sliceMs, GOVERNOR_MIN_SLEEP_MS * duty / (1 - duty)));
+    }
+    const calls = Math.max(1, Math.ceil(busyMs / (msPerHash * ways)));
+    return Math.min(MAX_BATCH, calls * ways);
+}
+
+// Sleep after a batch that took `busyMs`: the batch's share of idle time
+// plus whatever is still owed.  mineLoop() subtracts the time it actually
+// slept, so late timers are repaid by shorter sleeps later.
+function governorSleep(busyMs) {
+    usage.busy += busyMs;
+    owedMs = Math.max(owedMs + busyMs * (1 - duty) / duty, -busyMs);
+    return Math.max(0, owedMs);
+}
+
+// Achieved utilisation, measured from batch start to batch start (whole
+// batch + sleep cycles) over at least USAGE_WINDOW_MS
+function measureUsage(now) {
+    if (!usage.start) {
+        usage.start = now;
+    } else if (now - usage.start >= USAGE_WINDOW_MS) {
+        usage.value = usage.busy / (now - usage.start);
+        usage.start = now;
+        usage.busy = 0;
+    }
+}
+
+function mineLoop() {
+    loopTimer = null;
+    if (sleepStart) {
+        owedMs -= performance.now() - sleepStart;
+        sleepStart = 0;
+    }
+    if (!mining || !currentJob || !jobReady || !wasmReady || !cn) {
+        usage.start = usage.busy = 0;  // idle time isn't throttling
+        return;
+    }
+
+    const batchSize = nextBatch();
+    // Use worker-specific nonce range to avoid collisions across workers
+    const nonceBase = (workerId * 0x10000000) + nonceCounter;
+    nonceCounter += batchSize;
+    const startTime = performance.now();
+    measureUsage(startTime);
+
+    const hashed = scanBatch(nonceBase, batchSize);
+
+    totalHashes += hashed;
+    const busyMs = performance.now() - startTime;
+    const elapsed = busyMs / 1000;
+    hashrate = elapsed > 0 ? (hashed / elapsed) : 0;
+    if (hashed) {
+        const msPerHash = busyMs / hashed;
+        engine.msPerHash = engine.msPerHash ? (engine.msPerHash + msPerHash) / 2 : msPerHash;
+    }
+
+    const sleepMs = governorSleep(busyMs);
+    // hashrate is while hashing; the throttled rate is hashrate × utilisation
+    hashrate *= Math.min(1, busyMs / (busyMs + sleepMs));
+
+    // Report stats periodically (log every ~10 s to avoid console spam)
+    if (startTime - lastLog > 10000) {
+        lastLog = startTime;
+        console.log(`[Worker ${workerId}] Hashrate: ${hashrate.toFixed(2)} H/s, Total: ${totalHashes}, Shares: ${acceptedShares}, CPU ${(usage.value * 100).toFixed(0)}% of ${(duty * 100).toFixed(0)}%`);
+    }
+    
+    // The kernel counted this batch into the adapter's stats already
+    if (!engine.counted) {
+        postMessage({
+            type: 'stats',
+            hashrate: hashrate,
+            totalHashes: totalHashes,
+            acceptedShares: acceptedShares,
+            batchHashes: hashed,
+            duty: duty,
+            utilisation: usage.value
+        });
+    }
+
+    // Continue after the governor's sleep (0 at 100%: just yield for messages)
     if (mining) {
-        setTimeout(mineLoop, 10);
+        sleepStart = performance.now();
+        loopTimer = setTimeout(mineLoop, sleepMs);
     }
 }
 
@@ -159,21 +675,54 @@ self.onmessage = function(e) {
     const data = e.data || {};
 
     if (data.type === 'init') {
-        initWasm();
+        if (data.error) postMessage({ type: 'error', error: 'Failed to init WASM: ' + data.error });
+        else {
+            if (data.duty !== undefined) setDuty(data.duty);
+            if (data.slice !== undefined) setSlice(data.slice);
+            if (data.control) control = new Int32Array(data.control);
+            if (data.stats) {
+                stats = new BigInt64Array(data.stats);
+                statsSlot = data.statsSlot || 0;
+            }
+            initWasm(data.name, data.wasm, data.threads);
+        }
+    } else if (data.type === 'duty') {
+        setDuty(data.duty);
+    } else if (data.type === 'time_slice') {
+        setSlice(data.ms);
+    } else if (data.type === 'wasm_module') {
+        const waiter = moduleWaiters[data.name];
+        delete moduleWaiters[data.name];
+        if (waiter && data.error) waiter.reject(new Error(data.error));
+        else if (waiter) waiter.resolve(data.wasm);
     } else if (data.type === 'job') {
         // New job from pool (via main thread WebSocket)
-        currentJob = data.job;
+        currentJob = decodeJob(data.job, data.bytes);
+        jobGeneration = data.generation || 0;
         if (data.workerId !== undefined) workerId = data.workerId;
+        if (wasmReady) setJob(currentJob);
         if (data.totalWorkers !== undefined) totalWorkers = data.totalWorkers;
         nonceCounter = 0;  // Reset nonce counter for new job
-        console.log(`[Worker ${workerId}] Got job ${currentJob.job_id}, target=${currentJob.target}`);
+        console.log(`[Worker ${workerId}] Got job ${currentJob.job_id} (${currentJob.blob.length}-byte blob)`);
         // Only start mining if WASM is ready
-        if (wasmReady && !mining) {
+        if (wasmReady) {
             mining = true;
-            mineLoop();
+            scheduleMining();
         }
+    } else if (data.type === 'rx_cache_build') {
+        // This worker was picked to build the cache for data.seed
+        if (rx) buildRxCache(data.seed);
+    } else if (data.type === 'rx_cache') {
+        if (rx && data.seed !== rxSeed) importRxCache(data.seed, data.memory);
+    } else if (data.type === 'rx_cache_failed') {
+        // Ask again with the next rx/0 job
+        if (rxRequested === data.seed) rxRequested = '';
     } else if (data.type === 'stop') {
         mining = false;
+        if (pool) {
+            cn._cn_pool_pause(pool);
+            poolPolled = 0;  // no rate across the pause
+        }
         postMessage({ type: 'stopped' });
     } else if (data.type === 'stats') {
         postMessage({
@@ -181,7 +730,9 @@ self.onmessage = function(e) {
             hashrate: hashrate,
             totalHashes: totalHashes,
             acceptedShares: acceptedShares,
-            batchHashes: 0
+            batchHashes: 0,
+            duty: duty,
+            utilisation: usage.value
         });
     }
 };
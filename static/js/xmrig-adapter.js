@@ -1,50 +1,280 @@
 /**
  * Mining Adapter - bridges WASM CryptoNight workers with WebSocket Stratum proxy.
- * Checks for WASM availability, creates workers, manages WebSocket to Flask proxy.
+ * Compiles the WASM module once (cached in IndexedDB), creates workers that
+ * instantiate it, manages WebSocket to Flask proxy.
+ * Cross-origin isolated pages (app.py sends COOP/COEP) get "pool mode":
+ * one worker running the -pthread build, whose C thread pool hashes on
+ * every core in one shared memory.  Elsewhere, and for rx/0 jobs, each
+ * thread is its own worker with its own module instance; rx/0 gets only as
+ * many of those as the device's memory allows (see _rxThreads).
+ * Isolated pages also share a control word with every worker (see
+ * RealWasmMiner._control) that preempts hashing on a new job or pause,
+ * and statistics counters the kernels add to directly (see
+ * RealWasmMiner._sampleStats), read whenever the page asks for stats
+ * instead of being posted after every batch.
  */
 
+// Control word bit set on pause; the rest is the job generation
+const CONTROL_STOP = 0x80000000 | 0;
+
+// Shared statistics: per worker slot, the kernel's cn_stats (hashes,
+// shares, busy ns, end of the last scan in ns since the epoch)
+const STATS_FIELDS = 4;
+const STATS_SLOTS = 256;
+const STATS_SAMPLE_MS = 1000;   // shortest interval rates are measured over
+
+// Memory one rx/0 worker holds: its RandomX module's 256 MB cache,
+// scratchpad and heap
+const RX_WORKER_MB = 320;
+
+// Smallest module using a v128 instruction (i8x16.splat + i8x16.popcnt);
+// WebAssembly.validate() accepts it only where SIMD128 is supported.
+const WASM_SIMD_PROBE = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0,
+    10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+]);
+
+function wasmSimdSupported() {
+    try {
+        return typeof WebAssembly === 'object' && WebAssembly.validate(WASM_SIMD_PROBE);
+    } catch (e) {
+        return false;
+    }
+}
+
+// Compiled WASM modules, shared by all workers.  Each .wasm is compiled
+// once per page on the main thread and the WebAssembly.Module is posted
+// to the workers, which only instantiate it.  Compiled modules are kept
+// in IndexedDB keyed by the file's SHA-256 (from manifest.json, written by
+// the WASM build), so repeat visits skip download and compilation.
+// Browsers that can't store a Module there get the bytes cached instead.
+class WasmModuleCache {
+    constructor(base) {
+        this.base = base || '/static/wasm/';
+        this.modules = {};      // name → Promise<WebAssembly.Module>
+        this.manifest = null;   // Promise<{ "<name>.wasm": sha256 hex }>
+        this.db = null;         // Promise<IDBDatabase | null>
+    }
+
+    // Promise of the compiled module for '<name>.wasm'
+    get(name) {
+        if (!this.modules[name]) {
+            this.modules[name] = this._load(name);
+            this.modules[name].catch(() => { delete this.modules[name]; });
+        }
+        return this.modules[name];
+    }
+
+    // File names the build published ({} for deployments without a manifest)
+    has(name) {
+        return this._manifest().then(m => Object.keys(m).length === 0 || (name + '.wasm') in m);
+    }
+
+    async _load(name) {
+        const t0 = performance.now();
+        const url = this.base + name + '.wasm';
+        let hash = (await this._manifest())[name + '.wasm'];
+        if (hash) {
+            const cached = await this._fromDb(name, hash);
+            if (cached) {
+                console.log(`🧩 ${name}.wasm from IndexedDB (${(performance.now() - t0).toFixed(0)} ms)`);
+                return cached;
+            }
+        }
+
+        const resp = await fetch(url);
+        if (!resp.ok) throw new Error(`${url}: HTTP ${resp.status}`);
+        // Compile while the bytes stream in; the bytes are still needed for
+        // the content hash (no manifest) and for browsers that can't store
+        // a Module in IndexedDB
+        const [streamed, bytes] = await Promise.all([
+            WebAssembly.compileStreaming ? WebAssembly.compileStreaming(resp.clone()).catch(() => null) : null,
+            resp.arrayBuffer()
+        ]);
+        if (!hash) {
+            hash = await sha256Hex(bytes);
+            const cached = await this._fromDb(name, hash);
+            if (cached) return cached;
+        }
+        const module = streamed || await WebAssembly.compile(bytes);
+        console.log(`🧩 ${name}.wasm compiled (${(performance.now() - t0).toFixed(0)} ms)`);
+        this._toDb(name, hash, module, bytes);
+        return module;
+    }
+
+    _manifest() {
+        if (!this.manifest) {
+            this.manifest = fetch(this.base + 'manifest.json', { cache: 'no-cache' })
+                .then(r => r.ok ? r.json() : {})
+                .catch(() => ({}));
+        }
+        return this.manifest;
+    }
+
+    _open() {
+        if (!this.db) {
+            this.db = new Promise(resolve => {
+                if (typeof indexedDB === 'undefined') return resolve(null);
+                const req = indexedDB.open('wasm-modules', 1);
+                req.onupgradeneeded = () => req.result.createObjectStore('modules');
+                req.onsuccess = () => resolve(req.result);
+                req.onerror = () => resolve(null);
+            });
+        }
+        return this.db;
+    }
+
+    // Cached entry for name@hash as a Module, or null
+    async _fromDb(name, hash) {
+        const db = await this._open();
+        if (!db) return null;
+        const entry = await new Promise(resolve => {
+            const req = db.transaction('modules').objectStore('modules').get(name);
+            req.onsuccess = () => resolve(req.result);
+            req.onerror = () => resolve(null);
+        });
+        if (!entry || entry.hash !== hash) return null;
+        try {
+            return entry.module || await WebAssembly.compile(entry.bytes);
+        } catch (e) {
+            return null;
+        }
+    }
+
+    // One entry per name, replaced when the file's hash changes.  Storing a
+    // Module throws DataCloneError where the browser doesn't support it.
+    async _toDb(name, hash, module, bytes) {
+        const db = await this._open();
+        if (!db) return;
+        for (const entry of [{ hash, module }, { hash, bytes }]) {
+            try {
+                await new Promise((resolve, reject) => {
+                    const tx = db.transaction('modules', 'readwrite');
+                    tx.objectStore('modules').put(entry, name);
+                    tx.oncomplete = resolve;
+                    tx.onerror = tx.onabort = () => reject(tx.error);
+                });
+                return;
+            } catch (e) {
+                // DataCloneError for the Module: fall through to the bytes
+            }
+        }
+    }
+}
+
+async function sha256Hex(bytes) {
+    const digest = await crypto.subtle.digest('SHA-256', bytes);
+    return Array.from(new Uint8Array(digest)).map(b => b.toString(16).padStart(2, '0')).join('');
+}
+
+function hexToBytes(hex) {
+    const bytes = new Uint8Array(hex.length >> 1);
+    for (let i = 0; i < bytes.length; i++) bytes[i] = parseInt(hex.substr(2 * i, 2), 16);
+    return bytes;
+}
+
+// A stratum job as the workers take it, decoded once per job: the blob
+// and the target's bytes back to back in `bytes` (blobLength splits
+// them), and the other fields they use in `meta`.  Each worker gets its
+// own copy of `bytes` as a transferred ArrayBuffer.
+function encodeJob(job) {
+    const blob = hexToBytes(job.blob || '');
+    const target = hexToBytes(job.target || '');
+    const bytes = new Uint8Array(blob.length + target.length);
+    bytes.set(blob);
+    bytes.set(target, blob.length);
+    const meta = {
+        job_id: job.job_id,
+        algo: job.algo,
+        height: job.height,
+        seed_hash: job.seed_hash,
+        blobLength: blob.length
+    };
+    return { job, meta, bytes };
+}
+
 (async function(){
     window.RealWasmAvailable = false;
     window.RealMiner = null;
 
     try {
-        // Check if WASM files exist
-        const [wasmResp, jsResp] = await Promise.all([
-            fetch('/static/wasm/cryptonight.wasm', { method: 'HEAD' }),
-            fetch('/static/wasm/cryptonight.js', { method: 'HEAD' })
-        ]);
-
-        if (wasmResp.ok && jsResp.ok) {
-            window.RealWasmAvailable = true;
-            console.log('✅ CryptoNight WASM found: Real mining available');
+        // Compile up front: by the time the user starts mining, workers
+        // only have to instantiate.  Prefer the -msimd128 build when the
+        // browser can run it and the build published it.
+        const modules = new WasmModuleCache();
+        let wasmModule = 'cryptonight';
+        if (wasmSimdSupported() && await modules.has('cryptonight-simd')) {
+            try {
+                await modules.get('cryptonight-simd');
+                wasmModule = 'cryptonight-simd';
+            } catch (e) {}
+        }
+        if (wasmModule === 'cryptonight') await modules.get('cryptonight');
 
-            window.RealMiner = new RealWasmMiner();
-        } else {
-            console.log('ℹ️ WASM not present; demo mode will be used');
+        // SharedArrayBuffer needs cross-origin isolation; without it (or
+        // without a -pthread build) each thread gets its own module
+        let poolModule = null;
+        const mt = wasmModule.replace('cryptonight', 'cryptonight-mt');
+        if (self.crossOriginIsolated && typeof SharedArrayBuffer === 'function' && await modules.has(mt)) {
+            try {
+                await modules.get(mt);
+                poolModule = mt;
+            } catch (e) {}
         }
+
+        window.RealWasmAvailable = true;
+        console.log(`✅ CryptoNight WASM ready (${poolModule || wasmModule}): Real mining available`);
+        window.RealMiner = new RealWasmMiner(wasmModule, modules, poolModule);
     } catch (e) {
-        console.warn('ℹ️ Error checking for WASM files:', e);
+        console.log('ℹ️ WASM not available; demo mode will be used:', e.message || e);
     }
 })();
 
 
 class RealWasmMiner {
-    constructor() {
-        this.workers = [];
+    constructor(wasmModule, modules, poolModule) {
+        this.wasmModule = wasmModule || 'cryptonight';  // 'cryptonight' or 'cryptonight-simd'
+        this.modules = modules || new WasmModuleCache();
+        this.poolModule = poolModule || null;  // -pthread build for pool mode
+        this.poolWorker = null;  // pool mode: the one worker hashing CryptoNight jobs
+        this.workers = [];       // one per thread; in pool mode only for rx/0 jobs
         this.ws = null;
         this.running = false;
         this.threads = 1;
         this.workerHashrates = {};  // per-worker hashrate tracking
+        this.workerUsage = {};      // per-worker achieved utilisation (0..1)
+        this.duty = 1;              // requested utilisation, 1 - opts.throttle
+        this.timeSlice = 250;       // ms per hashing batch: bounds job-switch latency
+        this.utilisation = 0;       // achieved, averaged over workers
+        // Job generation and stop bit in shared memory: the kernels read it
+        // mid-hash, so a new job or a pause ends batches in flight instead
+        // of waiting up to a time slice for the next message
+        this.control = self.crossOriginIsolated && typeof SharedArrayBuffer === 'function'
+            ? new Int32Array(new SharedArrayBuffer(4)) : null;
+        this.generation = 0;
+        // Hashing counters in shared memory, STATS_FIELDS per worker (its
+        // index); the pool worker's live in its own module's memory
+        this.stats = this.control ? new BigInt64Array(new SharedArrayBuffer(8 * STATS_FIELDS * STATS_SLOTS)) : null;
+        this.counters = {};         // workerId → { view, index, threads, last: counters at the last sample }
+        this.sampledAt = 0;         // performance.now() of the last sample
+        this.sharesFound = 0;       // shares the kernels reported (acceptedShares: submitted)
+        this.lastHashAt = 0;        // Date.now() time of the latest counted scan
         this.hashrate = 0;
         this.totalHashes = 0;
         this.acceptedShares = 0;
         this.currentJob = null;
+        this.encodedJob = null;     // encodeJob(currentJob)
         this._reconnecting = false;
         this.userWallet = '';  // user's XMR wallet for 85% rewards
+        // RandomX cache for the current seed hash: one worker builds it,
+        // the others get a copy of its memory instead of rebuilding
+        this.rxCache = this._newRxCache(null);
     }
 
     async start(opts) {
         this.threads = opts.threads || navigator.hardwareConcurrency || 2;
+        this.duty = Math.min(1, Math.max(0.01, 1 - (opts.throttle || 0)));
+        if (opts.timeSlice) this.timeSlice = opts.timeSlice;
         this.running = true;
         this.userWallet = opts.userWallet || '';
 
@@ -74,15 +304,11 @@ class RealWasmMiner {
                 // Request current job
                 this.ws.send(JSON.stringify({ type: 'get_job' }));
                 // Start workers if we don't have them already
-                if (this.workers.length === 0) {
+                if (this.workers.length === 0 && !this.poolWorker) {
                     this._startWorkers();
-                } else {
+                } else if (this.currentJob) {
                     // If workers exist and we already have a job cached, forward it
-                    if (this.currentJob) {
-                        this.workers.forEach((w, idx) => {
-                            try { w.postMessage({ type: 'job', job: this.currentJob, workerId: idx, totalWorkers: this.threads }); } catch(e) {}
-                        });
-                    }
+                    this._sendJob();
                 }
                 resolve();
             };
@@ -128,53 +354,284 @@ class RealWasmMiner {
     }
 
     _startWorkers() {
+        if (this.poolModule) {
+            this.poolWorker = this._createWorker('pool', this.poolModule, { threads: this.threads, ...this._governor(0) });
+            console.log(`🧵 Pool mode: ${this.threads} threads in one shared module`);
+            return;
+        }
         for (let i = 0; i < this.threads; i++) {
-            const worker = new Worker('/static/js/xmr-wasm-worker.js');
-            const workerId = i;
-
-            worker.onmessage = (e) => {
-                const data = e.data;
-                if (data.type === 'ready') {
-                    console.log(`Worker ${workerId} ready`);
-                    // Send current job if available
-                    if (this.currentJob) {
-                        worker.postMessage({ type: 'job', job: this.currentJob, workerId: workerId, totalWorkers: this.threads });
-                    }
-                } else if (data.type === 'share') {
-                    // Forward share to pool via WebSocket
-                    if (this.ws && this.ws.readyState === WebSocket.OPEN) {
-                        this.ws.send(JSON.stringify({
-                            type: 'submit',
-                            nonce: data.nonce,
-                            result: data.result,
-                            job_id: data.job_id
-                        }));
-                        console.log(`⛏️ Share from worker ${workerId}: nonce=${data.nonce}`);
-                    }
-                    this.acceptedShares++;
-                } else if (data.type === 'stats') {
-                    // Aggregate hashrate from all workers
-                    this.workerHashrates[workerId] = data.hashrate || 0;
-                    let total = 0;
-                    for (const key in this.workerHashrates) {
-                        total += this.workerHashrates[key];
-                    }
-                    this.hashrate = total;
-                    this.totalHashes += data.batchHashes || 0;
-                    
-                    // Log aggregated hashrate periodically (every ~5 seconds)
-                    if (!this._lastHashrateLog || (Date.now() - this._lastHashrateLog) > 5000) {
-                        console.log(`💎 Total Hashrate: ${this.hashrate.toFixed(2)} H/s (${this.threads} workers)`);
-                        this._lastHashrateLog = Date.now();
-                    }
-                } else if (data.type === 'error') {
-                    console.error(`Worker ${workerId} error:`, data.error);
+            this.workers.push(this._createWorker(i, this.wasmModule, this._governor(i)));
+        }
+    }
+
+    // Requested CPU utilisation (0.01..1) for every worker; each one
+    // governs its own duty cycle and reports what it achieved
+    setDuty(duty) {
+        this.duty = Math.min(1, Math.max(0.01, duty));
+        this._allWorkers().forEach(w => w.postMessage({ type: 'duty', duty: this.duty }));
+    }
+
+    // Duration of each hashing batch in ms: a new job reaches the kernel
+    // within about that long; longer slices spend less on per-call overhead
+    setTimeSlice(ms) {
+        this.timeSlice = ms;
+        this._allWorkers().forEach(w => w.postMessage({ type: 'time_slice', ms }));
+    }
+
+    // Init fields for worker `slot`: governor settings and shared memory
+    _governor(slot) {
+        return { duty: this.duty, slice: this.timeSlice, control: this.control && this.control.buffer,
+                 stats: this.stats && this.stats.buffer, statsSlot: slot };
+    }
+
+    // Preempt the workers' hashing: `job` starts a new generation, anything
+    // else sets the stop bit until the next job.  Returns the generation
+    // job messages carry (0 without a control word).
+    _control(job) {
+        if (!this.control) return 0;
+        if (job) {
+            this.generation = this.generation % 0x7fffffff + 1;
+            Atomics.store(this.control, 0, this.generation);
+        } else {
+            Atomics.or(this.control, 0, CONTROL_STOP);
+        }
+        return this.generation;
+    }
+
+    _createWorker(workerId, moduleName, init) {
+        const worker = new Worker('/static/js/xmr-wasm-worker.js');
+        if (this.stats && typeof workerId === 'number' && !this.counters[workerId]) {
+            this._addCounters(workerId, this.stats, workerId * STATS_FIELDS, 1);
+        }
+
+        worker.onmessage = (e) => {
+            const data = e.data;
+            if (data.type === 'ready') {
+                console.log(`Worker ${workerId} ready`);
+                // Send current job if available
+                if (this.currentJob) this._sendJob(worker);
+            } else if (data.type === 'share') {
+                // Forward share to pool via WebSocket
+                if (this.ws && this.ws.readyState === WebSocket.OPEN) {
+                    this.ws.send(JSON.stringify({
+                        type: 'submit',
+                        nonce: data.nonce,
+                        result: data.result,
+                        job_id: data.job_id
+                    }));
+                    console.log(`⛏️ Share from worker ${workerId}: nonce=${data.nonce}`);
                 }
-            };
+                this.acceptedShares++;
+            } else if (data.type === 'stats') {
+                // Worker without shared counters: aggregate hashrate from all workers
+                this.workerHashrates[workerId] = data.hashrate || 0;
+                this.totalHashes += data.batchHashes || 0;
+                if (data.utilisation) this.workerUsage[workerId] = data.utilisation;
+                this._aggregate();
+            } else if (data.type === 'stats_memory') {
+                // Pool mode: its threads' cn_stats, in the module's shared memory
+                this._addCounters(workerId, new BigInt64Array(data.memory, data.offset, STATS_FIELDS), 0, this.threads);
+            } else if (data.type === 'wasm_module_request') {
+                this._sendModule(worker, data.name);
+            } else if (data.type === 'rx_cache_request') {
+                this._rxCacheRequest(worker, data.seed);
+            } else if (data.type === 'rx_cache') {
+                this._rxCacheBuilt(data.seed, data.memory);
+            } else if (data.type === 'rx_cache_failed') {
+                this._rxCacheFailed(data.seed, data.error);
+            } else if (data.type === 'stopped') {
+                delete this.workerHashrates[workerId];
+                delete this.workerUsage[workerId];
+            } else if (data.type === 'error') {
+                console.error(`Worker ${workerId} error:`, data.error);
+            }
+        };
 
-            worker.postMessage({ type: 'init' });
-            this.workers.push(worker);
+        this._sendModule(worker, moduleName, 'init', init);
+        return worker;
+    }
+
+    // Sample the counters at `index` of `view` for worker `workerId`, over
+    // `threads` hashing threads, from their current values on
+    _addCounters(workerId, view, index, threads) {
+        this.counters[workerId] = { view, index, threads, last: this._readCounters(view, index) };
+    }
+
+    _readCounters(view, index) {
+        const read = i => Number(Atomics.load(view, index + i));
+        return { hashes: read(0), shares: read(1), busyNs: read(2), lastNs: read(3) };
+    }
+
+    // Fold what the kernels counted since the last sample into the totals,
+    // rates and utilisation.  Sampled when the page reads stats, at most
+    // every STATS_SAMPLE_MS unless `force`d; workers still reporting by
+    // message (no shared memory, older builds) keep their own entries.
+    _sampleStats(force) {
+        const now = performance.now();
+        if (!this.sampledAt) this.sampledAt = now;
+        const ms = now - this.sampledAt;
+        if (ms < STATS_SAMPLE_MS && !force) return;
+        this.sampledAt = now;
+        let counted = false;
+        for (const workerId in this.counters) {
+            const c = this.counters[workerId];
+            const cur = this._readCounters(c.view, c.index);
+            const hashes = cur.hashes - c.last.hashes;
+            const busyNs = cur.busyNs - c.last.busyNs;
+            this.totalHashes += hashes;
+            this.sharesFound += cur.shares - c.last.shares;
+            this.lastHashAt = Math.max(this.lastHashAt, cur.lastNs / 1e6);
+            c.last = cur;
+            if (!hashes && !busyNs) {
+                // Idle (paused, or not the kind of job it hashes)
+                if (this.workerHashrates[workerId]) counted = true;
+                delete this.workerHashrates[workerId];
+                delete this.workerUsage[workerId];
+                continue;
+            }
+            counted = true;
+            if (ms > 0) {
+                this.workerHashrates[workerId] = hashes * 1000 / ms;
+                this.workerUsage[workerId] = busyNs / 1e6 / (ms * c.threads);
+            }
         }
+        if (counted) this._aggregate();
+    }
+
+    // Totals over the per-worker rates, by message or sampled
+    _aggregate() {
+        let total = 0;
+        for (const key in this.workerHashrates) {
+            total += this.workerHashrates[key];
+        }
+        this.hashrate = total;
+        const usage = Object.values(this.workerUsage);
+        this.utilisation = usage.length ? usage.reduce((a, b) => a + b, 0) / usage.length : 0;
+
+        // Log aggregated hashrate periodically (every ~5 seconds)
+        if (!this._lastHashrateLog || (Date.now() - this._lastHashrateLog) > 5000) {
+            console.log(`💎 Total Hashrate: ${this.hashrate.toFixed(2)} H/s (${this.threads} workers, CPU ${(this.utilisation * 100).toFixed(0)}% of ${(this.duty * 100).toFixed(0)}%)`);
+            this._lastHashrateLog = Date.now();
+        }
+    }
+
+    // Post the compiled module `name` to a worker (type 'init' starts it,
+    // with `extra` fields such as the pool's thread count);
+    // Modules are shared with workers, not copied or recompiled
+    _sendModule(worker, name, type, extra) {
+        this.modules.get(name).then(
+            wasm => worker.postMessage({ type: type || 'wasm_module', name, wasm, ...extra }),
+            e => worker.postMessage({ type: type || 'wasm_module', name, error: e.message || String(e) })
+        );
+    }
+
+    // Forward the current job, in binary (see encodeJob()), to `only` or to
+    // every worker that should hash it.  In pool mode rx/0 jobs (no pooled
+    // build) pause the pool and go to per-thread workers, created the first
+    // time one comes in; CryptoNight jobs stop those again.
+    _sendJob(only) {
+        const job = this.currentJob;
+        if (!this.encodedJob || this.encodedJob.job !== job) this.encodedJob = encodeJob(job);
+        const { meta, bytes } = this.encodedJob;
+        const generation = only ? this.generation : this._control(true);
+        const rx = job.algo === 'rx/0';
+        let hashers = this.workers;
+        let idle = [];
+        if (this.poolWorker) {
+            if (rx && this.workers.length === 0) {
+                for (let i = 0; i < this._rxThreads(); i++) {
+                    this.workers.push(this._createWorker(i, this.wasmModule, this._governor(i)));
+                }
+            }
+            idle = rx ? [this.poolWorker] : this.workers;
+            hashers = rx ? this.workers : [this.poolWorker];
+        } else if (rx) {
+            hashers = this.workers.slice(0, this._rxThreads());
+            idle = this.workers.slice(hashers.length);
+        }
+        if (!only) idle.forEach(w => w.postMessage({ type: 'stop' }));
+        hashers.forEach((w, idx) => {
+            if (only && w !== only) return;
+            const pooled = w === this.poolWorker;
+            const copy = bytes.slice().buffer;
+            try {
+                w.postMessage({ type: 'job', job: meta, bytes: copy, generation,
+                                workerId: pooled ? 0 : idx, totalWorkers: pooled ? 1 : this.threads }, [copy]);
+            } catch (e) {}
+        });
+    }
+
+    // Workers that hash rx/0 jobs: every thread, but each holds its own
+    // RandomX module, so no more than fit in half the device's memory
+    // (navigator.deviceMemory, in GB, where the browser reports it)
+    _rxThreads() {
+        const gb = navigator.deviceMemory;
+        if (!gb) return this.threads;
+        return Math.max(1, Math.min(this.threads, Math.floor(gb * 1024 / 2 / RX_WORKER_MB)));
+    }
+
+    // `memory`: the built cache, until every rx/0 worker has a copy;
+    // `served`: workers that have it
+    _newRxCache(seed) {
+        return { seed, memory: null, building: false, waiting: [], served: 0 };
+    }
+
+    // A worker needs the RandomX cache for `seed`: send the memory if we have
+    // it, let the first requester build it, queue the rest until it's built.
+    _rxCacheRequest(worker, seed) {
+        const rc = this.rxCache;
+        if (rc.seed !== seed) {
+            // New seed hash (every 2048 blocks): drop the old cache
+            this.rxCache = this._newRxCache(seed);
+            return this._rxCacheRequest(worker, seed);
+        }
+        if (rc.memory) {
+            this._rxCacheSend(worker);
+        } else if (!rc.building) {
+            rc.building = true;
+            console.log(`🧱 Building RandomX cache for seed ${seed.slice(0, 16)}…`);
+            worker.postMessage({ type: 'rx_cache_build', seed });
+        } else {
+            rc.waiting.push(worker);
+        }
+    }
+
+    // The builder's copy of the cache: a SharedArrayBuffer on isolated
+    // pages, else an ArrayBuffer it transferred to us
+    _rxCacheBuilt(seed, memory) {
+        const rc = this.rxCache;
+        if (rc.seed !== seed) return;  // seed changed while it was built
+        rc.memory = memory;
+        rc.building = false;
+        rc.served = 1;                 // the builder
+        const waiting = rc.waiting;
+        rc.waiting = [];
+        waiting.forEach(w => this._rxCacheSend(w));
+        if (rc.served >= this._rxThreads()) rc.memory = null;
+    }
+
+    // Post the cache to a worker, which copies it into its module.  Shared
+    // memory goes as is; otherwise every worker gets a transferred copy,
+    // the last one the buffer itself.  Once every rx/0 worker has the
+    // cache it is dropped here: a worker that asks later rebuilds it.
+    _rxCacheSend(worker) {
+        const rc = this.rxCache;
+        const last = ++rc.served >= this._rxThreads();
+        let memory = rc.memory;
+        const shared = typeof SharedArrayBuffer === 'function' && memory instanceof SharedArrayBuffer;
+        if (!shared && !last) memory = memory.slice(0);
+        worker.postMessage({ type: 'rx_cache', seed: rc.seed, memory }, shared ? [] : [memory]);
+        if (last) rc.memory = null;
+    }
+
+    // The builder couldn't build the cache: the workers waiting for it ask
+    // again (and one of them builds) with their next rx/0 job
+    _rxCacheFailed(seed, error) {
+        const rc = this.rxCache;
+        if (rc.seed !== seed) return;
+        console.error(`RandomX cache for seed ${seed.slice(0, 16)}… failed:`, error);
+        rc.waiting.forEach(w => w.postMessage({ type: 'rx_cache_failed', seed }));
+        this.rxCache = this._newRxCache(null);
     }
 
     _handlePoolMessage(msg) {
@@ -183,9 +640,7 @@ class RealWasmMiner {
             this.currentJob = msg.params;
             console.log('📋 New job:', this.currentJob.job_id, 'target:', this.currentJob.target);
             // Forward to all workers
-            this.workers.forEach((w, idx) => {
-                w.postMessage({ type: 'job', job: this.currentJob, workerId: idx, totalWorkers: this.threads });
-            });
+            this._sendJob();
         }
         // Submit acknowledgement
         if (msg.type === 'submit_ack') {
@@ -195,7 +650,8 @@ class RealWasmMiner {
         if (msg.type === 'pause_mining') {
             console.log('⏸️ Pausing mining: wallet switch in progress');
             this.currentJob = null;
-            this.workers.forEach(w => {
+            this._control(false);
+            this._allWorkers().forEach(w => {
                 try { w.postMessage({ type: 'stop' }); } catch(e) {}
             });
         }
@@ -221,9 +677,7 @@ class RealWasmMiner {
         if (msg.result && typeof msg.result === 'object' && msg.result.job) {
             this.currentJob = msg.result.job;
             console.log('📋 Initial job:', this.currentJob.job_id, 'target:', this.currentJob.target);
-            this.workers.forEach((w, idx) => {
-                w.postMessage({ type: 'job', job: this.currentJob, workerId: idx, totalWorkers: this.threads });
-            });
+            this._sendJob();
         }
         // Pool error
         if (msg.error) {
@@ -231,27 +685,45 @@ class RealWasmMiner {
         }
     }
 
+    _allWorkers() {
+        return this.poolWorker ? [this.poolWorker, ...this.workers] : this.workers;
+    }
+
     stop() {
         this.running = false;
-        this.workers.forEach(w => {
+        this._control(false);
+        this._sampleStats(true);
+        delete this.counters.pool;  // dies with its module; per-worker slots carry on
+        this._allWorkers().forEach(w => {
             w.postMessage({ type: 'stop' });
             w.terminate();
         });
         this.workers = [];
+        this.poolWorker = null;
+        this.workerHashrates = {};
+        this.workerUsage = {};
+        // The next workers build their own cache
+        this.rxCache = this._newRxCache(null);
         if (this.ws) {
             this.ws.close();
             this.ws = null;
         }
     }
 
-    getHashrate() { return this.hashrate; }
-    getTotalHashes() { return this.totalHashes; }
+    getHashrate() { this._sampleStats(); return this.hashrate; }
+    getTotalHashes() { this._sampleStats(); return this.totalHashes; }
     getAcceptedShares() { return this.acceptedShares; }
+    getUtilisation() { this._sampleStats(); return { requested: this.duty, achieved: this.utilisation }; }
     getStats() {
+        this._sampleStats();
         return {
             hashrate: this.hashrate,
             totalHashes: this.totalHashes,
-            acceptedShares: this.acceptedShares
+            acceptedShares: this.acceptedShares,
+            sharesFound: this.sharesFound,
+            lastHashAt: this.lastHashAt,
+            duty: this.duty,
+            utilisation: this.utilisation
         };
     }
 }
\ No newline at end of file
@@ -11,6 +11,45 @@ import logging
 
 logger = logging.getLogger(__name__)
 
+U64_MAX = 0xFFFFFFFFFFFFFFFF
+
+
+# Share targets — mirrors cn_target_from_pool() / cn_target_from_difficulty()
+# / cn_check_hash() in wasm_src/cryptonight_impl.c, so the proxy accepts
+# exactly the results the browser kernel reports.
+
+def target_from_pool(target_hex):
+    """Stratum target hex → 64-bit threshold on the hash's last 8 bytes.
+    4 bytes: compact, (2^64-1) / ((2^32-1) / t); 8 bytes: LE threshold.
+    Returns 0 (nothing passes) for any other form."""
+    try:
+        raw = bytes.fromhex(target_hex or '')
+    except ValueError:
+        return 0
+    if len(raw) == 4:
+        t32 = int.from_bytes(raw, 'little')
+        return U64_MAX // (0xFFFFFFFF // t32) if t32 else 0
+    if len(raw) == 8:
+        return int.from_bytes(raw, 'little')
+    return 0
+
+
+def target_from_difficulty(difficulty):
+    """Difficulty → 64-bit threshold; 0 or 1 accepts every hash."""
+    difficulty = int(difficulty)
+    return U64_MAX if difficulty <= 1 else U64_MAX // difficulty
+
+
+def check_hash(result_hex, target64):
+    """True when the 32-byte result's last 8 bytes (LE) are below target64."""
+    try:
+        raw = bytes.fromhex(result_hex or '')
+    except ValueError:
+        return False
+    if len(raw) != 32:
+        return False
+    return int.from_bytes(raw[24:32], 'little') < target64
+
 
 class StratumSession:
     """
@@ -40,8 +79,6 @@ class StratumSession:
         self._recv_thread = None
         self._switch_thread = None
         self._buffer = ''
-        self._last_share_time = 0
-        self._share_interval = 2.0
         self._shares_submitted = 0
         self._shares_accepted = 0
         self._current_wallet = None   # which wallet is currently logged in
@@ -112,7 +149,7 @@ class StratumSession:
                 "login": wallet,
                 "pass": self.password,
                 "agent": "MineWithMe/1.0",
-                "algo": ["cn/r", "cn/0", "cn/1", "cn/2", "cn-lite/1", "rx/0"]
+                "algo": ["cn/r", "cn/0", "cn/1", "cn/2", "cn-lite/0", "cn-lite/1", "cn-heavy/0", "cn-pico", "rx/0"]
             }
         }
         self._send_to_pool(login_msg)
@@ -305,7 +342,7 @@ class StratumSession:
                 pass
 
     def submit_share(self, nonce, result_hash, job_id=None):
-        """Submit a found share to the pool (rate-limited)."""
+        """Submit a found share to the pool after checking it meets the job target."""
         if not self.connected:
             logger.warning("Pool disconnected, attempting reconnect for share submission")
             if not self.reconnect():
@@ -320,11 +357,12 @@ class StratumSession:
             logger.warning(f"Share rejected: stale job_id {job_id} != current {current_job_id}")
             return False
 
-        # Rate limit
-        now = time.time()
-        if now - self._last_share_time < self._share_interval:
+        # Every result that meets the target is forwarded; the check stops
+        # junk reaching the pool without dropping real shares.
+        target64 = target_from_pool(self.job.get('target'))
+        if not check_hash(result_hash, target64):
+            logger.warning(f"Share rejected: result does not meet target {self.job.get('target')}")
             return False
-        self._last_share_time = now
 
         submit = {
             "id": self._next_id(),
@@ -1,7 +1,8 @@
 /*
  * CryptoNight hash function - Self-contained implementation for WebAssembly
  * Based on the Monero reference implementation (portable C fallback).
- * Implements CryptoNight variant 0 (cn/0).
+ * Implements CryptoNight variants 0, 1, 2 and 4 (cn/0, cn/1, cn/2, cn/r)
+ * and the family members cn-lite/0, cn-lite/1, cn-heavy/0 and cn-pico.
  *
  * Copyright (c) 2012-2013 The CryptoNote developers
  * Copyright (c) 2014-2024 The Monero Project
@@ -28,8 +29,206 @@ extern "C" {
  */
 void cn_hash(const uint8_t *input, size_t len, uint8_t *output);
 
+/* Same for the other family members: cn/1 and cn/2 (Monero's variants 1
+ * and 2; cn/1 needs at least 43 bytes of input, shorter inputs hash to
+ * zeros), cn-lite/0 and /1 (1 MB scratchpad, 262144 iterations),
+ * cn-heavy/0 (4 MB, 262144 iterations, extra mixing and a division in the
+ * main loop) and cn-pico (256 KB, 65536 iterations, variant 2 rules).
+ */
+void cn_v1_hash(const uint8_t *input, uint32_t len, uint8_t *output);
+void cn_v2_hash(const uint8_t *input, uint32_t len, uint8_t *output);
+void cn_lite_hash(const uint8_t *input, uint32_t len, uint8_t *output);
+void cn_lite_v1_hash(const uint8_t *input, uint32_t len, uint8_t *output);
+void cn_heavy_hash(const uint8_t *input, uint32_t len, uint8_t *output);
+void cn_pico_hash(const uint8_t *input, uint32_t len, uint8_t *output);
+
+/* Reusable hashing context: owns the scratchpad (2 MB for cn/0), expanded
+ * AES keys and Keccak state, so hashing many nonces does no per-hash
+ * allocation.  A context must not be used by two threads at once.
+ */
+typedef struct cn_ctx cn_ctx;
+
+cn_ctx *cn_ctx_create(void);
+void    cn_ctx_hash(cn_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output);
+void    cn_ctx_destroy(cn_ctx *ctx);
+
+/* Multi-way hashing: a context created with ways = 2 or 4 owns that many
+ * scratchpads and runs the nonces' main loops interleaved so their cache
+ * misses overlap.  `input` holds 2 / 4 blobs back to back (stride
+ * input_len); `output` receives 32 bytes per blob.  With a context of
+ * fewer ways the blobs are hashed one after another.
+ */
+cn_ctx  *cn_ctx_create_ways(uint32_t ways);
+uint32_t cn_ctx_ways(const cn_ctx *ctx);
+
+/* Contexts for any family member.  Every hashing and scanning entry point
+ * works on the context's algorithm, each through its own constant-folded
+ * kernel.  cn_algo_by_name() maps a stratum algo name ("cn/0", "cn/1",
+ * "cn/2", "cn/r", "cn-lite/0", "cn-lite/1", "cn-heavy/0", "cn-pico") to
+ * its id, or -1.
+ */
+enum cn_algo_id {
+    CN_ALGO_CN0, CN_ALGO_LITE0, CN_ALGO_HEAVY0,
+    CN_ALGO_CN1, CN_ALGO_CN2, CN_ALGO_LITE1, CN_ALGO_PICO0,
+    CN_ALGO_R,
+    CN_ALGO_COUNT
+};
+
+int32_t     cn_algo_by_name(const char *name);
+cn_ctx     *cn_ctx_create_algo(uint32_t algo, uint32_t ways);
+const char *cn_ctx_algo_name(const cn_ctx *ctx);
+void     cn_hash_x2(cn_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output);
+void     cn_hash_x4(cn_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output);
+
+/* cn/r: each block height has its own random-math program, generated and
+ * compiled (x86-64 code natively, a small WebAssembly module in the
+ * browser) on first use and cached per context.  cn_ctx_set_height()
+ * selects the job's height; new contexts start at 0, other algorithms
+ * ignore it.  cn_set_r_jit(0) runs later programs through the
+ * interpreter instead.
+ */
+void cn_ctx_set_height(cn_ctx *ctx, uint64_t height);
+void cn_set_r_jit(int enable);
+
+/* Share targets.  A hash meets the target when its last 8 bytes, read as
+ * a LE uint64, are below a 64-bit threshold; these reduce the pool's forms
+ * to that threshold once per job.
+ *   cn_target_from_pool: hex-decoded stratum target, 4 bytes (compact,
+ *     threshold = (2^64-1) / ((2^32-1) / t)) or 8 bytes (LE threshold).
+ *     Returns 0 for any other length.
+ *   cn_target_from_difficulty: (2^64-1) / difficulty.
+ *   cn_check_hash: 1 when the 32-byte hash meets target64.
+ */
+uint64_t cn_target_from_pool(const uint8_t *target, uint32_t target_len);
+uint64_t cn_target_from_difficulty(uint64_t difficulty);
+int      cn_check_hash(const uint8_t *hash, uint64_t target64);
+
+/* Job setup: copies the hashing blob into the context and precomputes the
+ * nonce-independent part of the first Keccak round.  Returns 0 for blobs
+ * shorter than 43 or longer than CN_MAX_BLOB bytes.
+ */
+int cn_ctx_set_job(cn_ctx *ctx, const uint8_t *blob, uint32_t blob_len);
+
+/* Batch nonce search over the context's job: hashes `count` nonces from
+ * nonce_start (written LE at blob offset 39) and keeps only hashes that
+ * meet target64 (see cn_check_hash).  Each match is a 36-byte record at
+ * out_results: 4-byte LE nonce, then the 32-byte hash.  out_results must
+ * hold CN_SCAN_MAX_RESULTS records; the scan stops early when it is full.
+ * Returns the number of records written.
+ * scan_nonces() does the same for `blob`, setting it as the job first when
+ * it differs from the current one outside the nonce bytes.
+ */
+#define CN_MAX_BLOB          256
+#define CN_SCAN_RESULT_SIZE  36
+#define CN_SCAN_MAX_RESULTS  16
+
+uint32_t cn_ctx_scan(cn_ctx *ctx, uint32_t nonce_start, uint32_t count, uint64_t target64,
+                     uint8_t *out_results);
+uint32_t scan_nonces(cn_ctx *ctx, const uint8_t *blob, uint32_t blob_len,
+                     uint32_t nonce_start, uint32_t count, uint64_t target64,
+                     uint8_t *out_results);
+
+/* Preemption: a context armed with a control word checks it before every
+ * kernel call of a scan and every CN_CONTROL_INTERVAL main-loop
+ * iterations (1/32 of a cn/0 hash).  Once it no longer equals `expect`
+ * the hashes in flight are abandoned and the scan returns, so another
+ * thread ends a scan within a fraction of a hash; cn_ctx_hash() and
+ * friends hash to zeros instead.  The owner
+ * keeps a job generation there, bumped for every job, and or's in
+ * CN_CONTROL_STOP to pause.  `word` is in this module's memory (NULL
+ * disarms); cn_ctx_set_host_control() uses Module.control instead, an
+ * Int32Array over a SharedArrayBuffer the page shares with the worker
+ * (Emscripten builds; elsewhere it disarms).
+ * cn_ctx_scanned() is where the next scan resumes: the nonces the last one
+ * covered, `count` unless the results filled up (then up to the last
+ * record) or the control word stopped it.
+ */
+#define CN_CONTROL_STOP      0x80000000u
+#define CN_CONTROL_INTERVAL  0x4000
+
+void     cn_ctx_set_control(cn_ctx *ctx, const uint32_t *word, uint32_t expect);
+void     cn_ctx_set_host_control(cn_ctx *ctx, uint32_t expect);
+uint32_t cn_ctx_scanned(const cn_ctx *ctx);
+
+/* Statistics: a context given a cn_stats block adds every scan to it
+ * atomically (nonces covered, records reported, time spent, wall clock
+ * in ns since the epoch at its end), so other threads, or the page, read
+ * progress without being sent it.  Contexts may share a block; NULL stops
+ * counting.  cn_ctx_set_host_stats() counts into slot `slot` of
+ * Module.stats instead, a BigInt64Array of CN_STATS_FIELDS words per slot
+ * over a SharedArrayBuffer (Emscripten builds; elsewhere it stops
+ * counting).
+ */
+typedef struct cn_stats {
+    uint64_t hashes;
+    uint64_t shares;
+    uint64_t busy_ns;
+    uint64_t last_ns;
+} cn_stats;
+
+#define CN_STATS_FIELDS  4
+
+void     cn_ctx_set_stats(cn_ctx *ctx, cn_stats *stats);
+void     cn_ctx_set_host_stats(cn_ctx *ctx, uint32_t slot);
+
+/* Scratchpad memory (native Linux builds): contexts try 2 MB pages first,
+ * mmap(MAP_HUGETLB), then transparent huge pages via madvise, then plain
+ * aligned memory.  cn_ctx_memory_kind() reports "hugetlb", "thp" or
+ * "aligned"; cn_set_hugepages(0) makes later contexts use plain memory.
+ */
+const char *cn_ctx_memory_kind(const cn_ctx *ctx);
+void        cn_set_hugepages(int enable);
+
+/* Scratchpad backend picked for this CPU at cn_ctx_create() time:
+ * "aesni" on x86-64 with AES-NI, otherwise "portable".
+ */
+const char *cn_ctx_backend_name(const cn_ctx *ctx);
+
+/* Thread pool (native POSIX builds and the Emscripten -pthread build,
+ * where the threads are Web Workers sharing one memory): `threads`
+ * threads hash the current job with their own `ways`-way contexts, taking
+ * nonces in batches from a shared counter.  Each thread sizes its batches
+ * from its measured hash rate to take one time slice, 250 ms unless set
+ * with cn_pool_set_slice(), which bounds how long a new job waits;
+ * slice 0 means fixed batches of `batch` nonces (0: 16).
+ * cn_pool_set_job() returns the job's id (0 for a bad algo or blob);
+ * shares come out of cn_pool_results() as CN_POOL_RESULT_SIZE-byte
+ * records: the job id (4 bytes LE), then a scan record.  Contexts are
+ * bound to the thread that created them (cn/r code is per thread under
+ * -pthread), which the pool threads do themselves.  A new job or a pause
+ * cuts the threads' batches in flight short through a control word.
+ * cn_pool_set_duty() caps each thread's hashing at `permille` of wall
+ * time: after every batch a thread sleeps in proportion to the time the
+ * batch took, net of earlier over- or undersleeping, and lengthens its
+ * batches so the sleeps stay long enough to time accurately.
+ * cn_pool_busy_ns() is the hashing time summed over threads; it and
+ * cn_pool_hashes() read cn_pool_stats(), the block every thread's scans
+ * count into, which can also be read directly (under -pthread from any
+ * thread sharing the memory).
+ */
+#define CN_POOL_RESULT_SIZE  40
+
+typedef struct cn_pool cn_pool;
+
+cn_pool *cn_pool_create(uint32_t threads, uint32_t ways, uint32_t batch);
+uint32_t cn_pool_set_job(cn_pool *pool, uint32_t algo, const uint8_t *blob, uint32_t blob_len,
+                         uint64_t target64, uint64_t height, uint32_t nonce_start);
+void     cn_pool_pause(cn_pool *pool);
+void     cn_pool_set_slice(cn_pool *pool, uint32_t ms);
+void     cn_pool_set_duty(cn_pool *pool, uint32_t permille);
+uint32_t cn_pool_results(cn_pool *pool, uint8_t *out, uint32_t max);
+uint64_t cn_pool_hashes(cn_pool *pool);
+uint64_t cn_pool_busy_ns(cn_pool *pool);
+const cn_stats *cn_pool_stats(cn_pool *pool);
+uint32_t cn_pool_dropped(cn_pool *pool);
+uint32_t cn_pool_threads(const cn_pool *pool);
+void     cn_pool_destroy(cn_pool *pool);
+
 /* Lower-level interface matching Monero's cn_slow_hash:
- *   variant: must be 0 for cn/0
+ *   variant:   0, 1, 2 or 4 for cn/0, cn/1, cn/2, cn/r (anything else hashes
+ *              to zeros)
+ *   prehashed: `data` is the 200-byte Keccak state instead of the input
+ *   height:    block height, selects cn/r's program (ignored otherwise)
  */
 void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int prehashed, uint64_t height);
 
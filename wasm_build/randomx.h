@@ -0,0 +1,111 @@
+/*
+ * RandomX (rx/0) hashing - Self-contained implementation for WebAssembly
+ * and native builds.
+ * Follows the RandomX v1.1 reference (tevador/RandomX) with Monero's
+ * parameters: 256 MB Argon2d cache, dataset items computed on demand
+ * (light mode) or precomputed into the 2 GB dataset (full mode, native
+ * 64-bit builds only, RX_FULL_MODE).
+ *
+ * The module is built from randomx_impl.c, which includes the CryptoNight
+ * kernel, so everything in cryptonight.h (share targets, cn_set_hugepages,
+ * the cn/ algorithms) is available as well.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ */
+
+#ifndef RANDOMX_H
+#define RANDOMX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cryptonight.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per-seed cache: 256 MB of Argon2d output plus the eight SuperscalarHash
+ * programs derived from the seed hash.  rx_cache_init() takes seconds and
+ * returns at once when the cache already holds `seed`; once initialised
+ * the cache is read-only and shared by any number of contexts/threads,
+ * which must not hash while it is re-initialised.
+ * rx_cache_import() adopts memory copied from a cache initialised with the
+ * same seed elsewhere (rx_cache_memory(), rx_cache_size() bytes), so one
+ * worker builds the cache and the others only regenerate the programs.
+ * Both return 0 for seeds of 0 or more than 64 bytes.
+ */
+typedef struct rx_cache rx_cache;
+
+rx_cache *rx_cache_create(void);
+int       rx_cache_init(rx_cache *cache, const uint8_t *seed, uint32_t seed_len);
+int       rx_cache_import(rx_cache *cache, const uint8_t *seed, uint32_t seed_len);
+uint8_t  *rx_cache_memory(rx_cache *cache);
+uint32_t  rx_cache_size(void);
+void      rx_cache_destroy(rx_cache *cache);
+
+/* Hashing context: 2 MB scratchpad and the VM state, used by one thread
+ * at a time.  The job, scan records, early stop, control word and
+ * statistics work as for cn_ctx (see cn_ctx_set_job, cn_ctx_scan,
+ * cn_ctx_set_control and cn_ctx_set_stats); the control word is checked
+ * before every hash and every 256 VM iterations (1/64 of a hash),
+ * abandoning the hash.  rx_ctx_backend_name() reports
+ * the AES implementation: "aesni" or "portable".
+ */
+typedef struct rx_ctx rx_ctx;
+
+rx_ctx     *rx_ctx_create(const rx_cache *cache);   /* NULL: full mode, see below */
+void        rx_ctx_hash(rx_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output);
+int         rx_ctx_set_job(rx_ctx *ctx, const uint8_t *blob, uint32_t blob_len);
+uint32_t    rx_ctx_scan(rx_ctx *ctx, uint32_t nonce_start, uint32_t count, uint64_t target64,
+                        uint8_t *out_results);
+void        rx_ctx_set_control(rx_ctx *ctx, const uint32_t *word, uint32_t expect);
+void        rx_ctx_set_host_control(rx_ctx *ctx, uint32_t expect);
+uint32_t    rx_ctx_scanned(const rx_ctx *ctx);
+void        rx_ctx_set_stats(rx_ctx *ctx, cn_stats *stats);
+void        rx_ctx_set_host_stats(rx_ctx *ctx, uint32_t slot);
+const char *rx_ctx_backend_name(const rx_ctx *ctx);
+void        rx_ctx_destroy(rx_ctx *ctx);
+
+/* Full mode.  rx_dataset_init() builds the cache and then the 2080 MB of
+ * items, split over `threads` threads (0: one per online CPU), on huge
+ * pages when the system has them; it takes tens of seconds and returns at
+ * once when the dataset already holds `seed`.
+ *
+ * rx_full keeps two datasets so hashing goes on across seed-hash changes:
+ * rx_full_prepare() starts a background build of the next seed's dataset,
+ * rx_full_acquire() returns a built dataset (or NULL) and holds it until
+ * rx_full_release(), and held datasets are never rebuilt.  A hashing
+ * thread acquires the dataset for its job's seed, points its context at
+ * it with rx_ctx_set_dataset(), and releases the previous one.
+ */
+typedef struct rx_dataset rx_dataset;
+typedef struct rx_full rx_full;
+
+rx_dataset *rx_dataset_create(void);
+int         rx_dataset_init(rx_dataset *ds, const uint8_t *seed, uint32_t seed_len, uint32_t threads);
+uint64_t    rx_dataset_size(void);
+const char *rx_dataset_memory_kind(const rx_dataset *ds);
+void        rx_dataset_destroy(rx_dataset *ds);
+void        rx_ctx_set_dataset(rx_ctx *ctx, const rx_dataset *ds);
+
+rx_full          *rx_full_create(uint32_t threads);
+int               rx_full_prepare(rx_full *f, const uint8_t *seed, uint32_t seed_len);
+int               rx_full_wait(rx_full *f);
+const rx_dataset *rx_full_acquire(rx_full *f, const uint8_t *seed, uint32_t seed_len);
+void              rx_full_release(rx_full *f, const rx_dataset *ds);
+double            rx_full_init_seconds(rx_full *f);
+void              rx_full_destroy(rx_full *f);
+
+/* Lower-level interface matching Monero's rx_slow_hash: hash of `data`
+ * under the 32-byte seed hash, with a per-thread cache that is rebuilt
+ * when the seed hash changes.  Hashes to zeros when out of memory.
+ */
+void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RANDOMX_H */
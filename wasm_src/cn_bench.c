@@ -0,0 +1,623 @@
+/**
+ * Native benchmark for the CryptoNight and RandomX kernels.
+ *
+ * randomx_impl.c (which includes cryptonight_impl.c) is compiled into this
+ * translation unit so every phase
+ * of cn_hash_lanes() can be timed on its own:
+ *   keccak    - Keccak-1600 of the blob (nonce-aware job absorb, as scanned)
+ *   explode   - AES key expansion + scratchpad fill (10-round AES)
+ *   main_loop - the memory-hard loop (all lanes of a call together)
+ *   implode   - scratchpad fold back into the state
+ *   final     - Keccak-f + Blake/Groestl/JH/Skein selection
+ *
+ * Build (same Monero sources and stub headers as the WASM build):
+ *   gcc -O2 -pthread -include monero_crypto/wasm_compat.h -I monero_crypto \
+ *       wasm_src/cn_bench.c monero_crypto/blake256.c monero_crypto/groestl.c \
+ *       monero_crypto/jh.c monero_crypto/skein.c -o cn_bench -lm
+ *
+ * Usage:
+ *   cn_bench [-a algo] [-t threads] [-w ways,...] [-s seconds]
+ *            [-b auto|portable|aesni] [-H on|off] [-J on|off] [-m light|full]
+ *            [-f text|json|csv]
+ *
+ * Every way-count in -w is run with the given number of threads, each
+ * thread owning its own context.  -a picks the family member by its
+ * stratum name (cn/0, cn/1, cn/2, cn/r, cn-lite/0, cn-lite/1, cn-heavy/0,
+ * cn-pico, rx/0; default cn/0).  Phase times are nanoseconds per hash.
+ * The scratchpad backing (hugetlb / thp / aligned) is reported per run;
+ * -H off forces 4 KB pages to measure the TLB cost, -J off runs cn/r's
+ * random-math program through the interpreter instead of compiled code.
+ *
+ * rx/0 runs RandomX in light mode: the 256 MB cache is initialised once
+ * (its time is reported) and shared by all threads, each hashing with its
+ * own context; -w does not apply and -b picks the AES implementation.
+ * -m full builds the 2 GB dataset first, on every CPU and on huge pages
+ * when -H allows, and reports its init time next to the H/s; a first
+ * hash is checked against light mode before the run.
+ */
+
+#include "randomx_impl.c"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+enum { PH_KECCAK, PH_EXPLODE, PH_MAIN_LOOP, PH_IMPLODE, PH_FINAL, PH_COUNT };
+
+static const char *const bench_phase_names[PH_COUNT] = {
+    "keccak", "explode", "main_loop", "implode", "final"
+};
+
+struct bench_thread {
+    pthread_t thread;
+    uint32_t algo;                          /* enum cn_algo_id */
+    const struct cn_backend *backend;
+    uint32_t ways;
+    uint32_t id;
+    double   seconds;                       /* requested run time */
+    /* results */
+    int      failed;
+    const char *memory_kind;
+    uint64_t hashes;
+    double   elapsed;
+    uint64_t phase_ns[PH_COUNT];
+};
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/** cn_ctx_scan()'s hashing of nonce .. nonce + ways - 1, with a clock read
+ *  between phases. */
+static void bench_hash_lanes(cn_ctx *ctx, uint32_t log2_ways, uint32_t nonce,
+                             uint8_t *output, uint64_t ns[PH_COUNT]) {
+    const uint32_t ways = 1u << log2_ways;
+    uint64_t t0, t1;
+
+    for (uint32_t w = 0; w < ways; w++) {
+        struct cn_lane *lane = &ctx->lane[w];
+        t0 = bench_now_ns();
+        cn_job_absorb(&ctx->job, nonce + w, lane->state.b);
+        if (ctx->algo->variant == 1) {
+            uint8_t head[CN_NONCE_OFFSET + 4];      /* input bytes 0..42 */
+            memcpy(head, ctx->job.blob, sizeof(head));
+            cn_set_nonce(head, sizeof(head), nonce + w);
+            lane->tweak1_2 = cn_variant1_tweak(lane, head + CN_VARIANT1_OFFSET);
+        }
+        t1 = bench_now_ns();
+        ctx->backend->explode(ctx, lane);
+        ns[PH_KECCAK]  += t1 - t0;
+        ns[PH_EXPLODE] += bench_now_ns() - t1;
+    }
+
+    t0 = bench_now_ns();
+    ctx->backend->main_loop[log2_ways](ctx);
+    ns[PH_MAIN_LOOP] += bench_now_ns() - t0;
+
+    for (uint32_t w = 0; w < ways; w++) {
+        t0 = bench_now_ns();
+        ctx->backend->implode(ctx, &ctx->lane[w]);
+        t1 = bench_now_ns();
+        cn_final(&ctx->lane[w], output + (size_t)w * 32);
+        ns[PH_IMPLODE] += t1 - t0;
+        ns[PH_FINAL]   += bench_now_ns() - t1;
+    }
+}
+
+static void *bench_thread_main(void *arg) {
+    struct bench_thread *bt = (struct bench_thread *)arg;
+    const uint32_t blob_len = 76;
+    const uint32_t log2_ways = bt->ways == 4 ? 2 : bt->ways == 2 ? 1 : 0;
+    uint8_t blob[76];
+    uint8_t hashes[CN_MAX_WAYS * 32];
+    uint64_t warmup_ns[PH_COUNT] = { 0 };
+    uint32_t nonce = bt->id << 24;
+
+    cn_ctx *ctx = cn_ctx_create_algo(bt->algo, bt->ways);
+    if (!ctx) {
+        bt->failed = 1;
+        return NULL;
+    }
+    ctx->backend = bt->backend;
+    bt->memory_kind = cn_ctx_memory_kind(ctx);
+
+    for (uint32_t i = 0; i < blob_len; i++)
+        blob[i] = (uint8_t)(i * 7 + 1);
+    cn_ctx_set_job(ctx, blob, blob_len);
+
+    /* First call touches the scratchpads; keep it out of the numbers */
+    bench_hash_lanes(ctx, log2_ways, nonce, hashes, warmup_ns);
+
+    const uint64_t start = bench_now_ns();
+    const uint64_t budget = (uint64_t)(bt->seconds * 1e9);
+    uint64_t now;
+    do {
+        bench_hash_lanes(ctx, log2_ways, nonce, hashes, bt->phase_ns);
+        nonce += bt->ways;
+        bt->hashes += bt->ways;
+        now = bench_now_ns();
+    } while (now - start < budget);
+
+    bt->elapsed = (double)(now - start) / 1e9;
+    cn_ctx_destroy(ctx);
+    return NULL;
+}
+
+/* ============================ Output ============================ */
+
+enum bench_format { FMT_TEXT, FMT_JSON, FMT_CSV };
+
+struct bench_run {
+    uint32_t ways;
+    uint32_t threads;
+    struct bench_thread *bt;
+};
+
+static double bench_rate(const struct bench_thread *bt) {
+    return bt->elapsed > 0 ? (double)bt->hashes / bt->elapsed : 0.0;
+}
+
+/** Phase times of all threads of a run, in ns per hash. */
+static void bench_run_phases(const struct bench_run *run, double out[PH_COUNT]) {
+    uint64_t hashes = 0;
+    for (int p = 0; p < PH_COUNT; p++) out[p] = 0;
+    for (uint32_t t = 0; t < run->threads; t++) {
+        hashes += run->bt[t].hashes;
+        for (int p = 0; p < PH_COUNT; p++)
+            out[p] += (double)run->bt[t].phase_ns[p];
+    }
+    for (int p = 0; p < PH_COUNT; p++)
+        out[p] = hashes ? out[p] / (double)hashes : 0.0;
+}
+
+static double bench_run_rate(const struct bench_run *run) {
+    double total = 0;
+    for (uint32_t t = 0; t < run->threads; t++)
+        total += bench_rate(&run->bt[t]);
+    return total;
+}
+
+static void bench_print(enum bench_format fmt, const struct cn_algo *algo, const char *backend,
+                        const struct bench_run *runs, uint32_t nruns) {
+    double ph[PH_COUNT];
+
+    if (fmt == FMT_CSV) {
+        printf("algo,backend,memory,ways,threads,thread,hashes,seconds,hashrate");
+        for (int p = 0; p < PH_COUNT; p++) printf(",%s_ns", bench_phase_names[p]);
+        printf("\n");
+        for (uint32_t r = 0; r < nruns; r++) {
+            const struct bench_run *run = &runs[r];
+            uint64_t hashes = 0;
+            double secs = 0;
+            for (uint32_t t = 0; t < run->threads; t++) {
+                const struct bench_thread *bt = &run->bt[t];
+                printf("%s,%s,%s,%u,%u,%u,%llu,%.3f,%.3f", algo->name, backend, bt->memory_kind,
+                       run->ways, run->threads, t,
+                       (unsigned long long)bt->hashes, bt->elapsed, bench_rate(bt));
+                for (int p = 0; p < PH_COUNT; p++)
+                    printf(",%.0f", bt->hashes ? (double)bt->phase_ns[p] / (double)bt->hashes : 0.0);
+                printf("\n");
+                hashes += bt->hashes;
+                if (bt->elapsed > secs) secs = bt->elapsed;
+            }
+            bench_run_phases(run, ph);
+            printf("%s,%s,%s,%u,%u,all,%llu,%.3f,%.3f", algo->name, backend, run->bt[0].memory_kind,
+                   run->ways, run->threads,
+                   (unsigned long long)hashes, secs, bench_run_rate(run));
+            for (int p = 0; p < PH_COUNT; p++) printf(",%.0f", ph[p]);
+            printf("\n");
+        }
+        return;
+    }
+
+    if (fmt == FMT_JSON) {
+        printf("{\n  \"algo\": \"%s\",\n  \"backend\": \"%s\",\n  \"memory\": %u,\n"
+               "  \"iterations\": %u,\n  \"runs\": [",
+               algo->name, backend, algo->memory, algo->iterations);
+        for (uint32_t r = 0; r < nruns; r++) {
+            const struct bench_run *run = &runs[r];
+            bench_run_phases(run, ph);
+            printf("%s\n    {\"ways\": %u, \"threads\": %u, \"memory\": \"%s\", \"hashrate\": %.3f,\n"
+                   "     \"thread_hashrate\": [",
+                   r ? "," : "", run->ways, run->threads, run->bt[0].memory_kind, bench_run_rate(run));
+            for (uint32_t t = 0; t < run->threads; t++)
+                printf("%s%.3f", t ? ", " : "", bench_rate(&run->bt[t]));
+            printf("],\n     \"phase_ns\": {");
+            for (int p = 0; p < PH_COUNT; p++)
+                printf("%s\"%s\": %.0f", p ? ", " : "", bench_phase_names[p], ph[p]);
+            printf("}}");
+        }
+        printf("\n  ]\n}\n");
+        return;
+    }
+
+    printf("%s, backend %s, %u iterations over %u KB\n", algo->name, backend,
+           algo->iterations, algo->memory / 1024);
+    for (uint32_t r = 0; r < nruns; r++) {
+        const struct bench_run *run = &runs[r];
+        bench_run_phases(run, ph);
+        printf("\n%u-way x %u thread(s), %s memory: %.2f H/s\n", run->ways, run->threads,
+               run->bt[0].memory_kind, bench_run_rate(run));
+        for (uint32_t t = 0; t < run->threads; t++)
+            printf("  thread %-3u %10.2f H/s\n", t, bench_rate(&run->bt[t]));
+        printf("  ns/hash:");
+        for (int p = 0; p < PH_COUNT; p++)
+            printf(" %s=%.0f", bench_phase_names[p], ph[p]);
+        printf("\n");
+    }
+}
+
+/* ============================ RandomX ============================ */
+
+struct bench_rx_thread {
+    pthread_t thread;
+    const rx_cache *cache;
+#if RX_FULL_MODE
+    const rx_dataset *dataset;              /* full mode, else NULL */
+#endif
+    const struct rx_aes_backend *aes;
+    uint32_t id;
+    double   seconds;                       /* requested run time */
+    /* results */
+    int      failed;
+    const char *memory_kind;
+    uint64_t hashes;
+    double   elapsed;
+};
+
+static double bench_rx_rate(const struct bench_rx_thread *bt) {
+    return bt->elapsed > 0 ? (double)bt->hashes / bt->elapsed : 0.0;
+}
+
+static void *bench_rx_thread_main(void *arg) {
+    struct bench_rx_thread *bt = (struct bench_rx_thread *)arg;
+    uint8_t blob[76], hash[32];
+    uint32_t nonce = bt->id << 24;
+
+    rx_ctx *ctx = rx_ctx_create(bt->cache);
+    if (!ctx) {
+        bt->failed = 1;
+        return NULL;
+    }
+#if RX_FULL_MODE
+    if (bt->dataset) rx_ctx_set_dataset(ctx, bt->dataset);
+#endif
+    ctx->aes = bt->aes;
+    bt->memory_kind = cn_mem_kind_names[ctx->scratchpad_kind];
+
+    for (uint32_t i = 0; i < sizeof(blob); i++)
+        blob[i] = (uint8_t)(i * 7 + 1);
+    rx_ctx_set_job(ctx, blob, sizeof(blob));
+
+    /* First hash touches the scratchpad; keep it out of the numbers */
+    rx_ctx_hash(ctx, ctx->blob, ctx->blob_len, hash);
+
+    const uint64_t start = bench_now_ns();
+    const uint64_t budget = (uint64_t)(bt->seconds * 1e9);
+    uint64_t now;
+    do {
+        cn_set_nonce(ctx->blob, ctx->blob_len, nonce++);
+        rx_ctx_hash(ctx, ctx->blob, ctx->blob_len, hash);
+        bt->hashes++;
+        now = bench_now_ns();
+    } while (now - start < budget);
+
+    bt->elapsed = (double)(now - start) / 1e9;
+    rx_ctx_destroy(ctx);
+    return NULL;
+}
+
+/* `data_kind` is the dataset's memory backing in full mode, NULL in light mode */
+static void bench_rx_print(enum bench_format fmt, const char *aes, const rx_cache *cache,
+                           const char *data_kind, double init_seconds,
+                           const struct bench_rx_thread *bt, uint32_t threads) {
+    const char *cache_kind = cn_mem_kind_names[cache->memory_kind];
+    const char *mode = data_kind ? "full" : "light";
+    double total = 0;
+    for (uint32_t t = 0; t < threads; t++)
+        total += bench_rx_rate(&bt[t]);
+
+    if (fmt == FMT_CSV) {
+        printf("algo,mode,backend,cache_memory,dataset_memory,init_seconds,memory,threads,thread,"
+               "hashes,seconds,hashrate\n");
+        for (uint32_t t = 0; t < threads; t++)
+            printf("rx/0,%s,%s,%s,%s,%.3f,%s,%u,%u,%llu,%.3f,%.3f\n", mode, aes, cache_kind,
+                   data_kind ? data_kind : "", init_seconds, bt[t].memory_kind, threads, t,
+                   (unsigned long long)bt[t].hashes, bt[t].elapsed, bench_rx_rate(&bt[t]));
+        printf("rx/0,%s,%s,%s,%s,%.3f,%s,%u,all,,,%.3f\n", mode, aes, cache_kind,
+               data_kind ? data_kind : "", init_seconds, bt[0].memory_kind, threads, total);
+        return;
+    }
+
+    if (fmt == FMT_JSON) {
+        printf("{\n  \"algo\": \"rx/0\",\n  \"mode\": \"%s\",\n  \"backend\": \"%s\",\n"
+               "  \"cache_memory\": \"%s\",\n", mode, aes, cache_kind);
+        if (data_kind)
+            printf("  \"dataset_memory\": \"%s\",\n", data_kind);
+        printf("  \"init_seconds\": %.3f,\n  \"runs\": [\n"
+               "    {\"threads\": %u, \"memory\": \"%s\", \"hashrate\": %.3f,\n"
+               "     \"thread_hashrate\": [",
+               init_seconds, threads, bt[0].memory_kind, total);
+        for (uint32_t t = 0; t < threads; t++)
+            printf("%s%.3f", t ? ", " : "", bench_rx_rate(&bt[t]));
+        printf("]}\n  ]\n}\n");
+        return;
+    }
+
+    if (data_kind) {
+        printf("rx/0 full mode, backend %s, %.0f MB dataset (%s memory)\n", aes,
+               (double)rx_dataset_size() / (1 << 20), data_kind);
+        printf("cache + dataset init: %.2f s\n", init_seconds);
+    } else {
+        printf("rx/0 light mode, backend %s, %u MB cache (%s memory)\n", aes,
+               rx_cache_size() >> 20, cache_kind);
+        printf("cache init: %.2f s\n", init_seconds);
+    }
+    printf("\n%u thread(s), %s scratchpads: %.2f H/s\n", threads, bt[0].memory_kind, total);
+    for (uint32_t t = 0; t < threads; t++)
+        printf("  thread %-3u %10.2f H/s\n", t, bench_rx_rate(&bt[t]));
+}
+
+#if RX_FULL_MODE
+/* Full-mode dataset for `seed`, built with every CPU through rx_full (the
+ * path a miner uses across seed changes); the time is the build's own */
+static const rx_dataset *bench_rx_dataset(rx_full *full, const uint8_t *seed, uint32_t seed_len,
+                                          double *init_seconds) {
+    rx_full_prepare(full, seed, seed_len);
+    if (!rx_full_wait(full)) return NULL;
+    *init_seconds = rx_full_init_seconds(full);
+    return rx_full_acquire(full, seed, seed_len);
+}
+
+/* One hash in full mode against the same hash in light mode */
+static int bench_rx_check_full(const rx_dataset *ds) {
+    static const uint8_t input[] = "rx/0 full mode self-check";
+    uint8_t full[32], light[32];
+    rx_ctx *ctx = rx_ctx_create(ds->cache);
+    if (!ctx) return 0;
+    rx_ctx_hash(ctx, input, sizeof(input) - 1, light);
+    rx_ctx_set_dataset(ctx, ds);
+    rx_ctx_hash(ctx, input, sizeof(input) - 1, full);
+    rx_ctx_destroy(ctx);
+    return !memcmp(full, light, sizeof(full));
+}
+#endif
+
+/**
+ * The rx/0 benchmark: one cache (light) or dataset (full), `threads`
+ * contexts hashing against it.
+ */
+static int bench_rx(uint32_t threads, double seconds, const char *backend_name, int full,
+                    enum bench_format fmt) {
+    const struct rx_aes_backend *aes = rx_select_aes();
+    if (!strcmp(backend_name, "portable")) {
+        aes = &rx_aes_portable;
+    } else if (!strcmp(backend_name, "aesni")) {
+#if CN_X86_AESNI
+        if (!__builtin_cpu_supports("aes")) {
+            fprintf(stderr, "this CPU has no AES-NI\n");
+            return 1;
+        }
+        aes = &rx_aes_aesni;
+#else
+        fprintf(stderr, "built without the AES-NI backend\n");
+        return 1;
+#endif
+    } else if (strcmp(backend_name, "auto")) {
+        fprintf(stderr, "unknown backend %s\n", backend_name);
+        return 2;
+    }
+
+    uint8_t seed[32];
+    for (uint32_t i = 0; i < sizeof(seed); i++)
+        seed[i] = (uint8_t)(i * 13 + 5);
+
+    struct bench_rx_thread *bt = (struct bench_rx_thread *)calloc(threads, sizeof(*bt));
+    rx_cache *cache = NULL;
+    const rx_cache *hash_cache;
+    const char *data_kind = NULL;
+    double init_seconds = 0;
+#if RX_FULL_MODE
+    rx_full *rxf = NULL;
+    const rx_dataset *ds = NULL;
+#endif
+
+    if (full) {
+#if RX_FULL_MODE
+        rxf = rx_full_create(0);
+        ds = rxf ? bench_rx_dataset(rxf, seed, sizeof(seed), &init_seconds) : NULL;
+        if (!ds || !bt) {
+            fprintf(stderr, "out of memory (full mode needs %llu MB)\n",
+                    (unsigned long long)((rx_dataset_size() + rx_cache_size()) >> 20));
+            return 1;
+        }
+        if (!bench_rx_check_full(ds)) {
+            fprintf(stderr, "full-mode hash differs from light mode\n");
+            return 1;
+        }
+        hash_cache = ds->cache;
+        data_kind = rx_dataset_memory_kind(ds);
+#else
+        fprintf(stderr, "built without full mode (RX_FULL_MODE)\n");
+        return 1;
+#endif
+    } else {
+        cache = rx_cache_create();
+        if (!cache || !bt) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        const uint64_t t0 = bench_now_ns();
+        rx_cache_init(cache, seed, sizeof(seed));
+        init_seconds = (double)(bench_now_ns() - t0) / 1e9;
+        hash_cache = cache;
+    }
+
+    for (uint32_t t = 0; t < threads; t++) {
+        bt[t].cache = hash_cache;
+#if RX_FULL_MODE
+        bt[t].dataset = ds;
+#endif
+        bt[t].aes = aes;
+        bt[t].id = t;
+        bt[t].seconds = seconds;
+        if (pthread_create(&bt[t].thread, NULL, bench_rx_thread_main, &bt[t])) {
+            fprintf(stderr, "pthread_create failed\n");
+            return 1;
+        }
+    }
+    for (uint32_t t = 0; t < threads; t++) {
+        pthread_join(bt[t].thread, NULL);
+        if (bt[t].failed) {
+            fprintf(stderr, "cannot allocate a RandomX context\n");
+            return 1;
+        }
+    }
+
+    bench_rx_print(fmt, aes->name, hash_cache, data_kind, init_seconds, bt, threads);
+    free(bt);
+#if RX_FULL_MODE
+    if (rxf) {
+        rx_full_release(rxf, ds);
+        rx_full_destroy(rxf);
+    }
+#endif
+    rx_cache_destroy(cache);
+    return 0;
+}
+
+/* ============================= Main ============================= */
+
+static void bench_usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-a algo] [-t threads] [-w ways,...] [-s seconds] "
+            "[-b auto|portable|aesni] [-H on|off] [-J on|off] [-m light|full] "
+            "[-f text|json|csv]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    uint32_t threads = 1;
+    uint32_t ways_list[3] = { 1, 2, 4 };
+    uint32_t nways = 3;
+    double seconds = 5.0;
+    const char *backend_name = "auto";
+    int32_t algo_id = CN_ALGO_CN0;
+    int rx = 0, rx_full_mode = 0;
+    enum bench_format fmt = FMT_TEXT;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (opt[0] != '-' || !opt[1] || opt[2] || !val) {
+            bench_usage(argv[0]);
+            return 2;
+        }
+        i++;
+        switch (opt[1]) {
+            case 'a':
+                rx = !strcmp(val, "rx/0");
+                if (rx) break;
+                algo_id = cn_algo_by_name(val);
+                if (algo_id < 0) {
+                    fprintf(stderr, "unknown algo %s\n", val);
+                    return 2;
+                }
+                break;
+            case 't': threads = (uint32_t)strtoul(val, NULL, 10); break;
+            case 's': seconds = strtod(val, NULL); break;
+            case 'b': backend_name = val; break;
+            case 'H': cn_set_hugepages(strcmp(val, "off") != 0); break;
+            case 'J': cn_set_r_jit(strcmp(val, "off") != 0); break;
+            case 'm':
+                if (!strcmp(val, "full"))       rx_full_mode = 1;
+                else if (!strcmp(val, "light")) rx_full_mode = 0;
+                else { bench_usage(argv[0]); return 2; }
+                break;
+            case 'w': {
+                char *end = (char *)val;
+                nways = 0;
+                while (*end && nways < 3) {
+                    uint32_t w = (uint32_t)strtoul(end, &end, 10);
+                    if (w != 1 && w != 2 && w != 4) {
+                        fprintf(stderr, "ways must be 1, 2 or 4\n");
+                        return 2;
+                    }
+                    ways_list[nways++] = w;
+                    if (*end == ',') end++;
+                }
+                break;
+            }
+            case 'f':
+                if (!strcmp(val, "json"))      fmt = FMT_JSON;
+                else if (!strcmp(val, "csv"))  fmt = FMT_CSV;
+                else if (!strcmp(val, "text")) fmt = FMT_TEXT;
+                else { bench_usage(argv[0]); return 2; }
+                break;
+            default:
+                bench_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (threads == 0 || threads > 256 || nways == 0 || seconds <= 0) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    if (rx)
+        return bench_rx(threads, seconds, backend_name, rx_full_mode, fmt);
+
+    const struct cn_algo *algo = &cn_algos[algo_id];
+    const struct cn_backend *backend = cn_select_backend(algo);
+    if (!strcmp(backend_name, "portable")) {
+        backend = algo->portable;
+    } else if (!strcmp(backend_name, "aesni")) {
+#if CN_X86_AESNI
+        if (!__builtin_cpu_supports("aes")) {
+            fprintf(stderr, "this CPU has no AES-NI\n");
+            return 1;
+        }
+        backend = algo->aesni;
+#else
+        fprintf(stderr, "built without the AES-NI backend\n");
+        return 1;
+#endif
+    } else if (strcmp(backend_name, "auto")) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+
+    struct bench_run runs[3];
+    for (uint32_t r = 0; r < nways; r++) {
+        runs[r].ways = ways_list[r];
+        runs[r].threads = threads;
+        runs[r].bt = (struct bench_thread *)calloc(threads, sizeof(struct bench_thread));
+        if (!runs[r].bt) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (uint32_t t = 0; t < threads; t++) {
+            struct bench_thread *bt = &runs[r].bt[t];
+            bt->algo = (uint32_t)algo_id;
+            bt->backend = backend;
+            bt->ways = ways_list[r];
+            bt->id = t;
+            bt->seconds = seconds;
+            if (pthread_create(&bt->thread, NULL, bench_thread_main, bt)) {
+                fprintf(stderr, "pthread_create failed\n");
+                return 1;
+            }
+        }
+        for (uint32_t t = 0; t < threads; t++) {
+            pthread_join(runs[r].bt[t].thread, NULL);
+            if (runs[r].bt[t].failed) {
+                fprintf(stderr, "cannot allocate a %u-way context\n", ways_list[r]);
+                return 1;
+            }
+        }
+    }
+
+    bench_print(fmt, algo, backend->name, runs, nways);
+    for (uint32_t r = 0; r < nways; r++) free(runs[r].bt);
+    return 0;
+}
@@ -0,0 +1,1377 @@
+/**
+ * Known-answer and differential tests for the CryptoNight and RandomX
+ * kernels.
+ *
+ * randomx_impl.c (which includes cryptonight_impl.c) is compiled into
+ * this translation unit so the primitives (keccakf, AES rounds, key
+ * expansion, mul_128, BLAKE2b, Argon2d) can be tested directly.  Groups:
+ *   keccak   - Keccak-f[1600] / Keccak-1600 known answers, the unrolled
+ *              permutation against the loop, nonce-aware job absorb
+ *              against the plain one
+ *   aes      - AES-256 key expansion (FIPS-197) and every single-round
+ *              implementation against the byte-wise reference
+ *   mul      - mul_128 (selected backend) and the portable fallback
+ *              against a 128-bit product
+ *   target   - share target conversion
+ *   control  - cn_ctx_scanned() and scans stopped by their control word,
+ *              natively also from another thread mid-scan and mid-hash
+ *   stats    - counters scans add to
+ *   sqrt     - variant 2's floating-point square root against Monero's
+ *              integer one
+ *   cnr      - cn/r programs compiled per height against Monero's
+ *              interpreter, and the per-context program cache
+ *   kat      - official cn/0, cn/1, cn/2 and cn/r vectors (Monero
+ *              tests/hash/tests-slow*.txt)
+ *   blake2b  - BLAKE2b known answers and incremental updates
+ *   argon2   - Argon2d (RFC 9106 test vector)
+ *   rxaes    - AES decryption rounds against the byte-wise reference,
+ *              the selected RandomX generators / hash against the
+ *              portable ones
+ *   superscalar - reciprocals, cache and dataset items (RandomX
+ *              tests/tests.cpp, 256 MB cache)
+ *   rounding - CFROUND's software rounding against known answers and,
+ *              natively, the FPU's rounding modes
+ *   rx       - RandomX known answers, rx_ctx_scan against single hashes
+ *              and stopped mid-hash, rx_cache_import and rx_slow_hash
+ *   dataset  - full mode (native): multi-threaded item fill and dataset
+ *              reads against items computed from the cache
+ *   pool     - cn_pool batch lengths, and shares across job and
+ *              algorithm switches and at a reduced duty cycle against
+ *              single-threaded hashes, shutdown during long batches
+ *              (native, and -pthread under node)
+ *   diff     - random blobs through every algorithm, backend and
+ *              way-count against ref_cn_hash_algo(), a straight
+ *              transcription of Monero's portable slow-hash loop built
+ *              from the byte-wise primitives
+ *
+ * The compile-time paths are covered by building this file several ways
+ * (see the test-native job and the WASM build in build-xmrig-wasm.yml):
+ * default (T-table + AES-NI + unrolled Keccak), -DCN_AES_TTABLE=0,
+ * -DCN_X86_AESNI=0, -DCN_KECCAK_UNROLLED=0, -DCN_MUL128=0, -DCN_R_JIT=0,
+ * -DRX_HW_ROUNDING=0 (the software rounding the WASM build uses),
+ * -DRX_FULL_MODE=0,
+ * and with emcc with and without -msimd128 (run under node).
+ *
+ * Build:
+ *   gcc -O2 -pthread -include monero_crypto/wasm_compat.h -I monero_crypto \
+ *       wasm_src/cn_test.c monero_crypto/blake256.c monero_crypto/groestl.c \
+ *       monero_crypto/jh.c monero_crypto/skein.c -o cn_test -lm
+ *
+ * Usage: cn_test [random blobs for the diff group, default 4]
+ * Exits non-zero when any check fails.
+ */
+
+#include "randomx_impl.c"
+
+#include <stdio.h>
+
+static int test_failures;
+static int test_checks;
+
+#define CHECK(cond, ...) do {                                   \
+        test_checks++;                                          \
+        if (!(cond)) {                                          \
+            test_failures++;                                    \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);         \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+static void hex_decode(const char *hex, uint8_t *out, size_t *out_len) {
+    size_t n = strlen(hex) / 2;
+    for (size_t i = 0; i < n; i++) {
+        unsigned v;
+        sscanf(hex + 2 * i, "%2x", &v);
+        out[i] = (uint8_t)v;
+    }
+    if (out_len) *out_len = n;
+}
+
+static void hex_encode(const uint8_t *in, size_t len, char *out) {
+    for (size_t i = 0; i < len; i++)
+        sprintf(out + 2 * i, "%02x", in[i]);
+}
+
+/* xorshift64*: reproducible inputs for the differential tests */
+static uint64_t test_rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t test_rand64(void) {
+    test_rng_state ^= test_rng_state >> 12;
+    test_rng_state ^= test_rng_state << 25;
+    test_rng_state ^= test_rng_state >> 27;
+    return test_rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+static void test_rand_bytes(uint8_t *out, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        out[i] = (uint8_t)(test_rand64() >> 56);
+}
+
+/* ========================= Keccak ========================= */
+
+static void test_keccak(void) {
+    uint64_t st[25];
+    uint8_t md[200];
+    char hex[65];
+
+    /* Keccak-f[1600] of the all-zero state (Keccak team's test vectors) */
+    memset(st, 0, sizeof(st));
+    keccakf(st);
+    CHECK(st[0] == 0xF1258F7940E1DDE7ull && st[1] == 0x84D5CCF933C0478Aull,
+          "keccakf(0) lanes 0,1 = %016llx %016llx",
+          (unsigned long long)st[0], (unsigned long long)st[1]);
+
+    /* Selected permutation (unrolled, lane-complemented by default)
+     * against the table-driven loop, including the after-Theta entry */
+    for (int i = 0; i < 200; i++) {
+        uint64_t want[25], got[25];
+        for (int j = 0; j < 25; j++) want[j] = got[j] = test_rand64();
+        keccakf_loop(want);
+        keccakf(got);
+        CHECK(!memcmp(want, got, 200), "keccakf vs keccakf_loop (case %d)", i);
+
+        for (int j = 0; j < 25; j++) want[j] = got[j] = test_rand64();
+        keccakf_loop_after_theta0(want);
+        keccakf_after_theta0(got);
+        CHECK(!memcmp(want, got, 200), "keccakf_after_theta0 vs loop (case %d)", i);
+    }
+
+    /* The first 32 bytes of keccak1600() are Keccak-256 (0x01 padding) */
+    keccak1600((const uint8_t *)"", 0, md);
+    hex_encode(md, 32, hex);
+    CHECK(!strcmp(hex, "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470"),
+          "keccak256(\"\") = %s", hex);
+
+    keccak1600((const uint8_t *)"abc", 3, md);
+    hex_encode(md, 32, hex);
+    CHECK(!strcmp(hex, "4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45"),
+          "keccak256(\"abc\") = %s", hex);
+
+    /* Nonce-aware absorb against keccak1600() of the patched blob, on
+     * both sides of the one-rate-block limit */
+    struct cn_job job;
+    uint8_t blob[CN_MAX_BLOB], want[200];
+    for (uint32_t len = CN_NONCE_OFFSET + 4; len <= 160; len++) {
+        test_rand_bytes(blob, len);
+        cn_job_prepare(&job, blob, len);
+        for (int n = 0; n < 4; n++) {
+            const uint32_t nonce = n == 0 ? 0 : n == 1 ? 0xFFFFFFFFu : (uint32_t)test_rand64();
+            cn_set_nonce(blob, len, nonce);
+            keccak1600(blob, len, want);
+            cn_job_absorb(&job, nonce, md);
+            CHECK(!memcmp(want, md, 200), "cn_job_absorb len %u nonce %08x", len, nonce);
+        }
+    }
+}
+
+/* =========================== AES =========================== */
+
+#if CN_X86_AESNI
+CN_AESNI_FN static void test_aesenc(uint8_t *out, const uint8_t *in, const uint8_t *key) {
+    __m128i r = _mm_aesenc_si128(_mm_loadu_si128((const __m128i *)in),
+                                 _mm_loadu_si128((const __m128i *)key));
+    _mm_storeu_si128((__m128i *)out, r);
+}
+#endif
+
+static void test_aes(void) {
+    uint8_t key[32], expanded[240];
+
+    /* FIPS-197 Appendix A.3 */
+    hex_decode("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", key, NULL);
+    aes256_expand_key(key, expanded);
+
+    static const char *const words[][2] = {
+        { "8", "9ba35411" }, { "9", "8e6925af" }, { "10", "a51a8b5f" }, { "11", "2067fcde" },
+        { "56", "fe4890d1" }, { "57", "e6188d0b" }, { "58", "046df344" }, { "59", "706c631e" },
+    };
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        int w = atoi(words[i][0]);
+        char hex[9];
+        hex_encode(expanded + 4 * w, 4, hex);
+        CHECK(!strcmp(hex, words[i][1]), "AES-256 w[%d] = %s, want %s", w, hex, words[i][1]);
+    }
+
+    /* Every round implementation against the byte-wise reference */
+    for (int i = 0; i < 1000; i++) {
+        uint8_t in[16], rk[16], want[16], got[16];
+        test_rand_bytes(in, 16);
+        test_rand_bytes(rk, 16);
+        aes_single_round(want, in, rk);
+
+        aes_single_round_tt(got, in, rk);
+        CHECK(!memcmp(want, got, 16), "T-table round mismatch (case %d)", i);
+
+#if CN_SIMD128
+        wasm_v128_store(got, aes_round_simd(wasm_v128_load(in), wasm_v128_load(rk)));
+        CHECK(!memcmp(want, got, 16), "SIMD128 round mismatch (case %d)", i);
+#endif
+
+#if CN_X86_AESNI
+        if (__builtin_cpu_supports("aes")) {
+            test_aesenc(got, in, rk);
+            CHECK(!memcmp(want, got, 16), "AESENC mismatch (case %d)", i);
+        }
+#endif
+    }
+
+    /* 10-round pseudo round: selected kernel path against the reference */
+    for (int i = 0; i < 100; i++) {
+        uint8_t want[16], got[16];
+        test_rand_bytes(want, 16);
+        memcpy(got, want, 16);
+        aes_pseudo_round(want, expanded);
+        cn_aes_pseudo_round(got, expanded);
+        CHECK(!memcmp(want, got, 16), "pseudo round mismatch (case %d)", i);
+    }
+}
+
+/* =========================== mul_128 =========================== */
+
+static void test_mul(void) {
+    static const uint64_t edge[] = {
+        0, 1, 2, 0xFFFFFFFFull, 0x100000000ull, 0x8000000000000000ull,
+        0xFFFFFFFFFFFFFFFFull, 0xFFFFFFFF00000001ull,
+    };
+    const size_t nedge = sizeof(edge) / sizeof(edge[0]);
+
+    for (size_t i = 0; i < nedge * nedge + 10000; i++) {
+        uint64_t a, b, hi, lo;
+        if (i < nedge * nedge) {
+            a = edge[i / nedge];
+            b = edge[i % nedge];
+        } else {
+            a = test_rand64();
+            b = test_rand64();
+        }
+        mul_128(a, b, &hi, &lo);
+        uint64_t phi, plo;
+        mul_128_portable(a, b, &phi, &plo);
+        CHECK(hi == phi && lo == plo, "mul_128(%016llx, %016llx): backend %d != portable",
+              (unsigned long long)a, (unsigned long long)b, CN_MUL128);
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 p = (unsigned __int128)a * b;
+        CHECK(phi == (uint64_t)(p >> 64) && plo == (uint64_t)p,
+              "mul_128_portable(%016llx, %016llx)", (unsigned long long)a, (unsigned long long)b);
+#else
+        CHECK(plo == a * b, "mul_128_portable(%016llx, %016llx) low half",
+              (unsigned long long)a, (unsigned long long)b);
+#endif
+    }
+}
+
+/* =========================== Targets =========================== */
+
+static void test_target(void) {
+    static const uint8_t compact[4] = { 0xb4, 0xb0, 0xbf, 0x00 };
+    static const uint8_t wide[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t hash[32] = { 0 };
+
+    CHECK(cn_target_from_pool(compact, 4) == 0x00c0300c0300c030ull, "compact target");
+    CHECK(cn_target_from_pool(wide, 8) == 0x0807060504030201ull, "8-byte target");
+    CHECK(cn_target_from_pool(compact, 3) == 0, "bad target length");
+    CHECK(cn_target_from_difficulty(0) == 0xFFFFFFFFFFFFFFFFull, "difficulty 0");
+    CHECK(cn_target_from_difficulty(120001) == 0x00008bcf188b362eull, "difficulty 120001");
+
+    hash[31] = 0x00; hash[30] = 0xc0; hash[29] = 0x30;
+    CHECK(cn_check_hash(hash, 0x00c0300c0300c030ull), "hash below target");
+    hash[28] = 0xff; hash[27] = 0xff; hash[26] = 0xff; hash[25] = 0xff; hash[24] = 0xff;
+    CHECK(!cn_check_hash(hash, 0x00c0300c0300c030ull), "hash above target");
+}
+
+/* ===================== Reference family path ===================== */
+
+static uint64_t test_load64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static void test_store64(uint8_t *p, uint64_t v) {
+    memcpy(p, &v, 8);
+}
+
+/* cn-heavy's block mixing, written out on the 128-byte text buffer */
+static void ref_mix(uint8_t *text) {
+    uint8_t t[INIT_SIZE_BYTE];
+    for (int j = 0; j < INIT_SIZE_BYTE; j++)
+        t[j] = text[j] ^ text[(j + 16) % INIT_SIZE_BYTE];
+    memcpy(text, t, INIT_SIZE_BYTE);
+}
+
+static void ref_rounds(uint8_t *text, const uint8_t *key) {
+    for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE)
+        aes_pseudo_round(text + j, key);
+}
+
+/* floor(2 * (sqrt(n + 2^64) - 2^32)) bit by bit, without floating point
+ * (Monero's integer_square_root_v2 reference) */
+static uint64_t ref_sqrt_v2(uint64_t n) {
+    uint64_t r = 1ULL << 63;
+    for (uint64_t bit = 1ULL << 60; bit; bit >>= 2) {
+        const int below = n < r + bit;
+        const uint64_t n_next = n - (r + bit);
+        const uint64_t r_next = r + bit * 2;
+        n = below ? n : n_next;
+        r = below ? r : r_next;
+        r >>= 1;
+    }
+    return r * 2 + ((n > r) ? 1 : 0) - (1ULL << 33);
+}
+
+/* VARIANT2_PORTABLE_SHUFFLE_ADD: rotate the line's other three blocks,
+ * adding b1, a and b0; variant 4 also XORs the old blocks into out */
+static void ref_shuffle(uint8_t *long_state, uint32_t j, const uint8_t *a, const uint8_t *b,
+                        uint8_t *out, int variant) {
+    uint8_t *chunk1 = long_state + (j ^ 0x10);
+    uint8_t *chunk2 = long_state + (j ^ 0x20);
+    uint8_t *chunk3 = long_state + (j ^ 0x30);
+    uint8_t chunk1_old[16], chunk2_old[16], chunk3_old[16];
+    memcpy(chunk1_old, chunk1, 16);
+    memcpy(chunk2_old, chunk2, 16);
+    memcpy(chunk3_old, chunk3, 16);
+    for (int k = 0; k < 16; k += 8) {
+        test_store64(chunk1 + k, test_load64(chunk3_old + k) + test_load64(b + 16 + k));
+        test_store64(chunk3 + k, test_load64(chunk2_old + k) + test_load64(a + k));
+        test_store64(chunk2 + k, test_load64(chunk1_old + k) + test_load64(b + k));
+    }
+    for (int k = 0; variant >= 4 && k < 16; k++)
+        out[k] ^= chunk1_old[k] ^ chunk2_old[k] ^ chunk3_old[k];
+}
+
+/**
+ * A family member as written in Monero's portable cn_slow_hash() (plus
+ * cn-heavy's steps as in the Loki/xmrig sources), one block at a time with
+ * the byte-wise AES round, the integer square root and, for cn/r at
+ * `height`, Monero's random-math interpreter.  Deliberately shares nothing
+ * with the kernel's lane/backend code; cn/0 when algo is
+ * &cn_algos[CN_ALGO_CN0].
+ */
+static void ref_cn_hash_algo(const struct cn_algo *algo, const uint8_t *input,
+                             uint32_t input_len, uint64_t height, uint8_t *output) {
+    static uint8_t long_state[4 * 1024 * 1024];
+    const uint32_t memory = algo->memory, mask = algo->mask;
+    const int variant = algo->variant;
+    struct cn_lane lane;
+    uint8_t *state = lane.state.b;
+    uint8_t key[240], text[INIT_SIZE_BYTE];
+    uint8_t a[16], b[32], c[16], d[16];
+    uint64_t tweak1_2 = 0, division_result = 0, sqrt_result = 0;
+    struct V4_Instruction code[NUM_INSTRUCTIONS_MAX + 1];
+    v4_reg r[9];
+
+    if (variant == 1 && input_len < 43) {
+        memset(output, 0, 32);
+        return;
+    }
+    keccak1600(input, input_len, state);
+    if (variant == 1)
+        tweak1_2 = test_load64(state + 192) ^ test_load64(input + 35);
+    if (variant >= 2) {
+        for (int i = 0; i < 16; i++) b[16 + i] = state[64 + i] ^ state[80 + i];
+        division_result = test_load64(state + 96);
+        sqrt_result = test_load64(state + 104);
+    }
+    if (variant == 4) {                                     /* VARIANT4_RANDOM_MATH_INIT */
+        memcpy(r, state + 96, 4 * sizeof(v4_reg));
+        v4_random_math_init(code, height);
+    }
+
+    aes256_expand_key(state, key);
+    memcpy(text, state + 64, INIT_SIZE_BYTE);
+    for (int r = 0; algo->heavy && r < 16; r++) {
+        ref_rounds(text, key);
+        ref_mix(text);
+    }
+    for (uint32_t i = 0; i < memory; i += INIT_SIZE_BYTE) {
+        ref_rounds(text, key);
+        memcpy(long_state + i, text, INIT_SIZE_BYTE);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        a[i] = state[i] ^ state[32 + i];
+        b[i] = state[16 + i] ^ state[48 + i];
+    }
+    uint64_t idx = test_load64(a);
+
+    for (uint32_t i = 0; i < algo->iterations; i++) {
+        uint32_t j = (uint32_t)idx & mask;
+        uint8_t *p = long_state + j;
+        aes_single_round(c, p, a);
+        if (variant >= 2) ref_shuffle(long_state, j, a, b, c, variant);
+        for (int k = 0; k < 16; k++) p[k] = c[k] ^ b[k];
+        if (variant == 1) {                                 /* VARIANT1_1 */
+            const uint8_t tmp = p[11];
+            const uint8_t index = (uint8_t)((((tmp >> 3) & 6) | (tmp & 1)) << 1);
+            p[11] = tmp ^ ((0x75310 >> index) & 0x30);
+        }
+
+        j = (uint32_t)test_load64(c) & mask;
+        p = long_state + j;
+        memcpy(d, p, 16);
+        uint8_t a1[16];
+        memcpy(a1, a, 16);
+        if (variant == 2) {                                 /* VARIANT2_PORTABLE_INTEGER_MATH */
+            test_store64(d, test_load64(d) ^ division_result ^ (sqrt_result << 32));
+            const uint64_t dividend = test_load64(c + 8);
+            const uint32_t divisor =
+                (uint32_t)((test_load64(c) + (uint32_t)(sqrt_result << 1)) | 0x80000001UL);
+            division_result = (uint32_t)(dividend / divisor) + ((dividend % divisor) << 32);
+            sqrt_result = ref_sqrt_v2(test_load64(c) + division_result);
+        }
+        if (variant == 4) {                                 /* VARIANT4_RANDOM_MATH */
+            test_store64(d, test_load64(d) ^ ((uint64_t)(r[0] + r[1]) |
+                                              ((uint64_t)(r[2] + r[3]) << 32)));
+            memcpy(r + 4, a1, 4);
+            memcpy(r + 5, a1 + 8, 4);
+            memcpy(r + 6, b, 4);
+            memcpy(r + 7, b + 16, 4);
+            memcpy(r + 8, b + 24, 4);
+            v4_random_math(code, r);
+            test_store64(a1, test_load64(a1) ^ (r[2] | ((uint64_t)r[3] << 32)));
+            test_store64(a1 + 8, test_load64(a1 + 8) ^ (r[0] | ((uint64_t)r[1] << 32)));
+        }
+        uint64_t hi, lo;
+        mul_128(test_load64(c), test_load64(d), &hi, &lo);
+        if (variant == 2) {                                 /* VARIANT2_2_PORTABLE */
+            uint8_t *n1 = long_state + (j ^ 0x10), *n2 = long_state + (j ^ 0x20);
+            test_store64(n1, test_load64(n1) ^ hi);
+            test_store64(n1 + 8, test_load64(n1 + 8) ^ lo);
+            hi ^= test_load64(n2);
+            lo ^= test_load64(n2 + 8);
+        }
+        if (variant >= 2) ref_shuffle(long_state, j, a, b, c, variant);
+        test_store64(a, test_load64(a1) + hi);
+        test_store64(a + 8, test_load64(a1 + 8) + lo);
+        memcpy(p, a, 16);
+        if (variant == 1) test_store64(p + 8, test_load64(p + 8) ^ tweak1_2);
+        for (int k = 0; k < 16; k++) a[k] ^= d[k];
+        if (variant >= 2) memcpy(b + 16, b, 16);
+        memcpy(b, c, 16);
+        idx = test_load64(a);
+
+        if (algo->heavy) {
+            p = long_state + (idx & mask);
+            int64_t n = (int64_t)test_load64(p);
+            int32_t dv = (int32_t)(uint32_t)test_load64(p + 8);
+            int64_t q = ((dv | 5) == -1) ? (int64_t)(0 - (uint64_t)n) : n / (dv | 5);
+            test_store64(p, (uint64_t)(n ^ q));
+            idx = (uint64_t)(dv ^ q);
+        }
+    }
+
+    aes256_expand_key(state + 32, key);
+    memcpy(text, state + 64, INIT_SIZE_BYTE);
+    for (int pass = 0; pass < (algo->heavy ? 2 : 1); pass++) {
+        for (uint32_t i = 0; i < memory; i += INIT_SIZE_BYTE) {
+            for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE) {
+                for (int k = 0; k < 16; k++) text[j + k] ^= long_state[i + j + k];
+                aes_pseudo_round(text + j, key);
+            }
+            if (algo->heavy) ref_mix(text);
+        }
+    }
+    for (int r = 0; algo->heavy && r < 16; r++) {
+        ref_rounds(text, key);
+        ref_mix(text);
+    }
+    memcpy(state + 64, text, INIT_SIZE_BYTE);
+
+    cn_final(&lane, output);
+}
+
+static void ref_cn_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    ref_cn_hash_algo(&cn_algos[CN_ALGO_CN0], input, input_len, 0, output);
+}
+
+/* ===================== Variant 2 square root ===================== */
+
+static void test_sqrt(void) {
+    static const uint64_t edge[] = {
+        0, 1, 2, 3, 0xFFFFFFFFull, 0x100000000ull, 0x1FFFFFFFFull,
+        0x7FFFFFFFFFFFFFFFull, 0x8000000000000000ull,
+        0xFFFFFFFE00000001ull, 0xFFFFFFFFFFFFFFFEull, 0xFFFFFFFFFFFFFFFFull,
+    };
+    const size_t nedge = sizeof(edge) / sizeof(edge[0]);
+
+    for (size_t i = 0; i < nedge + 100000; i++) {
+        uint64_t n = i < nedge ? edge[i] : test_rand64();
+        /* every fourth random value is near a square-root boundary */
+        if (i >= nedge && (i & 3) == 0) {
+            const uint64_t r = ref_sqrt_v2(n);
+            n = (r >> 1) * ((r >> 1) + (r & 1)) + (r << 32) + (test_rand64() & 3) - 2;
+        }
+        CHECK(cn_variant2_sqrt(n) == ref_sqrt_v2(n), "cn_variant2_sqrt(%016llx) = %016llx, want %016llx",
+              (unsigned long long)n, (unsigned long long)cn_variant2_sqrt(n),
+              (unsigned long long)ref_sqrt_v2(n));
+    }
+}
+
+/* ========================= Known answers ========================= */
+
+static void test_kat(void) {
+    /* Monero tests/hash/tests-slow.txt: expected hash, hex input */
+    static const char *const vectors[][2] = {
+        { "2f8e3df40bd11f9ac90c743ca8e32bb391da4fb98612aa3b6cdc639ee00b31f5",
+          "6465206f6d6e69627573206475626974616e64756d" },
+        { "722fa8ccd594d40e4a41f3822734304c8d5eff7e1b528408e2229da38ba553c4",
+          "6162756e64616e732063617574656c61206e6f6e206e6f636574" },
+        { "bbec2cacf69866a8e740380fe7b818fc78f8571221742d729d9d02d7f8989b87",
+          "63617665617420656d70746f72" },
+        { "b1257de4efc5ce28c6b40ceb1c6c8f812a64634eb3e81c5220bee9b2b76a6f05",
+          "6578206e6968696c6f206e6968696c20666974" },
+    };
+    uint8_t in[128], out[32];
+    char hex[65];
+    size_t len;
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        hex_decode(vectors[i][1], in, &len);
+        cn_hash(in, (uint32_t)len, out);
+        hex_encode(out, 32, hex);
+        CHECK(!strcmp(hex, vectors[i][0]), "cn/0(%s) = %s, want %s", vectors[i][1], hex, vectors[i][0]);
+
+        ref_cn_hash(in, (uint32_t)len, out);
+        hex_encode(out, 32, hex);
+        CHECK(!strcmp(hex, vectors[i][0]), "ref cn/0(%s) = %s", vectors[i][1], hex);
+    }
+
+    cn_hash((const uint8_t *)"This is a test", 14, out);
+    hex_encode(out, 32, hex);
+    CHECK(!strcmp(hex, "a084f01d1437a09c6985401b60d43554ae105802c5f5d8a9b3253649c0be6605"),
+          "cn/0(\"This is a test\") = %s", hex);
+
+    /* Monero tests/hash/tests-slow-1.txt, -2.txt and -4.txt (cn/r, at a
+     * block height), through cn_slow_hash() as Monero calls it */
+    static const struct {
+        int variant;
+        uint32_t algo;
+        uint64_t height;
+        const char *want, *input;
+    } variants[] = {
+        { 1, CN_ALGO_CN1, 0, "b5a7f63abb94d07d1a6445c36c07c7e8327fe61b1647e391b4c7edae5de57a3d",
+          "00000000000000000000000000000000000000000000000000000000000000000000000000000000"
+          "000000000000000000000000000000000000000000000000000000000000000000000000" },
+        { 2, CN_ALGO_CN2, 0, "353fdc068fd47b03c04b9431e005e00b68c2168a3cc7335c8b9b308156591a4f",
+          "5468697320697320612074657374205468697320697320612074657374205468697320697320612074657374" },
+        { 4, CN_ALGO_R, 1806260, "f759588ad57e758467295443a9bd71490abff8e9dad1b95b6bf2f5d0d78387bc",
+          "5468697320697320612074657374205468697320697320612074657374205468697320697320612074657374" },
+    };
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        hex_decode(variants[i].input, in, &len);
+        cn_slow_hash(in, len, (char *)out, variants[i].variant, 0, variants[i].height);
+        hex_encode(out, 32, hex);
+        CHECK(!strcmp(hex, variants[i].want), "cn/%d(%s) = %s, want %s",
+              variants[i].variant, variants[i].input, hex, variants[i].want);
+
+        ref_cn_hash_algo(&cn_algos[variants[i].algo], in, (uint32_t)len, variants[i].height, out);
+        hex_encode(out, 32, hex);
+        CHECK(!strcmp(hex, variants[i].want), "ref cn/%d(%s) = %s", variants[i].variant,
+              variants[i].input, hex);
+    }
+
+    /* variant 1 needs 43 input bytes; prehashed input skips the Keccak */
+    memset(in, 0, sizeof(in));
+    cn_v1_hash(in, 42, out);
+    CHECK(!memcmp(out, in, 32), "cn/1 of a 42-byte input is not zero");
+
+    uint8_t state[200], want[32];
+    keccak1600(in, 76, state);
+    cn_slow_hash(state, sizeof(state), (char *)out, 2, 1, 0);
+    cn_v2_hash(in, 76, want);
+    CHECK(!memcmp(out, want, 32), "prehashed cn/2 differs");
+}
+
+/* ===================== cn/r random-math programs ===================== */
+
+static void test_cnr_program(const struct cn_r_program *prog, uint64_t height) {
+    struct V4_Instruction code[NUM_INSTRUCTIONS_MAX + 1];
+    v4_random_math_init(code, height);
+    for (int k = 0; k < 16; k++) {
+        uint32_t want[9], got[9];
+        for (int i = 0; i < 9; i++) want[i] = got[i] = (uint32_t)test_rand64();
+        v4_random_math(code, want);
+        prog->run(prog->code, got);
+        CHECK(!memcmp(want, got, 4 * sizeof(uint32_t)),
+              "cn/r program for height %llu (%s) differs from the interpreter",
+              (unsigned long long)height, prog->jit ? "compiled" : "interpreted");
+    }
+}
+
+static void test_cnr(void) {
+    cn_ctx *ctx = cn_ctx_create_algo(CN_ALGO_R, 1);
+    CHECK(ctx != NULL, "cn_ctx_create_algo(cn/r)");
+    if (!ctx) return;
+
+    /* Generated code against the interpreter, many programs */
+    for (int i = 0; i < 2000; i++) {
+        const uint64_t height = i < 2 ? (uint64_t)i * 1806260 : test_rand64() % 10000000;
+        cn_ctx_set_height(ctx, height);
+        CHECK(ctx->r_program->height == height, "cn/r program height");
+        CHECK(!CN_R_JIT || ctx->r_program->jit, "cn/r program for height %llu not compiled",
+              (unsigned long long)height);
+        test_cnr_program(ctx->r_program, height);
+    }
+
+    /* Cached by height until CN_R_CACHE newer heights evict it */
+    cn_ctx_set_height(ctx, 1);
+    const struct cn_r_program *first = ctx->r_program;
+    cn_ctx_set_height(ctx, 2);
+    cn_ctx_set_height(ctx, 1);
+    CHECK(ctx->r_program == first, "cn/r program for a cached height regenerated");
+    for (uint64_t h = 3; h < 3 + CN_R_CACHE; h++)
+        cn_ctx_set_height(ctx, h);
+    CHECK(first->height != 1, "cn/r program cache not evicted");
+    cn_ctx_set_height(ctx, 1);
+    test_cnr_program(ctx->r_program, 1);
+
+    /* With code generation off new programs go through the interpreter */
+    cn_set_r_jit(0);
+    cn_ctx_set_height(ctx, 100);
+    CHECK(ctx->r_program->run == cn_r_interpret && !ctx->r_program->jit,
+          "cn/r program compiled with code generation off");
+    test_cnr_program(ctx->r_program, 100);
+    cn_set_r_jit(1);
+
+    cn_ctx_destroy(ctx);
+}
+
+/* ======================= Differential tests ======================= */
+
+static void test_diff_backend(uint32_t algo, const struct cn_backend *backend, uint64_t height,
+                              const uint8_t *blobs, uint32_t blob_len, const uint8_t *want) {
+    static const uint32_t ways_list[] = { 1, 2, 4 };
+    uint8_t got[CN_MAX_WAYS * 32];
+
+    for (size_t wi = 0; wi < 3; wi++) {
+        const uint32_t ways = ways_list[wi];
+        cn_ctx *ctx = cn_ctx_create_algo(algo, ways);
+        CHECK(ctx != NULL, "cn_ctx_create_algo(%u, %u)", algo, ways);
+        if (!ctx) continue;
+        ctx->backend = backend;
+        cn_ctx_set_height(ctx, height);
+
+        if (ways == 4)      cn_hash_x4(ctx, blobs, blob_len, got);
+        else if (ways == 2) cn_hash_x2(ctx, blobs, blob_len, got);
+        else                cn_ctx_hash(ctx, blobs, blob_len, got);
+
+        for (uint32_t w = 0; w < ways; w++)
+            CHECK(!memcmp(got + w * 32, want + w * 32, 32),
+                  "%s %s backend, %u-way, lane %u differs from reference",
+                  cn_algos[algo].name, backend->name, ways, w);
+        cn_ctx_destroy(ctx);
+    }
+}
+
+static void test_diff(uint32_t rounds) {
+    for (uint32_t r = 0; r < rounds; r++) {
+        uint8_t blobs[CN_MAX_WAYS * CN_MAX_BLOB], want[CN_MAX_WAYS * 32];
+        const uint32_t blob_len = 43 + (uint32_t)(test_rand64() % 120);
+        const uint64_t height = test_rand64() % 10000000;       /* cn/r */
+
+        test_rand_bytes(blobs, sizeof(blobs));
+        for (uint32_t algo = 0; algo < CN_ALGO_COUNT; algo++) {
+            const struct cn_algo *a = &cn_algos[algo];
+            for (uint32_t w = 0; w < CN_MAX_WAYS; w++)
+                ref_cn_hash_algo(a, blobs + w * blob_len, blob_len, height, want + w * 32);
+
+            test_diff_backend(algo, a->portable, height, blobs, blob_len, want);
+#if CN_X86_AESNI
+            if (__builtin_cpu_supports("aes"))
+                test_diff_backend(algo, a->aesni, height, blobs, blob_len, want);
+#endif
+        }
+
+        /* scan_nonces must report exactly the nonces whose hash meets the
+         * target; cn/1 also checks that its tweak follows the nonce */
+        static const uint32_t scan_algos[] = { CN_ALGO_CN0, CN_ALGO_CN1 };
+        for (size_t sa = 0; sa < 2; sa++) {
+            uint8_t blob[CN_MAX_BLOB], hash[32], results[CN_SCAN_MAX_RESULTS * CN_SCAN_RESULT_SIZE];
+            const uint64_t target = 0x4000000000000000ull;
+            const uint32_t nonce0 = (uint32_t)test_rand64();
+            uint32_t expect = 0;
+            memcpy(blob, blobs, blob_len);
+            cn_ctx *ctx = cn_ctx_create_algo(scan_algos[sa], CN_MAX_WAYS);
+            uint32_t found = scan_nonces(ctx, blob, blob_len, nonce0, 6, target, results);
+            for (uint32_t n = 0; n < 6; n++) {
+                cn_set_nonce(blob, blob_len, nonce0 + n);
+                ref_cn_hash_algo(&cn_algos[scan_algos[sa]], blob, blob_len, 0, hash);
+                if (!cn_hash_meets_target(hash, target)) continue;
+                const uint8_t *rec = results + expect * CN_SCAN_RESULT_SIZE;
+                uint32_t rec_nonce = (uint32_t)rec[0] | ((uint32_t)rec[1] << 8) |
+                                     ((uint32_t)rec[2] << 16) | ((uint32_t)rec[3] << 24);
+                CHECK(expect < found && rec_nonce == nonce0 + n && !memcmp(rec + 4, hash, 32),
+                      "%s scan_nonces record %u (nonce %u)", cn_algos[scan_algos[sa]].name,
+                      expect, nonce0 + n);
+                expect++;
+            }
+            CHECK(found == expect, "%s scan_nonces found %u, reference %u",
+                  cn_algos[scan_algos[sa]].name, found, expect);
+            cn_ctx_destroy(ctx);
+        }
+    }
+}
+
+/* =========================== RandomX =========================== */
+
+/* One cache for the superscalar and rx groups: 256 MB, built once */
+static rx_cache *test_rx_cache;
+
+static rx_cache *test_rx_cache_for(const char *key) {
+    if (!test_rx_cache) test_rx_cache = rx_cache_create();
+    if (test_rx_cache) rx_cache_init(test_rx_cache, (const uint8_t *)key, (uint32_t)strlen(key));
+    return test_rx_cache;
+}
+
+static void test_blake2b(void) {
+    uint8_t out[64];
+    char hex[129];
+
+    /* RFC 7693 Appendix A, and BLAKE2b-512 of the empty string */
+    rx_blake2b(out, 64, "abc", 3);
+    hex_encode(out, 64, hex);
+    CHECK(!strcmp(hex, "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+                       "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923"),
+          "blake2b(\"abc\") = %s", hex);
+    rx_blake2b(out, 64, "", 0);
+    hex_encode(out, 64, hex);
+    CHECK(!strcmp(hex, "786a02f742015903c6c6fd852552d272912f4740e15847618a86e217f71f5419"
+                       "d25e1031afee585313896444934eb04b903a685b1448b755d56f701afe9be2ce"),
+          "blake2b(\"\") = %s", hex);
+
+    /* Incremental updates across the 128-byte block boundary */
+    uint8_t msg[300], want[64];
+    test_rand_bytes(msg, sizeof(msg));
+    for (size_t split = 0; split <= sizeof(msg); split += 37) {
+        struct rx_blake2b S;
+        rx_blake2b(want, 32, msg, sizeof(msg));
+        rx_blake2b_init(&S, 32);
+        rx_blake2b_update(&S, msg, split);
+        rx_blake2b_update(&S, msg + split, sizeof(msg) - split);
+        rx_blake2b_final(&S, out);
+        CHECK(!memcmp(want, out, 32), "blake2b split at %zu", split);
+    }
+}
+
+static void test_argon2(void) {
+    /* RFC 9106 section 5.1: Argon2d, 32 KiB, 3 passes, 4 lanes */
+    static uint64_t memory[32 * RX_ARGON2_BLOCK_WORDS];
+    uint8_t pwd[32], salt[16], secret[8], ad[12], tag[32];
+    char hex[65];
+
+    memset(pwd, 1, sizeof(pwd));
+    memset(salt, 2, sizeof(salt));
+    memset(secret, 3, sizeof(secret));
+    memset(ad, 4, sizeof(ad));
+    rx_argon2d(memory, 32, 3, 4, pwd, sizeof(pwd), salt, sizeof(salt), secret, sizeof(secret),
+               ad, sizeof(ad), tag, sizeof(tag));
+    hex_encode(tag, 32, hex);
+    CHECK(!strcmp(hex, "512b391b6f1162975371d30919734294f868e3be3984f3c1a13a4db9fabe4acb"),
+          "argon2d tag = %s", hex);
+}
+
+static void test_rxaes(void) {
+    /* Decryption rounds against the byte-wise reference */
+    for (int i = 0; i < 1000; i++) {
+        uint8_t in[16], rk[16], want[16];
+        uint32_t got[4], k[4];
+        test_rand_bytes(in, 16);
+        test_rand_bytes(rk, 16);
+        aes_dec_single_round(want, in, rk);
+
+        memcpy(got, in, 16);
+        memcpy(k, rk, 16);
+        aes_dec_round_tt(got, k);
+        CHECK(!memcmp(want, got, 16), "T-table AESDEC mismatch (case %d)", i);
+
+        memcpy(got, in, 16);
+        rx_aesdec(got, k);
+        CHECK(!memcmp(want, got, 16), "rx_aesdec mismatch (case %d)", i);
+    }
+
+    /* Selected generators and hash against the portable ones */
+    const struct rx_aes_backend *aes = rx_select_aes();
+    static uint8_t want[4096], got[4096];
+    uint8_t seed[64], state[64], hw[64], hg[64];
+
+    test_rand_bytes(seed, sizeof(seed));
+    memcpy(state, seed, 64);
+    rx_aes_portable.fill1r(state, sizeof(want), want);
+    memcpy(hw, state, 64);
+    memcpy(state, seed, 64);
+    aes->fill1r(state, sizeof(got), got);
+    CHECK(!memcmp(want, got, sizeof(got)) && !memcmp(hw, state, 64), "%s fill1r mismatch", aes->name);
+
+    rx_aes_portable.fill4r(seed, sizeof(want), want);
+    aes->fill4r(seed, sizeof(got), got);
+    CHECK(!memcmp(want, got, sizeof(got)), "%s fill4r mismatch", aes->name);
+
+    rx_aes_portable.hash1r(want, sizeof(want), hw);
+    aes->hash1r(want, sizeof(want), hg);
+    CHECK(!memcmp(hw, hg, 64), "%s hash1r mismatch", aes->name);
+}
+
+static void test_superscalar(void) {
+    /* RandomX tests/tests.cpp: reciprocals, cache words and dataset items */
+    static const uint64_t rcp[][2] = {
+        { 3, 12297829382473034410ull }, { 13, 11351842506898185609ull },
+        { 33, 17887751829051686415ull }, { 65537, 18446462603027742720ull },
+        { 15000001, 10316166306300415204ull }, { 3845182035, 10302264209224146340ull },
+        { 0xffffffff, 9223372039002259456ull },
+    };
+    for (size_t i = 0; i < sizeof(rcp) / sizeof(rcp[0]); i++)
+        CHECK(rx_reciprocal(rcp[i][0]) == rcp[i][1], "reciprocal(%llu) = %llu",
+              (unsigned long long)rcp[i][0], (unsigned long long)rx_reciprocal(rcp[i][0]));
+
+    const rx_cache *cache = test_rx_cache_for("test key 000");
+    CHECK(cache != NULL, "rx_cache_create failed");
+    if (!cache) return;
+
+    const uint64_t *words = (const uint64_t *)cache->memory;
+    CHECK(words[0] == 0x191e0e1d23c02186ull && words[1568413] == 0xf1b62fe6210bf8b1ull &&
+          words[33554431] == 0x1f47f056d05cd99bull,
+          "cache words %016llx %016llx %016llx", (unsigned long long)words[0],
+          (unsigned long long)words[1568413], (unsigned long long)words[33554431]);
+
+    static const uint64_t items[][2] = {
+        { 0, 0x680588a85ae222dbull }, { 10000000, 0x7943a1f6186ffb72ull },
+        { 20000000, 0x9035244d718095e1ull }, { 30000000, 0x145a5091f7853099ull },
+    };
+    for (size_t i = 0; i < sizeof(items) / sizeof(items[0]); i++) {
+        uint64_t item[8];
+        rx_dataset_item(cache, items[i][0], item);
+        CHECK(item[0] == items[i][1], "dataset item %llu = %016llx",
+              (unsigned long long)items[i][0], (unsigned long long)item[0]);
+    }
+}
+
+/* Software rounding against known answers and, natively, the FPU */
+static void test_rounding(void) {
+    CHECK(rx_fdiv_soft(1.0, 3.0, RX_ROUND_UP) == 0x1.5555555555556p-2 &&
+          rx_fdiv_soft(1.0, 3.0, RX_ROUND_DOWN) == 0x1.5555555555555p-2 &&
+          rx_fdiv_soft(-1.0, 3.0, RX_ROUND_ZERO) == -0x1.5555555555555p-2,
+          "1/3 rounding");
+    CHECK(rx_fadd_soft(1.0, 0x1p-60, RX_ROUND_UP) == 0x1.0000000000001p+0 &&
+          rx_fadd_soft(1.0, -0x1p-60, RX_ROUND_ZERO) == 0x1.fffffffffffffp-1,
+          "1 +- 2^-60 rounding");
+    CHECK(rx_fmul_soft(DBL_MAX, 2.0, RX_ROUND_ZERO) == DBL_MAX &&
+          rx_fmul_soft(DBL_MAX, -2.0, RX_ROUND_UP) == -DBL_MAX &&
+          isinf(rx_fmul_soft(DBL_MAX, 2.0, RX_ROUND_UP)),
+          "overflow rounding");
+    CHECK(signbit(rx_fsub_soft(1.0, 1.0, RX_ROUND_DOWN)) && !signbit(rx_fsub_soft(1.0, 1.0, RX_ROUND_UP)),
+          "sign of an exact zero");
+
+#if RX_HW_ROUNDING
+    /* Operands over the ranges RandomX produces: integers, wide
+     * exponents (no subnormals) and values at the overflow limit */
+    static const char *const names[5] = { "add", "sub", "mul", "div", "sqrt" };
+    for (int i = 0; i < 200000; i++) {
+        double v[2];
+        for (int j = 0; j < 2; j++) {
+            const uint64_t r = test_rand64();
+            switch (test_rand64() % 4) {
+            case 0:  v[j] = (double)(int32_t)r; break;
+            case 1:  v[j] = ldexp((double)(r >> 11), (int)(test_rand64() % 1800) - 900 - 53); break;
+            case 2:  v[j] = DBL_MAX; break;
+            default: v[j] = ldexp((double)(r >> 11), (int)(test_rand64() % 200) - 100 - 53); break;
+            }
+            if (r & 1) v[j] = -v[j];
+        }
+        /* FMUL_R multiplies by A-group values (positive, [1, 2^32));
+         * FDIV_M divides by E-group ones (positive, [2^-255, 2)) */
+        const uint64_t e = test_rand64();
+        const double areg = ldexp((double)((e >> 11) | (1ull << 52)), (int)(e % 32) - 52);
+        const double divisor = ldexp((double)((e >> 11) | (1ull << 52)), -(int)(e % 256) - 52);
+        const uint32_t mode = (uint32_t)(test_rand64() % 4);
+        volatile double a = v[0], b = v[1], m = areg, d = divisor, x = fabs(v[0]);
+        double hw[5], sw[5];
+
+        rx_set_rounding(mode);
+        hw[0] = a + b; hw[1] = a - b; hw[2] = a * m; hw[3] = a / d; hw[4] = sqrt(x);
+        rx_set_rounding(RX_ROUND_NEAREST);
+        sw[0] = rx_fadd_soft(a, b, mode);
+        sw[1] = rx_fsub_soft(a, b, mode);
+        sw[2] = rx_fmul_soft(a, m, mode);
+        sw[3] = rx_fdiv_soft(a, d, mode);
+        sw[4] = rx_fsqrt_soft(x, mode);
+        for (int k = 0; k < 5; k++)
+            CHECK(rx_dbits(hw[k]) == rx_dbits(sw[k]), "soft %s mode %u (%a, %a) = %a, want %a",
+                  names[k], mode, (double)a, (double)b, sw[k], hw[k]);
+    }
+#endif
+}
+
+#if CN_THREADS
+/* Control word for scans preempted from another thread (see test_control) */
+static uint32_t test_control_word;
+static uint64_t test_control_delay;         /* ns before the bump */
+static uint64_t test_control_bumped;        /* cn_pool_now_ns() at the bump */
+
+/* Moves the control word on after test_control_delay, mid-scan */
+static void *test_control_bump(void *arg) {
+    (void)arg;
+    const uint64_t until = cn_pool_now_ns() + test_control_delay;
+    while (cn_pool_now_ns() < until) {}
+    cn_control_store(&test_control_word, test_control_word | CN_CONTROL_STOP);
+    test_control_bumped = cn_pool_now_ns();
+    return NULL;
+}
+
+/* Runs scan() with the word moved on `delay` ns in; 1 if that happened
+ * before scan() returned, 0 if not (or no thread could be started).  Only
+ * what the scan covered is checked, not how soon it stopped: under load
+ * the wall clock measures the scheduler more than the kernel. */
+static int test_control_preempt(void (*scan)(void *), void *arg, uint64_t delay) {
+    pthread_t bump;
+    test_control_delay = delay;
+    if (pthread_create(&bump, NULL, test_control_bump, NULL)) return 0;
+    scan(arg);
+    const uint64_t end = cn_pool_now_ns();
+    pthread_join(bump, NULL);
+    return test_control_bumped < end;
+}
+
+static void test_rx_scan_one(void *ctx) {
+    uint8_t records[CN_SCAN_RESULT_SIZE];
+    rx_ctx_scan((rx_ctx *)ctx, 0, 1, UINT64_MAX, records);
+}
+
+static void test_cn_scan_one(void *ctx) {
+    uint8_t records[CN_SCAN_RESULT_SIZE];
+    cn_ctx_scan((cn_ctx *)ctx, 0, 1, UINT64_MAX, records);
+}
+
+/* ~1M hashes without a share: seconds of pico hashing */
+static void test_cn_scan_many(void *ctx) {
+    uint8_t records[CN_SCAN_RESULT_SIZE];
+    cn_ctx_scan((cn_ctx *)ctx, 0, 1u << 20, 0, records);
+}
+#endif
+
+static void test_rx(void) {
+    /* RandomX tests/tests.cpp: key, input, expected hash */
+    static const char *const vectors[][3] = {
+        { "test key 000", "This is a test",
+          "639183aae1bf4c9a35884cb46b09cad9175f04efd7684e7262a0ac1c2f0b4e3f" },
+        { "test key 000", "Lorem ipsum dolor sit amet",
+          "300a0adb47603dedb42228ccb2b211104f4da45af709cd7547cd049e9489c969" },
+        { "test key 000", "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua",
+          "c36d4ed4191e617309867ed66a443be4075014e2b061bcdaf9ce7b721d2b77a8" },
+        { "test key 001", "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua",
+          "e9ff4503201c0c2cca26d285c93ae883f9b1d30c9eb240b820756f2d5a7905fc" },
+        { "test key 001", "0b0b98bea7e805e0010a2126d287a2a0cc833d312cb786385a7c2f9de69d2553"
+                          "7f584a9bc9977b00000000666fd8753bf61a8631f12984e3fd44f4014eca6292"
+                          "76817b56f32e9b68bd82f416",
+          "c56414121acda1713c2f2a819d8ae38aed7c80c35c2a769298d34f03833cd5f1" },
+    };
+    uint8_t in[128], out[32];
+    char hex[65];
+    size_t len;
+
+    rx_cache *cache = test_rx_cache_for("test key 000");
+    rx_ctx *ctx = cache ? rx_ctx_create(cache) : NULL;
+    CHECK(ctx != NULL, "rx_ctx_create failed");
+    if (!ctx) return;
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        test_rx_cache_for(vectors[i][0]);
+        if (i == 4) {
+            hex_decode(vectors[i][1], in, &len);
+        } else {
+            len = strlen(vectors[i][1]);
+            memcpy(in, vectors[i][1], len);
+        }
+        rx_ctx_hash(ctx, in, (uint32_t)len, out);
+        hex_encode(out, 32, hex);
+        CHECK(!strcmp(hex, vectors[i][2]), "rx/0(%s, %s) = %s, want %s",
+              vectors[i][0], vectors[i][1], hex, vectors[i][2]);
+    }
+
+    /* Scan records against single hashes; target 0 matches nothing */
+    uint8_t blob[76], records[CN_SCAN_RESULT_SIZE * CN_SCAN_MAX_RESULTS];
+    test_rand_bytes(blob, sizeof(blob));
+    CHECK(rx_ctx_set_job(ctx, blob, sizeof(blob)) == 1, "rx_ctx_set_job refused a 76-byte blob");
+    CHECK(rx_ctx_scan(ctx, 7, 3, 0, records) == 0, "rx_ctx_scan with target 0 found hashes");
+    const uint32_t found = rx_ctx_scan(ctx, 0xFFFFFFFE, 3, UINT64_MAX, records);
+    CHECK(found == 3, "rx_ctx_scan found %u of 3", found);
+    for (uint32_t r = 0; r < found; r++) {
+        const uint32_t nonce = 0xFFFFFFFE + r;
+        cn_set_nonce(blob, sizeof(blob), nonce);
+        rx_ctx_hash(ctx, blob, sizeof(blob), out);
+        CHECK(rx_load64(records + r * CN_SCAN_RESULT_SIZE) << 32 >> 32 == nonce &&
+              !memcmp(records + r * CN_SCAN_RESULT_SIZE + 4, out, 32), "rx_ctx_scan record %u", r);
+    }
+
+    /* A control word that has moved on stops the scan before any hash */
+    uint32_t word = 7;
+    rx_ctx_set_control(ctx, &word, 7);
+    CHECK(rx_ctx_scan(ctx, 0, 2, 0, records) == 0 && rx_ctx_scanned(ctx) == 2,
+          "armed rx_ctx_scan covered %u of 2", rx_ctx_scanned(ctx));
+    word = 8;
+    CHECK(rx_ctx_scan(ctx, 0, 2, UINT64_MAX, records) == 0 && rx_ctx_scanned(ctx) == 0,
+          "rx_ctx_scan ran past its control word");
+    rx_ctx_set_control(ctx, NULL, 0);
+
+#if CN_THREADS
+    /* A hash stopped halfway is abandoned, and the context hashes the next
+     * one right */
+    uint8_t first[CN_SCAN_RESULT_SIZE], again[CN_SCAN_RESULT_SIZE];
+    uint64_t t = cn_pool_now_ns();
+    rx_ctx_scan(ctx, 0, 1, UINT64_MAX, first);
+    const uint64_t hash_ns = cn_pool_now_ns() - t;
+    test_control_word = 3;
+    rx_ctx_set_control(ctx, &test_control_word, 3);
+    if (test_control_preempt(test_rx_scan_one, ctx, hash_ns / 2))
+        CHECK(rx_ctx_scanned(ctx) == 0, "rx/0 hash finished past its control word");
+    rx_ctx_set_control(ctx, NULL, 0);
+    rx_ctx_scan(ctx, 0, 1, UINT64_MAX, again);
+    CHECK(!memcmp(first, again, sizeof(first)), "rx/0 hash after an abandoned one");
+#endif
+
+    cn_stats stats = { 0 };
+    rx_ctx_set_stats(ctx, &stats);
+    rx_ctx_scan(ctx, 5, 2, UINT64_MAX, records);
+    rx_ctx_set_stats(ctx, NULL);
+    CHECK(stats.hashes == 2 && stats.shares == 2 && stats.busy_ns > 0, "rx_ctx_scan stats");
+    rx_ctx_destroy(ctx);
+    rx_cache_destroy(test_rx_cache);
+    test_rx_cache = NULL;
+
+    /* rx_slow_hash() against a cache imported from its own memory */
+    uint8_t seedhash[32], want[32];
+    test_rand_bytes(seedhash, sizeof(seedhash));
+    rx_slow_hash((const char *)seedhash, blob, sizeof(blob), (char *)want);
+    rx_cache *imported = rx_cache_create();
+    CHECK(imported != NULL, "second rx_cache_create failed");
+    if (!imported) return;
+    memcpy(rx_cache_memory(imported), rx_cache_memory(rx_default_cache), rx_cache_size());
+    CHECK(rx_cache_import(imported, seedhash, sizeof(seedhash)) == 1, "rx_cache_import failed");
+    ctx = rx_ctx_create(imported);
+    rx_ctx_hash(ctx, blob, sizeof(blob), out);
+    CHECK(!memcmp(out, want, 32), "imported cache hashes differently from rx_slow_hash");
+    rx_ctx_destroy(ctx);
+    rx_cache_destroy(imported);
+}
+
+/* Full-mode initialisation fills ranges on several threads; a 2 GB
+ * dataset is too big for a unit test, so compare item ranges at both ends
+ * and the VM's dataset reads against items computed from the cache */
+static void test_dataset(void) {
+#if RX_FULL_MODE
+    enum { ITEMS = 1000 };
+    static const uint64_t starts[] = { 0, 12345, RX_DATASET_ITEMS - ITEMS };
+    static const uint32_t threads[] = { 1, 3, 7 };
+    uint64_t item[8];
+
+    rx_cache *cache = test_rx_cache_for("test key 000");
+    uint8_t *buf = (uint8_t *)malloc(ITEMS * RX_CACHE_LINE_SIZE);
+    CHECK(cache && buf, "out of memory");
+    if (!cache || !buf) {
+        free(buf);
+        return;
+    }
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+            memset(buf, 0xA5, ITEMS * RX_CACHE_LINE_SIZE);
+            rx_dataset_fill(cache, buf, starts[s], ITEMS, threads[t]);
+            int bad = 0;
+            for (uint64_t i = 0; i < ITEMS && !bad; i++) {
+                rx_dataset_item(cache, starts[s] + i, item);
+                bad = memcmp(buf + i * RX_CACHE_LINE_SIZE, item, sizeof(item)) != 0;
+            }
+            CHECK(!bad, "dataset items %llu.. on %u threads differ",
+                  (unsigned long long)starts[s], threads[t]);
+        }
+    }
+
+    /* Reads of the first ITEMS lines, served from buf as a dataset */
+    rx_dataset_fill(cache, buf, 0, ITEMS, 2);
+    for (uint64_t line = 0; line < ITEMS; line += 97) {
+        uint64_t full[8], light[8];
+        for (int i = 0; i < 8; i++)
+            full[i] = light[i] = line * 8 + (uint64_t)i;
+        rx_dataset_read(cache, buf, line * RX_CACHE_LINE_SIZE, full);
+        rx_dataset_read(cache, NULL, line * RX_CACHE_LINE_SIZE, light);
+        CHECK(!memcmp(full, light, sizeof(full)), "full-mode read of line %llu",
+              (unsigned long long)line);
+    }
+    free(buf);
+#endif
+}
+
+/* ========================= Preemption ========================= */
+
+static void test_control(void) {
+    uint8_t blob[76], results[CN_SCAN_MAX_RESULTS * CN_SCAN_RESULT_SIZE];
+    cn_ctx *ctx = cn_ctx_create_algo(CN_ALGO_PICO0, 2);
+    CHECK(ctx != NULL, "out of memory");
+    if (!ctx) return;
+    test_rand_bytes(blob, sizeof(blob));
+    cn_ctx_set_job(ctx, blob, sizeof(blob));
+
+    /* Where the next scan resumes: everything, or up to the last record
+     * once the results fill up (every hash meets UINT64_MAX) */
+    CHECK(cn_ctx_scan(ctx, 0, 7, 0, results) == 0 && cn_ctx_scanned(ctx) == 7,
+          "cn_ctx_scanned after a full scan: %u", cn_ctx_scanned(ctx));
+    CHECK(cn_ctx_scan(ctx, 0, 40, UINT64_MAX, results) == CN_SCAN_MAX_RESULTS &&
+          cn_ctx_scanned(ctx) == CN_SCAN_MAX_RESULTS,
+          "cn_ctx_scanned after full results: %u", cn_ctx_scanned(ctx));
+
+    /* Armed: runs while the word holds `expect`, stops before any kernel
+     * call once it doesn't (new generation or stop bit) */
+    uint32_t word = 5;
+    cn_ctx_set_control(ctx, &word, 5);
+    CHECK(cn_ctx_scan(ctx, 0, 7, 0, results) == 0 && cn_ctx_scanned(ctx) == 7,
+          "armed scan covered %u of 7", cn_ctx_scanned(ctx));
+    word = 5 | CN_CONTROL_STOP;
+    CHECK(cn_ctx_scan(ctx, 0, 7, UINT64_MAX, results) == 0 && cn_ctx_scanned(ctx) == 0,
+          "scan ran past a stop");
+    word = 6;
+    CHECK(cn_ctx_scan(ctx, 0, 7, UINT64_MAX, results) == 0 && cn_ctx_scanned(ctx) == 0,
+          "scan ran past a new generation");
+    cn_ctx_set_host_control(ctx, 6);        /* no page natively: disarmed */
+    CHECK(cn_ctx_scan(ctx, 0, 3, 0, results) == 0 && cn_ctx_scanned(ctx) == 3,
+          "host control word armed outside the browser");
+    cn_ctx_set_control(ctx, NULL, 0);
+    CHECK(cn_ctx_scan(ctx, 0, 3, 0, results) == 0 && cn_ctx_scanned(ctx) == 3,
+          "disarmed scan stopped");
+
+#if CN_THREADS
+    /* Another thread stops a scan of ~1M hashes mid-way */
+    test_control_word = 9;
+    cn_ctx_set_control(ctx, &test_control_word, 9);
+    if (test_control_preempt(test_cn_scan_many, ctx, 20000000u))
+        CHECK(cn_ctx_scanned(ctx) < 1u << 20, "preempted scan covered %u of %u",
+              cn_ctx_scanned(ctx), 1u << 20);
+#endif
+    cn_ctx_destroy(ctx);
+
+#if CN_THREADS
+    /* ... and a single cn/0 hash halfway through its main loop; the context
+     * hashes the next one right */
+    uint8_t first[CN_SCAN_RESULT_SIZE], again[CN_SCAN_RESULT_SIZE];
+    ctx = cn_ctx_create_algo(CN_ALGO_CN0, 1);
+    CHECK(ctx != NULL, "out of memory");
+    if (!ctx) return;
+    cn_ctx_set_job(ctx, blob, sizeof(blob));
+    uint64_t t = cn_pool_now_ns();
+    cn_ctx_scan(ctx, 0, 1, UINT64_MAX, first);
+    const uint64_t hash_ns = cn_pool_now_ns() - t;
+    test_control_word = 3;
+    cn_ctx_set_control(ctx, &test_control_word, 3);
+    if (test_control_preempt(test_cn_scan_one, ctx, hash_ns / 2))
+        CHECK(cn_ctx_scanned(ctx) == 0, "cn/0 hash finished past its control word");
+    cn_ctx_hash(ctx, blob, sizeof(blob), again);
+    CHECK(!memcmp(again, (uint8_t[32]){ 0 }, 32), "cn_ctx_hash past its control word");
+    cn_ctx_set_control(ctx, NULL, 0);
+    cn_ctx_scan(ctx, 0, 1, UINT64_MAX, again);
+    CHECK(!memcmp(first, again, sizeof(first)), "cn/0 hash after an abandoned one");
+    cn_ctx_destroy(ctx);
+#endif
+}
+
+/* ========================= Statistics ========================= */
+
+static void test_stats(void) {
+    uint8_t blob[76], results[CN_SCAN_MAX_RESULTS * CN_SCAN_RESULT_SIZE];
+    cn_stats stats = { 0 };
+    cn_ctx *ctx = cn_ctx_create_algo(CN_ALGO_PICO0, 4);
+    CHECK(ctx != NULL, "out of memory");
+    if (!ctx) return;
+    test_rand_bytes(blob, sizeof(blob));
+    cn_ctx_set_job(ctx, blob, sizeof(blob));
+
+    /* Nonces covered, records reported, time and end of the last scan */
+    const uint64_t before = cn_clock_ns();
+    cn_ctx_set_stats(ctx, &stats);
+    cn_ctx_scan(ctx, 0, 7, 0, results);
+    CHECK(stats.hashes == 7 && stats.shares == 0 && stats.busy_ns > 0,
+          "stats after 7 nonces: %llu hashes, %llu shares, %llu ns",
+          (unsigned long long)stats.hashes, (unsigned long long)stats.shares,
+          (unsigned long long)stats.busy_ns);
+    CHECK(stats.last_ns >= before && stats.last_ns <= cn_clock_ns(), "last scan timestamp");
+    cn_ctx_scan(ctx, 0, 40, UINT64_MAX, results);
+    CHECK(stats.hashes == 7 + CN_SCAN_MAX_RESULTS && stats.shares == CN_SCAN_MAX_RESULTS,
+          "stats after full results: %llu hashes, %llu shares",
+          (unsigned long long)stats.hashes, (unsigned long long)stats.shares);
+
+    /* A stopped scan counts what it covered */
+    uint32_t word = 1 | CN_CONTROL_STOP;
+    cn_ctx_set_control(ctx, &word, 1);
+    cn_ctx_scan(ctx, 0, 7, 0, results);
+    cn_ctx_set_control(ctx, NULL, 0);
+    CHECK(stats.hashes == 7 + CN_SCAN_MAX_RESULTS, "stopped scan counted hashes");
+
+    /* Disarmed, and natively no page to count into */
+    const uint64_t hashes = stats.hashes;
+    cn_ctx_set_stats(ctx, NULL);
+    cn_ctx_scan(ctx, 0, 3, 0, results);
+    cn_ctx_set_host_stats(ctx, 0);
+    cn_ctx_scan(ctx, 0, 3, 0, results);
+    CHECK(stats.hashes == hashes, "scans counted after cn_ctx_set_stats(NULL)");
+    cn_ctx_destroy(ctx);
+}
+
+/* ========================= Thread pool ========================= */
+
+#if CN_THREADS
+static uint32_t test_load32le(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* Runs a job on the pool until `nonces` hashes are done and checks every
+ * share it reported against a single-threaded hash of that nonce */
+static void test_pool_job(cn_pool *pool, uint32_t algo, uint64_t height, uint32_t nonces) {
+    enum { MAX_SHARES = 256 };
+    static uint8_t shares[MAX_SHARES * CN_POOL_RESULT_SIZE];
+    uint8_t blob[76], input[76], hash[32];
+    const uint64_t target = cn_target_from_difficulty(4);
+    uint32_t found = 0;
+
+    test_rand_bytes(blob, sizeof(blob));
+    const uint64_t start = cn_pool_hashes(pool);
+    const uint32_t id = cn_pool_set_job(pool, algo, blob, sizeof(blob), target, height, 1000);
+    CHECK(id != 0, "%s: job rejected", cn_algos[algo].name);
+    if (!id) return;
+    /* The count includes batches of the previous job still in flight */
+    for (uint64_t done = 0; found < MAX_SHARES && (done < nonces || (!found && done < 64 * nonces)); ) {
+        found += cn_pool_results(pool, shares + (size_t)found * CN_POOL_RESULT_SIZE,
+                                 MAX_SHARES - found);
+        done = cn_pool_hashes(pool) - start;
+    }
+    cn_pool_pause(pool);
+    CHECK(found > 0, "%s: no shares in %u hashes", cn_algos[algo].name, nonces);
+    CHECK(cn_pool_stats(pool)->shares >= found && cn_pool_stats(pool)->hashes == cn_pool_hashes(pool),
+          "%s: pool stats behind the shares queued", cn_algos[algo].name);
+
+    cn_ctx *ctx = cn_ctx_create_algo(algo, 1);
+    CHECK(ctx != NULL, "out of memory");
+    if (!ctx) return;
+    cn_ctx_set_height(ctx, height);
+    for (uint32_t i = 0; i < found; i++) {
+        const uint8_t *rec = shares + (size_t)i * CN_POOL_RESULT_SIZE;
+        const uint32_t rec_id = test_load32le(rec);
+        const uint32_t nonce = test_load32le(rec + 4);
+        int dup = 0;
+        for (uint32_t j = 0; j < i; j++)
+            dup |= !memcmp(rec + 4, shares + (size_t)j * CN_POOL_RESULT_SIZE + 4, 4);
+
+        memcpy(input, blob, sizeof(blob));
+        cn_set_nonce(input, sizeof(input), nonce);
+        cn_ctx_hash(ctx, input, sizeof(input), hash);
+        CHECK(rec_id == id && !dup && nonce >= 1000, "%s: share %u: job %u, nonce %u%s",
+              cn_algos[algo].name, i, rec_id, nonce, dup ? " (duplicate)" : "");
+        CHECK(!memcmp(rec + 8, hash, 32) && cn_hash_meets_target(hash, target),
+              "%s: share at nonce %u differs from cn_ctx_hash", cn_algos[algo].name, nonce);
+    }
+    cn_ctx_destroy(ctx);
+}
+#endif
+
+static void test_pool(void) {
+#if CN_THREADS
+    cn_pool *pool = cn_pool_create(3, 2, 4);
+    CHECK(pool && cn_pool_threads(pool) == 3, "cn_pool_create(3, 2, 4)");
+    if (!pool) return;
+
+    uint8_t blob[76] = { 0 }, shares[CN_POOL_RESULT_SIZE];
+    CHECK(!cn_pool_set_job(pool, CN_ALGO_COUNT, blob, sizeof(blob), 0, 0, 0) &&
+          !cn_pool_set_job(pool, CN_ALGO_CN0, blob, 42, 0, 0, 0),
+          "bad algo / short blob accepted");
+
+    /* Job switches: a new algorithm recreates the threads' contexts, cn/r
+     * compiles its program on each thread */
+    test_pool_job(pool, CN_ALGO_PICO0, 0, 64);
+    test_pool_job(pool, CN_ALGO_LITE1, 0, 24);
+    test_pool_job(pool, CN_ALGO_R, 1806260, 12);
+    test_pool_job(pool, CN_ALGO_PICO0, 0, 64);
+
+    /* Batch lengths: one nonce per way until the rate is measured, then
+     * one time slice, lengthened (up to two) below 100% duty so sleeps
+     * stay >= CN_POOL_MIN_SLEEP_NS; fixed batches with slices off */
+    {
+        cn_pool p = { .ways = 2, .batch = 16, .slice_ns = 250000000u, .duty = 1000 };
+        CHECK(cn_pool_batch(&p, 0) == 2 && cn_pool_batch(&p, 1000000u) == 250 &&
+              cn_pool_batch(&p, 3000000u) == 84 && cn_pool_batch(&p, 900000000u) == 2,
+              "time-slice batch lengths");
+        p.duty = 950;                       /* 475 ms of hashing per 25 ms sleep */
+        CHECK(cn_pool_batch(&p, 1000000u) == 476, "batch at 95%% duty: %u",
+              cn_pool_batch(&p, 1000000u));
+        p.duty = 990;                       /* capped at two slices */
+        CHECK(cn_pool_batch(&p, 1000000u) == 500, "batch at 99%% duty: %u",
+              cn_pool_batch(&p, 1000000u));
+        p.duty = 1000;
+        p.slice_ns = 0;
+        CHECK(cn_pool_batch(&p, 0) == 16 && cn_pool_batch(&p, 1000000u) == 16,
+              "fixed batch length");
+    }
+
+    /* Below 100% the threads sleep between longer batches */
+    const uint64_t busy_ns = cn_pool_busy_ns(pool);
+    cn_pool_set_duty(pool, 250);
+    test_pool_job(pool, CN_ALGO_PICO0, 0, 64);
+    CHECK(cn_pool_busy_ns(pool) > busy_ns, "no hashing time accounted");
+    cn_pool_set_duty(pool, 1000);
+
+    /* Nothing from earlier jobs is left once a new one is set */
+    cn_pool_set_job(pool, CN_ALGO_PICO0, blob, sizeof(blob), 0, 0, 0);
+    CHECK(cn_pool_results(pool, shares, 1) == 0, "shares of an earlier job after a job switch");
+
+    /* Batches of seconds don't hold up shutdown: the control word ends
+     * them mid-hash, long before the batch would (the bound is loose, for
+     * loaded machines) */
+    cn_pool_set_slice(pool, 5000);
+    const uint64_t hashes = cn_pool_hashes(pool);
+    cn_pool_set_job(pool, CN_ALGO_PICO0, blob, sizeof(blob), 0, 0, 0);
+    while (cn_pool_hashes(pool) < hashes + 3 * 2) {}
+    const uint64_t settle = cn_pool_now_ns() + 50000000u;
+    while (cn_pool_now_ns() < settle) {}
+    const uint64_t start = cn_pool_now_ns();
+    cn_pool_destroy(pool);
+    const uint64_t ms = (cn_pool_now_ns() - start) / 1000000u;
+    CHECK(ms < 2500, "cn_pool_destroy waited %llu ms for 5 s batches", (unsigned long long)ms);
+#endif
+}
+
+/* ============================= Main ============================= */
+
+int main(int argc, char **argv) {
+    const uint32_t diff_rounds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 4;
+
+    printf("cn_test: backend %s, T-table %d, SIMD128 %d, AES-NI %d, unrolled Keccak %d\n",
+           cn_select_backend(&cn_algos[CN_ALGO_CN0])->name, CN_AES_TTABLE, CN_SIMD128, CN_X86_AESNI, CN_KECCAK_UNROLLED);
+
+    static const struct { const char *name; void (*fn)(void); } groups[] = {
+        { "keccak", test_keccak },
+        { "aes",    test_aes },
+        { "mul",    test_mul },
+        { "target", test_target },
+        { "control", test_control },
+        { "stats",  test_stats },
+        { "sqrt",   test_sqrt },
+        { "cnr",    test_cnr },
+        { "kat",    test_kat },
+        { "blake2b", test_blake2b },
+        { "argon2", test_argon2 },
+        { "rxaes",  test_rxaes },
+        { "superscalar", test_superscalar },
+        { "rounding", test_rounding },
+        { "rx",     test_rx },
+        { "dataset", test_dataset },
+        { "pool",   test_pool },
+    };
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+        const int before = test_failures;
+        groups[g].fn();
+        printf("%-7s %s\n", groups[g].name, test_failures == before ? "ok" : "FAILED");
+    }
+
+    const int before = test_failures;
+    test_diff(diff_rounds);
+    printf("%-7s %s (%u rounds)\n", "diff", test_failures == before ? "ok" : "FAILED", diff_rounds);
+
+    printf("%d checks, %d failures\n", test_checks, test_failures);
+    return test_failures ? 1 : 0;
+}
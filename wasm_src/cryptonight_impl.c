@@ -1,11 +1,24 @@
 /**
- * CryptoNight v0 (cn/0) implementation for WASM.
+ * CryptoNight family (cn/0, cn/1, cn/2, cn/r, cn-lite, cn-heavy, cn-pico)
+ * implementation for WASM.
  *
  * Includes:
- *  - Keccak-f[1600] (standard permutation)
+ *  - Keccak-f[1600]: unrolled, lane-complemented permutation (the
+ *    table-driven loop with -DCN_KECCAK_UNROLLED=0)
  *  - Software AES with correct SubBytes + ShiftRows + MixColumns + AddRoundKey
+ *  - T-table AES round engine used by the kernel (-DCN_AES_TTABLE=0 selects
+ *    the byte-wise reference rounds instead)
+ *  - WebAssembly SIMD128 AES state / XOR / scratchpad path (-msimd128)
+ *  - Native x86-64 AES-NI kernel, selected at runtime by cpuid
+ *  - 64x64->128 multiply from the widest native product available
+ *    (__int128, _umul128, WASM wide-arithmetic; portable otherwise)
  *  - AES-256 key expansion
- *  - CryptoNight main algorithm (2 MB scratchpad, 524288 iterations)
+ *  - CryptoNight main algorithm, one kernel instantiated per family member
+ *    (cn/0: 2 MB scratchpad, 524288 iterations), with the variant 1
+ *    (VARIANT1 tweaks) and variant 2 (shuffle, division, square root)
+ *    steps compiled into their own loops
+ *  - cn/r random-math programs (Monero's variant4_random_math.h), compiled
+ *    once per block height to x86-64 code or a WebAssembly module
  *  - Final hash selection: Blake-256 / Groestl-256 / JH-256 / Skein-256
  *    (uses Monero's proven implementations linked at compile time)
  *
@@ -14,8 +27,11 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#include <time.h>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -23,6 +39,107 @@
 #define EMSCRIPTEN_KEEPALIVE
 #endif
 
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define CN_SIMD128 1
+#else
+#define CN_SIMD128 0
+#endif
+
+/* Native x86-64 builds carry an AES-NI kernel chosen at runtime via cpuid
+ * (-DCN_X86_AESNI=0 leaves it out) */
+#ifndef CN_X86_AESNI
+#if !defined(__EMSCRIPTEN__) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CN_X86_AESNI 1
+#else
+#define CN_X86_AESNI 0
+#endif
+#endif
+
+#if CN_X86_AESNI
+#include <immintrin.h>
+#endif
+
+/* Native Linux builds back scratchpads with 2 MB pages when they can
+ * (-DCN_HUGEPAGES=0 always uses plain aligned memory) */
+#ifndef CN_HUGEPAGES
+#if !defined(__EMSCRIPTEN__) && defined(__linux__)
+#define CN_HUGEPAGES 1
+#else
+#define CN_HUGEPAGES 0
+#endif
+#endif
+
+#if CN_HUGEPAGES
+#include <sys/mman.h>
+#endif
+
+/* cn/r programs are compiled per height: to x86-64 code on native Linux,
+ * to a WebAssembly module under Emscripten (-DCN_R_JIT=0 interprets them) */
+#ifndef CN_R_JIT
+#if defined(__EMSCRIPTEN__) || (defined(__x86_64__) && defined(__linux__))
+#define CN_R_JIT 1
+#else
+#define CN_R_JIT 0
+#endif
+#endif
+
+#if CN_R_JIT && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#ifndef MAP_ANONYMOUS                       /* strict ISO C: no anonymous maps */
+#undef CN_R_JIT
+#define CN_R_JIT 0
+#endif
+#endif
+
+/* cn_pool hashing threads: native POSIX builds and the Emscripten -pthread
+ * build, where they are Web Workers sharing the module's memory
+ * (-DCN_THREADS=0 leaves the pool out) */
+#ifndef CN_THREADS
+#if defined(__EMSCRIPTEN_PTHREADS__) || \
+    (!defined(__EMSCRIPTEN__) && (defined(__unix__) || defined(__APPLE__)))
+#define CN_THREADS 1
+#else
+#define CN_THREADS 0
+#endif
+#endif
+
+#if CN_THREADS
+#include <pthread.h>
+#endif
+
+/* 64x64->128 multiply backend, picked at compile time (-DCN_MUL128=N):
+ *   CN_MUL128_PORTABLE  four 32x32 partial products; wasm32 MVP default,
+ *                       where __int128 would be an out-of-line __multi3 call
+ *   CN_MUL128_INT128    unsigned __int128: one MUL (x86-64) / MUL+UMULH (arm64)
+ *   CN_MUL128_UMUL128   MSVC _umul128
+ *   CN_MUL128_WIDE      WASM wide-arithmetic i64.mul_wide_u (-mwide-arithmetic) */
+#define CN_MUL128_PORTABLE 0
+#define CN_MUL128_INT128   1
+#define CN_MUL128_UMUL128  2
+#define CN_MUL128_WIDE     3
+
+#ifndef CN_MUL128
+#if defined(__wasm__)
+#if defined(__wasm_wide_arithmetic__)
+#define CN_MUL128 CN_MUL128_WIDE
+#else
+#define CN_MUL128 CN_MUL128_PORTABLE
+#endif
+#elif defined(__SIZEOF_INT128__)
+#define CN_MUL128 CN_MUL128_INT128
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+#define CN_MUL128 CN_MUL128_UMUL128
+#else
+#define CN_MUL128 CN_MUL128_PORTABLE
+#endif
+#endif
+
+#if CN_MUL128 == CN_MUL128_UMUL128
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
 /* ========================= Keccak-f[1600] ========================= */
 
 static const uint64_t keccak_rc[24] = {
@@ -38,46 +155,303 @@ static const uint64_t keccak_rc[24] = {
 
 #define ROTL64(x, y) (((x) << (y)) | ((x) >> (64 - (y))))
 
-static void keccakf(uint64_t st[25]) {
-    for (int round = 0; round < 24; round++) {
-        /* Theta */
-        uint64_t bc[5];
+static inline void keccak_theta(uint64_t st[25]) {
+    uint64_t bc[5];
+    for (int i = 0; i < 5; i++)
+        bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+    for (int i = 0; i < 5; i++) {
+        uint64_t t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
+        for (int j = 0; j < 25; j += 5)
+            st[j + i] ^= t;
+    }
+}
+
+/* Rho, Pi, Chi and Iota of one round (Theta already applied) */
+static inline void keccak_rho_pi_chi_iota(uint64_t st[25], int round) {
+    /* Rho + Pi */
+    uint64_t t = st[1];
+    static const int piln[24] = {
+        10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
+        15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1
+    };
+    static const int rotc[24] = {
+        1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
+        27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44
+    };
+    for (int i = 0; i < 24; i++) {
+        int j = piln[i];
+        uint64_t temp = st[j];
+        st[j] = ROTL64(t, rotc[i]);
+        t = temp;
+    }
+    /* Chi */
+    for (int j = 0; j < 25; j += 5) {
+        uint64_t tmp[5];
         for (int i = 0; i < 5; i++)
-            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
-        for (int i = 0; i < 5; i++) {
-            uint64_t t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
-            for (int j = 0; j < 25; j += 5)
-                st[j + i] ^= t;
-        }
-        /* Rho + Pi */
-        uint64_t t = st[1];
-        static const int piln[24] = {
-            10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
-            15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1
-        };
-        static const int rotc[24] = {
-            1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
-            27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44
-        };
-        for (int i = 0; i < 24; i++) {
-            int j = piln[i];
-            uint64_t temp = st[j];
-            st[j] = ROTL64(t, rotc[i]);
-            t = temp;
-        }
-        /* Chi */
-        for (int j = 0; j < 25; j += 5) {
-            uint64_t tmp[5];
-            for (int i = 0; i < 5; i++)
-                tmp[i] = st[j + i];
-            for (int i = 0; i < 5; i++)
-                st[j + i] = tmp[i] ^ ((~tmp[(i + 1) % 5]) & tmp[(i + 2) % 5]);
-        }
-        /* Iota */
-        st[0] ^= keccak_rc[round];
+            tmp[i] = st[j + i];
+        for (int i = 0; i < 5; i++)
+            st[j + i] = tmp[i] ^ ((~tmp[(i + 1) % 5]) & tmp[(i + 2) % 5]);
+    }
+    /* Iota */
+    st[0] ^= keccak_rc[round];
+}
+
+/* Reference permutation (table-driven loop); kept for -DCN_KECCAK_UNROLLED=0
+ * and as the test oracle for the unrolled one */
+static inline void keccakf_loop(uint64_t st[25]) {
+    for (int round = 0; round < 24; round++) {
+        keccak_theta(st);
+        keccak_rho_pi_chi_iota(st, round);
+    }
+}
+
+/** keccakf_loop() for a state whose round-0 Theta has already been applied. */
+static inline void keccakf_loop_after_theta0(uint64_t st[25]) {
+    keccak_rho_pi_chi_iota(st, 0);
+    for (int round = 1; round < 24; round++) {
+        keccak_theta(st);
+        keccak_rho_pi_chi_iota(st, round);
+    }
+}
+
+/*
+ * Unrolled Keccak-f[1600] (default; -DCN_KECCAK_UNROLLED=0 selects the loop).
+ * The 25 lanes live in locals, rotation counts and the pi lane order are
+ * spelled out, and rounds alternate between two lane sets (a -> e -> a), so
+ * nothing is indexed at run time and both native compilers and the WASM
+ * backend can keep the state in registers/locals.
+ *
+ * Lane complementing (Keccak implementation overview, sec. 2.2): lanes
+ * 1, 2, 8, 12, 17 and 20 are stored inverted between rounds.  With that
+ * pattern each Chi row needs one NOT instead of five; the per-row AND/OR
+ * forms below were derived for exactly this pattern.  After Theta the
+ * inverted set is 0-3, 5, 10, 12, 13, 15, 17, 18, 23, which is what
+ * KECCAK_LOAD_AFTER_THETA applies for the nonce-aware absorb path.
+ */
+#ifndef CN_KECCAK_UNROLLED
+#define CN_KECCAK_UNROLLED 1
+#endif
+
+#if CN_KECCAK_UNROLLED
+#define KECCAK_ROUND(A, E, rc) do {                          \
+    const uint64_t c0 = A##0 ^ A##5 ^ A##10 ^ A##15 ^ A##20; \
+    const uint64_t c1 = A##1 ^ A##6 ^ A##11 ^ A##16 ^ A##21; \
+    const uint64_t c2 = A##2 ^ A##7 ^ A##12 ^ A##17 ^ A##22; \
+    const uint64_t c3 = A##3 ^ A##8 ^ A##13 ^ A##18 ^ A##23; \
+    const uint64_t c4 = A##4 ^ A##9 ^ A##14 ^ A##19 ^ A##24; \
+    const uint64_t d0 = c4 ^ ROTL64(c1, 1);                  \
+    const uint64_t d1 = c0 ^ ROTL64(c2, 1);                  \
+    const uint64_t d2 = c1 ^ ROTL64(c3, 1);                  \
+    const uint64_t d3 = c2 ^ ROTL64(c4, 1);                  \
+    const uint64_t d4 = c3 ^ ROTL64(c0, 1);                  \
+    {                                                        \
+        const uint64_t b0 = (A##0 ^ d0);                     \
+        const uint64_t b1 = ROTL64(A##6 ^ d1, 44);           \
+        const uint64_t b2 = ROTL64(A##12 ^ d2, 43);          \
+        const uint64_t b3 = ROTL64(A##18 ^ d3, 21);          \
+        const uint64_t b4 = ROTL64(A##24 ^ d4, 14);          \
+        const uint64_t n2 = ~b2;                             \
+        E##0 = b0 ^ (b1 | b2);                               \
+        E##1 = b1 ^ (n2 | b3);                               \
+        E##2 = b2 ^ (b3 & b4);                               \
+        E##3 = b3 ^ (b4 | b0);                               \
+        E##4 = b4 ^ (b0 & b1);                               \
+    }                                                        \
+    {                                                        \
+        const uint64_t b0 = ROTL64(A##3 ^ d3, 28);           \
+        const uint64_t b1 = ROTL64(A##9 ^ d4, 20);           \
+        const uint64_t b2 = ROTL64(A##10 ^ d0, 3);           \
+        const uint64_t b3 = ROTL64(A##16 ^ d1, 45);          \
+        const uint64_t b4 = ROTL64(A##22 ^ d2, 61);          \
+        const uint64_t n4 = ~b4;                             \
+        E##5 = b0 ^ (b1 | b2);                               \
+        E##6 = b1 ^ (b2 & b3);                               \
+        E##7 = b2 ^ (b3 | n4);                               \
+        E##8 = b3 ^ (b4 | b0);                               \
+        E##9 = b4 ^ (b0 & b1);                               \
+    }                                                        \
+    {                                                        \
+        const uint64_t b0 = ROTL64(A##1 ^ d1, 1);            \
+        const uint64_t b1 = ROTL64(A##7 ^ d2, 6);            \
+        const uint64_t b2 = ROTL64(A##13 ^ d3, 25);          \
+        const uint64_t b3 = ROTL64(A##19 ^ d4, 8);           \
+        const uint64_t b4 = ROTL64(A##20 ^ d0, 18);          \
+        const uint64_t n3 = ~b3;                             \
+        E##10 = b0 ^ (b1 | b2);                              \
+        E##11 = b1 ^ (b2 & b3);                              \
+        E##12 = b2 ^ (n3 & b4);                              \
+        E##13 = n3 ^ (b4 | b0);                              \
+        E##14 = b4 ^ (b0 & b1);                              \
+    }                                                        \
+    {                                                        \
+        const uint64_t b0 = ROTL64(A##4 ^ d4, 27);           \
+        const uint64_t b1 = ROTL64(A##5 ^ d0, 36);           \
+        const uint64_t b2 = ROTL64(A##11 ^ d1, 10);          \
+        const uint64_t b3 = ROTL64(A##17 ^ d2, 15);          \
+        const uint64_t b4 = ROTL64(A##23 ^ d3, 56);          \
+        const uint64_t n3 = ~b3;                             \
+        E##15 = b0 ^ (b1 & b2);                              \
+        E##16 = b1 ^ (b2 | b3);                              \
+        E##17 = b2 ^ (n3 | b4);                              \
+        E##18 = n3 ^ (b4 & b0);                              \
+        E##19 = b4 ^ (b0 | b1);                              \
+    }                                                        \
+    {                                                        \
+        const uint64_t b0 = ROTL64(A##2 ^ d2, 62);           \
+        const uint64_t b1 = ROTL64(A##8 ^ d3, 55);           \
+        const uint64_t b2 = ROTL64(A##14 ^ d4, 39);          \
+        const uint64_t b3 = ROTL64(A##15 ^ d0, 41);          \
+        const uint64_t b4 = ROTL64(A##21 ^ d1, 2);           \
+        const uint64_t n1 = ~b1;                             \
+        E##20 = b0 ^ (n1 & b2);                              \
+        E##21 = n1 ^ (b2 | b3);                              \
+        E##22 = b2 ^ (b3 & b4);                              \
+        E##23 = b3 ^ (b4 | b0);                              \
+        E##24 = b4 ^ (b0 & b1);                              \
+    }                                                        \
+    E##0 ^= (rc);                                            \
+} while (0)
+
+#define KECCAK_ROUND_NO_THETA(A, E, rc) do {   \
+    {                                          \
+        const uint64_t b0 = A##0;              \
+        const uint64_t b1 = ROTL64(A##6, 44);  \
+        const uint64_t b2 = ROTL64(A##12, 43); \
+        const uint64_t b3 = ROTL64(A##18, 21); \
+        const uint64_t b4 = ROTL64(A##24, 14); \
+        const uint64_t n2 = ~b2;               \
+        E##0 = b0 ^ (b1 | b2);                 \
+        E##1 = b1 ^ (n2 | b3);                 \
+        E##2 = b2 ^ (b3 & b4);                 \
+        E##3 = b3 ^ (b4 | b0);                 \
+        E##4 = b4 ^ (b0 & b1);                 \
+    }                                          \
+    {                                          \
+        const uint64_t b0 = ROTL64(A##3, 28);  \
+        const uint64_t b1 = ROTL64(A##9, 20);  \
+        const uint64_t b2 = ROTL64(A##10, 3);  \
+        const uint64_t b3 = ROTL64(A##16, 45); \
+        const uint64_t b4 = ROTL64(A##22, 61); \
+        const uint64_t n4 = ~b4;               \
+        E##5 = b0 ^ (b1 | b2);                 \
+        E##6 = b1 ^ (b2 & b3);                 \
+        E##7 = b2 ^ (b3 | n4);                 \
+        E##8 = b3 ^ (b4 | b0);                 \
+        E##9 = b4 ^ (b0 & b1);                 \
+    }                                          \
+    {                                          \
+        const uint64_t b0 = ROTL64(A##1, 1);   \
+        const uint64_t b1 = ROTL64(A##7, 6);   \
+        const uint64_t b2 = ROTL64(A##13, 25); \
+        const uint64_t b3 = ROTL64(A##19, 8);  \
+        const uint64_t b4 = ROTL64(A##20, 18); \
+        const uint64_t n3 = ~b3;               \
+        E##10 = b0 ^ (b1 | b2);                \
+        E##11 = b1 ^ (b2 & b3);                \
+        E##12 = b2 ^ (n3 & b4);                \
+        E##13 = n3 ^ (b4 | b0);                \
+        E##14 = b4 ^ (b0 & b1);                \
+    }                                          \
+    {                                          \
+        const uint64_t b0 = ROTL64(A##4, 27);  \
+        const uint64_t b1 = ROTL64(A##5, 36);  \
+        const uint64_t b2 = ROTL64(A##11, 10); \
+        const uint64_t b3 = ROTL64(A##17, 15); \
+        const uint64_t b4 = ROTL64(A##23, 56); \
+        const uint64_t n3 = ~b3;               \
+        E##15 = b0 ^ (b1 & b2);                \
+        E##16 = b1 ^ (b2 | b3);                \
+        E##17 = b2 ^ (n3 | b4);                \
+        E##18 = n3 ^ (b4 & b0);                \
+        E##19 = b4 ^ (b0 | b1);                \
+    }                                          \
+    {                                          \
+        const uint64_t b0 = ROTL64(A##2, 62);  \
+        const uint64_t b1 = ROTL64(A##8, 55);  \
+        const uint64_t b2 = ROTL64(A##14, 39); \
+        const uint64_t b3 = ROTL64(A##15, 41); \
+        const uint64_t b4 = ROTL64(A##21, 2);  \
+        const uint64_t n1 = ~b1;               \
+        E##20 = b0 ^ (n1 & b2);                \
+        E##21 = n1 ^ (b2 | b3);                \
+        E##22 = b2 ^ (b3 & b4);                \
+        E##23 = b3 ^ (b4 | b0);                \
+        E##24 = b4 ^ (b0 & b1);                \
+    }                                          \
+    E##0 ^= (rc);                              \
+} while (0)
+
+#define KECCAK_LOAD(A, st) do {                                                                \
+    A##0 = (st)[0]; A##1 = ~(st)[1]; A##2 = ~(st)[2]; A##3 = (st)[3]; A##4 = (st)[4];          \
+    A##5 = (st)[5]; A##6 = (st)[6]; A##7 = (st)[7]; A##8 = ~(st)[8]; A##9 = (st)[9];           \
+    A##10 = (st)[10]; A##11 = (st)[11]; A##12 = ~(st)[12]; A##13 = (st)[13]; A##14 = (st)[14]; \
+    A##15 = (st)[15]; A##16 = (st)[16]; A##17 = ~(st)[17]; A##18 = (st)[18]; A##19 = (st)[19]; \
+    A##20 = ~(st)[20]; A##21 = (st)[21]; A##22 = (st)[22]; A##23 = (st)[23]; A##24 = (st)[24]; \
+} while (0)
+
+#define KECCAK_LOAD_AFTER_THETA(A, st) do {                                                      \
+    A##0 = ~(st)[0]; A##1 = ~(st)[1]; A##2 = ~(st)[2]; A##3 = ~(st)[3]; A##4 = (st)[4];          \
+    A##5 = ~(st)[5]; A##6 = (st)[6]; A##7 = (st)[7]; A##8 = (st)[8]; A##9 = (st)[9];             \
+    A##10 = ~(st)[10]; A##11 = (st)[11]; A##12 = ~(st)[12]; A##13 = ~(st)[13]; A##14 = (st)[14]; \
+    A##15 = ~(st)[15]; A##16 = (st)[16]; A##17 = ~(st)[17]; A##18 = ~(st)[18]; A##19 = (st)[19]; \
+    A##20 = (st)[20]; A##21 = (st)[21]; A##22 = (st)[22]; A##23 = ~(st)[23]; A##24 = (st)[24];   \
+} while (0)
+
+#define KECCAK_STORE(st, A) do {                                                               \
+    (st)[0] = A##0; (st)[1] = ~A##1; (st)[2] = ~A##2; (st)[3] = A##3; (st)[4] = A##4;          \
+    (st)[5] = A##5; (st)[6] = A##6; (st)[7] = A##7; (st)[8] = ~A##8; (st)[9] = A##9;           \
+    (st)[10] = A##10; (st)[11] = A##11; (st)[12] = ~A##12; (st)[13] = A##13; (st)[14] = A##14; \
+    (st)[15] = A##15; (st)[16] = A##16; (st)[17] = ~A##17; (st)[18] = A##18; (st)[19] = A##19; \
+    (st)[20] = ~A##20; (st)[21] = A##21; (st)[22] = A##22; (st)[23] = A##23; (st)[24] = A##24; \
+} while (0)
+
+/** Keccak-f[1600]; theta0_done: round-0 Theta was already applied. */
+static void keccakf_unrolled(uint64_t st[25], int theta0_done) {
+    uint64_t a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12,
+             a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24;
+    uint64_t e0, e1, e2, e3, e4, e5, e6, e7, e8, e9, e10, e11, e12,
+             e13, e14, e15, e16, e17, e18, e19, e20, e21, e22, e23, e24;
+
+    if (theta0_done) {
+        KECCAK_LOAD_AFTER_THETA(a, st);
+        KECCAK_ROUND_NO_THETA(a, e, keccak_rc[0]);
+    } else {
+        KECCAK_LOAD(a, st);
+        KECCAK_ROUND(a, e, keccak_rc[0]);
     }
+    KECCAK_ROUND(e, a, keccak_rc[1]);
+    KECCAK_ROUND(a, e, keccak_rc[2]);
+    KECCAK_ROUND(e, a, keccak_rc[3]);
+    KECCAK_ROUND(a, e, keccak_rc[4]);
+    KECCAK_ROUND(e, a, keccak_rc[5]);
+    KECCAK_ROUND(a, e, keccak_rc[6]);
+    KECCAK_ROUND(e, a, keccak_rc[7]);
+    KECCAK_ROUND(a, e, keccak_rc[8]);
+    KECCAK_ROUND(e, a, keccak_rc[9]);
+    KECCAK_ROUND(a, e, keccak_rc[10]);
+    KECCAK_ROUND(e, a, keccak_rc[11]);
+    KECCAK_ROUND(a, e, keccak_rc[12]);
+    KECCAK_ROUND(e, a, keccak_rc[13]);
+    KECCAK_ROUND(a, e, keccak_rc[14]);
+    KECCAK_ROUND(e, a, keccak_rc[15]);
+    KECCAK_ROUND(a, e, keccak_rc[16]);
+    KECCAK_ROUND(e, a, keccak_rc[17]);
+    KECCAK_ROUND(a, e, keccak_rc[18]);
+    KECCAK_ROUND(e, a, keccak_rc[19]);
+    KECCAK_ROUND(a, e, keccak_rc[20]);
+    KECCAK_ROUND(e, a, keccak_rc[21]);
+    KECCAK_ROUND(a, e, keccak_rc[22]);
+    KECCAK_ROUND(e, a, keccak_rc[23]);
+    KECCAK_STORE(st, a);
 }
 
+static inline void keccakf(uint64_t st[25])              { keccakf_unrolled(st, 0); }
+static inline void keccakf_after_theta0(uint64_t st[25]) { keccakf_unrolled(st, 1); }
+#else
+static inline void keccakf(uint64_t st[25])              { keccakf_loop(st); }
+static inline void keccakf_after_theta0(uint64_t st[25]) { keccakf_loop_after_theta0(st); }
+#endif
+
 /**
  * Keccak-1600 hash.  rate = 1088 bits = 136 bytes.
  * Outputs full 200-byte state (needed for CryptoNight).
@@ -219,11 +593,282 @@ static void aes256_expand_key(const uint8_t *key, uint8_t expanded[240]) {
  * Applies SubBytes+ShiftRows+MixColumns+AddRoundKey 10 times,
  * using consecutive 16-byte round keys from the expanded key.
  */
-static void aes_pseudo_round(uint8_t *data, const uint8_t *expanded_key) {
+static inline void aes_pseudo_round(uint8_t *data, const uint8_t *expanded_key) {
     for (int r = 0; r < 10; r++)
         aes_single_round(data, data, expanded_key + r * 16);
 }
 
+/* ====================== T-table AES (32-bit) ====================== */
+/*
+ * aes_teN[x] is column N of MixColumns applied to SubBytes(x), packed
+ * little-endian (row 0 in the low byte).  One AES round then becomes
+ * 16 table lookups and 16 XORs on four 32-bit column words, with
+ * ShiftRows folded into which column each byte is taken from.
+ * Build with -DCN_AES_TTABLE=0 to use the byte-wise reference instead.
+ */
+
+#ifndef CN_AES_TTABLE
+#define CN_AES_TTABLE 1
+#endif
+
+static const uint32_t aes_te0[256] = {
+    0xa56363c6, 0x847c7cf8, 0x997777ee, 0x8d7b7bf6, 0x0df2f2ff, 0xbd6b6bd6,
+    0xb16f6fde, 0x54c5c591, 0x50303060, 0x03010102, 0xa96767ce, 0x7d2b2b56,
+    0x19fefee7, 0x62d7d7b5, 0xe6abab4d, 0x9a7676ec, 0x45caca8f, 0x9d82821f,
+    0x40c9c989, 0x877d7dfa, 0x15fafaef, 0xeb5959b2, 0xc947478e, 0x0bf0f0fb,
+    0xecadad41, 0x67d4d4b3, 0xfda2a25f, 0xeaafaf45, 0xbf9c9c23, 0xf7a4a453,
+    0x967272e4, 0x5bc0c09b, 0xc2b7b775, 0x1cfdfde1, 0xae93933d, 0x6a26264c,
+    0x5a36366c, 0x413f3f7e, 0x02f7f7f5, 0x4fcccc83, 0x5c343468, 0xf4a5a551,
+    0x34e5e5d1, 0x08f1f1f9, 0x937171e2, 0x73d8d8ab, 0x53313162, 0x3f15152a,
+    0x0c040408, 0x52c7c795, 0x65232346, 0x5ec3c39d, 0x28181830, 0xa1969637,
+    0x0f05050a, 0xb59a9a2f, 0x0907070e, 0x36121224, 0x9b80801b, 0x3de2e2df,
+    0x26ebebcd, 0x6927274e, 0xcdb2b27f, 0x9f7575ea, 0x1b090912, 0x9e83831d,
+    0x742c2c58, 0x2e1a1a34, 0x2d1b1b36, 0xb26e6edc, 0xee5a5ab4, 0xfba0a05b,
+    0xf65252a4, 0x4d3b3b76, 0x61d6d6b7, 0xceb3b37d, 0x7b292952, 0x3ee3e3dd,
+    0x712f2f5e, 0x97848413, 0xf55353a6, 0x68d1d1b9, 0x00000000, 0x2cededc1,
+    0x60202040, 0x1ffcfce3, 0xc8b1b179, 0xed5b5bb6, 0xbe6a6ad4, 0x46cbcb8d,
+    0xd9bebe67, 0x4b393972, 0xde4a4a94, 0xd44c4c98, 0xe85858b0, 0x4acfcf85,
+    0x6bd0d0bb, 0x2aefefc5, 0xe5aaaa4f, 0x16fbfbed, 0xc5434386, 0xd74d4d9a,
+    0x55333366, 0x94858511, 0xcf45458a, 0x10f9f9e9, 0x06020204, 0x817f7ffe,
+    0xf05050a0, 0x443c3c78, 0xba9f9f25, 0xe3a8a84b, 0xf35151a2, 0xfea3a35d,
+    0xc0404080, 0x8a8f8f05, 0xad92923f, 0xbc9d9d21, 0x48383870, 0x04f5f5f1,
+    0xdfbcbc63, 0xc1b6b677, 0x75dadaaf, 0x63212142, 0x30101020, 0x1affffe5,
+    0x0ef3f3fd, 0x6dd2d2bf, 0x4ccdcd81, 0x140c0c18, 0x35131326, 0x2fececc3,
+    0xe15f5fbe, 0xa2979735, 0xcc444488, 0x3917172e, 0x57c4c493, 0xf2a7a755,
+    0x827e7efc, 0x473d3d7a, 0xac6464c8, 0xe75d5dba, 0x2b191932, 0x957373e6,
+    0xa06060c0, 0x98818119, 0xd14f4f9e, 0x7fdcdca3, 0x66222244, 0x7e2a2a54,
+    0xab90903b, 0x8388880b, 0xca46468c, 0x29eeeec7, 0xd3b8b86b, 0x3c141428,
+    0x79dedea7, 0xe25e5ebc, 0x1d0b0b16, 0x76dbdbad, 0x3be0e0db, 0x56323264,
+    0x4e3a3a74, 0x1e0a0a14, 0xdb494992, 0x0a06060c, 0x6c242448, 0xe45c5cb8,
+    0x5dc2c29f, 0x6ed3d3bd, 0xefacac43, 0xa66262c4, 0xa8919139, 0xa4959531,
+    0x37e4e4d3, 0x8b7979f2, 0x32e7e7d5, 0x43c8c88b, 0x5937376e, 0xb76d6dda,
+    0x8c8d8d01, 0x64d5d5b1, 0xd24e4e9c, 0xe0a9a949, 0xb46c6cd8, 0xfa5656ac,
+    0x07f4f4f3, 0x25eaeacf, 0xaf6565ca, 0x8e7a7af4, 0xe9aeae47, 0x18080810,
+    0xd5baba6f, 0x887878f0, 0x6f25254a, 0x722e2e5c, 0x241c1c38, 0xf1a6a657,
+    0xc7b4b473, 0x51c6c697, 0x23e8e8cb, 0x7cdddda1, 0x9c7474e8, 0x211f1f3e,
+    0xdd4b4b96, 0xdcbdbd61, 0x868b8b0d, 0x858a8a0f, 0x907070e0, 0x423e3e7c,
+    0xc4b5b571, 0xaa6666cc, 0xd8484890, 0x05030306, 0x01f6f6f7, 0x120e0e1c,
+    0xa36161c2, 0x5f35356a, 0xf95757ae, 0xd0b9b969, 0x91868617, 0x58c1c199,
+    0x271d1d3a, 0xb99e9e27, 0x38e1e1d9, 0x13f8f8eb, 0xb398982b, 0x33111122,
+    0xbb6969d2, 0x70d9d9a9, 0x898e8e07, 0xa7949433, 0xb69b9b2d, 0x221e1e3c,
+    0x92878715, 0x20e9e9c9, 0x49cece87, 0xff5555aa, 0x78282850, 0x7adfdfa5,
+    0x8f8c8c03, 0xf8a1a159, 0x80898909, 0x170d0d1a, 0xdabfbf65, 0x31e6e6d7,
+    0xc6424284, 0xb86868d0, 0xc3414182, 0xb0999929, 0x772d2d5a, 0x110f0f1e,
+    0xcbb0b07b, 0xfc5454a8, 0xd6bbbb6d, 0x3a16162c
+};
+
+static const uint32_t aes_te1[256] = {
+    0x6363c6a5, 0x7c7cf884, 0x7777ee99, 0x7b7bf68d, 0xf2f2ff0d, 0x6b6bd6bd,
+    0x6f6fdeb1, 0xc5c59154, 0x30306050, 0x01010203, 0x6767cea9, 0x2b2b567d,
+    0xfefee719, 0xd7d7b562, 0xabab4de6, 0x7676ec9a, 0xcaca8f45, 0x82821f9d,
+    0xc9c98940, 0x7d7dfa87, 0xfafaef15, 0x5959b2eb, 0x47478ec9, 0xf0f0fb0b,
+    0xadad41ec, 0xd4d4b367, 0xa2a25ffd, 0xafaf45ea, 0x9c9c23bf, 0xa4a453f7,
+    0x7272e496, 0xc0c09b5b, 0xb7b775c2, 0xfdfde11c, 0x93933dae, 0x26264c6a,
+    0x36366c5a, 0x3f3f7e41, 0xf7f7f502, 0xcccc834f, 0x3434685c, 0xa5a551f4,
+    0xe5e5d134, 0xf1f1f908, 0x7171e293, 0xd8d8ab73, 0x31316253, 0x15152a3f,
+    0x0404080c, 0xc7c79552, 0x23234665, 0xc3c39d5e, 0x18183028, 0x969637a1,
+    0x05050a0f, 0x9a9a2fb5, 0x07070e09, 0x12122436, 0x80801b9b, 0xe2e2df3d,
+    0xebebcd26, 0x27274e69, 0xb2b27fcd, 0x7575ea9f, 0x0909121b, 0x83831d9e,
+    0x2c2c5874, 0x1a1a342e, 0x1b1b362d, 0x6e6edcb2, 0x5a5ab4ee, 0xa0a05bfb,
+    0x5252a4f6, 0x3b3b764d, 0xd6d6b761, 0xb3b37dce, 0x2929527b, 0xe3e3dd3e,
+    0x2f2f5e71, 0x84841397, 0x5353a6f5, 0xd1d1b968, 0x00000000, 0xededc12c,
+    0x20204060, 0xfcfce31f, 0xb1b179c8, 0x5b5bb6ed, 0x6a6ad4be, 0xcbcb8d46,
+    0xbebe67d9, 0x3939724b, 0x4a4a94de, 0x4c4c98d4, 0x5858b0e8, 0xcfcf854a,
+    0xd0d0bb6b, 0xefefc52a, 0xaaaa4fe5, 0xfbfbed16, 0x434386c5, 0x4d4d9ad7,
+    0x33336655, 0x85851194, 0x45458acf, 0xf9f9e910, 0x02020406, 0x7f7ffe81,
+    0x5050a0f0, 0x3c3c7844, 0x9f9f25ba, 0xa8a84be3, 0x5151a2f3, 0xa3a35dfe,
+    0x404080c0, 0x8f8f058a, 0x92923fad, 0x9d9d21bc, 0x38387048, 0xf5f5f104,
+    0xbcbc63df, 0xb6b677c1, 0xdadaaf75, 0x21214263, 0x10102030, 0xffffe51a,
+    0xf3f3fd0e, 0xd2d2bf6d, 0xcdcd814c, 0x0c0c1814, 0x13132635, 0xececc32f,
+    0x5f5fbee1, 0x979735a2, 0x444488cc, 0x17172e39, 0xc4c49357, 0xa7a755f2,
+    0x7e7efc82, 0x3d3d7a47, 0x6464c8ac, 0x5d5dbae7, 0x1919322b, 0x7373e695,
+    0x6060c0a0, 0x81811998, 0x4f4f9ed1, 0xdcdca37f, 0x22224466, 0x2a2a547e,
+    0x90903bab, 0x88880b83, 0x46468cca, 0xeeeec729, 0xb8b86bd3, 0x1414283c,
+    0xdedea779, 0x5e5ebce2, 0x0b0b161d, 0xdbdbad76, 0xe0e0db3b, 0x32326456,
+    0x3a3a744e, 0x0a0a141e, 0x494992db, 0x06060c0a, 0x2424486c, 0x5c5cb8e4,
+    0xc2c29f5d, 0xd3d3bd6e, 0xacac43ef, 0x6262c4a6, 0x919139a8, 0x959531a4,
+    0xe4e4d337, 0x7979f28b, 0xe7e7d532, 0xc8c88b43, 0x37376e59, 0x6d6ddab7,
+    0x8d8d018c, 0xd5d5b164, 0x4e4e9cd2, 0xa9a949e0, 0x6c6cd8b4, 0x5656acfa,
+    0xf4f4f307, 0xeaeacf25, 0x6565caaf, 0x7a7af48e, 0xaeae47e9, 0x08081018,
+    0xbaba6fd5, 0x7878f088, 0x25254a6f, 0x2e2e5c72, 0x1c1c3824, 0xa6a657f1,
+    0xb4b473c7, 0xc6c69751, 0xe8e8cb23, 0xdddda17c, 0x7474e89c, 0x1f1f3e21,
+    0x4b4b96dd, 0xbdbd61dc, 0x8b8b0d86, 0x8a8a0f85, 0x7070e090, 0x3e3e7c42,
+    0xb5b571c4, 0x6666ccaa, 0x484890d8, 0x03030605, 0xf6f6f701, 0x0e0e1c12,
+    0x6161c2a3, 0x35356a5f, 0x5757aef9, 0xb9b969d0, 0x86861791, 0xc1c19958,
+    0x1d1d3a27, 0x9e9e27b9, 0xe1e1d938, 0xf8f8eb13, 0x98982bb3, 0x11112233,
+    0x6969d2bb, 0xd9d9a970, 0x8e8e0789, 0x949433a7, 0x9b9b2db6, 0x1e1e3c22,
+    0x87871592, 0xe9e9c920, 0xcece8749, 0x5555aaff, 0x28285078, 0xdfdfa57a,
+    0x8c8c038f, 0xa1a159f8, 0x89890980, 0x0d0d1a17, 0xbfbf65da, 0xe6e6d731,
+    0x424284c6, 0x6868d0b8, 0x414182c3, 0x999929b0, 0x2d2d5a77, 0x0f0f1e11,
+    0xb0b07bcb, 0x5454a8fc, 0xbbbb6dd6, 0x16162c3a
+};
+
+static const uint32_t aes_te2[256] = {
+    0x63c6a563, 0x7cf8847c, 0x77ee9977, 0x7bf68d7b, 0xf2ff0df2, 0x6bd6bd6b,
+    0x6fdeb16f, 0xc59154c5, 0x30605030, 0x01020301, 0x67cea967, 0x2b567d2b,
+    0xfee719fe, 0xd7b562d7, 0xab4de6ab, 0x76ec9a76, 0xca8f45ca, 0x821f9d82,
+    0xc98940c9, 0x7dfa877d, 0xfaef15fa, 0x59b2eb59, 0x478ec947, 0xf0fb0bf0,
+    0xad41ecad, 0xd4b367d4, 0xa25ffda2, 0xaf45eaaf, 0x9c23bf9c, 0xa453f7a4,
+    0x72e49672, 0xc09b5bc0, 0xb775c2b7, 0xfde11cfd, 0x933dae93, 0x264c6a26,
+    0x366c5a36, 0x3f7e413f, 0xf7f502f7, 0xcc834fcc, 0x34685c34, 0xa551f4a5,
+    0xe5d134e5, 0xf1f908f1, 0x71e29371, 0xd8ab73d8, 0x31625331, 0x152a3f15,
+    0x04080c04, 0xc79552c7, 0x23466523, 0xc39d5ec3, 0x18302818, 0x9637a196,
+    0x050a0f05, 0x9a2fb59a, 0x070e0907, 0x12243612, 0x801b9b80, 0xe2df3de2,
+    0xebcd26eb, 0x274e6927, 0xb27fcdb2, 0x75ea9f75, 0x09121b09, 0x831d9e83,
+    0x2c58742c, 0x1a342e1a, 0x1b362d1b, 0x6edcb26e, 0x5ab4ee5a, 0xa05bfba0,
+    0x52a4f652, 0x3b764d3b, 0xd6b761d6, 0xb37dceb3, 0x29527b29, 0xe3dd3ee3,
+    0x2f5e712f, 0x84139784, 0x53a6f553, 0xd1b968d1, 0x00000000, 0xedc12ced,
+    0x20406020, 0xfce31ffc, 0xb179c8b1, 0x5bb6ed5b, 0x6ad4be6a, 0xcb8d46cb,
+    0xbe67d9be, 0x39724b39, 0x4a94de4a, 0x4c98d44c, 0x58b0e858, 0xcf854acf,
+    0xd0bb6bd0, 0xefc52aef, 0xaa4fe5aa, 0xfbed16fb, 0x4386c543, 0x4d9ad74d,
+    0x33665533, 0x85119485, 0x458acf45, 0xf9e910f9, 0x02040602, 0x7ffe817f,
+    0x50a0f050, 0x3c78443c, 0x9f25ba9f, 0xa84be3a8, 0x51a2f351, 0xa35dfea3,
+    0x4080c040, 0x8f058a8f, 0x923fad92, 0x9d21bc9d, 0x38704838, 0xf5f104f5,
+    0xbc63dfbc, 0xb677c1b6, 0xdaaf75da, 0x21426321, 0x10203010, 0xffe51aff,
+    0xf3fd0ef3, 0xd2bf6dd2, 0xcd814ccd, 0x0c18140c, 0x13263513, 0xecc32fec,
+    0x5fbee15f, 0x9735a297, 0x4488cc44, 0x172e3917, 0xc49357c4, 0xa755f2a7,
+    0x7efc827e, 0x3d7a473d, 0x64c8ac64, 0x5dbae75d, 0x19322b19, 0x73e69573,
+    0x60c0a060, 0x81199881, 0x4f9ed14f, 0xdca37fdc, 0x22446622, 0x2a547e2a,
+    0x903bab90, 0x880b8388, 0x468cca46, 0xeec729ee, 0xb86bd3b8, 0x14283c14,
+    0xdea779de, 0x5ebce25e, 0x0b161d0b, 0xdbad76db, 0xe0db3be0, 0x32645632,
+    0x3a744e3a, 0x0a141e0a, 0x4992db49, 0x060c0a06, 0x24486c24, 0x5cb8e45c,
+    0xc29f5dc2, 0xd3bd6ed3, 0xac43efac, 0x62c4a662, 0x9139a891, 0x9531a495,
+    0xe4d337e4, 0x79f28b79, 0xe7d532e7, 0xc88b43c8, 0x376e5937, 0x6ddab76d,
+    0x8d018c8d, 0xd5b164d5, 0x4e9cd24e, 0xa949e0a9, 0x6cd8b46c, 0x56acfa56,
+    0xf4f307f4, 0xeacf25ea, 0x65caaf65, 0x7af48e7a, 0xae47e9ae, 0x08101808,
+    0xba6fd5ba, 0x78f08878, 0x254a6f25, 0x2e5c722e, 0x1c38241c, 0xa657f1a6,
+    0xb473c7b4, 0xc69751c6, 0xe8cb23e8, 0xdda17cdd, 0x74e89c74, 0x1f3e211f,
+    0x4b96dd4b, 0xbd61dcbd, 0x8b0d868b, 0x8a0f858a, 0x70e09070, 0x3e7c423e,
+    0xb571c4b5, 0x66ccaa66, 0x4890d848, 0x03060503, 0xf6f701f6, 0x0e1c120e,
+    0x61c2a361, 0x356a5f35, 0x57aef957, 0xb969d0b9, 0x86179186, 0xc19958c1,
+    0x1d3a271d, 0x9e27b99e, 0xe1d938e1, 0xf8eb13f8, 0x982bb398, 0x11223311,
+    0x69d2bb69, 0xd9a970d9, 0x8e07898e, 0x9433a794, 0x9b2db69b, 0x1e3c221e,
+    0x87159287, 0xe9c920e9, 0xce8749ce, 0x55aaff55, 0x28507828, 0xdfa57adf,
+    0x8c038f8c, 0xa159f8a1, 0x89098089, 0x0d1a170d, 0xbf65dabf, 0xe6d731e6,
+    0x4284c642, 0x68d0b868, 0x4182c341, 0x9929b099, 0x2d5a772d, 0x0f1e110f,
+    0xb07bcbb0, 0x54a8fc54, 0xbb6dd6bb, 0x162c3a16
+};
+
+static const uint32_t aes_te3[256] = {
+    0xc6a56363, 0xf8847c7c, 0xee997777, 0xf68d7b7b, 0xff0df2f2, 0xd6bd6b6b,
+    0xdeb16f6f, 0x9154c5c5, 0x60503030, 0x02030101, 0xcea96767, 0x567d2b2b,
+    0xe719fefe, 0xb562d7d7, 0x4de6abab, 0xec9a7676, 0x8f45caca, 0x1f9d8282,
+    0x8940c9c9, 0xfa877d7d, 0xef15fafa, 0xb2eb5959, 0x8ec94747, 0xfb0bf0f0,
+    0x41ecadad, 0xb367d4d4, 0x5ffda2a2, 0x45eaafaf, 0x23bf9c9c, 0x53f7a4a4,
+    0xe4967272, 0x9b5bc0c0, 0x75c2b7b7, 0xe11cfdfd, 0x3dae9393, 0x4c6a2626,
+    0x6c5a3636, 0x7e413f3f, 0xf502f7f7, 0x834fcccc, 0x685c3434, 0x51f4a5a5,
+    0xd134e5e5, 0xf908f1f1, 0xe2937171, 0xab73d8d8, 0x62533131, 0x2a3f1515,
+    0x080c0404, 0x9552c7c7, 0x46652323, 0x9d5ec3c3, 0x30281818, 0x37a19696,
+    0x0a0f0505, 0x2fb59a9a, 0x0e090707, 0x24361212, 0x1b9b8080, 0xdf3de2e2,
+    0xcd26ebeb, 0x4e692727, 0x7fcdb2b2, 0xea9f7575, 0x121b0909, 0x1d9e8383,
+    0x58742c2c, 0x342e1a1a, 0x362d1b1b, 0xdcb26e6e, 0xb4ee5a5a, 0x5bfba0a0,
+    0xa4f65252, 0x764d3b3b, 0xb761d6d6, 0x7dceb3b3, 0x527b2929, 0xdd3ee3e3,
+    0x5e712f2f, 0x13978484, 0xa6f55353, 0xb968d1d1, 0x00000000, 0xc12ceded,
+    0x40602020, 0xe31ffcfc, 0x79c8b1b1, 0xb6ed5b5b, 0xd4be6a6a, 0x8d46cbcb,
+    0x67d9bebe, 0x724b3939, 0x94de4a4a, 0x98d44c4c, 0xb0e85858, 0x854acfcf,
+    0xbb6bd0d0, 0xc52aefef, 0x4fe5aaaa, 0xed16fbfb, 0x86c54343, 0x9ad74d4d,
+    0x66553333, 0x11948585, 0x8acf4545, 0xe910f9f9, 0x04060202, 0xfe817f7f,
+    0xa0f05050, 0x78443c3c, 0x25ba9f9f, 0x4be3a8a8, 0xa2f35151, 0x5dfea3a3,
+    0x80c04040, 0x058a8f8f, 0x3fad9292, 0x21bc9d9d, 0x70483838, 0xf104f5f5,
+    0x63dfbcbc, 0x77c1b6b6, 0xaf75dada, 0x42632121, 0x20301010, 0xe51affff,
+    0xfd0ef3f3, 0xbf6dd2d2, 0x814ccdcd, 0x18140c0c, 0x26351313, 0xc32fecec,
+    0xbee15f5f, 0x35a29797, 0x88cc4444, 0x2e391717, 0x9357c4c4, 0x55f2a7a7,
+    0xfc827e7e, 0x7a473d3d, 0xc8ac6464, 0xbae75d5d, 0x322b1919, 0xe6957373,
+    0xc0a06060, 0x19988181, 0x9ed14f4f, 0xa37fdcdc, 0x44662222, 0x547e2a2a,
+    0x3bab9090, 0x0b838888, 0x8cca4646, 0xc729eeee, 0x6bd3b8b8, 0x283c1414,
+    0xa779dede, 0xbce25e5e, 0x161d0b0b, 0xad76dbdb, 0xdb3be0e0, 0x64563232,
+    0x744e3a3a, 0x141e0a0a, 0x92db4949, 0x0c0a0606, 0x486c2424, 0xb8e45c5c,
+    0x9f5dc2c2, 0xbd6ed3d3, 0x43efacac, 0xc4a66262, 0x39a89191, 0x31a49595,
+    0xd337e4e4, 0xf28b7979, 0xd532e7e7, 0x8b43c8c8, 0x6e593737, 0xdab76d6d,
+    0x018c8d8d, 0xb164d5d5, 0x9cd24e4e, 0x49e0a9a9, 0xd8b46c6c, 0xacfa5656,
+    0xf307f4f4, 0xcf25eaea, 0xcaaf6565, 0xf48e7a7a, 0x47e9aeae, 0x10180808,
+    0x6fd5baba, 0xf0887878, 0x4a6f2525, 0x5c722e2e, 0x38241c1c, 0x57f1a6a6,
+    0x73c7b4b4, 0x9751c6c6, 0xcb23e8e8, 0xa17cdddd, 0xe89c7474, 0x3e211f1f,
+    0x96dd4b4b, 0x61dcbdbd, 0x0d868b8b, 0x0f858a8a, 0xe0907070, 0x7c423e3e,
+    0x71c4b5b5, 0xccaa6666, 0x90d84848, 0x06050303, 0xf701f6f6, 0x1c120e0e,
+    0xc2a36161, 0x6a5f3535, 0xaef95757, 0x69d0b9b9, 0x17918686, 0x9958c1c1,
+    0x3a271d1d, 0x27b99e9e, 0xd938e1e1, 0xeb13f8f8, 0x2bb39898, 0x22331111,
+    0xd2bb6969, 0xa970d9d9, 0x07898e8e, 0x33a79494, 0x2db69b9b, 0x3c221e1e,
+    0x15928787, 0xc920e9e9, 0x8749cece, 0xaaff5555, 0x50782828, 0xa57adfdf,
+    0x038f8c8c, 0x59f8a1a1, 0x09808989, 0x1a170d0d, 0x65dabfbf, 0xd731e6e6,
+    0x84c64242, 0xd0b86868, 0x82c34141, 0x29b09999, 0x5a772d2d, 0x1e110f0f,
+    0x7bcbb0b0, 0xa8fc5454, 0x6dd6bbbb, 0x2c3a1616
+};
+
+#define AES_TT_COLUMN(s0, s1, s2, s3, k) \
+    (aes_te0[(s0) & 0xff] ^ aes_te1[((s1) >> 8) & 0xff] ^ \
+     aes_te2[((s2) >> 16) & 0xff] ^ aes_te3[(s3) >> 24] ^ (k))
+
+/** One AES round on four column words: out = MixColumns(ShiftRows(SubBytes(in))) ^ k */
+static inline void aes_round_tt(uint32_t s[4], const uint32_t k[4]) {
+    uint32_t t0 = AES_TT_COLUMN(s[0], s[1], s[2], s[3], k[0]);
+    uint32_t t1 = AES_TT_COLUMN(s[1], s[2], s[3], s[0], k[1]);
+    uint32_t t2 = AES_TT_COLUMN(s[2], s[3], s[0], s[1], k[2]);
+    uint32_t t3 = AES_TT_COLUMN(s[3], s[0], s[1], s[2], k[3]);
+    s[0] = t0; s[1] = t1; s[2] = t2; s[3] = t3;
+}
+
+/** T-table equivalent of aes_single_round(). */
+static inline void aes_single_round_tt(uint8_t *out, const uint8_t *in, const uint8_t *key) {
+    uint32_t s[4], k[4];
+    memcpy(s, in, 16);
+    memcpy(k, key, 16);
+    aes_round_tt(s, k);
+    memcpy(out, s, 16);
+}
+
+/** T-table equivalent of aes_pseudo_round(): state stays in registers for all 10 rounds. */
+static inline void aes_pseudo_round_tt(uint8_t *data, const uint8_t *expanded_key) {
+    uint32_t s[4];
+    memcpy(s, data, 16);
+    for (int r = 0; r < 10; r++) {
+        uint32_t k[4];
+        memcpy(k, expanded_key + r * 16, 16);
+        aes_round_tt(s, k);
+    }
+    memcpy(data, s, 16);
+}
+
+/* ===================== WebAssembly SIMD128 AES ===================== */
+/*
+ * With -msimd128 the AES state and round keys are v128 values and
+ * AddRoundKey is a single v128.xor.  WASM SIMD has no AES instruction,
+ * so SubBytes+MixColumns still go through the T-tables on the four
+ * column lanes.
+ */
+
+#if CN_SIMD128
+static inline v128_t aes_round_simd(v128_t s, v128_t k) {
+    uint32_t s0 = (uint32_t)wasm_i32x4_extract_lane(s, 0);
+    uint32_t s1 = (uint32_t)wasm_i32x4_extract_lane(s, 1);
+    uint32_t s2 = (uint32_t)wasm_i32x4_extract_lane(s, 2);
+    uint32_t s3 = (uint32_t)wasm_i32x4_extract_lane(s, 3);
+    v128_t t = wasm_i32x4_make((int32_t)AES_TT_COLUMN(s0, s1, s2, s3, 0),
+                               (int32_t)AES_TT_COLUMN(s1, s2, s3, s0, 0),
+                               (int32_t)AES_TT_COLUMN(s2, s3, s0, s1, 0),
+                               (int32_t)AES_TT_COLUMN(s3, s0, s1, s2, 0));
+    return wasm_v128_xor(t, k);
+}
+
+static inline void aes_pseudo_round_simd(uint8_t *data, const uint8_t *expanded_key) {
+    v128_t s = wasm_v128_load(data);
+    for (int r = 0; r < 10; r++)
+        s = aes_round_simd(s, wasm_v128_load(expanded_key + r * 16));
+    wasm_v128_store(data, s);
+}
+#endif
+
+#if CN_SIMD128
+#define cn_aes_single_round aes_single_round_tt
+#define cn_aes_pseudo_round aes_pseudo_round_simd
+#elif CN_AES_TTABLE
+#define cn_aes_single_round aes_single_round_tt
+#define cn_aes_pseudo_round aes_pseudo_round_tt
+#else
+#define cn_aes_single_round aes_single_round
+#define cn_aes_pseudo_round aes_pseudo_round
+#endif
+
 /* =================== Final hash function externs =================== */
 /* These are provided by Monero's blake256.c, groestl.c, jh.c, skein.c */
 
@@ -232,23 +877,71 @@ extern void groestl(const uint8_t *data, unsigned long long databitlen, uint8_t
 extern int  jh_hash(int hashbitlen, const uint8_t *data, unsigned long long databitlen, uint8_t *hashval);
 extern int  skein_hash(int hashbitlen, const uint8_t *data, size_t databitlen, uint8_t *hashval);
 
-/* ========================= CryptoNight v0 ========================= */
+/* Monero's cn/r program generator and interpreter (fetched with the final
+ * hashes), which expects hash-ops.h's Blake-256 wrapper */
+static void hash_extra_blake(const void *data, size_t length, char *hash) {
+    blake256_hash((uint8_t *)hash, (const uint8_t *)data, length);
+}
+
+#include "variant4_random_math.h"
 
-#define CN_MEMORY       2097152     /* 2 MB scratchpad */
-#define CN_ITER         524288      /* number of iterations (loop runs ITER/2) */
+/* ======================== CryptoNight family ======================== */
+
+#define CN_MEMORY       2097152     /* cn/0: 2 MB scratchpad */
+#define CN_ITER         1048576     /* cn/0: Monero's ITER (1 << 20); loop runs ITER/2 */
 #define AES_BLOCK_SIZE  16
 #define AES_KEY_SIZE    32
 #define INIT_SIZE_BYTE  128         /* 8 AES blocks */
+#define CN_MAX_BLOB     256         /* largest hashing blob accepted */
+
+#define CN_SCAN_RESULT_SIZE  36     /* nonce (4) + hash (32) */
+#define CN_SCAN_MAX_RESULTS  16
+
+/*
+ * Family members that differ only in scratchpad size, main-loop length,
+ * address mask, main-loop variant (0, 1, 2 or 4 = cn/r, Monero's numbering)
+ * and cn-heavy's extra mixing and division steps share one kernel.  The
+ * explode / main loop / implode bodies take those as arguments and are
+ * force-inlined into one set of functions per row below, so every
+ * algorithm gets a hot loop with its bound, mask, variant and heavy steps
+ * folded to constants.
+ * Ids are exported (cn_ctx_create_algo), so new rows go at the end.
+ *
+ *   X(id, enum, name, memory, loop iterations, address mask, variant, heavy)
+ */
+#define CN_ALGOS(X)                                                                   \
+    X(cn,    CN_ALGO_CN0,    "cn/0",       CN_MEMORY, CN_ITER / 2, 0x1FFFF0, 0, 0)   \
+    X(lite,  CN_ALGO_LITE0,  "cn-lite/0",  1048576,   0x40000,     0x0FFFF0, 0, 0)   \
+    X(heavy, CN_ALGO_HEAVY0, "cn-heavy/0", 4194304,   0x40000,     0x3FFFF0, 0, 1)   \
+    X(cn1,   CN_ALGO_CN1,    "cn/1",       CN_MEMORY, CN_ITER / 2, 0x1FFFF0, 1, 0)   \
+    X(cn2,   CN_ALGO_CN2,    "cn/2",       CN_MEMORY, CN_ITER / 2, 0x1FFFF0, 2, 0)   \
+    X(lite1, CN_ALGO_LITE1,  "cn-lite/1",  1048576,   0x40000,     0x0FFFF0, 1, 0)   \
+    X(pico,  CN_ALGO_PICO0,  "cn-pico",    262144,    0x10000,     0x01FFF0, 2, 0)   \
+    X(cnr,   CN_ALGO_R,      "cn/r",       CN_MEMORY, CN_ITER / 2, 0x1FFFF0, 4, 0)
+
+#define CN_ALGO_ENUM(id, e, name, memory, iterations, mask, variant, heavy) e,
+enum cn_algo_id { CN_ALGOS(CN_ALGO_ENUM) CN_ALGO_COUNT };
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CN_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define CN_ALWAYS_INLINE inline
+#endif
 
 static inline void xor_blocks(uint8_t *a, const uint8_t *b) {
+#if CN_SIMD128
+    wasm_v128_store(a, wasm_v128_xor(wasm_v128_load(a), wasm_v128_load(b)));
+#else
     for (int i = 0; i < 16; i++) a[i] ^= b[i];
+#endif
 }
 
 /**
- * 64×64 → 128-bit multiply.
- * Produces high and low 64-bit halves of (a * b).
+ * 64×64 → 128-bit multiply from 32×32 partial products.  The middle sum
+ * p1 + hi(p0) + lo(p2) is at most (2^32-1)^2 + 2(2^32-1) = 2^64-1, so it
+ * cannot carry and the whole thing stays branch-free.
  */
-static inline void mul_128(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+static inline void mul_128_portable(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
     uint64_t a_lo = (uint32_t)a;
     uint64_t a_hi = a >> 32;
     uint64_t b_lo = (uint32_t)b;
@@ -259,158 +952,2312 @@ static inline void mul_128(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
     uint64_t p2 = a_hi * b_lo;
     uint64_t p3 = a_hi * b_hi;
 
-    uint64_t mid = p1 + (p0 >> 32);
-    mid += p2;
-    if (mid < p2)
-        p3 += 0x100000000ULL;       /* carry */
+    uint64_t mid = p1 + (p0 >> 32) + (uint32_t)p2;
 
     *lo = (mid << 32) | (uint32_t)p0;
-    *hi = p3 + (mid >> 32);
+    *hi = p3 + (p2 >> 32) + (mid >> 32);
 }
 
 /**
- * CryptoNight v0 (cn/0) hash function.
- *
- * Algorithm (portable path from Monero's slow-hash.c with variant=0):
- *  1. Keccak-1600(input) → 200-byte state
- *  2. AES-256 key expansion using state[0..31]
- *  3. Initialize 2 MB scratchpad (10-round AES per block)
- *  4. Main loop: 524288 operations (262144 iterations × 2 sub-steps)
- *     4a. AES single round + XOR + write
- *     4b. 64-bit multiply + accumulate + XOR + write
- *  5. Finalize: XOR scratchpad back + AES (key from state[32..63])
- *  6. Keccak-f permutation on state
- *  7. Select final hash: Blake-256 / Groestl-256 / JH-256 / Skein-256
+ * 64×64 → 128-bit multiply.
+ * Produces high and low 64-bit halves of (a * b) with the CN_MUL128 backend.
  */
-EMSCRIPTEN_KEEPALIVE
-void cn_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
-    uint8_t  state[200];
+static inline void mul_128(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+#if CN_MUL128 == CN_MUL128_INT128 || CN_MUL128 == CN_MUL128_WIDE
+    /* with wide-arithmetic enabled clang lowers this to i64.mul_wide_u */
+    unsigned __int128 p = (unsigned __int128)a * b;
+    *lo = (uint64_t)p;
+    *hi = (uint64_t)(p >> 64);
+#elif CN_MUL128 == CN_MUL128_UMUL128
+    *lo = _umul128(a, b, hi);
+#else
+    mul_128_portable(a, b, hi, lo);
+#endif
+}
+
+/* ======================= Nonce-aware absorb ======================= */
+/*
+ * A Monero hashing blob (76 bytes typically) fits in one 136-byte rate
+ * block, and between hashes of a job only the nonce at bytes 39..42
+ * changes: byte 7 of lane 4 and bytes 0..2 of lane 5.  Lane 4 sits in
+ * Theta column 4 and lane 5 in column 0, so the parities of
+ * columns 1-3 and the Theta-D of column 2 (D2 = C1 ^ rotl(C3, 1)) are
+ * fixed for the job.  cn_job_prepare() absorbs the block once with the
+ * nonce bytes zeroed, applies D2 to column 2 and keeps the parities;
+ * cn_job_absorb() then finishes round-0 Theta for the four columns the
+ * nonce reaches and runs the remaining permutation.
+ */
+#define CN_NONCE_OFFSET 39
+
+/** Writes a 32-bit nonce little-endian at blob offset 39 (Monero layout). */
+static inline void cn_set_nonce(uint8_t *blob, uint32_t blob_len, uint32_t nonce) {
+    if (blob_len >= CN_NONCE_OFFSET + 4) {
+        blob[CN_NONCE_OFFSET]     = (uint8_t)(nonce & 0xFF);
+        blob[CN_NONCE_OFFSET + 1] = (uint8_t)((nonce >> 8)  & 0xFF);
+        blob[CN_NONCE_OFFSET + 2] = (uint8_t)((nonce >> 16) & 0xFF);
+        blob[CN_NONCE_OFFSET + 3] = (uint8_t)((nonce >> 24) & 0xFF);
+    }
+}
+
+struct cn_job {
+    uint32_t blob_len;                      /* 0: no job set */
+    uint32_t one_block;                     /* blob < rate: nonce-aware path */
+    uint8_t  blob[CN_MAX_BLOB];             /* nonce bytes as given */
+    uint64_t lanes[25];                     /* absorbed block, nonce zeroed,
+                                               column 2 after Theta */
+    uint64_t parity[5];                     /* Theta C[x]; C0/C4 without the
+                                               nonce lanes 5/4 */
+};
+
+static void cn_job_prepare(struct cn_job *job, const uint8_t *blob, uint32_t blob_len) {
+    const int rsiz = 136;
+    uint8_t block[136];
+
+    job->blob_len = blob_len;
+    memcpy(job->blob, blob, blob_len);
+    job->one_block = blob_len >= CN_NONCE_OFFSET + 4 && blob_len < (uint32_t)rsiz;
+    if (!job->one_block) return;
+
+    memset(block, 0, rsiz);
+    memcpy(block, blob, blob_len);
+    memset(block + CN_NONCE_OFFSET, 0, 4);
+    block[blob_len] = 0x01;
+    block[rsiz - 1] |= 0x80;
+
+    uint64_t *st = job->lanes;
+    memset(st, 0, 200);
+    for (int i = 0; i < rsiz / 8; i++)
+        memcpy(&st[i], block + i * 8, 8);
+
+    for (int x = 0; x < 5; x++)
+        job->parity[x] = st[x] ^ st[x + 5] ^ st[x + 10] ^ st[x + 15] ^ st[x + 20];
+    job->parity[0] ^= st[5];
+    job->parity[4] ^= st[4];
+
+    const uint64_t d2 = job->parity[1] ^ ROTL64(job->parity[3], 1);
+    for (int j = 2; j < 25; j += 5)
+        st[j] ^= d2;
+}
+
+/** keccak1600() of the job blob with `nonce` at bytes 39..42. */
+static void cn_job_absorb(const struct cn_job *job, uint32_t nonce, uint8_t *md) {
+    if (!job->one_block) {
+        uint8_t blob[CN_MAX_BLOB];
+        memcpy(blob, job->blob, job->blob_len);
+        cn_set_nonce(blob, job->blob_len, nonce);
+        keccak1600(blob, job->blob_len, md);
+        return;
+    }
+
+    uint64_t st[25];
+    memcpy(st, job->lanes, 200);
+    st[4] |= (uint64_t)(nonce & 0xFF) << 56;
+    st[5] |= (uint64_t)(nonce >> 8);
+
+    const uint64_t c0 = job->parity[0] ^ st[5];
+    const uint64_t c4 = job->parity[4] ^ st[4];
+    const uint64_t d0 = c4 ^ ROTL64(job->parity[1], 1);
+    const uint64_t d1 = c0 ^ ROTL64(job->parity[2], 1);
+    const uint64_t d3 = job->parity[2] ^ ROTL64(c4, 1);
+    const uint64_t d4 = job->parity[3] ^ ROTL64(c0, 1);
+    for (int j = 0; j < 25; j += 5) {
+        st[j]     ^= d0;
+        st[j + 1] ^= d1;
+        st[j + 3] ^= d3;
+        st[j + 4] ^= d4;
+    }
+    keccakf_after_theta0(st);
+    memcpy(md, st, 200);
+}
+
+/* ========================= Hashing context ========================= */
+
+#define CN_MAX_WAYS 4
+
+typedef struct cn_ctx cn_ctx;
+
+/** Per-hash state: one lane per nonce hashed in the same call. */
+struct cn_lane {
+    uint8_t *scratchpad;                    /* algo->memory bytes */
+    union {
+        uint8_t  b[200];
+        uint64_t w[25];
+    } state;
+    uint64_t tweak1_2;                      /* variant 1 only */
+};
+
+/**
+ * One implementation of the scratchpad phases (steps 3-5) for one
+ * algorithm.  main_loop[0..2] run 1, 2 and 4 lanes interleaved; they
+ * return 0 when the context's control word abandoned the hashes.
+ */
+struct cn_backend {
+    const char *name;
+    void (*explode)(cn_ctx *ctx, struct cn_lane *lane);
+    int  (*main_loop[3])(cn_ctx *ctx);
+    void (*implode)(cn_ctx *ctx, struct cn_lane *lane);
+};
+
+/** A CN_ALGOS row with its instantiated backends. */
+struct cn_algo {
+    const char *name;
+    uint32_t memory;                        /* scratchpad bytes per lane */
+    uint32_t iterations;                    /* main-loop iterations */
+    uint32_t mask;                          /* scratchpad address mask */
+    int      variant;                       /* main-loop variant: 0, 1, 2, 4 */
+    int      heavy;                         /* cn-heavy mixing + division */
+    const struct cn_backend *portable;
+    const struct cn_backend *aesni;         /* NULL without CN_X86_AESNI */
+};
+
+static const struct cn_algo cn_algos[CN_ALGO_COUNT];
+static const struct cn_backend *cn_select_backend(const struct cn_algo *algo);
+
+/** A cn/r random-math program and the code generated for it. */
+struct cn_r_program {
+    uint64_t height;
+    void   (*run)(const struct V4_Instruction *code, uint32_t *r);   /* NULL: free slot */
+    void    *jit;                           /* generated code, NULL: interpreted */
+    struct V4_Instruction code[NUM_INSTRUCTIONS_MAX + 1];
+};
+
+#define CN_R_CACHE 4                        /* programs kept per context */
+
+/**
+ * Control word a scan runs under (see cn_ctx_set_control()): it stops,
+ * mid-hash if need be, once the word no longer reads `expect`.
+ */
+struct cn_control {
+    const uint32_t *word;                   /* in this module's memory, NULL: none */
+    uint32_t expect;
+    uint32_t host;                          /* Emscripten: Module.control[0] instead */
+};
+
+/** Counters scans add to (see cn_ctx_set_stats()); 64-bit words only. */
+typedef struct cn_stats {
+    uint64_t hashes;                        /* nonces hashed */
+    uint64_t shares;                        /* of those, hashes that met the target */
+    uint64_t busy_ns;                       /* time spent scanning */
+    uint64_t last_ns;                       /* wall clock at the end of the last scan */
+} cn_stats;
+
+#define CN_STATS_FIELDS 4
+
+/** Where a context's scans report to: memory, the page, or nowhere. */
+struct cn_stats_sink {
+    cn_stats *stats;                        /* in this module's memory, NULL: none */
+    uint32_t host;                          /* Emscripten: Module.stats slot + 1, 0: none */
+};
+
+/**
+ * Everything a hash needs, allocated once and reused for every nonce.
+ * Scratchpads are cache-line aligned and laid out back to back; state is
+ * a union so it can be handed to keccakf() without an aliasing cast.
+ */
+struct cn_ctx {
+    const struct cn_algo *algo;
+    const struct cn_backend *backend;       /* one of algo's backends */
+    uint32_t ways;                          /* lanes (scratchpads) owned */
+    uint8_t *memory;                        /* ways × algo->memory */
+    size_t   memory_size;                   /* bytes reserved at `memory` */
+    uint32_t memory_kind;                   /* enum cn_mem_kind */
     uint8_t  text[INIT_SIZE_BYTE];
     uint8_t  expanded_key[240];
-    uint8_t *hp_state;
+    struct cn_lane lane[CN_MAX_WAYS];
+    struct cn_job  job;                     /* set by cn_ctx_set_job() */
+    const struct cn_r_program *r_program;   /* cn/r: cn_ctx_set_height() */
+    struct cn_r_program r_cache[CN_R_CACHE];
+    uint32_t r_next;                        /* r_cache slot to replace next */
+    struct cn_control control;
+    struct cn_stats_sink stats;
+    uint32_t scanned;                       /* nonces the last cn_ctx_scan() covered */
+};
 
-    hp_state = (uint8_t *)malloc(CN_MEMORY);
-    if (!hp_state) return;
+#define CN_SCRATCHPAD_ALIGN 64
 
-    /* --- Step 1: Keccak → 200-byte state --- */
-    keccak1600(input, input_len, state);
+/* ========================== Preemption ========================== */
+/*
+ * A scan can be cut short from outside: the caller arms the context with a
+ * control word and the value it should hold.  The scan checks it before
+ * every kernel call and the main loop every CN_CONTROL_INTERVAL
+ * iterations, abandoning the hashes in flight, so a new job or a pause
+ * ends it within a fraction of a hash (cn/0: 1/32) instead of after the
+ * batch.  Natively and in the pool the word is in this module's memory; a
+ * browser worker's module memory is its own, so there the word is the
+ * page's SharedArrayBuffer, read through JS.
+ */
+#define CN_CONTROL_STOP 0x80000000u         /* or'ed in by the owner to pause */
+#define CN_CONTROL_INTERVAL 0x4000          /* main-loop iterations between checks */
 
-    /* --- Step 2: AES-256 key expansion (first 32 bytes of state) --- */
-    aes256_expand_key(state, expanded_key);
+#ifdef __EMSCRIPTEN__
+/* Module.control[0] (an Int32Array the adapter shares with every worker),
+ * or `expect` while the page has none */
+EM_JS(uint32_t, cn_control_host_load, (uint32_t expect), {
+    var word = Module['control'];
+    return word ? Atomics.load(word, 0) : expect;
+});
+#endif
 
-    /* --- Step 3: Initialize scratchpad --- */
-    memcpy(text, state + 64, INIT_SIZE_BYTE);
-    for (uint32_t i = 0; i < CN_MEMORY; i += INIT_SIZE_BYTE) {
-        for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE)
-            aes_pseudo_round(text + j, expanded_key);
-        memcpy(hp_state + i, text, INIT_SIZE_BYTE);
+static inline uint32_t cn_control_load(const uint32_t *word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(word, __ATOMIC_RELAXED);
+#else
+    return *(const volatile uint32_t *)word;
+#endif
+}
+
+static inline void cn_control_store(uint32_t *word, uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(word, value, __ATOMIC_RELAXED);
+#else
+    *(volatile uint32_t *)word = value;
+#endif
+}
+
+/** 1 once the word `c` was armed with has moved on (new job, stop). */
+static inline int cn_control_changed(const struct cn_control *c) {
+#ifdef __EMSCRIPTEN__
+    if (c->host) return cn_control_host_load(c->expect) != c->expect;
+#endif
+    return c->word && cn_control_load(c->word) != c->expect;
+}
+
+static void cn_control_arm(struct cn_control *c, const uint32_t *word, uint32_t expect, int host) {
+    c->word = host ? NULL : word;
+    c->expect = expect;
+#ifdef __EMSCRIPTEN__
+    c->host = (uint32_t)(host != 0);
+#else
+    c->host = 0;                            /* no page to share a word with */
+#endif
+}
+
+/* ===================== Scratchpad allocation ===================== */
+/*
+ * A cn/0 scratchpad is exactly one x86 2 MB page.  Backed by 4 KB pages, the
+ * main loop's random accesses walk 512 pages per lane and miss the TLB
+ * on most of them.  Allocation tries, in order:
+ *   hugetlb - mmap(MAP_HUGETLB) from the reserved pool (vm.nr_hugepages)
+ *   thp     - 2 MB-aligned anonymous memory with madvise(MADV_HUGEPAGE)
+ *   aligned - aligned_alloc (WASM, other OSes, or everything above failed)
+ */
+enum cn_mem_kind { CN_MEM_ALIGNED, CN_MEM_HUGETLB, CN_MEM_THP };
+
+static const char *const cn_mem_kind_names[] = { "aligned", "hugetlb", "thp" };
+
+#define CN_HUGEPAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+static int cn_hugepages_enabled = CN_HUGEPAGES;
+
+/** Turns huge-page scratchpads on/off for contexts created afterwards. */
+EMSCRIPTEN_KEEPALIVE
+void cn_set_hugepages(int enable) {
+    cn_hugepages_enabled = CN_HUGEPAGES && enable;
+}
+
+static uint8_t *cn_mem_alloc(size_t size, size_t *reserved, uint32_t *kind) {
+#if CN_HUGEPAGES && (defined(MAP_HUGETLB) || defined(MADV_HUGEPAGE))
+    if (cn_hugepages_enabled) {
+        const size_t huge = (size + CN_HUGEPAGE_SIZE - 1) & ~(CN_HUGEPAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+        void *p = mmap(NULL, huge, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *reserved = huge;
+            *kind = CN_MEM_HUGETLB;
+            return (uint8_t *)p;
+        }
+#endif
+#ifdef MADV_HUGEPAGE
+        /* Over-map by one page and trim so the region is 2 MB aligned,
+         * which THP needs to back it with whole huge pages */
+        uint8_t *raw = (uint8_t *)mmap(NULL, huge + CN_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if ((void *)raw != MAP_FAILED) {
+            uint8_t *aligned = (uint8_t *)(((uintptr_t)raw + CN_HUGEPAGE_SIZE - 1) &
+                                           ~(uintptr_t)(CN_HUGEPAGE_SIZE - 1));
+            if (aligned > raw)
+                munmap(raw, (size_t)(aligned - raw));
+            munmap(aligned + huge, (size_t)(raw + CN_HUGEPAGE_SIZE - aligned));
+            if (madvise(aligned, huge, MADV_HUGEPAGE) == 0) {
+                *reserved = huge;
+                *kind = CN_MEM_THP;
+                return aligned;
+            }
+            munmap(aligned, huge);
+        }
+#endif
+    }
+#endif
+    *reserved = size;
+    *kind = CN_MEM_ALIGNED;
+    return (uint8_t *)aligned_alloc(CN_SCRATCHPAD_ALIGN, size);
+}
+
+static void cn_mem_free(uint8_t *p, size_t reserved, uint32_t kind) {
+#if CN_HUGEPAGES
+    if (kind != CN_MEM_ALIGNED) {
+        munmap(p, reserved);
+        return;
     }
+#endif
+    (void)reserved;
+    (void)kind;
+    free(p);
+}
 
-    /* --- Step 4: Main loop --- */
-    /* a = state[0..15] XOR state[32..47]
-     * b = state[16..31] XOR state[48..63]  */
-    uint64_t a[2], b[2];
-    {
-        uint64_t s0, s1, s2, s3;
-        memcpy(&s0, state +  0, 8);  memcpy(&s1, state +  8, 8);
-        memcpy(&s2, state + 32, 8);  memcpy(&s3, state + 40, 8);
-        a[0] = s0 ^ s2;  a[1] = s1 ^ s3;
+/* ===================== cn/r random-math programs ===================== */
+/*
+ * cn/r (Monero variant 4) replaces cn/2's division and square root with
+ * 60-70 random 32-bit MUL/ADD/SUB/ROR/ROL/XOR instructions over nine
+ * registers r0-r8, a new program per block height.  v4_random_math_init()
+ * generates it; instead of interpreting it twice per iteration, every
+ * program is translated once into a function taking r[] in memory:
+ *   - x86-64 Linux: machine code in its own executable page, r0-r8 held in
+ *     registers for the whole program;
+ *   - Emscripten: a ~1 KB WebAssembly module importing this module's
+ *     memory, compiled by the engine and added to the function table.
+ * Contexts keep the last CN_R_CACHE programs keyed by height.  When code
+ * generation is off or fails the program runs through Monero's
+ * interpreter (cn_r_interpret), which the tests check the generated code
+ * against.
+ */
+typedef void (*cn_r_fn)(const struct V4_Instruction *code, uint32_t *r);
+
+static int cn_r_jit_enabled = CN_R_JIT;
 
-        memcpy(&s0, state + 16, 8);  memcpy(&s1, state + 24, 8);
-        memcpy(&s2, state + 48, 8);  memcpy(&s3, state + 56, 8);
-        b[0] = s0 ^ s2;  b[1] = s1 ^ s3;
+/** Turns cn/r code generation on/off for programs generated afterwards. */
+EMSCRIPTEN_KEEPALIVE
+void cn_set_r_jit(int enable) {
+    cn_r_jit_enabled = CN_R_JIT && enable;
+}
+
+static void cn_r_interpret(const struct V4_Instruction *code, uint32_t *r) {
+    v4_random_math(code, r);
+}
+
+#if CN_R_JIT && !defined(__EMSCRIPTEN__)
+#define CN_R_X86_CODE_SIZE 4096             /* one page; programs need < 1 KB */
+
+/* r0-r8 in eax, edx, edi, r8d-r11d, ebx, ebp; ecx takes rotation counts
+ * and rsi points at r[] (the SysV code argument in rdi is not needed) */
+static const uint8_t cn_r_x86_reg[9] = { 0, 2, 7, 8, 9, 10, 11, 3, 5 };
+
+/* REX if needed, 1-2 opcode bytes, then ModRM for register `reg` and
+ * either register `rm` or, with disp >= 0, [rsi + disp8] */
+static uint8_t *cn_r_x86_op(uint8_t *p, uint32_t opcode, int reg, int rm, int disp) {
+    const int rex = ((reg & 8) >> 1) | (disp < 0 ? (rm & 8) >> 3 : 0);
+    if (rex) *p++ = (uint8_t)(0x40 | rex);
+    if (opcode > 0xFF) *p++ = (uint8_t)(opcode >> 8);
+    *p++ = (uint8_t)opcode;
+    if (disp < 0) {
+        *p++ = (uint8_t)(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    } else {
+        *p++ = (uint8_t)(0x40 | ((reg & 7) << 3) | 6);
+        *p++ = (uint8_t)disp;
     }
+    return p;
+}
 
-    for (uint32_t i = 0; i < CN_ITER / 2; i++) {
-        /* ------ Sub-step A: AES round ------ */
-        uint32_t j1 = ((uint32_t)a[0]) & 0x1FFFF0;
-        uint8_t  c1[16];
-        memcpy(c1, hp_state + j1, 16);
-        aes_single_round(c1, c1, (const uint8_t *)a);
-
-        /* Write (c1 XOR b) to scratchpad, then b ← c1 */
-        {
-            uint64_t c1_64[2], *sp = (uint64_t *)(hp_state + j1);
-            memcpy(c1_64, c1, 16);
-            sp[0] = c1_64[0] ^ b[0];
-            sp[1] = c1_64[1] ^ b[1];
-        }
+static void *cn_r_compile(const struct V4_Instruction *code) {
+    uint8_t *mem = (uint8_t *)mmap(NULL, CN_R_X86_CODE_SIZE, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return NULL;
 
-        /* ------ Sub-step B: Multiply ------ */
-        uint64_t c1_64[2];
-        memcpy(c1_64, c1, 16);
-        uint32_t j2 = ((uint32_t)c1_64[0]) & 0x1FFFF0;
-        uint64_t *p2 = (uint64_t *)(hp_state + j2);
-        uint64_t c2_0 = p2[0], c2_1 = p2[1];
-
-        uint64_t hi, lo;
-        mul_128(c1_64[0], c2_0, &hi, &lo);
-
-        a[0] += hi;
-        a[1] += lo;
-
-        /* Write updated a to scratchpad */
-        p2[0] = a[0];
-        p2[1] = a[1];
-
-        /* XOR a with original scratchpad value */
-        a[0] ^= c2_0;
-        a[1] ^= c2_1;
-
-        /* b ← c1 */
-        b[0] = c1_64[0];
-        b[1] = c1_64[1];
-    }
-
-    /* --- Step 5: Finalize scratchpad → state --- */
-    aes256_expand_key(state + 32, expanded_key);
-    memcpy(text, state + 64, INIT_SIZE_BYTE);
-    for (uint32_t i = 0; i < CN_MEMORY; i += INIT_SIZE_BYTE) {
-        for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE) {
-            xor_blocks(text + j, hp_state + i + j);
-            aes_pseudo_round(text + j, expanded_key);
+    uint8_t *p = mem;
+    *p++ = 0x53;                                            /* push rbx */
+    *p++ = 0x55;                                            /* push rbp */
+    for (int i = 0; i < 9; i++)                             /* mov reg, [rsi + 4i] */
+        p = cn_r_x86_op(p, 0x8B, cn_r_x86_reg[i], 0, 4 * i);
+
+    for (const struct V4_Instruction *op = code; op->opcode != RET; op++) {
+        const int dst = cn_r_x86_reg[op->dst_index];
+        const int src = cn_r_x86_reg[op->src_index];
+        switch (op->opcode) {
+        case MUL: p = cn_r_x86_op(p, 0x0FAF, dst, src, -1); break;     /* imul dst, src */
+        case ADD:
+            p = cn_r_x86_op(p, 0x01, src, dst, -1);                     /* add dst, src */
+            if (op->C) {
+                p = cn_r_x86_op(p, 0x81, 0, dst, -1);                   /* add dst, C */
+                memcpy(p, &op->C, 4);
+                p += 4;
+            }
+            break;
+        case SUB: p = cn_r_x86_op(p, 0x29, src, dst, -1); break;       /* sub dst, src */
+        case XOR: p = cn_r_x86_op(p, 0x31, src, dst, -1); break;       /* xor dst, src */
+        case ROR:
+        case ROL:
+            p = cn_r_x86_op(p, 0x89, src, 1, -1);                       /* mov ecx, src */
+            p = cn_r_x86_op(p, 0xD3, op->opcode == ROR ? 1 : 0, dst, -1); /* ror/rol dst, cl */
+            break;
         }
     }
-    memcpy(state + 64, text, INIT_SIZE_BYTE);
 
-    /* --- Step 6: Final Keccak-f permutation --- */
-    keccakf((uint64_t *)state);
+    for (int i = 0; i < 4; i++)                             /* mov [rsi + 4i], reg */
+        p = cn_r_x86_op(p, 0x89, cn_r_x86_reg[i], 0, 4 * i);
+    *p++ = 0x5D;                                            /* pop rbp */
+    *p++ = 0x5B;                                            /* pop rbx */
+    *p++ = 0xC3;                                            /* ret */
 
-    /* --- Step 7: Select final hash --- */
-    switch (state[0] & 3) {
-        case 0:  blake256_hash(output, state, 200);                 break;
-        case 1:  groestl(state, (unsigned long long)200 * 8, output); break;
-        case 2:  jh_hash(256, state, (unsigned long long)200 * 8, output); break;
-        default: skein_hash(256, state, (size_t)(200 * 8), output); break;
+    if (mprotect(mem, CN_R_X86_CODE_SIZE, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, CN_R_X86_CODE_SIZE);
+        return NULL;
     }
-
-    free(hp_state);
+    return mem;
 }
 
-/* ======================== WASM API exports ======================== */
-
-EMSCRIPTEN_KEEPALIVE
-uint32_t get_memory_size(void) {
-    return CN_MEMORY;
+static void cn_r_release(void *jit) {
+    munmap(jit, CN_R_X86_CODE_SIZE);
 }
 
-EMSCRIPTEN_KEEPALIVE
-int try_hash(const uint8_t *blob, uint32_t blob_len, uint32_t nonce,
-             uint64_t target, uint8_t *out_hash)
-{
-    uint8_t input[256];
-    if (blob_len > 256) return 0;
-    memcpy(input, blob, blob_len);
-    /* Set nonce at offset 39 (little-endian) */
-    if (blob_len >= 43) {
-        input[39] = (uint8_t)(nonce & 0xFF);
-        input[40] = (uint8_t)((nonce >> 8)  & 0xFF);
-        input[41] = (uint8_t)((nonce >> 16) & 0xFF);
-        input[42] = (uint8_t)((nonce >> 24) & 0xFF);
+#endif
+
+#if CN_R_JIT && defined(__EMSCRIPTEN__)
+/* Table index of the generated module's export, 0 on failure (old engine,
+ * table not growable).  Under -pthread every thread has its own table, so
+ * a cn/r context only hashes on the thread that created it. */
+EM_JS_DEPS(cn_r_jit, "$addFunction,$removeFunction");
+EM_JS(int, cn_r_wasm_instantiate, (const uint8_t *bytes, uint32_t len), {
+    try {
+        var module = new WebAssembly.Module(HEAPU8.slice(bytes, bytes + len));
+        var instance = new WebAssembly.Instance(module, { env: { memory: wasmMemory } });
+        return addFunction(instance.exports.r, 'vii');
+    } catch (e) {
+        return 0;
     }
-    cn_hash(input, blob_len, out_hash);
+});
+EM_JS(void, cn_r_wasm_remove, (int index), {
+    removeFunction(index);
+});
 
-    uint64_t hash_val;
-    memcpy(&hash_val, out_hash + 24, 8);
-    return (hash_val < target) ? 1 : 0;
+static uint8_t *cn_r_uleb(uint8_t *p, uint32_t v) {
+    do {
+        uint8_t byte = v & 0x7F;
+        v >>= 7;
+        *p++ = (uint8_t)(byte | (v ? 0x80 : 0));
+    } while (v);
+    return p;
 }
+
+static uint8_t *cn_r_sleb(uint8_t *p, int32_t v) {
+    for (;;) {
+        const uint8_t byte = v & 0x7F;
+        v >>= 7;
+        if ((v == 0 && !(byte & 0x40)) || (v == -1 && (byte & 0x40))) {
+            *p++ = byte;
+            return p;
+        }
+        *p++ = (uint8_t)(byte | 0x80);
+    }
+}
+
+/* (func (param $code i32) (param $r i32) (local $r0..$r8 i32) ...): locals
+ * 2-10 hold r0-r8 */
+static uint32_t cn_r_wasm_body(const struct V4_Instruction *code, uint8_t *out) {
+    static const uint8_t ops[] = {
+        [MUL] = 0x6C, [ADD] = 0x6A, [SUB] = 0x6B, [ROR] = 0x78, [ROL] = 0x77, [XOR] = 0x73,
+    };
+    uint8_t *p = out;
+    *p++ = 1; *p++ = 9; *p++ = 0x7F;                        /* 9 i32 locals */
+    for (int i = 0; i < 9; i++) {                           /* $ri = i32.load offset=4i ($r) */
+        *p++ = 0x20; *p++ = 1;
+        *p++ = 0x28; *p++ = 2; *p++ = (uint8_t)(4 * i);
+        *p++ = 0x21; *p++ = (uint8_t)(2 + i);
+    }
+    for (const struct V4_Instruction *op = code; op->opcode != RET; op++) {
+        *p++ = 0x20; *p++ = (uint8_t)(2 + op->dst_index);
+        *p++ = 0x20; *p++ = (uint8_t)(2 + op->src_index);
+        *p++ = ops[op->opcode];
+        if (op->opcode == ADD && op->C) {
+            *p++ = 0x41;
+            p = cn_r_sleb(p, (int32_t)op->C);
+            *p++ = 0x6A;
+        }
+        *p++ = 0x21; *p++ = (uint8_t)(2 + op->dst_index);
+    }
+    for (int i = 0; i < 4; i++) {                           /* i32.store offset=4i ($r) $ri */
+        *p++ = 0x20; *p++ = 1;
+        *p++ = 0x20; *p++ = (uint8_t)(2 + i);
+        *p++ = 0x36; *p++ = 2; *p++ = (uint8_t)(4 * i);
+    }
+    *p++ = 0x0B;
+    return (uint32_t)(p - out);
+}
+
+static void *cn_r_compile(const struct V4_Instruction *code) {
+    static const uint8_t head[] = {
+        0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00,
+        0x01, 0x06, 0x01, 0x60, 0x02, 0x7F, 0x7F, 0x00,     /* type 0: (i32, i32) -> () */
+#ifdef __EMSCRIPTEN_PTHREADS__
+        0x02, 0x12, 0x01, 0x03, 'e', 'n', 'v',              /* import env.memory, */
+        0x06, 'm', 'e', 'm', 'o', 'r', 'y', 0x02, 0x03,     /* shared, max 4 GB */
+        0x00, 0x80, 0x80, 0x04,
+#else
+        0x02, 0x0F, 0x01, 0x03, 'e', 'n', 'v',              /* import env.memory */
+        0x06, 'm', 'e', 'm', 'o', 'r', 'y', 0x02, 0x00, 0x00,
+#endif
+        0x03, 0x02, 0x01, 0x00,                             /* func 0: type 0 */
+        0x07, 0x05, 0x01, 0x01, 'r', 0x00, 0x00,            /* export "r" = func 0 */
+    };
+    uint8_t body[2048], module[sizeof(head) + 16 + sizeof(body)];
+    const uint32_t body_len = cn_r_wasm_body(code, body);
+
+    uint8_t size[5], *p = module + sizeof(head);
+    const uint32_t size_len = (uint32_t)(cn_r_uleb(size, body_len) - size);
+    memcpy(module, head, sizeof(head));
+    *p++ = 0x0A;                                            /* code section */
+    p = cn_r_uleb(p, 1 + size_len + body_len);
+    *p++ = 1;
+    p = cn_r_uleb(p, body_len);
+    memcpy(p, body, body_len);
+    p += body_len;
+
+    const int index = cn_r_wasm_instantiate(module, (uint32_t)(p - module));
+    return index ? (void *)(uintptr_t)index : NULL;
+}
+
+static void cn_r_release(void *jit) {
+    cn_r_wasm_remove((int)(uintptr_t)jit);
+}
+
+#endif
+
+/* Generated code: x86-64 entry point or WebAssembly table index */
+#define cn_r_jit_fn(jit) ((cn_r_fn)(uintptr_t)(jit))
+
+static void cn_r_program_release(struct cn_r_program *prog) {
+#if CN_R_JIT
+    if (prog->jit) cn_r_release(prog->jit);
+#endif
+    prog->jit = NULL;
+    prog->run = NULL;
+}
+
+/* ctx's program for `height`: cached, or generated into the least
+ * recently generated slot */
+static const struct cn_r_program *cn_r_program_get(cn_ctx *ctx, uint64_t height) {
+    for (uint32_t i = 0; i < CN_R_CACHE; i++)
+        if (ctx->r_cache[i].run && ctx->r_cache[i].height == height)
+            return &ctx->r_cache[i];
+
+    struct cn_r_program *prog = &ctx->r_cache[ctx->r_next];
+    ctx->r_next = (ctx->r_next + 1) % CN_R_CACHE;
+    cn_r_program_release(prog);
+
+    prog->height = height;
+    v4_random_math_init(prog->code, height);
+    prog->run = cn_r_interpret;
+#if CN_R_JIT
+    if (cn_r_jit_enabled && (prog->jit = cn_r_compile(prog->code)))
+        prog->run = cn_r_jit_fn(prog->jit);
+#endif
+    return prog;
+}
+
+/**
+ * Block height for a cn/r context: selects (generating and compiling it on
+ * first use) the random-math program its hashes run.  New cn/r contexts
+ * start at height 0; other algorithms ignore the height.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_ctx_set_height(cn_ctx *ctx, uint64_t height) {
+    if (ctx->algo->variant == 4)
+        ctx->r_program = cn_r_program_get(ctx, height);
+}
+
+/**
+ * Context hashing `algo` (enum cn_algo_id) that can do `ways` (1, 2 or 4)
+ * nonces per call with cn_hash_x2()/cn_hash_x4().  Each way owns its own
+ * scratchpad.  Returns NULL for an unknown algorithm or way-count.
+ */
+EMSCRIPTEN_KEEPALIVE
+cn_ctx *cn_ctx_create_algo(uint32_t algo, uint32_t ways) {
+    if (algo >= CN_ALGO_COUNT) return NULL;
+    if (ways != 1 && ways != 2 && ways != 4) return NULL;
+
+    cn_ctx *ctx = (cn_ctx *)calloc(1, sizeof(cn_ctx));
+    if (!ctx) return NULL;
+
+    ctx->algo = &cn_algos[algo];
+    ctx->memory = cn_mem_alloc((size_t)ways * ctx->algo->memory,
+                               &ctx->memory_size, &ctx->memory_kind);
+    if (!ctx->memory) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->ways = ways;
+    for (uint32_t w = 0; w < ways; w++)
+        ctx->lane[w].scratchpad = ctx->memory + (size_t)w * ctx->algo->memory;
+    ctx->backend = cn_select_backend(ctx->algo);
+    cn_ctx_set_height(ctx, 0);
+    return ctx;
+}
+
+/** cn/0 context for `ways` nonces per call. */
+EMSCRIPTEN_KEEPALIVE
+cn_ctx *cn_ctx_create_ways(uint32_t ways) {
+    return cn_ctx_create_algo(CN_ALGO_CN0, ways);
+}
+
+EMSCRIPTEN_KEEPALIVE
+cn_ctx *cn_ctx_create(void) {
+    return cn_ctx_create_ways(1);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_ctx_destroy(cn_ctx *ctx) {
+    if (!ctx) return;
+    for (uint32_t i = 0; i < CN_R_CACHE; i++)
+        cn_r_program_release(&ctx->r_cache[i]);
+    cn_mem_free(ctx->memory, ctx->memory_size, ctx->memory_kind);
+    free(ctx);
+}
+
+/* cn-heavy: after each 8-block pass, block i ^= block i+1 (the last one
+ * takes the old first block) */
+static inline void cn_mix_and_propagate(uint8_t *text) {
+    uint8_t first[AES_BLOCK_SIZE];
+    memcpy(first, text, AES_BLOCK_SIZE);
+    for (int j = 0; j < INIT_SIZE_BYTE - AES_BLOCK_SIZE; j += AES_BLOCK_SIZE)
+        xor_blocks(text + j, text + j + AES_BLOCK_SIZE);
+    xor_blocks(text + INIT_SIZE_BYTE - AES_BLOCK_SIZE, first);
+}
+
+/* --- Step 3: fill the scratchpad from state[64..191] (10-round AES) --- */
+static CN_ALWAYS_INLINE void cn_explode(cn_ctx *ctx, struct cn_lane *lane,
+                                        const uint32_t memory, const int heavy) {
+    uint8_t *hp_state = lane->scratchpad;
+    uint8_t *text = ctx->text;
+
+    aes256_expand_key(lane->state.b, ctx->expanded_key);
+    memcpy(text, lane->state.b + 64, INIT_SIZE_BYTE);
+    if (heavy) {
+        for (int r = 0; r < 16; r++) {
+            for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE)
+                cn_aes_pseudo_round(text + j, ctx->expanded_key);
+            cn_mix_and_propagate(text);
+        }
+    }
+    for (uint32_t i = 0; i < memory; i += INIT_SIZE_BYTE) {
+        for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE)
+            cn_aes_pseudo_round(text + j, ctx->expanded_key);
+        memcpy(hp_state + i, text, INIT_SIZE_BYTE);
+    }
+}
+
+/*
+ * cn-heavy's extra main-loop step: a signed 64/32 division on the block at
+ * `idx`, whose quotient is folded into the block and yields the next
+ * address.  INT64_MIN / -1 (which traps on x86) is taken as the wrapped
+ * quotient INT64_MIN.
+ */
+static inline uint64_t cn_heavy_div(uint8_t *l, uint64_t idx, uint32_t mask) {
+    uint8_t *p = l + ((uint32_t)idx & mask);
+    int64_t n;
+    int32_t d;
+    memcpy(&n, p, 8);
+    memcpy(&d, p + 8, 4);
+    const int64_t dv = (int64_t)(d | 0x5);
+    const int64_t q = (dv == -1) ? (int64_t)(0 - (uint64_t)n) : n / dv;
+    const int64_t nq = n ^ q;
+    memcpy(p, &nq, 8);
+    return (uint64_t)((int64_t)d ^ q);
+}
+
+/*
+ * cn/1 (Monero VARIANT1): after the AES half-step, bits 4-5 of byte 11 of
+ * the block just written are flipped according to a 3-bit index taken from
+ * that byte; the multiply half-step stores its high word XOR tweak1_2.
+ */
+static inline void cn_variant1_1(uint8_t *p) {
+    const uint8_t tmp = p[11];
+    const uint8_t index = (uint8_t)((((tmp >> 3) & 6) | (tmp & 1)) << 1);
+    p[11] = tmp ^ (uint8_t)((0x75310 >> index) & 0x30);
+}
+
+/* tweak1_2 = state[192..199] XOR the 8 input bytes at offset 35 (which end
+ * with the nonce); inputs shorter than 43 bytes have no cn/1 hash */
+#define CN_VARIANT1_OFFSET 35
+
+static inline uint64_t cn_variant1_tweak(const struct cn_lane *lane, const uint8_t *data35) {
+    uint64_t v;
+    memcpy(&v, data35, 8);
+    return lane->state.w[24] ^ v;
+}
+
+/*
+ * cn/2 (Monero VARIANT2).  Each lane also carries the previous b block
+ * (b1) and the last division / square-root results:
+ *   - the three 16-byte neighbours of the accessed block (offset ^ 0x10,
+ *     ^ 0x20, ^ 0x30) are rotated and added to b1, a and b;
+ *   - the multiply half-step first XORs the results into c2[0], then
+ *     divides c1[1] by a 32-bit divisor built from c1[0] and takes an
+ *     integer square root, both of which feed the next iteration;
+ *   - the 128-bit product is XORed through the first two neighbours.
+ */
+static inline void cn_variant2_init(const struct cn_lane *lane, uint64_t b1[2],
+                                    uint64_t *division_result, uint64_t *sqrt_result) {
+    const uint64_t *st = lane->state.w;
+    b1[0] = st[8] ^ st[10];
+    b1[1] = st[9] ^ st[11];
+    *division_result = st[12];
+    *sqrt_result = st[13];
+}
+
+/* floor(2 * (sqrt(n + 2^64) - 2^32)) from one double-precision sqrt, then
+ * corrected by at most one in either direction */
+static inline uint64_t cn_variant2_sqrt(uint64_t n) {
+    uint64_t r = (uint64_t)(sqrt((double)n + 18446744073709551616.0) * 2.0 - 8589934592.0);
+    const uint64_t s = r >> 1;
+    const uint64_t b = r & 1;
+    const uint64_t r2 = s * (s + b) + (r << 32);
+    r += (uint64_t)(((r2 + b > n) ? -1 : 0) + ((r2 + (1ULL << 32) < n - s) ? 1 : 0));
+    return r;
+}
+
+/* Division and square-root step; returns c2[0] with the previous results
+ * folded in */
+static inline uint64_t cn_variant2_math(uint64_t c2_0, uint64_t c1_0, uint64_t c1_1,
+                                        uint64_t *division_result, uint64_t *sqrt_result) {
+    c2_0 ^= *division_result ^ (*sqrt_result << 32);
+    const uint32_t divisor = (uint32_t)((c1_0 + (uint32_t)(*sqrt_result << 1)) | 0x80000001UL);
+    *division_result = (uint32_t)(c1_1 / divisor) + ((c1_1 % divisor) << 32);
+    *sqrt_result = cn_variant2_sqrt(c1_0 + *division_result);
+    return c2_0;
+}
+
+/* cn/r (variant 4) also XORs the three old neighbours into c (c1 of the
+ * current half-step) */
+static inline void cn_variant2_shuffle(uint8_t *l, uint32_t j, const uint64_t a[2],
+                                       const uint64_t b0[2], const uint64_t b1[2],
+                                       uint64_t c[2], const int variant) {
+    uint64_t *n1 = (uint64_t *)(l + (j ^ 0x10));
+    uint64_t *n2 = (uint64_t *)(l + (j ^ 0x20));
+    uint64_t *n3 = (uint64_t *)(l + (j ^ 0x30));
+    const uint64_t n1_0 = n1[0], n1_1 = n1[1];
+    const uint64_t n2_0 = n2[0], n2_1 = n2[1];
+    const uint64_t n3_0 = n3[0], n3_1 = n3[1];
+
+    n1[0] = n3_0 + b1[0];   n1[1] = n3_1 + b1[1];
+    n3[0] = n2_0 + a[0];    n3[1] = n2_1 + a[1];
+    n2[0] = n1_0 + b0[0];   n2[1] = n1_1 + b0[1];
+    if (variant == 4) {
+        c[0] ^= n1_0 ^ n2_0 ^ n3_0;
+        c[1] ^= n1_1 ^ n2_1 ^ n3_1;
+    }
+}
+
+/* The product goes through the first neighbour, the second one into it */
+static inline void cn_variant2_mix_product(uint8_t *l, uint32_t j, uint64_t *hi, uint64_t *lo) {
+    uint64_t *n1 = (uint64_t *)(l + (j ^ 0x10));
+    const uint64_t *n2 = (const uint64_t *)(l + (j ^ 0x20));
+    n1[0] ^= *hi;
+    n1[1] ^= *lo;
+    *hi ^= n2[0];
+    *lo ^= n2[1];
+}
+
+/*
+ * cn/r (Monero VARIANT4): cn/2's shuffle and b1, but the division and
+ * square root (and the product mixing) give way to the height's random
+ * program over r0-r8.  r0-r3 persist across iterations, seeded from
+ * state[96..111]; before each multiply their sums go into c2[0], r4-r8
+ * are reloaded from a, b and b1, and the program's r0-r3 end up in a.
+ */
+static inline void cn_variant4_init(const struct cn_lane *lane, uint32_t r[9]) {
+    const uint64_t *st = lane->state.w;
+    r[0] = (uint32_t)st[12];  r[1] = (uint32_t)(st[12] >> 32);
+    r[2] = (uint32_t)st[13];  r[3] = (uint32_t)(st[13] >> 32);
+}
+
+/* Random-math step; returns c2[0] with r0-r3 folded in and updates a (a
+ * copy: the shuffle still uses the original) */
+static inline uint64_t cn_variant4_math(const struct cn_r_program *prog, uint32_t r[9],
+                                        uint64_t c2_0, uint64_t a[2], uint64_t b0_0,
+                                        uint64_t b1_0, uint64_t b1_1) {
+    c2_0 ^= (uint64_t)(r[0] + r[1]) | ((uint64_t)(r[2] + r[3]) << 32);
+    r[4] = (uint32_t)a[0];
+    r[5] = (uint32_t)a[1];
+    r[6] = (uint32_t)b0_0;
+    r[7] = (uint32_t)b1_0;
+    r[8] = (uint32_t)b1_1;
+    prog->run(prog->code, r);
+    a[0] ^= r[2] | ((uint64_t)r[3] << 32);
+    a[1] ^= r[0] | ((uint64_t)r[1] << 32);
+    return c2_0;
+}
+
+/*
+ * --- Step 4: memory-hard main loop ---
+ *
+ * Each half-step is a dependent random access into the scratchpad, so a
+ * single hash mostly waits on cache misses.  The loops below advance
+ * `ways` independent hashes in lock step: all lanes' AES half-steps, then
+ * all lanes' multiply half-steps, so their memory accesses overlap.
+ * `ways`, `iterations`, `mask`, `variant` and `heavy` are compile-time
+ * constants at every call site: the lane loops unroll completely, the
+ * variant steps of other variants compile away, and idx[] collapses into
+ * a[] for the non-heavy algorithms.  Each variant is thereby its own loop
+ * with no per-iteration variant checks.
+ */
+#if CN_SIMD128
+static inline v128_t cn_variant2_shuffle_simd(uint8_t *l, uint32_t j, v128_t a, v128_t b0,
+                                              v128_t b1, v128_t c, const int variant) {
+    v128_t *n1 = (v128_t *)(l + (j ^ 0x10));
+    v128_t *n2 = (v128_t *)(l + (j ^ 0x20));
+    v128_t *n3 = (v128_t *)(l + (j ^ 0x30));
+    const v128_t n1_old = wasm_v128_load(n1);
+    const v128_t n2_old = wasm_v128_load(n2);
+    const v128_t n3_old = wasm_v128_load(n3);
+
+    wasm_v128_store(n1, wasm_i64x2_add(n3_old, b1));
+    wasm_v128_store(n3, wasm_i64x2_add(n2_old, a));
+    wasm_v128_store(n2, wasm_i64x2_add(n1_old, b0));
+    if (variant == 4)
+        c = wasm_v128_xor(c, wasm_v128_xor(n1_old, wasm_v128_xor(n2_old, n3_old)));
+    return c;
+}
+
+static CN_ALWAYS_INLINE int cn_main_loop_n(cn_ctx *ctx, const uint32_t ways,
+                                           const uint32_t iterations, const uint32_t mask,
+                                           const int variant, const int heavy) {
+    uint8_t *l[CN_MAX_WAYS];
+    v128_t a[CN_MAX_WAYS], b[CN_MAX_WAYS], c1[CN_MAX_WAYS];
+    uint64_t idx[CN_MAX_WAYS];
+    uint64_t tweak1_2[CN_MAX_WAYS];                             /* cn/1 */
+    v128_t b1[CN_MAX_WAYS];                                     /* cn/2, cn/r */
+    uint64_t division_result[CN_MAX_WAYS], sqrt_result[CN_MAX_WAYS];
+    uint32_t r[CN_MAX_WAYS][9];                                 /* cn/r */
+    const struct cn_r_program *prog = ctx->r_program;
+
+    for (uint32_t w = 0; w < ways; w++) {
+        const uint8_t *st = ctx->lane[w].state.b;
+        l[w] = ctx->lane[w].scratchpad;
+        a[w] = wasm_v128_xor(wasm_v128_load(st),      wasm_v128_load(st + 32));
+        b[w] = wasm_v128_xor(wasm_v128_load(st + 16), wasm_v128_load(st + 48));
+        idx[w] = (uint64_t)wasm_i64x2_extract_lane(a[w], 0);
+        tweak1_2[w] = ctx->lane[w].tweak1_2;
+        if (variant >= 2) {
+            uint64_t b1w[2];
+            cn_variant2_init(&ctx->lane[w], b1w, &division_result[w], &sqrt_result[w]);
+            b1[w] = wasm_i64x2_make((int64_t)b1w[0], (int64_t)b1w[1]);
+        }
+        if (variant == 4)
+            cn_variant4_init(&ctx->lane[w], r[w]);
+    }
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (!(i & (CN_CONTROL_INTERVAL - 1)) && cn_control_changed(&ctx->control))
+            return 0;
+
+        /* ------ Sub-step A: AES round, write (c1 XOR b) ------ */
+        _Pragma("GCC unroll 4")
+        for (uint32_t w = 0; w < ways; w++) {
+            const uint32_t j = (uint32_t)idx[w] & mask;
+            uint8_t *p1 = l[w] + j;
+            c1[w] = aes_round_simd(wasm_v128_load(p1), a[w]);
+            if (variant >= 2)
+                c1[w] = cn_variant2_shuffle_simd(l[w], j, a[w], b[w], b1[w], c1[w], variant);
+            wasm_v128_store(p1, wasm_v128_xor(c1[w], b[w]));
+            if (variant == 1)
+                cn_variant1_1(p1);
+        }
+
+        /* ------ Sub-step B: Multiply, write a, a ^= c2 ------ */
+        _Pragma("GCC unroll 4")
+        for (uint32_t w = 0; w < ways; w++) {
+            const uint64_t c1_0 = (uint64_t)wasm_i64x2_extract_lane(c1[w], 0);
+            const uint32_t j = (uint32_t)c1_0 & mask;
+            uint8_t *p2 = l[w] + j;
+            v128_t c2 = wasm_v128_load(p2);
+            uint64_t c2_0 = (uint64_t)wasm_i64x2_extract_lane(c2, 0);
+            v128_t ar = a[w];                   /* a after cn/r's random math */
+
+            if (variant == 2) {
+                c2_0 = cn_variant2_math(c2_0, c1_0, (uint64_t)wasm_i64x2_extract_lane(c1[w], 1),
+                                        &division_result[w], &sqrt_result[w]);
+                c2 = wasm_i64x2_replace_lane(c2, 0, (int64_t)c2_0);
+            }
+            if (variant == 4) {
+                uint64_t a4[2] = { (uint64_t)wasm_i64x2_extract_lane(ar, 0),
+                                   (uint64_t)wasm_i64x2_extract_lane(ar, 1) };
+                c2_0 = cn_variant4_math(prog, r[w], c2_0, a4,
+                                        (uint64_t)wasm_i64x2_extract_lane(b[w], 0),
+                                        (uint64_t)wasm_i64x2_extract_lane(b1[w], 0),
+                                        (uint64_t)wasm_i64x2_extract_lane(b1[w], 1));
+                c2 = wasm_i64x2_replace_lane(c2, 0, (int64_t)c2_0);
+                ar = wasm_i64x2_make((int64_t)a4[0], (int64_t)a4[1]);
+            }
+
+            uint64_t hi, lo;
+            mul_128(c1_0, c2_0, &hi, &lo);
+
+            if (variant == 2)
+                cn_variant2_mix_product(l[w], j, &hi, &lo);
+            if (variant >= 2)
+                c1[w] = cn_variant2_shuffle_simd(l[w], j, a[w], b[w], b1[w], c1[w], variant);
+
+            a[w] = wasm_i64x2_add(ar, wasm_i64x2_make((int64_t)hi, (int64_t)lo));
+            if (variant == 1)
+                wasm_v128_store(p2, wasm_v128_xor(a[w], wasm_i64x2_make(0, (int64_t)tweak1_2[w])));
+            else
+                wasm_v128_store(p2, a[w]);
+            a[w] = wasm_v128_xor(a[w], c2);
+            if (variant >= 2)
+                b1[w] = b[w];
+            b[w] = c1[w];
+            idx[w] = (uint64_t)wasm_i64x2_extract_lane(a[w], 0);
+            if (heavy)
+                idx[w] = cn_heavy_div(l[w], idx[w], mask);
+        }
+    }
+    return 1;
+}
+#else
+static CN_ALWAYS_INLINE int cn_main_loop_n(cn_ctx *ctx, const uint32_t ways,
+                                           const uint32_t iterations, const uint32_t mask,
+                                           const int variant, const int heavy) {
+    uint8_t *l[CN_MAX_WAYS];
+    uint64_t a[CN_MAX_WAYS][2], b[CN_MAX_WAYS][2], c1[CN_MAX_WAYS][2];
+    uint64_t idx[CN_MAX_WAYS];
+    uint64_t tweak1_2[CN_MAX_WAYS];                             /* cn/1 */
+    uint64_t b1[CN_MAX_WAYS][2];                                /* cn/2, cn/r */
+    uint64_t division_result[CN_MAX_WAYS], sqrt_result[CN_MAX_WAYS];
+    uint32_t r[CN_MAX_WAYS][9];                                 /* cn/r */
+    const struct cn_r_program *prog = ctx->r_program;
+
+    /* a = state[0..15] XOR state[32..47]
+     * b = state[16..31] XOR state[48..63]  */
+    for (uint32_t w = 0; w < ways; w++) {
+        const uint64_t *st = ctx->lane[w].state.w;
+        l[w] = ctx->lane[w].scratchpad;
+        a[w][0] = st[0] ^ st[4];  a[w][1] = st[1] ^ st[5];
+        b[w][0] = st[2] ^ st[6];  b[w][1] = st[3] ^ st[7];
+        idx[w] = a[w][0];
+        tweak1_2[w] = ctx->lane[w].tweak1_2;
+        if (variant >= 2)
+            cn_variant2_init(&ctx->lane[w], b1[w], &division_result[w], &sqrt_result[w]);
+        if (variant == 4)
+            cn_variant4_init(&ctx->lane[w], r[w]);
+    }
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (!(i & (CN_CONTROL_INTERVAL - 1)) && cn_control_changed(&ctx->control))
+            return 0;
+
+        /* ------ Sub-step A: AES round ------ */
+        _Pragma("GCC unroll 4")
+        for (uint32_t w = 0; w < ways; w++) {
+            const uint32_t j = (uint32_t)idx[w] & mask;
+            uint64_t *sp = (uint64_t *)(l[w] + j);
+            cn_aes_single_round((uint8_t *)c1[w], (const uint8_t *)sp, (const uint8_t *)a[w]);
+            if (variant >= 2)
+                cn_variant2_shuffle(l[w], j, a[w], b[w], b1[w], c1[w], variant);
+
+            /* Write (c1 XOR b) to scratchpad */
+            sp[0] = c1[w][0] ^ b[w][0];
+            sp[1] = c1[w][1] ^ b[w][1];
+            if (variant == 1)
+                cn_variant1_1((uint8_t *)sp);
+        }
+
+        /* ------ Sub-step B: Multiply ------ */
+        _Pragma("GCC unroll 4")
+        for (uint32_t w = 0; w < ways; w++) {
+            const uint32_t j = (uint32_t)c1[w][0] & mask;
+            uint64_t *p2 = (uint64_t *)(l[w] + j);
+            uint64_t c2_0 = p2[0], c2_1 = p2[1];
+            uint64_t ar[2] = { a[w][0], a[w][1] };  /* a after cn/r's random math */
+
+            if (variant == 2)
+                c2_0 = cn_variant2_math(c2_0, c1[w][0], c1[w][1],
+                                        &division_result[w], &sqrt_result[w]);
+            if (variant == 4)
+                c2_0 = cn_variant4_math(prog, r[w], c2_0, ar, b[w][0], b1[w][0], b1[w][1]);
+
+            uint64_t hi, lo;
+            mul_128(c1[w][0], c2_0, &hi, &lo);
+
+            if (variant == 2)
+                cn_variant2_mix_product(l[w], j, &hi, &lo);
+            if (variant >= 2)
+                cn_variant2_shuffle(l[w], j, a[w], b[w], b1[w], c1[w], variant);
+
+            a[w][0] = ar[0] + hi;
+            a[w][1] = ar[1] + lo;
+
+            /* Write updated a to scratchpad */
+            p2[0] = a[w][0];
+            p2[1] = variant == 1 ? a[w][1] ^ tweak1_2[w] : a[w][1];
+
+            /* XOR a with original scratchpad value */
+            a[w][0] ^= c2_0;
+            a[w][1] ^= c2_1;
+
+            /* b ← c1 (and b1 ← b for cn/2, cn/r) */
+            if (variant >= 2) {
+                b1[w][0] = b[w][0];
+                b1[w][1] = b[w][1];
+            }
+            b[w][0] = c1[w][0];
+            b[w][1] = c1[w][1];
+
+            idx[w] = a[w][0];
+            if (heavy)
+                idx[w] = cn_heavy_div(l[w], idx[w], mask);
+        }
+    }
+    return 1;
+}
+#endif
+
+/* --- Step 5: fold the scratchpad back into state[64..191] --- */
+static CN_ALWAYS_INLINE void cn_implode(cn_ctx *ctx, struct cn_lane *lane,
+                                        const uint32_t memory, const int heavy) {
+    const uint8_t *hp_state = lane->scratchpad;
+    uint8_t *text = ctx->text;
+
+    aes256_expand_key(lane->state.b + 32, ctx->expanded_key);
+    memcpy(text, lane->state.b + 64, INIT_SIZE_BYTE);
+    /* cn-heavy folds the scratchpad in twice, mixing after every pass,
+     * then runs 16 more mixed passes without it */
+    for (int pass = 0; pass < (heavy ? 2 : 1); pass++) {
+        for (uint32_t i = 0; i < memory; i += INIT_SIZE_BYTE) {
+            for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE) {
+                xor_blocks(text + j, hp_state + i + j);
+                cn_aes_pseudo_round(text + j, ctx->expanded_key);
+            }
+            if (heavy)
+                cn_mix_and_propagate(text);
+        }
+    }
+    if (heavy) {
+        for (int r = 0; r < 16; r++) {
+            for (int j = 0; j < INIT_SIZE_BYTE; j += AES_BLOCK_SIZE)
+                cn_aes_pseudo_round(text + j, ctx->expanded_key);
+            cn_mix_and_propagate(text);
+        }
+    }
+    memcpy(lane->state.b + 64, text, INIT_SIZE_BYTE);
+}
+
+/* ===================== Native AES-NI kernel ===================== */
+/*
+ * x86-64 hosts (share verification, benchmark nodes) run the scratchpad
+ * phases with AESENC, which is exactly one SubBytes+ShiftRows+MixColumns+
+ * AddRoundKey round, and take the 64x64->128 product from mul_128()
+ * (a single MUL with the __int128 backend).  Compiled with a target
+ * attribute so the rest of the file keeps the baseline ISA;
+ * cn_select_backend() only picks it when cpuid reports AES.  Key
+ * expansion stays in software (twice per hash).
+ */
+
+#if CN_X86_AESNI
+#define CN_AESNI_FN __attribute__((target("aes,sse2")))
+
+#define AESNI_ENC8(k)                                                   \
+    do {                                                                \
+        x0 = _mm_aesenc_si128(x0, k); x1 = _mm_aesenc_si128(x1, k);     \
+        x2 = _mm_aesenc_si128(x2, k); x3 = _mm_aesenc_si128(x3, k);     \
+        x4 = _mm_aesenc_si128(x4, k); x5 = _mm_aesenc_si128(x5, k);     \
+        x6 = _mm_aesenc_si128(x6, k); x7 = _mm_aesenc_si128(x7, k);     \
+    } while (0)
+
+#define AESNI_PSEUDO_ROUND8()                                           \
+    do {                                                                \
+        AESNI_ENC8(k0); AESNI_ENC8(k1); AESNI_ENC8(k2); AESNI_ENC8(k3); \
+        AESNI_ENC8(k4); AESNI_ENC8(k5); AESNI_ENC8(k6); AESNI_ENC8(k7); \
+        AESNI_ENC8(k8); AESNI_ENC8(k9);                                 \
+    } while (0)
+
+/* cn-heavy block mixing, see cn_mix_and_propagate() */
+#define AESNI_MIX8()                                                    \
+    do {                                                                \
+        const __m128i first = x0;                                       \
+        x0 = _mm_xor_si128(x0, x1); x1 = _mm_xor_si128(x1, x2);         \
+        x2 = _mm_xor_si128(x2, x3); x3 = _mm_xor_si128(x3, x4);         \
+        x4 = _mm_xor_si128(x4, x5); x5 = _mm_xor_si128(x5, x6);         \
+        x6 = _mm_xor_si128(x6, x7); x7 = _mm_xor_si128(x7, first);      \
+    } while (0)
+
+#define AESNI_LOAD_KEYS(ek)                                             \
+    const __m128i *kp = (const __m128i *)(ek);                          \
+    __m128i k0 = _mm_loadu_si128(kp + 0), k1 = _mm_loadu_si128(kp + 1); \
+    __m128i k2 = _mm_loadu_si128(kp + 2), k3 = _mm_loadu_si128(kp + 3); \
+    __m128i k4 = _mm_loadu_si128(kp + 4), k5 = _mm_loadu_si128(kp + 5); \
+    __m128i k6 = _mm_loadu_si128(kp + 6), k7 = _mm_loadu_si128(kp + 7); \
+    __m128i k8 = _mm_loadu_si128(kp + 8), k9 = _mm_loadu_si128(kp + 9)
+
+#define AESNI_LOAD_TEXT(p)                                              \
+    const __m128i *tp = (const __m128i *)(p);                           \
+    __m128i x0 = _mm_loadu_si128(tp + 0), x1 = _mm_loadu_si128(tp + 1); \
+    __m128i x2 = _mm_loadu_si128(tp + 2), x3 = _mm_loadu_si128(tp + 3); \
+    __m128i x4 = _mm_loadu_si128(tp + 4), x5 = _mm_loadu_si128(tp + 5); \
+    __m128i x6 = _mm_loadu_si128(tp + 6), x7 = _mm_loadu_si128(tp + 7)
+
+CN_AESNI_FN
+static CN_ALWAYS_INLINE void cn_explode_aesni(cn_ctx *ctx, struct cn_lane *lane,
+                                              const uint32_t memory, const int heavy) {
+    aes256_expand_key(lane->state.b, ctx->expanded_key);
+
+    AESNI_LOAD_KEYS(ctx->expanded_key);
+    AESNI_LOAD_TEXT(lane->state.b + 64);
+
+    if (heavy) {
+        for (int r = 0; r < 16; r++) {
+            AESNI_PSEUDO_ROUND8();
+            AESNI_MIX8();
+        }
+    }
+    for (uint32_t i = 0; i < memory; i += INIT_SIZE_BYTE) {
+        __m128i *out = (__m128i *)(lane->scratchpad + i);
+        AESNI_PSEUDO_ROUND8();
+        _mm_store_si128(out + 0, x0); _mm_store_si128(out + 1, x1);
+        _mm_store_si128(out + 2, x2); _mm_store_si128(out + 3, x3);
+        _mm_store_si128(out + 4, x4); _mm_store_si128(out + 5, x5);
+        _mm_store_si128(out + 6, x6); _mm_store_si128(out + 7, x7);
+    }
+}
+
+CN_AESNI_FN
+static inline __m128i cn_variant2_shuffle_aesni(uint8_t *l, uint32_t j, __m128i a, __m128i b0,
+                                                __m128i b1, __m128i c, const int variant) {
+    __m128i *n1 = (__m128i *)(l + (j ^ 0x10));
+    __m128i *n2 = (__m128i *)(l + (j ^ 0x20));
+    __m128i *n3 = (__m128i *)(l + (j ^ 0x30));
+    const __m128i n1_old = _mm_load_si128(n1);
+    const __m128i n2_old = _mm_load_si128(n2);
+    const __m128i n3_old = _mm_load_si128(n3);
+
+    _mm_store_si128(n1, _mm_add_epi64(n3_old, b1));
+    _mm_store_si128(n3, _mm_add_epi64(n2_old, a));
+    _mm_store_si128(n2, _mm_add_epi64(n1_old, b0));
+    if (variant == 4)
+        c = _mm_xor_si128(c, _mm_xor_si128(n1_old, _mm_xor_si128(n2_old, n3_old)));
+    return c;
+}
+
+CN_AESNI_FN
+static CN_ALWAYS_INLINE int cn_main_loop_aesni_n(cn_ctx *ctx, const uint32_t ways,
+                                                 const uint32_t iterations, const uint32_t mask,
+                                                 const int variant, const int heavy) {
+    uint8_t *l[CN_MAX_WAYS];
+    uint64_t al[CN_MAX_WAYS], ah[CN_MAX_WAYS], idx[CN_MAX_WAYS];
+    __m128i bx[CN_MAX_WAYS], cx[CN_MAX_WAYS];
+    uint64_t tweak1_2[CN_MAX_WAYS];                             /* cn/1 */
+    __m128i bx1[CN_MAX_WAYS];                                   /* cn/2, cn/r */
+    uint64_t division_result[CN_MAX_WAYS], sqrt_result[CN_MAX_WAYS];
+    uint32_t r[CN_MAX_WAYS][9];                                 /* cn/r */
+    const struct cn_r_program *prog = ctx->r_program;
+
+    for (uint32_t w = 0; w < ways; w++) {
+        const uint64_t *st = ctx->lane[w].state.w;
+        l[w]  = ctx->lane[w].scratchpad;
+        al[w] = st[0] ^ st[4];
+        ah[w] = st[1] ^ st[5];
+        bx[w] = _mm_set_epi64x((long long)(st[3] ^ st[7]), (long long)(st[2] ^ st[6]));
+        idx[w] = al[w];
+        tweak1_2[w] = ctx->lane[w].tweak1_2;
+        if (variant >= 2) {
+            uint64_t b1[2];
+            cn_variant2_init(&ctx->lane[w], b1, &division_result[w], &sqrt_result[w]);
+            bx1[w] = _mm_set_epi64x((long long)b1[1], (long long)b1[0]);
+        }
+        if (variant == 4)
+            cn_variant4_init(&ctx->lane[w], r[w]);
+    }
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (!(i & (CN_CONTROL_INTERVAL - 1)) && cn_control_changed(&ctx->control))
+            return 0;
+
+        _Pragma("GCC unroll 4")
+        for (uint32_t w = 0; w < ways; w++) {
+            const uint32_t j = (uint32_t)idx[w] & mask;
+            __m128i *p1 = (__m128i *)(l[w] + j);
+            const __m128i ax = _mm_set_epi64x((long long)ah[w], (long long)al[w]);
+            cx[w] = _mm_aesenc_si128(_mm_load_si128(p1), ax);
+            if (variant >= 2)
+                cx[w] = cn_variant2_shuffle_aesni(l[w], j, ax, bx[w], bx1[w], cx[w], variant);
+            _mm_store_si128(p1, _mm_xor_si128(bx[w], cx[w]));
+            if (variant == 1)
+                cn_variant1_1((uint8_t *)p1);
+            idx[w] = (uint64_t)_mm_cvtsi128_si64(cx[w]);
+        }
+
+        _Pragma("GCC unroll 4")
+        for (uint32_t w = 0; w < ways; w++) {
+            const uint32_t j = (uint32_t)idx[w] & mask;
+            uint64_t *p2 = (uint64_t *)(l[w] + j);
+            uint64_t cl = p2[0], ch = p2[1];
+            uint64_t ar[2] = { al[w], ah[w] };      /* a after cn/r's random math */
+
+            if (variant == 2)
+                cl = cn_variant2_math(cl, idx[w],
+                                      (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(cx[w], cx[w])),
+                                      &division_result[w], &sqrt_result[w]);
+            if (variant == 4)
+                cl = cn_variant4_math(prog, r[w], cl, ar, (uint64_t)_mm_cvtsi128_si64(bx[w]),
+                                      (uint64_t)_mm_cvtsi128_si64(bx1[w]),
+                                      (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(bx1[w], bx1[w])));
+
+            uint64_t hi, lo;
+            mul_128(idx[w], cl, &hi, &lo);
+
+            if (variant == 2)
+                cn_variant2_mix_product(l[w], j, &hi, &lo);
+            if (variant >= 2)
+                cx[w] = cn_variant2_shuffle_aesni(l[w], j,
+                                                  _mm_set_epi64x((long long)ah[w], (long long)al[w]),
+                                                  bx[w], bx1[w], cx[w], variant);
+
+            al[w] = ar[0] + hi;
+            ah[w] = ar[1] + lo;
+
+            p2[0] = al[w];
+            p2[1] = variant == 1 ? ah[w] ^ tweak1_2[w] : ah[w];
+
+            al[w] ^= cl;
+            ah[w] ^= ch;
+            if (variant >= 2)
+                bx1[w] = bx[w];
+            bx[w] = cx[w];
+            idx[w] = al[w];
+            if (heavy)
+                idx[w] = cn_heavy_div(l[w], idx[w], mask);
+        }
+    }
+    return 1;
+}
+
+CN_AESNI_FN
+static CN_ALWAYS_INLINE void cn_implode_aesni(cn_ctx *ctx, struct cn_lane *lane,
+                                              const uint32_t memory, const int heavy) {
+    aes256_expand_key(lane->state.b + 32, ctx->expanded_key);
+
+    AESNI_LOAD_KEYS(ctx->expanded_key);
+    AESNI_LOAD_TEXT(lane->state.b + 64);
+
+    for (int pass = 0; pass < (heavy ? 2 : 1); pass++) {
+        for (uint32_t i = 0; i < memory; i += INIT_SIZE_BYTE) {
+            const __m128i *in = (const __m128i *)(lane->scratchpad + i);
+            x0 = _mm_xor_si128(x0, _mm_load_si128(in + 0));
+            x1 = _mm_xor_si128(x1, _mm_load_si128(in + 1));
+            x2 = _mm_xor_si128(x2, _mm_load_si128(in + 2));
+            x3 = _mm_xor_si128(x3, _mm_load_si128(in + 3));
+            x4 = _mm_xor_si128(x4, _mm_load_si128(in + 4));
+            x5 = _mm_xor_si128(x5, _mm_load_si128(in + 5));
+            x6 = _mm_xor_si128(x6, _mm_load_si128(in + 6));
+            x7 = _mm_xor_si128(x7, _mm_load_si128(in + 7));
+            AESNI_PSEUDO_ROUND8();
+            if (heavy)
+                AESNI_MIX8();
+        }
+    }
+    if (heavy) {
+        for (int r = 0; r < 16; r++) {
+            AESNI_PSEUDO_ROUND8();
+            AESNI_MIX8();
+        }
+    }
+
+    __m128i *out = (__m128i *)(lane->state.b + 64);
+    _mm_storeu_si128(out + 0, x0); _mm_storeu_si128(out + 1, x1);
+    _mm_storeu_si128(out + 2, x2); _mm_storeu_si128(out + 3, x3);
+    _mm_storeu_si128(out + 4, x4); _mm_storeu_si128(out + 5, x5);
+    _mm_storeu_si128(out + 6, x6); _mm_storeu_si128(out + 7, x7);
+}
+#endif
+
+/* ======================== Backend dispatch ======================== */
+/*
+ * One backend per (implementation, CN_ALGOS row): cn_backend_portable_<id>
+ * and, with CN_X86_AESNI, cn_backend_aesni_<id>.  Their functions
+ * (cn_explode_<id>, cn_main_loop_aesni_<id>_x2, ...) are the force-inlined
+ * kernel bodies with the row's constants plugged in.
+ */
+
+#define CN_DEFINE_BACKEND(impl, attr, id, memory, iterations, mask, variant, heavy) \
+    attr static void cn_explode##impl##_##id(cn_ctx *ctx, struct cn_lane *lane)     \
+        { cn_explode##impl(ctx, lane, memory, heavy); }                             \
+    attr static int cn_main_loop##impl##_##id##_x1(cn_ctx *ctx) {                   \
+        return cn_main_loop##impl##_n(ctx, 1, iterations, mask, variant, heavy);    \
+    }                                                                               \
+    attr static int cn_main_loop##impl##_##id##_x2(cn_ctx *ctx) {                   \
+        return cn_main_loop##impl##_n(ctx, 2, iterations, mask, variant, heavy);    \
+    }                                                                               \
+    attr static int cn_main_loop##impl##_##id##_x4(cn_ctx *ctx) {                   \
+        return cn_main_loop##impl##_n(ctx, 4, iterations, mask, variant, heavy);    \
+    }                                                                               \
+    attr static void cn_implode##impl##_##id(cn_ctx *ctx, struct cn_lane *lane)     \
+        { cn_implode##impl(ctx, lane, memory, heavy); }
+
+#define CN_DEFINE_PORTABLE(id, e, name, memory, iterations, mask, variant, heavy)   \
+    CN_DEFINE_BACKEND(, , id, memory, iterations, mask, variant, heavy)             \
+    static const struct cn_backend cn_backend_portable_##id = {                     \
+        "portable", cn_explode_##id,                                                \
+        { cn_main_loop_##id##_x1, cn_main_loop_##id##_x2,                           \
+          cn_main_loop_##id##_x4 },                                                 \
+        cn_implode_##id                                                             \
+    };
+
+CN_ALGOS(CN_DEFINE_PORTABLE)
+
+#if CN_X86_AESNI
+#define CN_DEFINE_AESNI(id, e, name, memory, iterations, mask, variant, heavy)      \
+    CN_DEFINE_BACKEND(_aesni, CN_AESNI_FN,                                          \
+                      id, memory, iterations, mask, variant, heavy)                 \
+    static const struct cn_backend cn_backend_aesni_##id = {                        \
+        "aesni", cn_explode_aesni_##id,                                             \
+        { cn_main_loop_aesni_##id##_x1, cn_main_loop_aesni_##id##_x2,               \
+          cn_main_loop_aesni_##id##_x4 },                                           \
+        cn_implode_aesni_##id                                                       \
+    };
+
+CN_ALGOS(CN_DEFINE_AESNI)
+#define CN_AESNI_BACKEND(id) &cn_backend_aesni_##id
+#else
+#define CN_AESNI_BACKEND(id) NULL
+#endif
+
+#define CN_ALGO_ENTRY(id, e, name, memory, iterations, mask, variant, heavy)        \
+    [e] = { name, memory, iterations, mask, variant, heavy,                         \
+            &cn_backend_portable_##id, CN_AESNI_BACKEND(id) },
+
+static const struct cn_algo cn_algos[CN_ALGO_COUNT] = { CN_ALGOS(CN_ALGO_ENTRY) };
+
+/** Picks the fastest implementation of `algo` this CPU can run (cpuid on x86-64). */
+static const struct cn_backend *cn_select_backend(const struct cn_algo *algo) {
+#if CN_X86_AESNI
+    if (__builtin_cpu_supports("aes"))
+        return algo->aesni;
+#endif
+    return algo->portable;
+}
+
+/** Algorithm id (enum cn_algo_id) for a stratum algo name, -1 if unknown. */
+EMSCRIPTEN_KEEPALIVE
+int32_t cn_algo_by_name(const char *name) {
+    for (int32_t a = 0; a < CN_ALGO_COUNT; a++)
+        if (!strcmp(cn_algos[a].name, name))
+            return a;
+    return -1;
+}
+
+/** Name of the algorithm a context hashes ("cn/0", "cn-lite/0", ...). */
+EMSCRIPTEN_KEEPALIVE
+const char *cn_ctx_algo_name(const cn_ctx *ctx) {
+    return ctx->algo->name;
+}
+
+/** Name of the backend a context hashes with ("portable", "aesni"). */
+EMSCRIPTEN_KEEPALIVE
+const char *cn_ctx_backend_name(const cn_ctx *ctx) {
+    return ctx->backend->name;
+}
+
+/** How the context's scratchpads are backed: "hugetlb", "thp" or "aligned". */
+EMSCRIPTEN_KEEPALIVE
+const char *cn_ctx_memory_kind(const cn_ctx *ctx) {
+    return cn_mem_kind_names[ctx->memory_kind];
+}
+
+/** Number of nonces the context can hash per call (1, 2 or 4). */
+EMSCRIPTEN_KEEPALIVE
+uint32_t cn_ctx_ways(const cn_ctx *ctx) {
+    return ctx->ways;
+}
+
+/* --- Steps 6-7: Keccak-f and final hash selection --- */
+static void cn_final(struct cn_lane *lane, uint8_t *output) {
+    uint8_t *state = lane->state.b;
+
+    keccakf(lane->state.w);
+
+    switch (state[0] & 3) {
+        case 0:  blake256_hash(output, state, 200);                 break;
+        case 1:  groestl(state, (unsigned long long)200 * 8, output); break;
+        case 2:  jh_hash(256, state, (unsigned long long)200 * 8, output); break;
+        default: skein_hash(256, state, (size_t)(200 * 8), output); break;
+    }
+}
+
+/**
+ * Steps 3-7 for the first 1 << log2_ways lanes, whose state already holds
+ * Keccak-1600 of their input (and, for variant 1, whose tweak1_2 is set);
+ * writes the 32-byte hashes back to back at `output`.  cn_hash_lanes()
+ * absorbs inputs stored back to back at `input` (stride input_len) first.
+ * Variant 1 has no hash for inputs shorter than 43 bytes: those come out
+ * as zeros, as do hashes the control word abandoned (cn_hash_absorbed()
+ * returns 0 for those and leaves `output` alone).
+ */
+static int cn_hash_absorbed(cn_ctx *ctx, uint32_t log2_ways, uint8_t *output) {
+    const uint32_t ways = 1u << log2_ways;
+
+    for (uint32_t w = 0; w < ways; w++)
+        ctx->backend->explode(ctx, &ctx->lane[w]);
+    if (!ctx->backend->main_loop[log2_ways](ctx))
+        return 0;
+    for (uint32_t w = 0; w < ways; w++) {
+        ctx->backend->implode(ctx, &ctx->lane[w]);
+        cn_final(&ctx->lane[w], output + (size_t)w * 32);
+    }
+    return 1;
+}
+
+static void cn_hash_lanes(cn_ctx *ctx, uint32_t log2_ways,
+                          const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    const int variant1 = ctx->algo->variant == 1;
+
+    if (variant1 && input_len < CN_VARIANT1_OFFSET + 8) {
+        memset(output, 0, (size_t)32 << log2_ways);
+        return;
+    }
+    for (uint32_t w = 0; w < (1u << log2_ways); w++) {
+        const uint8_t *in = input + (size_t)w * input_len;
+        keccak1600(in, input_len, ctx->lane[w].state.b);
+        if (variant1)
+            ctx->lane[w].tweak1_2 = cn_variant1_tweak(&ctx->lane[w], in + CN_VARIANT1_OFFSET);
+    }
+    if (!cn_hash_absorbed(ctx, log2_ways, output))
+        memset(output, 0, (size_t)32 << log2_ways);
+}
+
+/**
+ * CryptoNight hash of the context's algorithm, using a caller-owned context.
+ *
+ * Algorithm (portable path from Monero's slow-hash.c with variant=0):
+ *  1. Keccak-1600(input) → 200-byte state
+ *  2. AES-256 key expansion using state[0..31]
+ *  3. Initialize the scratchpad (10-round AES per block; cn/0: 2 MB)
+ *  4. Main loop (cn/0: 524288 iterations) × 2 sub-steps
+ *     4a. AES single round + XOR + write
+ *     4b. 64-bit multiply + accumulate + XOR + write
+ *  5. Finalize: XOR scratchpad back + AES (key from state[32..63])
+ *  6. Keccak-f permutation on state
+ *  7. Select final hash: Blake-256 / Groestl-256 / JH-256 / Skein-256
+ * Variant 1 tweaks step 4's writes, variant 2 adds the neighbour shuffle,
+ * division and square root to it; cn-heavy adds block mixing to steps 3
+ * and 5 and a division to step 4.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_ctx_hash(cn_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_lanes(ctx, 0, input, input_len, output);
+}
+
+/**
+ * Two / four hashes with interleaved main loops.  `input` holds the
+ * blobs back to back (stride input_len), `output` receives 32 bytes per
+ * blob.  A context created with fewer ways hashes them one at a time.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_hash_x2(cn_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    if (ctx->ways >= 2) {
+        cn_hash_lanes(ctx, 1, input, input_len, output);
+        return;
+    }
+    for (uint32_t w = 0; w < 2; w++)
+        cn_hash_lanes(ctx, 0, input + (size_t)w * input_len, input_len, output + w * 32);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_hash_x4(cn_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    if (ctx->ways >= 4) {
+        cn_hash_lanes(ctx, 2, input, input_len, output);
+        return;
+    }
+    for (uint32_t w = 0; w < 4; w += 2)
+        cn_hash_x2(ctx, input + (size_t)w * input_len, input_len, output + w * 32);
+}
+
+/**
+ * Contexts shared by the context-less entry points below, one per
+ * algorithm.  Created on first use and kept for the lifetime of the thread
+ * (one per WASM instance).
+ */
+static _Thread_local cn_ctx *cn_default_ctx[CN_ALGO_COUNT];
+
+static cn_ctx *cn_get_default_ctx(uint32_t algo) {
+    if (!cn_default_ctx[algo])
+        cn_default_ctx[algo] = cn_ctx_create_algo(algo, 1);
+    return cn_default_ctx[algo];
+}
+
+static void cn_hash_algo(uint32_t algo, const uint8_t *input, uint32_t input_len,
+                         uint8_t *output) {
+    cn_ctx *ctx = cn_get_default_ctx(algo);
+    if (!ctx) return;
+    cn_ctx_hash(ctx, input, input_len, output);
+}
+
+/**
+ * One-shot hash per family member: cn_hash() is cn/0, cn_v1_hash() cn/1,
+ * cn_v2_hash() cn/2, cn_lite_hash() / cn_lite_v1_hash() cn-lite/0 and /1,
+ * cn_heavy_hash() cn-heavy/0, cn_pico_hash() cn-pico.  Thin wrappers over
+ * cn_ctx_hash() with the per-thread default context of that algorithm.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_algo(CN_ALGO_CN0, input, input_len, output);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_v1_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_algo(CN_ALGO_CN1, input, input_len, output);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_v2_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_algo(CN_ALGO_CN2, input, input_len, output);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_lite_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_algo(CN_ALGO_LITE0, input, input_len, output);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_lite_v1_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_algo(CN_ALGO_LITE1, input, input_len, output);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_heavy_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_algo(CN_ALGO_HEAVY0, input, input_len, output);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void cn_pico_hash(const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    cn_hash_algo(CN_ALGO_PICO0, input, input_len, output);
+}
+
+/**
+ * Monero's cn_slow_hash() interface: variant 0, 1, 2 or 4 is cn/0, cn/1,
+ * cn/2 or cn/r at block `height`.  With `prehashed` set, `data` is the
+ * 200-byte Keccak state rather than the input (variant 1 still reads its
+ * tweak from data + 35, as Monero does).  Other variants (3 was never
+ * deployed) and unusable lengths hash to zeros.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int prehashed,
+                  uint64_t height) {
+    static const int32_t algos[] = { CN_ALGO_CN0, CN_ALGO_CN1, CN_ALGO_CN2, -1, CN_ALGO_R };
+    uint8_t *out = (uint8_t *)hash;
+    cn_ctx *ctx;
+
+    memset(out, 0, 32);
+    if (variant < 0 || variant > 4 || algos[variant] < 0 || length > UINT32_MAX) return;
+    if (!(ctx = cn_get_default_ctx((uint32_t)algos[variant]))) return;
+    if (variant == 4)
+        cn_ctx_set_height(ctx, height);
+
+    if (!prehashed) {
+        cn_ctx_hash(ctx, (const uint8_t *)data, (uint32_t)length, out);
+        return;
+    }
+    if (length != sizeof(ctx->lane[0].state.b)) return;
+    memcpy(ctx->lane[0].state.b, data, length);
+    if (variant == 1)
+        ctx->lane[0].tweak1_2 = cn_variant1_tweak(&ctx->lane[0],
+                                                  (const uint8_t *)data + CN_VARIANT1_OFFSET);
+    cn_hash_absorbed(ctx, 0, out);
+}
+
+/* ========================= Share targets ========================= */
+/*
+ * A hash is a 256-bit little-endian number and meets difficulty D when
+ * hash * D < 2^256.  Pool difficulties fit in 64 bits, so only the top
+ * 64 bits (hash bytes 24..31) matter: the share is good when that word is
+ * below a 64-bit threshold.  Every target form is reduced to that one
+ * threshold up front so each hash costs a single compare.
+ * stratum_proxy.py mirrors these rules to validate submitted results.
+ */
+
+/**
+ * Stratum "target" bytes (hex-decoded, as sent by the pool) → threshold.
+ *   4 bytes: compact form, LE uint32 t; threshold = (2^64-1) / ((2^32-1) / t)
+ *   8 bytes: LE uint64 threshold as is
+ * Returns 0 (no hash passes) for other lengths or a zero target.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint64_t cn_target_from_pool(const uint8_t *target, uint32_t target_len) {
+    if (target_len == 4) {
+        uint32_t t32 = (uint32_t)target[0] | ((uint32_t)target[1] << 8) |
+                       ((uint32_t)target[2] << 16) | ((uint32_t)target[3] << 24);
+        if (t32 == 0) return 0;
+        return 0xFFFFFFFFFFFFFFFFULL / (0xFFFFFFFFULL / t32);
+    }
+    if (target_len == 8) {
+        uint64_t t64 = 0;
+        for (int i = 7; i >= 0; i--)
+            t64 = (t64 << 8) | target[i];
+        return t64;
+    }
+    return 0;
+}
+
+/** Difficulty → threshold; difficulty 0 or 1 accepts every hash. */
+EMSCRIPTEN_KEEPALIVE
+uint64_t cn_target_from_difficulty(uint64_t difficulty) {
+    if (difficulty <= 1) return 0xFFFFFFFFFFFFFFFFULL;
+    return 0xFFFFFFFFFFFFFFFFULL / difficulty;
+}
+
+/** A hash meets the share target when its last 8 bytes (LE) are below it. */
+static inline int cn_hash_meets_target(const uint8_t *hash, uint64_t target) {
+    uint64_t hash_val;
+    memcpy(&hash_val, hash + 24, 8);
+    return hash_val < target;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int cn_check_hash(const uint8_t *hash, uint64_t target64) {
+    return cn_hash_meets_target(hash, target64);
+}
+
+/* ========================== Statistics ========================== */
+/*
+ * Scans can count their work into a cn_stats block, so whoever watches
+ * the hashing (the pool's controller, the page) samples it at its own
+ * rate instead of being sent it after every batch.  Counters are only
+ * added to atomically and read without locks.  In a browser worker the
+ * block is a slot in the page's SharedArrayBuffer, like the control word.
+ */
+#ifdef __EMSCRIPTEN__
+/* Wall clock in ms, comparable across the page and its workers */
+EM_JS(double, cn_clock_ms, (void), {
+    return performance.timeOrigin + performance.now();
+});
+
+/* Adds to slot `slot` of Module.stats (a BigInt64Array of CN_STATS_FIELDS
+ * words per slot) */
+EM_JS(void, cn_stats_host_add, (uint32_t slot, uint32_t hashes, uint32_t shares,
+                                double busy_ns, double now_ns), {
+    var stats = Module['stats'];
+    if (!stats) return;
+    var i = slot * 4;
+    Atomics.add(stats, i, BigInt(hashes));
+    Atomics.add(stats, i + 1, BigInt(shares));
+    Atomics.add(stats, i + 2, BigInt(Math.round(busy_ns)));
+    Atomics.store(stats, i + 3, BigInt(Math.round(now_ns)));
+});
+#endif
+
+static uint64_t cn_clock_ns(void) {
+#ifdef __EMSCRIPTEN__
+    return (uint64_t)(cn_clock_ms() * 1e6);
+#else
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline uint64_t cn_stats_load(const uint64_t *counter) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+#else
+    return *(const volatile uint64_t *)counter;
+#endif
+}
+
+static inline void cn_stats_add64(uint64_t *counter, uint64_t n) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+#else
+    *(volatile uint64_t *)counter += n;     /* no pool without GCC builtins */
+#endif
+}
+
+/** Clock at the start of a scan, 0 when nothing is counted. */
+static inline uint64_t cn_stats_begin(const struct cn_stats_sink *sink) {
+    return sink->stats || sink->host ? cn_clock_ns() : 0;
+}
+
+/** Counts a scan that began at `start` (cn_stats_begin()). */
+static void cn_stats_end(const struct cn_stats_sink *sink, uint64_t start,
+                         uint32_t hashes, uint32_t shares) {
+    if (!sink->stats && !sink->host) return;
+    const uint64_t now = cn_clock_ns();
+#ifdef __EMSCRIPTEN__
+    if (sink->host) {
+        cn_stats_host_add(sink->host - 1, hashes, shares, (double)(now - start), (double)now);
+        return;
+    }
+#endif
+    cn_stats_add64(&sink->stats->hashes, hashes);
+    cn_stats_add64(&sink->stats->shares, shares);
+    cn_stats_add64(&sink->stats->busy_ns, now - start);
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(&sink->stats->last_ns, now, __ATOMIC_RELAXED);
+#else
+    sink->stats->last_ns = now;
+#endif
+}
+
+static void cn_stats_arm(struct cn_stats_sink *sink, cn_stats *stats, int32_t host_slot) {
+    sink->stats = host_slot >= 0 ? NULL : stats;
+#ifdef __EMSCRIPTEN__
+    sink->host = host_slot >= 0 ? (uint32_t)host_slot + 1 : 0;
+#else
+    sink->host = 0;                         /* no page to count into */
+#endif
+}
+
+/* ======================== WASM API exports ======================== */
+
+/** cn/0 scratchpad size (see cn_ctx_create_algo() for the others). */
+EMSCRIPTEN_KEEPALIVE
+uint32_t get_memory_size(void) {
+    return CN_MEMORY;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int try_hash(const uint8_t *blob, uint32_t blob_len, uint32_t nonce,
+             uint64_t target, uint8_t *out_hash)
+{
+    uint8_t input[CN_MAX_BLOB];
+    if (blob_len > CN_MAX_BLOB) return 0;
+    memcpy(input, blob, blob_len);
+    cn_set_nonce(input, blob_len, nonce);
+    cn_hash(input, blob_len, out_hash);
+    return cn_hash_meets_target(out_hash, target);
+}
+
+/**
+ * Job setup: keeps a copy of the hashing blob in the context and does the
+ * nonce-independent part of the first Keccak round once (see
+ * cn_job_prepare()).  Returns 0 for blobs shorter than 43 bytes (no room
+ * for the nonce) or longer than CN_MAX_BLOB.
+ */
+EMSCRIPTEN_KEEPALIVE
+int cn_ctx_set_job(cn_ctx *ctx, const uint8_t *blob, uint32_t blob_len) {
+    if (blob_len < CN_NONCE_OFFSET + 4 || blob_len > CN_MAX_BLOB) {
+        ctx->job.blob_len = 0;
+        return 0;
+    }
+    cn_job_prepare(&ctx->job, blob, blob_len);
+    return 1;
+}
+
+/**
+ * Batch nonce search over the context's job: hashes `count` nonces
+ * starting at nonce_start (mod 2^32) with the context's way-count and
+ * reports only the hashes that meet `target`.  Each result is
+ * CN_SCAN_RESULT_SIZE bytes at out_results: the nonce (4 bytes LE), then
+ * the 32-byte hash.  Stops early once CN_SCAN_MAX_RESULTS are found; the
+ * caller resumes after the last reported nonce.  Also stops, abandoning
+ * the hashes in flight, once the control word has moved on
+ * (cn_ctx_set_control()).  cn_ctx_scanned() tells how far it got.
+ * Returns the result count.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t cn_ctx_scan(cn_ctx *ctx, uint32_t nonce_start, uint32_t count, uint64_t target,
+                     uint8_t *out_results)
+{
+    uint8_t  hash[CN_MAX_WAYS * 32];
+    uint32_t found = 0;
+
+    ctx->scanned = 0;
+    if (!ctx->job.blob_len) return 0;
+
+    const uint64_t start = cn_stats_begin(&ctx->stats);
+    for (uint32_t done = 0; done < count && found < CN_SCAN_MAX_RESULTS; ) {
+        if (cn_control_changed(&ctx->control)) break;
+        uint32_t left = count - done;
+        uint32_t log2_ways = (ctx->ways >= 4 && left >= 4) ? 2 :
+                             (ctx->ways >= 2 && left >= 2) ? 1 : 0;
+        uint32_t ways = 1u << log2_ways;
+
+        for (uint32_t w = 0; w < ways; w++) {
+            struct cn_lane *lane = &ctx->lane[w];
+            cn_job_absorb(&ctx->job, nonce_start + done + w, lane->state.b);
+            if (ctx->algo->variant == 1) {
+                uint8_t head[CN_NONCE_OFFSET + 4];  /* input bytes 0..42 */
+                memcpy(head, ctx->job.blob, sizeof(head));
+                cn_set_nonce(head, sizeof(head), nonce_start + done + w);
+                lane->tweak1_2 = cn_variant1_tweak(lane, head + CN_VARIANT1_OFFSET);
+            }
+        }
+        if (!cn_hash_absorbed(ctx, log2_ways, hash))
+            break;                              /* abandoned: not scanned */
+
+        for (uint32_t w = 0; w < ways; w++) {
+            if (!cn_hash_meets_target(hash + w * 32, target))
+                continue;
+            uint32_t nonce = nonce_start + done + w;
+            uint8_t *rec = out_results + found * CN_SCAN_RESULT_SIZE;
+            rec[0] = (uint8_t)(nonce & 0xFF);
+            rec[1] = (uint8_t)((nonce >> 8)  & 0xFF);
+            rec[2] = (uint8_t)((nonce >> 16) & 0xFF);
+            rec[3] = (uint8_t)((nonce >> 24) & 0xFF);
+            memcpy(rec + 4, hash + w * 32, 32);
+            if (++found == CN_SCAN_MAX_RESULTS) {
+                ways = w + 1;                   /* the rest is hashed again */
+                break;
+            }
+        }
+        done += ways;
+        ctx->scanned = done;
+    }
+    cn_stats_end(&ctx->stats, start, ctx->scanned, found);
+    return found;
+}
+
+/**
+ * Arms the context with a control word: once *word no longer equals
+ * `expect`, the main loop abandons its hashes within CN_CONTROL_INTERVAL
+ * iterations and cn_ctx_scan() returns.  The owner keeps a job generation
+ * there, bumped for every job, and or's in CN_CONTROL_STOP to pause.
+ * cn_ctx_hash() and friends on an armed context hash to zeros once the
+ * word moves on.  NULL disarms.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_ctx_set_control(cn_ctx *ctx, const uint32_t *word, uint32_t expect) {
+    cn_control_arm(&ctx->control, word, expect, 0);
+}
+
+/**
+ * cn_ctx_set_control() with the page's word: Module.control, an Int32Array
+ * over a SharedArrayBuffer the adapter shares with the worker, read with
+ * Atomics.load().  Emscripten builds only; elsewhere it disarms.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_ctx_set_host_control(cn_ctx *ctx, uint32_t expect) {
+    cn_control_arm(&ctx->control, NULL, expect, 1);
+}
+
+/**
+ * Makes the context's scans count into `stats` (NULL: stop counting):
+ * nonces covered (see cn_ctx_scanned()), shares reported, time spent and
+ * when the last scan ended.  The counters are added to atomically, so
+ * several contexts can share a block and other threads can read it.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_ctx_set_stats(cn_ctx *ctx, cn_stats *stats) {
+    cn_stats_arm(&ctx->stats, stats, -1);
+}
+
+/**
+ * cn_ctx_set_stats() into slot `slot` of the page's Module.stats, a
+ * BigInt64Array of CN_STATS_FIELDS words per slot over a
+ * SharedArrayBuffer, updated with Atomics.  Emscripten builds only;
+ * elsewhere scans stop counting.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_ctx_set_host_stats(cn_ctx *ctx, uint32_t slot) {
+    cn_stats_arm(&ctx->stats, NULL, (int32_t)(slot & 0x7FFFFFFF));
+}
+
+/**
+ * Nonces the last cn_ctx_scan() covered, i.e. where the next one resumes:
+ * all of `count`, or up to the last record when the results filled up, or
+ * up to where the control word stopped it.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t cn_ctx_scanned(const cn_ctx *ctx) {
+    return ctx->scanned;
+}
+
+/**
+ * cn_ctx_scan() for `blob`: sets it as the context's job first unless it
+ * already is (nonce bytes aside), so repeated calls per job reuse the
+ * precomputed Keccak prefix.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t scan_nonces(cn_ctx *ctx, const uint8_t *blob, uint32_t blob_len,
+                     uint32_t nonce_start, uint32_t count, uint64_t target,
+                     uint8_t *out_results)
+{
+    const struct cn_job *job = &ctx->job;
+    if (blob_len < CN_NONCE_OFFSET + 4 || blob_len > CN_MAX_BLOB) return 0;
+    if (job->blob_len != blob_len ||
+        memcmp(job->blob, blob, CN_NONCE_OFFSET) ||
+        memcmp(job->blob + CN_NONCE_OFFSET + 4, blob + CN_NONCE_OFFSET + 4,
+               blob_len - CN_NONCE_OFFSET - 4))
+        cn_ctx_set_job(ctx, blob, blob_len);
+    return cn_ctx_scan(ctx, nonce_start, count, target, out_results);
+}
+
+/* ========================== Thread pool ========================== */
+/*
+ * cn_pool hashes one job on `threads` threads at once.  In the browser this
+ * is the -pthread build: the threads are Web Workers sharing this module's
+ * memory, so one controller drives every core through a single heap
+ * instead of a module instance and heap per worker.
+ *
+ * Threads take nonces in batches from a shared counter and look for a new
+ * job, pause or shutdown between batches.  A batch in flight is cut short
+ * through the pool's control word (see cn_ctx_set_control()), which holds
+ * the job id and gets CN_CONTROL_STOP on pause, so a new job waits a
+ * fraction of a hash, not one batch.  Each thread sizes its batches from
+ * its measured hash rate to last one time slice (250 ms by default, see
+ * cn_pool_set_slice()) so per-batch overhead stays small.  Below a 100%
+ * duty cycle each thread then sleeps for the share of wall time it should
+ * not hash (see cn_pool_set_duty()).  Shares go into a queue the
+ * controller drains with cn_pool_results(); each record is the job id
+ * (4 bytes LE) followed by a scan record.  Every thread creates its own
+ * context, on its own thread, because cn/r code lives in the creating
+ * thread's function table.
+ */
+#if CN_THREADS
+
+#define CN_POOL_MAX_THREADS  64
+#define CN_POOL_BATCH        16             /* nonces per batch without time slices */
+#define CN_POOL_SLICE_MS     250            /* default time slice */
+#define CN_POOL_QUEUE        64             /* queued shares */
+#define CN_POOL_RESULT_SIZE  (4 + CN_SCAN_RESULT_SIZE)
+#define CN_POOL_MAX_BATCH    4096
+#define CN_POOL_MIN_SLEEP_NS 25000000ull    /* shortest sleep the governor aims for */
+
+typedef struct cn_pool cn_pool;
+
+/** A job as the pool threads see it; id 0 means none yet. */
+struct cn_pool_job {
+    uint32_t id;
+    uint32_t algo;
+    uint64_t height;
+    uint64_t target;
+    uint32_t blob_len;
+    uint8_t  blob[CN_MAX_BLOB];
+};
+
+struct cn_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;                   /* new job, pause or quit */
+    struct cn_pool_job job;
+    uint32_t next_id;
+    uint32_t next_nonce;                    /* first nonce of the next batch */
+    uint32_t ways, batch;
+    uint64_t slice_ns;                      /* batch duration, 0: fixed `batch` */
+    uint32_t duty;                          /* per mille of wall time hashing */
+    uint32_t paused, quit;
+    uint32_t control;                       /* job id, | CN_CONTROL_STOP: paused */
+    cn_stats stats;                         /* all threads' scans, see cn_pool_stats() */
+    uint32_t queued, dropped;               /* shares in / lost from queue */
+    uint8_t  queue[CN_POOL_QUEUE * CN_POOL_RESULT_SIZE];
+    uint32_t threads;
+    pthread_t thread[CN_POOL_MAX_THREADS];
+};
+
+/* Queues `count` scan records for job `id` unless the job has changed
+ * since; lock held */
+static void cn_pool_queue(cn_pool *pool, uint32_t id, const uint8_t *results, uint32_t count) {
+    if (id != pool->job.id) return;
+    for (uint32_t i = 0; i < count; i++) {
+        if (pool->queued == CN_POOL_QUEUE) {
+            pool->dropped += count - i;
+            return;
+        }
+        uint8_t *rec = pool->queue + (size_t)pool->queued++ * CN_POOL_RESULT_SIZE;
+        rec[0] = (uint8_t)(id & 0xFF);
+        rec[1] = (uint8_t)((id >> 8)  & 0xFF);
+        rec[2] = (uint8_t)((id >> 16) & 0xFF);
+        rec[3] = (uint8_t)((id >> 24) & 0xFF);
+        memcpy(rec + 4, results + (size_t)i * CN_SCAN_RESULT_SIZE, CN_SCAN_RESULT_SIZE);
+    }
+}
+
+static uint64_t cn_pool_now_ns(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Duty-cycle governor, run by each thread after a batch that took `busy`
+ * ns; lock held.  The sleep owed for it (busy × (1 - duty) / duty) is
+ * added to `owed` and slept off on the pool's condition variable, so a
+ * new job, pause or shutdown cuts it short.  The time actually slept is
+ * subtracted, so oversleeping (timer granularity) is repaid by shorter
+ * sleeps later and an interrupted sleep is finished after the next batch.
+ */
+static void cn_pool_govern(cn_pool *pool, uint32_t job_id, uint64_t busy, int64_t *owed) {
+    const uint32_t duty = pool->duty;
+    if (duty >= 1000) {
+        *owed = 0;
+        return;
+    }
+
+    *owed += (int64_t)(busy * (1000 - duty) / duty);
+    if (*owed > 0) {
+        const uint64_t start = cn_pool_now_ns(), deadline = start + (uint64_t)*owed;
+        const struct timespec until = { (time_t)(deadline / 1000000000u),
+                                        (long)(deadline % 1000000000u) };
+        uint64_t now = start;
+        while (!pool->quit && !pool->paused && pool->job.id == job_id && now < deadline) {
+            pthread_cond_timedwait(&pool->wake, &pool->lock, &until);
+            now = cn_pool_now_ns();
+        }
+        *owed -= (int64_t)(now - start);
+    }
+    if (*owed < -(int64_t)busy) *owed = -(int64_t)busy;     /* no catching up in bursts */
+}
+
+/*
+ * Nonces in a thread's next batch at ns_per_hash (0: not measured yet,
+ * one nonce per way); lock held.  Aims at one time slice, or at the fixed
+ * batch with slices off.  Below a 100% duty cycle the batch is lengthened,
+ * to at most twice that, until the sleep after it is at least
+ * CN_POOL_MIN_SLEEP_NS, well above timer granularity.  Whole multiples
+ * of the way-count.
+ */
+static uint32_t cn_pool_batch(const cn_pool *pool, uint64_t ns_per_hash) {
+    const uint32_t ways = pool->ways, duty = pool->duty;
+    if (!pool->slice_ns && !ns_per_hash) return pool->batch;
+    if (!ns_per_hash) return ways;
+
+    const uint64_t target = pool->slice_ns ? pool->slice_ns : pool->batch * ns_per_hash;
+    uint64_t busy = target;
+    if (duty < 1000) {
+        const uint64_t min_busy = CN_POOL_MIN_SLEEP_NS * duty / (1000 - duty);
+        if (min_busy > busy) busy = min_busy < 2 * target ? min_busy : 2 * target;
+    }
+    uint64_t n = (busy + ns_per_hash * ways - 1) / (ns_per_hash * ways) * ways;
+    if (n < ways) n = ways;
+    if (n > CN_POOL_MAX_BATCH) n = CN_POOL_MAX_BATCH;
+    return (uint32_t)n;
+}
+
+static void *cn_pool_thread(void *arg) {
+    cn_pool *pool = (cn_pool *)arg;
+    struct cn_pool_job job = { 0 };
+    uint8_t results[CN_SCAN_MAX_RESULTS * CN_SCAN_RESULT_SIZE];
+    cn_ctx *ctx = NULL;
+    int usable = 0;                         /* ctx is set up for `job` */
+    uint64_t ns_per_hash = 0;               /* measured on ctx, smoothed */
+    int64_t owed = 0;                       /* sleep owed, ns */
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit &&
+               (pool->paused || !pool->job.id || (!usable && job.id == pool->job.id)))
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->quit) break;
+
+        if (job.id != pool->job.id) {
+            job = pool->job;
+            pthread_mutex_unlock(&pool->lock);
+            if (ctx && ctx->algo != &cn_algos[job.algo]) {
+                cn_ctx_destroy(ctx);
+                ctx = NULL;
+                ns_per_hash = 0;
+            }
+            if (!ctx)
+                ctx = cn_ctx_create_algo(job.algo, pool->ways);
+            usable = ctx && cn_ctx_set_job(ctx, job.blob, job.blob_len);
+            if (usable) {
+                cn_ctx_set_height(ctx, job.height);
+                cn_ctx_set_control(ctx, &pool->control, job.id);
+                cn_ctx_set_stats(ctx, &pool->stats);
+            }
+            pthread_mutex_lock(&pool->lock);
+            continue;
+        }
+
+        const uint32_t batch = cn_pool_batch(pool, ns_per_hash);
+        const uint32_t nonce = pool->next_nonce;
+        pool->next_nonce += batch;
+        pthread_mutex_unlock(&pool->lock);
+
+        const uint64_t start = cn_pool_now_ns();
+        uint32_t done = 0;
+        while (done < batch) {
+            const uint32_t found = cn_ctx_scan(ctx, nonce + done, batch - done,
+                                               job.target, results);
+            if (found) {
+                pthread_mutex_lock(&pool->lock);
+                cn_pool_queue(pool, job.id, results, found);
+                pthread_mutex_unlock(&pool->lock);
+            }
+            done += cn_ctx_scanned(ctx);
+            if (found < CN_SCAN_MAX_RESULTS) break;     /* done, or preempted */
+        }
+
+        const uint64_t busy = cn_pool_now_ns() - start;
+        if (done)
+            ns_per_hash = ns_per_hash ? (ns_per_hash + busy / done) / 2 : busy / done + 1;
+
+        pthread_mutex_lock(&pool->lock);
+        cn_pool_govern(pool, job.id, busy, &owed);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    cn_ctx_destroy(ctx);
+    return NULL;
+}
+
+/**
+ * Pool of `threads` hashing threads (1..CN_POOL_MAX_THREADS), each
+ * scanning with a `ways`-way context in batches of CN_POOL_SLICE_MS, or of
+ * `batch` nonces (0: CN_POOL_BATCH) after cn_pool_set_slice(pool, 0).
+ * Threads idle until cn_pool_set_job().  Returns NULL
+ * for a bad way-count or when no thread could be started.  Under -pthread
+ * the threads start once the browser has spun up their workers, which
+ * needs the calling thread to return to its event loop.
+ */
+EMSCRIPTEN_KEEPALIVE
+cn_pool *cn_pool_create(uint32_t threads, uint32_t ways, uint32_t batch) {
+    if (ways != 1 && ways != 2 && ways != 4) return NULL;
+    if (threads < 1) threads = 1;
+    if (threads > CN_POOL_MAX_THREADS) threads = CN_POOL_MAX_THREADS;
+
+    cn_pool *pool = (cn_pool *)calloc(1, sizeof(cn_pool));
+    if (!pool) return NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pool->ways = ways;
+    pool->batch = batch ? batch : CN_POOL_BATCH;
+    pool->slice_ns = (uint64_t)CN_POOL_SLICE_MS * 1000000u;
+    pool->duty = 1000;
+
+    for (uint32_t t = 0; t < threads; t++)
+        if (!pthread_create(&pool->thread[pool->threads], NULL, cn_pool_thread, pool))
+            pool->threads++;
+    if (!pool->threads) {
+        pthread_cond_destroy(&pool->wake);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/**
+ * Switches every thread to a new job: `blob` hashed with `algo` (enum
+ * cn_algo_id) at `height` (cn/r), shares below `target` (see
+ * cn_target_from_difficulty()), nonces counting up from nonce_start.
+ * Unpauses the pool and drops queued shares of earlier jobs.  Threads
+ * abandon the hashes in flight within CN_CONTROL_INTERVAL main-loop
+ * iterations and pick the job up.  Returns the job id that tags its
+ * shares, 0 for an unknown algorithm or unusable blob length.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t cn_pool_set_job(cn_pool *pool, uint32_t algo, const uint8_t *blob, uint32_t blob_len,
+                         uint64_t target, uint64_t height, uint32_t nonce_start) {
+    if (algo >= CN_ALGO_COUNT) return 0;
+    if (blob_len < CN_NONCE_OFFSET + 4 || blob_len > CN_MAX_BLOB) return 0;
+
+    pthread_mutex_lock(&pool->lock);
+    if (!++pool->next_id) pool->next_id = 1;
+    pool->job.id = pool->next_id;
+    pool->job.algo = algo;
+    pool->job.height = height;
+    pool->job.target = target;
+    pool->job.blob_len = blob_len;
+    memcpy(pool->job.blob, blob, blob_len);
+    pool->next_nonce = nonce_start;
+    pool->queued = 0;
+    pool->paused = 0;
+    cn_control_store(&pool->control, pool->job.id);
+    pthread_cond_broadcast(&pool->wake);
+    const uint32_t id = pool->job.id;
+    pthread_mutex_unlock(&pool->lock);
+    return id;
+}
+
+/** Stops the threads, mid-hash, until the next job. */
+EMSCRIPTEN_KEEPALIVE
+void cn_pool_pause(cn_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->paused = 1;
+    cn_control_store(&pool->control, pool->job.id | CN_CONTROL_STOP);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Moves up to `max` queued shares, oldest first, to `out`
+ * (CN_POOL_RESULT_SIZE bytes each) and returns how many.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t cn_pool_results(cn_pool *pool, uint8_t *out, uint32_t max) {
+    pthread_mutex_lock(&pool->lock);
+    const uint32_t n = pool->queued < max ? pool->queued : max;
+    memcpy(out, pool->queue, (size_t)n * CN_POOL_RESULT_SIZE);
+    memmove(pool->queue, pool->queue + (size_t)n * CN_POOL_RESULT_SIZE,
+            (size_t)(pool->queued - n) * CN_POOL_RESULT_SIZE);
+    pool->queued -= n;
+    pthread_mutex_unlock(&pool->lock);
+    return n;
+}
+
+/**
+ * Time each batch should take, in ms: how often a thread takes the lock
+ * for nonces and runs the governor.  New jobs don't wait for it (see
+ * cn_pool_set_job()).  0 goes back to fixed-length batches.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_pool_set_slice(cn_pool *pool, uint32_t ms) {
+    pthread_mutex_lock(&pool->lock);
+    pool->slice_ns = (uint64_t)ms * 1000000u;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Fraction of wall time each thread spends hashing, in per mille (1 to
+ * 1000, the default); the rest it sleeps after every batch.  Batches grow
+ * at low duty cycles so that sleeps stay long enough to time accurately.
+ */
+EMSCRIPTEN_KEEPALIVE
+void cn_pool_set_duty(cn_pool *pool, uint32_t permille) {
+    pthread_mutex_lock(&pool->lock);
+    pool->duty = permille < 1 ? 1 : permille > 1000 ? 1000 : permille;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Nanoseconds all threads together have spent hashing: over an interval,
+ * its increase / (interval × threads) is the utilisation achieved.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint64_t cn_pool_busy_ns(cn_pool *pool) {
+    return cn_stats_load(&pool->stats.busy_ns);
+}
+
+/** Nonces hashed by all threads since the pool was created. */
+EMSCRIPTEN_KEEPALIVE
+uint64_t cn_pool_hashes(cn_pool *pool) {
+    return cn_stats_load(&pool->stats.hashes);
+}
+
+/**
+ * The counters every thread's scans add to (hashes, shares found, busy
+ * time, end of the last scan), for reading without the lock or, under
+ * -pthread, straight from the shared memory on another thread.
+ */
+EMSCRIPTEN_KEEPALIVE
+const cn_stats *cn_pool_stats(cn_pool *pool) {
+    return &pool->stats;
+}
+
+/** Shares lost because the queue was full when they were found. */
+EMSCRIPTEN_KEEPALIVE
+uint32_t cn_pool_dropped(cn_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    const uint32_t dropped = pool->dropped;
+    pthread_mutex_unlock(&pool->lock);
+    return dropped;
+}
+
+/** Number of threads the pool runs. */
+EMSCRIPTEN_KEEPALIVE
+uint32_t cn_pool_threads(const cn_pool *pool) {
+    return pool->threads;
+}
+
+/** Stops and joins the threads, then frees the pool. */
+EMSCRIPTEN_KEEPALIVE
+void cn_pool_destroy(cn_pool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    cn_control_store(&pool->control, CN_CONTROL_STOP);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (uint32_t t = 0; t < pool->threads; t++)
+        pthread_join(pool->thread[t], NULL);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+#endif /* CN_THREADS */
@@ -0,0 +1,97 @@
+#!/usr/bin/env bash
+# Fetches the Monero final-hash sources (Blake-256, Groestl-256, JH-256,
+# Skein-256) that cryptonight_impl.c links against, the cn/r program
+# generator it includes, plus stub headers for the epee dependencies they
+# include.  Used by the WASM, bench and test
+# builds in .github/workflows/build-xmrig-wasm.yml.
+#
+#   wasm_src/fetch_monero_crypto.sh [output dir, default monero_crypto]
+set -euo pipefail
+cd "$(dirname "$0")/.."
+OUT="${1:-monero_crypto}"
+
+mkdir -p "$OUT"
+BASE="https://raw.githubusercontent.com/monero-project/monero/master/src/crypto"
+
+echo "=== Downloading hash function sources ==="
+# Blake-256
+curl -fSL "$BASE/blake256.c"       -o "$OUT"/blake256.c
+curl -fSL "$BASE/blake256.h"       -o "$OUT"/blake256.h
+
+# Groestl-256
+curl -fSL "$BASE/groestl.c"        -o "$OUT"/groestl.c
+curl -fSL "$BASE/groestl.h"        -o "$OUT"/groestl.h
+curl -fSL "$BASE/groestl_tables.h" -o "$OUT"/groestl_tables.h
+
+# JH-256
+curl -fSL "$BASE/jh.c"             -o "$OUT"/jh.c
+curl -fSL "$BASE/jh.h"             -o "$OUT"/jh.h
+
+# Skein-256 (uses Skein-512 internally for 256-bit output)
+curl -fSL "$BASE/skein.c"          -o "$OUT"/skein.c
+curl -fSL "$BASE/skein.h"          -o "$OUT"/skein.h
+curl -fSL "$BASE/skein_port.h"     -o "$OUT"/skein_port.h
+
+# cn/r random-math program generator + interpreter (consensus code, used as is)
+curl -fSL "$BASE/variant4_random_math.h" -o "$OUT"/variant4_random_math.h
+
+echo "=== Downloaded files ==="
+ls -la "$OUT"/
+
+# blake256.c includes <memwipe.h> (from epee submodule - not in src/crypto)
+cat > "$OUT"/memwipe.h << 'STUBEOF'
+#pragma once
+#include <string.h>
+static inline void memwipe(void *ptr, size_t n) {
+    volatile unsigned char *p = (volatile unsigned char *)ptr;
+    while (n--) *p++ = 0;
+}
+STUBEOF
+
+# int-util.h (from contrib/epee/include - not in src/common)
+# Provides BYTE_ORDER, LITTLE_ENDIAN, BIG_ENDIAN for groestl_tables.h and skein_port.h
+cat > "$OUT"/int-util.h << 'INTEOF'
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#ifndef LITTLE_ENDIAN
+#define LITTLE_ENDIAN 1234
+#endif
+#ifndef BIG_ENDIAN
+#define BIG_ENDIAN 4321
+#endif
+#ifndef BYTE_ORDER
+#define BYTE_ORDER LITTLE_ENDIAN
+#endif
+INTEOF
+
+# warnings.h (from contrib/epee/include - not in src/common)
+cat > "$OUT"/warnings.h << 'WARNEOF'
+#pragma once
+#define PUSH_WARNINGS
+#define POP_WARNINGS
+#define DISABLE_VS_WARNINGS(...)
+#define DISABLE_GCC_WARNING(x)
+#define DISABLE_CLANG_WARNING(x)
+#define DISABLE_GCC_AND_CLANG_WARNING(x)
+WARNEOF
+
+# Compatibility defines (little-endian targets: WASM, x86-64)
+cat > "$OUT"/wasm_compat.h << 'COMPATEOF'
+#pragma once
+#include <stdint.h>
+#ifndef SWAP32LE
+#define SWAP32LE(x) (x)
+#endif
+#ifndef SWAP64LE
+#define SWAP64LE(x) (x)
+#endif
+#ifndef u32BIG
+#define u32BIG(x) \
+    ((((x) & 0x000000ffU) << 24) | (((x) & 0x0000ff00U) << 8) | \
+     (((x) & 0x00ff0000U) >> 8)  | (((x) & 0xff000000U) >> 24))
+#endif
+COMPATEOF
+
+echo "=== Stub headers created ==="
+ls -la "$OUT"/
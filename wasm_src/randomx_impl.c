@@ -0,0 +1,2670 @@
+/**
+ * RandomX (rx/0) implementation: light mode for WASM and native builds,
+ * full mode natively.
+ *
+ * Includes:
+ *  - BLAKE2b (RFC 7693) and Argon2d (RFC 9106, version 0x13) for the
+ *    256 MB cache
+ *  - Blake2Generator and the SuperscalarHash program generator /
+ *    executor that derive dataset items from the cache
+ *  - AES decryption rounds (T-table, byte-wise reference, AES-NI) and the
+ *    AesGenerator1R / AesGenerator4R / AesHash1R scratchpad functions
+ *  - A bytecode interpreter for the RandomX VM: 256-instruction programs
+ *    decoded once per program, 2048 iterations over a 2 MB scratchpad,
+ *    with dataset items computed from the cache on demand (light mode)
+ *    or read from the precomputed 2 GB dataset (full mode)
+ *  - Full-mode dataset initialisation split across threads, on huge
+ *    pages, and rx_full: a double-buffered dataset rebuilt in the
+ *    background when the seed hash changes
+ *  - CFROUND rounding through fesetround() natively, emulated with exact
+ *    error terms where the host has no rounding-mode control (WASM)
+ *
+ * The cache is built once per seed hash and only read afterwards, so any
+ * number of contexts (threads) can hash against one rx_cache.  Shares the
+ * CryptoNight kernel's primitives (AES tables, mul_128, scratchpad
+ * allocation, share targets and scan records), so it is compiled as a
+ * superset of cryptonight_impl.c and the module exports both APIs.
+ *
+ * Follows tevador/RandomX v1.1 (the rx/0 parameters Monero uses).
+ *
+ * Compile with:
+ *   emcc randomx_impl.c blake256.c groestl.c jh.c skein.c ...
+ */
+
+#include "cryptonight_impl.c"
+
+/* CFROUND switches the host's rounding mode where it can (x86-64, arm64);
+ * -DRX_HW_ROUNDING=0 rounds in software as the WASM build must, since
+ * WebAssembly only has round-to-nearest */
+#ifndef RX_HW_ROUNDING
+#if !defined(__EMSCRIPTEN__) && (defined(__x86_64__) || defined(__aarch64__))
+#define RX_HW_ROUNDING 1
+#else
+#define RX_HW_ROUNDING 0
+#endif
+#endif
+
+#include <float.h>
+#if RX_HW_ROUNDING
+#include <fenv.h>
+#endif
+
+/* Native 64-bit builds can also hash in full mode, with the 2 GB dataset
+ * built by a pool of threads (-DRX_FULL_MODE=0 leaves it out; the WASM
+ * build is light mode only) */
+#ifndef RX_FULL_MODE
+#if !defined(__EMSCRIPTEN__) && (defined(__unix__) || defined(__APPLE__)) && UINTPTR_MAX > 0xFFFFFFFFu
+#define RX_FULL_MODE 1
+#else
+#define RX_FULL_MODE 0
+#endif
+#endif
+
+#if RX_FULL_MODE
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/* ========================== Parameters ========================== */
+
+#define RX_ARGON_MEMORY         262144      /* KiB: 256 MB cache */
+#define RX_ARGON_ITERATIONS     3
+#define RX_ARGON_LANES          1
+#define RX_ARGON_SALT           "RandomX\x03"
+#define RX_CACHE_ACCESSES       8           /* superscalar programs per item */
+#define RX_SUPERSCALAR_LATENCY  170
+#define RX_SUPERSCALAR_MAX_SIZE 512
+#define RX_DATASET_BASE_SIZE    2147483648ULL
+#define RX_DATASET_EXTRA_SIZE   33554368ULL
+#define RX_PROGRAM_SIZE         256
+#define RX_PROGRAM_ITERATIONS   2048
+#define RX_PROGRAM_COUNT        8
+#define RX_CONTROL_INTERVAL     256         /* VM iterations between control checks */
+#define RX_SCRATCHPAD_L3        2097152
+#define RX_SCRATCHPAD_L2        262144
+#define RX_SCRATCHPAD_L1        16384
+#define RX_JUMP_BITS            8
+#define RX_JUMP_OFFSET          8
+
+#define RX_CACHE_SIZE           ((size_t)RX_ARGON_MEMORY * 1024)
+#define RX_CACHE_LINE_SIZE      64
+#define RX_CACHE_LINE_MASK      (RX_CACHE_SIZE / RX_CACHE_LINE_SIZE - 1)
+#define RX_DATASET_EXTRA_ITEMS  (RX_DATASET_EXTRA_SIZE / RX_CACHE_LINE_SIZE)
+#define RX_DATASET_ITEMS        ((RX_DATASET_BASE_SIZE + RX_DATASET_EXTRA_SIZE) / RX_CACHE_LINE_SIZE)
+#define RX_CACHE_LINE_ALIGN_MASK ((RX_DATASET_BASE_SIZE - 1) & ~(uint64_t)(RX_CACHE_LINE_SIZE - 1))
+#define RX_SCRATCHPAD_L1_MASK   (RX_SCRATCHPAD_L1 - 8)
+#define RX_SCRATCHPAD_L2_MASK   (RX_SCRATCHPAD_L2 - 8)
+#define RX_SCRATCHPAD_L3_MASK   (RX_SCRATCHPAD_L3 - 8)
+#define RX_SCRATCHPAD_L3_MASK64 (RX_SCRATCHPAD_L3 - 64)
+#define RX_CONDITION_MASK       ((1u << RX_JUMP_BITS) - 1)
+#define RX_STORE_L3_CONDITION   14
+#define RX_PROGRAM_BYTES        (128 + RX_PROGRAM_SIZE * 8)    /* entropy + code */
+#define RX_MAX_SEED             64          /* seed hashes are 32 bytes */
+
+static inline uint64_t rx_rotr64(uint64_t x, unsigned c) {
+    c &= 63;
+    return c ? (x >> c) | (x << (64 - c)) : x;
+}
+
+static inline uint64_t rx_rotl64(uint64_t x, unsigned c) {
+    c &= 63;
+    return c ? (x << c) | (x >> (64 - c)) : x;
+}
+
+static inline uint64_t rx_load64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline void rx_store64(uint8_t *p, uint64_t v) {
+    memcpy(p, &v, 8);
+}
+
+static inline uint64_t rx_sign_extend(uint32_t x) {
+    return (uint64_t)(int64_t)(int32_t)x;
+}
+
+static inline uint64_t rx_mulh(uint64_t a, uint64_t b) {
+    uint64_t hi, lo;
+    mul_128(a, b, &hi, &lo);
+    return hi;
+}
+
+/* signed high half from the unsigned one: subtract b (a) when a (b) < 0 */
+static inline uint64_t rx_smulh(uint64_t a, uint64_t b) {
+    uint64_t hi = rx_mulh(a, b);
+    if ((int64_t)a < 0) hi -= b;
+    if ((int64_t)b < 0) hi -= a;
+    return hi;
+}
+
+/* =========================== BLAKE2b =========================== */
+
+static const uint64_t rx_blake2b_iv[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+    0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t rx_blake2b_sigma[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+struct rx_blake2b {
+    uint64_t h[8];
+    uint64_t t;                             /* bytes compressed so far */
+    uint8_t  buf[128];
+    uint32_t buflen;
+    uint32_t outlen;
+};
+
+#define RX_B2B_G(a, b, c, d, x, y) do {             \
+        a = a + b + (x); d = rx_rotr64(d ^ a, 32);  \
+        c = c + d;       b = rx_rotr64(b ^ c, 24);  \
+        a = a + b + (y); d = rx_rotr64(d ^ a, 16);  \
+        c = c + d;       b = rx_rotr64(b ^ c, 63);  \
+    } while (0)
+
+static void rx_blake2b_compress(struct rx_blake2b *S, const uint8_t *block, int last) {
+    uint64_t m[16], v[16];
+    for (int i = 0; i < 16; i++)
+        m[i] = rx_load64(block + 8 * i);
+    for (int i = 0; i < 8; i++) {
+        v[i] = S->h[i];
+        v[i + 8] = rx_blake2b_iv[i];
+    }
+    v[12] ^= S->t;
+    if (last) v[14] = ~v[14];
+    for (int r = 0; r < 12; r++) {
+        const uint8_t *s = rx_blake2b_sigma[r];
+        RX_B2B_G(v[0], v[4], v[8],  v[12], m[s[0]],  m[s[1]]);
+        RX_B2B_G(v[1], v[5], v[9],  v[13], m[s[2]],  m[s[3]]);
+        RX_B2B_G(v[2], v[6], v[10], v[14], m[s[4]],  m[s[5]]);
+        RX_B2B_G(v[3], v[7], v[11], v[15], m[s[6]],  m[s[7]]);
+        RX_B2B_G(v[0], v[5], v[10], v[15], m[s[8]],  m[s[9]]);
+        RX_B2B_G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        RX_B2B_G(v[2], v[7], v[8],  v[13], m[s[12]], m[s[13]]);
+        RX_B2B_G(v[3], v[4], v[9],  v[14], m[s[14]], m[s[15]]);
+    }
+    for (int i = 0; i < 8; i++)
+        S->h[i] ^= v[i] ^ v[i + 8];
+}
+
+static void rx_blake2b_init(struct rx_blake2b *S, uint32_t outlen) {
+    memcpy(S->h, rx_blake2b_iv, sizeof(S->h));
+    S->h[0] ^= 0x01010000ULL ^ outlen;      /* no key, fanout = depth = 1 */
+    S->t = 0;
+    S->buflen = 0;
+    S->outlen = outlen;
+}
+
+/* The last block is kept buffered: it has to be compressed with the
+ * final flag, which only rx_blake2b_final() knows to set */
+static void rx_blake2b_update(struct rx_blake2b *S, const void *data, size_t len) {
+    const uint8_t *in = (const uint8_t *)data;
+    while (len > 0) {
+        if (S->buflen == sizeof(S->buf)) {
+            S->t += sizeof(S->buf);
+            rx_blake2b_compress(S, S->buf, 0);
+            S->buflen = 0;
+        }
+        size_t n = sizeof(S->buf) - S->buflen;
+        if (n > len) n = len;
+        memcpy(S->buf + S->buflen, in, n);
+        S->buflen += (uint32_t)n;
+        in += n;
+        len -= n;
+    }
+}
+
+static void rx_blake2b_final(struct rx_blake2b *S, void *out) {
+    uint8_t full[64];
+    S->t += S->buflen;
+    memset(S->buf + S->buflen, 0, sizeof(S->buf) - S->buflen);
+    rx_blake2b_compress(S, S->buf, 1);
+    for (int i = 0; i < 8; i++)
+        rx_store64(full + 8 * i, S->h[i]);
+    memcpy(out, full, S->outlen);
+}
+
+/** Unkeyed BLAKE2b with a 1..64-byte digest. */
+static void rx_blake2b(void *out, uint32_t outlen, const void *in, size_t inlen) {
+    struct rx_blake2b S;
+    rx_blake2b_init(&S, outlen);
+    rx_blake2b_update(&S, in, inlen);
+    rx_blake2b_final(&S, out);
+}
+
+/* Argon2's variable-length hash H' (RFC 9106, sec. 3.3) */
+static void rx_blake2b_long(uint8_t *out, uint32_t outlen, const void *in, size_t inlen) {
+    struct rx_blake2b S;
+    uint8_t len_le[4] = { (uint8_t)outlen, (uint8_t)(outlen >> 8),
+                          (uint8_t)(outlen >> 16), (uint8_t)(outlen >> 24) };
+
+    if (outlen <= 64) {
+        rx_blake2b_init(&S, outlen);
+        rx_blake2b_update(&S, len_le, 4);
+        rx_blake2b_update(&S, in, inlen);
+        rx_blake2b_final(&S, out);
+        return;
+    }
+
+    uint8_t v[64];
+    rx_blake2b_init(&S, 64);
+    rx_blake2b_update(&S, len_le, 4);
+    rx_blake2b_update(&S, in, inlen);
+    rx_blake2b_final(&S, v);
+    memcpy(out, v, 32);
+    out += 32;
+    uint32_t left = outlen - 32;
+    while (left > 64) {
+        rx_blake2b(v, 64, v, 64);
+        memcpy(out, v, 32);
+        out += 32;
+        left -= 32;
+    }
+    rx_blake2b(v, left, v, 64);
+    memcpy(out, v, left);
+}
+
+/* ============================ Argon2d ============================ */
+/*
+ * Memory-hard fill of the RandomX cache: Argon2d, version 0x13.  Written
+ * for any lane count so the RFC 9106 test vector can check it; RandomX
+ * itself uses one lane, 3 passes and 262144 1 KiB blocks.  Lanes are
+ * filled one after another (the reference's single-thread order).
+ */
+
+#define RX_ARGON2_BLOCK_WORDS 128           /* 1 KiB block */
+#define RX_ARGON2_SYNC_POINTS 4
+
+static inline uint64_t rx_blamka(uint64_t x, uint64_t y) {
+    return x + y + 2 * (uint64_t)(uint32_t)x * (uint32_t)y;
+}
+
+#define RX_ARGON2_G(a, b, c, d) do {                        \
+        a = rx_blamka(a, b); d = rx_rotr64(d ^ a, 32);      \
+        c = rx_blamka(c, d); b = rx_rotr64(b ^ c, 24);      \
+        a = rx_blamka(a, b); d = rx_rotr64(d ^ a, 16);      \
+        c = rx_blamka(c, d); b = rx_rotr64(b ^ c, 63);      \
+    } while (0)
+
+#define RX_ARGON2_ROUND(v0, v1, v2, v3, v4, v5, v6, v7,                  \
+                        v8, v9, v10, v11, v12, v13, v14, v15) do {       \
+        RX_ARGON2_G(v0, v4, v8, v12); RX_ARGON2_G(v1, v5, v9, v13);      \
+        RX_ARGON2_G(v2, v6, v10, v14); RX_ARGON2_G(v3, v7, v11, v15);    \
+        RX_ARGON2_G(v0, v5, v10, v15); RX_ARGON2_G(v1, v6, v11, v12);    \
+        RX_ARGON2_G(v2, v7, v8, v13); RX_ARGON2_G(v3, v4, v9, v14);      \
+    } while (0)
+
+/* next = P(prev ^ ref) ^ prev ^ ref, also ^ next itself after pass 0 */
+static void rx_argon2_fill_block(const uint64_t *prev, const uint64_t *ref, uint64_t *next,
+                                 int with_xor) {
+    uint64_t r[RX_ARGON2_BLOCK_WORDS], tmp[RX_ARGON2_BLOCK_WORDS];
+
+    for (int i = 0; i < RX_ARGON2_BLOCK_WORDS; i++) {
+        r[i] = prev[i] ^ ref[i];
+        tmp[i] = with_xor ? r[i] ^ next[i] : r[i];
+    }
+    for (int i = 0; i < 8; i++) {
+        uint64_t *v = r + 16 * i;
+        RX_ARGON2_ROUND(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+                        v[8], v[9], v[10], v[11], v[12], v[13], v[14], v[15]);
+    }
+    for (int i = 0; i < 8; i++) {
+        uint64_t *v = r + 2 * i;
+        RX_ARGON2_ROUND(v[0], v[1], v[16], v[17], v[32], v[33], v[48], v[49],
+                        v[64], v[65], v[80], v[81], v[96], v[97], v[112], v[113]);
+    }
+    for (int i = 0; i < RX_ARGON2_BLOCK_WORDS; i++)
+        next[i] = tmp[i] ^ r[i];
+}
+
+/* Index of the reference block within its lane (RFC 9106, sec. 3.4.1.2) */
+static uint32_t rx_argon2_index_alpha(uint32_t pass, uint32_t slice, uint32_t index,
+                                      uint32_t segment_length, uint32_t lane_length,
+                                      uint32_t pseudo_rand, int same_lane) {
+    uint32_t area;
+    if (pass == 0) {
+        if (slice == 0)
+            area = index - 1;
+        else if (same_lane)
+            area = slice * segment_length + index - 1;
+        else
+            area = slice * segment_length + (index == 0 ? (uint32_t)-1 : 0);
+    } else {
+        if (same_lane)
+            area = lane_length - segment_length + index - 1;
+        else
+            area = lane_length - segment_length + (index == 0 ? (uint32_t)-1 : 0);
+    }
+
+    uint64_t rel = pseudo_rand;
+    rel = (rel * rel) >> 32;
+    rel = area - 1 - ((area * rel) >> 32);
+
+    uint32_t start = 0;
+    if (pass != 0)
+        start = (slice == RX_ARGON2_SYNC_POINTS - 1) ? 0 : (slice + 1) * segment_length;
+    return (uint32_t)((start + rel) % lane_length);
+}
+
+static void rx_argon2_fill_segment(uint64_t *memory, uint32_t pass, uint32_t lane, uint32_t slice,
+                                   uint32_t lanes, uint32_t segment_length) {
+    const uint32_t lane_length = segment_length * RX_ARGON2_SYNC_POINTS;
+    const uint32_t first = (pass == 0 && slice == 0) ? 2 : 0;
+    uint32_t curr = lane * lane_length + slice * segment_length + first;
+    uint32_t prev = (curr % lane_length == 0) ? curr + lane_length - 1 : curr - 1;
+
+    for (uint32_t i = first; i < segment_length; i++, curr++, prev++) {
+        if (curr % lane_length == 1)
+            prev = curr - 1;
+        const uint64_t pseudo_rand = memory[(size_t)prev * RX_ARGON2_BLOCK_WORDS];
+        uint32_t ref_lane = (uint32_t)((pseudo_rand >> 32) % lanes);
+        if (pass == 0 && slice == 0)
+            ref_lane = lane;
+        const uint32_t ref_index = rx_argon2_index_alpha(pass, slice, i, segment_length,
+                                                         lane_length, (uint32_t)pseudo_rand,
+                                                         ref_lane == lane);
+        rx_argon2_fill_block(memory + (size_t)prev * RX_ARGON2_BLOCK_WORDS,
+                             memory + ((size_t)lane_length * ref_lane + ref_index) * RX_ARGON2_BLOCK_WORDS,
+                             memory + (size_t)curr * RX_ARGON2_BLOCK_WORDS, pass != 0);
+    }
+}
+
+static void rx_blake2b_update_le32(struct rx_blake2b *S, uint32_t v) {
+    const uint8_t le[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    rx_blake2b_update(S, le, 4);
+}
+
+/**
+ * Argon2d over `memory` (m_cost KiB, rounded down to a multiple of
+ * 4 * lanes blocks).  With tag_len > 0 the tag is written to `tag`; the
+ * RandomX cache uses the filled memory itself and passes tag_len = 0.
+ */
+static void rx_argon2d(uint64_t *memory, uint32_t m_cost, uint32_t t_cost, uint32_t lanes,
+                       const void *pwd, uint32_t pwd_len, const void *salt, uint32_t salt_len,
+                       const void *secret, uint32_t secret_len, const void *ad, uint32_t ad_len,
+                       uint8_t *tag, uint32_t tag_len) {
+    uint32_t blocks = m_cost;
+    if (blocks < 2 * RX_ARGON2_SYNC_POINTS * lanes)
+        blocks = 2 * RX_ARGON2_SYNC_POINTS * lanes;
+    const uint32_t segment_length = blocks / (lanes * RX_ARGON2_SYNC_POINTS);
+    const uint32_t lane_length = segment_length * RX_ARGON2_SYNC_POINTS;
+
+    /* H0 over the parameters and inputs, then the first two blocks of each lane */
+    uint8_t seed[64 + 8];
+    struct rx_blake2b S;
+    rx_blake2b_init(&S, 64);
+    rx_blake2b_update_le32(&S, lanes);
+    rx_blake2b_update_le32(&S, tag_len);
+    rx_blake2b_update_le32(&S, m_cost);
+    rx_blake2b_update_le32(&S, t_cost);
+    rx_blake2b_update_le32(&S, 0x13);       /* version */
+    rx_blake2b_update_le32(&S, 0);          /* type: Argon2d */
+    rx_blake2b_update_le32(&S, pwd_len);
+    rx_blake2b_update(&S, pwd, pwd_len);
+    rx_blake2b_update_le32(&S, salt_len);
+    rx_blake2b_update(&S, salt, salt_len);
+    rx_blake2b_update_le32(&S, secret_len);
+    rx_blake2b_update(&S, secret, secret_len);
+    rx_blake2b_update_le32(&S, ad_len);
+    rx_blake2b_update(&S, ad, ad_len);
+    rx_blake2b_final(&S, seed);
+
+    for (uint32_t l = 0; l < lanes; l++) {
+        for (uint32_t b = 0; b < 2; b++) {
+            uint8_t block[RX_ARGON2_BLOCK_WORDS * 8];
+            const uint32_t ext[2] = { b, l };
+            for (int i = 0; i < 2; i++) {
+                seed[64 + 4 * i]     = (uint8_t)ext[i];
+                seed[64 + 4 * i + 1] = (uint8_t)(ext[i] >> 8);
+                seed[64 + 4 * i + 2] = (uint8_t)(ext[i] >> 16);
+                seed[64 + 4 * i + 3] = (uint8_t)(ext[i] >> 24);
+            }
+            rx_blake2b_long(block, sizeof(block), seed, sizeof(seed));
+            memcpy(memory + ((size_t)l * lane_length + b) * RX_ARGON2_BLOCK_WORDS, block, sizeof(block));
+        }
+    }
+
+    for (uint32_t pass = 0; pass < t_cost; pass++)
+        for (uint32_t slice = 0; slice < RX_ARGON2_SYNC_POINTS; slice++)
+            for (uint32_t l = 0; l < lanes; l++)
+                rx_argon2_fill_segment(memory, pass, l, slice, lanes, segment_length);
+
+    if (tag_len) {
+        uint64_t last[RX_ARGON2_BLOCK_WORDS];
+        memcpy(last, memory + ((size_t)lane_length - 1) * RX_ARGON2_BLOCK_WORDS, sizeof(last));
+        for (uint32_t l = 1; l < lanes; l++) {
+            const uint64_t *blk = memory + ((size_t)l * lane_length + lane_length - 1) * RX_ARGON2_BLOCK_WORDS;
+            for (int i = 0; i < RX_ARGON2_BLOCK_WORDS; i++)
+                last[i] ^= blk[i];
+        }
+        rx_blake2b_long(tag, tag_len, last, sizeof(last));
+    }
+}
+
+/* ====================== AES for RandomX ====================== */
+/*
+ * RandomX fills and hashes the scratchpad with single AES rounds in both
+ * directions: aesenc (aes_round_tt, x86 AESENC) and aesdec (x86 AESDEC:
+ * InvShiftRows, InvSubBytes, InvMixColumns, then AddRoundKey).  aes_tdN is
+ * the decryption counterpart of aes_teN: column N of InvMixColumns applied
+ * to InvSubBytes(x), row 0 in the low byte.
+ */
+
+static const uint8_t rx_aes_inv_sbox[256] = {
+    0x52,0x09,0x6a,0xd5,0x30,0x36,0xa5,0x38,0xbf,0x40,0xa3,0x9e,0x81,0xf3,0xd7,0xfb,
+    0x7c,0xe3,0x39,0x82,0x9b,0x2f,0xff,0x87,0x34,0x8e,0x43,0x44,0xc4,0xde,0xe9,0xcb,
+    0x54,0x7b,0x94,0x32,0xa6,0xc2,0x23,0x3d,0xee,0x4c,0x95,0x0b,0x42,0xfa,0xc3,0x4e,
+    0x08,0x2e,0xa1,0x66,0x28,0xd9,0x24,0xb2,0x76,0x5b,0xa2,0x49,0x6d,0x8b,0xd1,0x25,
+    0x72,0xf8,0xf6,0x64,0x86,0x68,0x98,0x16,0xd4,0xa4,0x5c,0xcc,0x5d,0x65,0xb6,0x92,
+    0x6c,0x70,0x48,0x50,0xfd,0xed,0xb9,0xda,0x5e,0x15,0x46,0x57,0xa7,0x8d,0x9d,0x84,
+    0x90,0xd8,0xab,0x00,0x8c,0xbc,0xd3,0x0a,0xf7,0xe4,0x58,0x05,0xb8,0xb3,0x45,0x06,
+    0xd0,0x2c,0x1e,0x8f,0xca,0x3f,0x0f,0x02,0xc1,0xaf,0xbd,0x03,0x01,0x13,0x8a,0x6b,
+    0x3a,0x91,0x11,0x41,0x4f,0x67,0xdc,0xea,0x97,0xf2,0xcf,0xce,0xf0,0xb4,0xe6,0x73,
+    0x96,0xac,0x74,0x22,0xe7,0xad,0x35,0x85,0xe2,0xf9,0x37,0xe8,0x1c,0x75,0xdf,0x6e,
+    0x47,0xf1,0x1a,0x71,0x1d,0x29,0xc5,0x89,0x6f,0xb7,0x62,0x0e,0xaa,0x18,0xbe,0x1b,
+    0xfc,0x56,0x3e,0x4b,0xc6,0xd2,0x79,0x20,0x9a,0xdb,0xc0,0xfe,0x78,0xcd,0x5a,0xf4,
+    0x1f,0xdd,0xa8,0x33,0x88,0x07,0xc7,0x31,0xb1,0x12,0x10,0x59,0x27,0x80,0xec,0x5f,
+    0x60,0x51,0x7f,0xa9,0x19,0xb5,0x4a,0x0d,0x2d,0xe5,0x7a,0x9f,0x93,0xc9,0x9c,0xef,
+    0xa0,0xe0,0x3b,0x4d,0xae,0x2a,0xf5,0xb0,0xc8,0xeb,0xbb,0x3c,0x83,0x53,0x99,0x61,
+    0x17,0x2b,0x04,0x7e,0xba,0x77,0xd6,0x26,0xe1,0x69,0x14,0x63,0x55,0x21,0x0c,0x7d
+};
+
+static const uint32_t aes_td0[256] = {
+    0x50a7f451, 0x5365417e, 0xc3a4171a, 0x965e273a, 0xcb6bab3b, 0xf1459d1f,
+    0xab58faac, 0x9303e34b, 0x55fa3020, 0xf66d76ad, 0x9176cc88, 0x254c02f5,
+    0xfcd7e54f, 0xd7cb2ac5, 0x80443526, 0x8fa362b5, 0x495ab1de, 0x671bba25,
+    0x980eea45, 0xe1c0fe5d, 0x02752fc3, 0x12f04c81, 0xa397468d, 0xc6f9d36b,
+    0xe75f8f03, 0x959c9215, 0xeb7a6dbf, 0xda595295, 0x2d83bed4, 0xd3217458,
+    0x2969e049, 0x44c8c98e, 0x6a89c275, 0x78798ef4, 0x6b3e5899, 0xdd71b927,
+    0xb64fe1be, 0x17ad88f0, 0x66ac20c9, 0xb43ace7d, 0x184adf63, 0x82311ae5,
+    0x60335197, 0x457f5362, 0xe07764b1, 0x84ae6bbb, 0x1ca081fe, 0x942b08f9,
+    0x58684870, 0x19fd458f, 0x876cde94, 0xb7f87b52, 0x23d373ab, 0xe2024b72,
+    0x578f1fe3, 0x2aab5566, 0x0728ebb2, 0x03c2b52f, 0x9a7bc586, 0xa50837d3,
+    0xf2872830, 0xb2a5bf23, 0xba6a0302, 0x5c8216ed, 0x2b1ccf8a, 0x92b479a7,
+    0xf0f207f3, 0xa1e2694e, 0xcdf4da65, 0xd5be0506, 0x1f6234d1, 0x8afea6c4,
+    0x9d532e34, 0xa055f3a2, 0x32e18a05, 0x75ebf6a4, 0x39ec830b, 0xaaef6040,
+    0x069f715e, 0x51106ebd, 0xf98a213e, 0x3d06dd96, 0xae053edd, 0x46bde64d,
+    0xb58d5491, 0x055dc471, 0x6fd40604, 0xff155060, 0x24fb9819, 0x97e9bdd6,
+    0xcc434089, 0x779ed967, 0xbd42e8b0, 0x888b8907, 0x385b19e7, 0xdbeec879,
+    0x470a7ca1, 0xe90f427c, 0xc91e84f8, 0x00000000, 0x83868009, 0x48ed2b32,
+    0xac70111e, 0x4e725a6c, 0xfbff0efd, 0x5638850f, 0x1ed5ae3d, 0x27392d36,
+    0x64d90f0a, 0x21a65c68, 0xd1545b9b, 0x3a2e3624, 0xb1670a0c, 0x0fe75793,
+    0xd296eeb4, 0x9e919b1b, 0x4fc5c080, 0xa220dc61, 0x694b775a, 0x161a121c,
+    0x0aba93e2, 0xe52aa0c0, 0x43e0223c, 0x1d171b12, 0x0b0d090e, 0xadc78bf2,
+    0xb9a8b62d, 0xc8a91e14, 0x8519f157, 0x4c0775af, 0xbbdd99ee, 0xfd607fa3,
+    0x9f2601f7, 0xbcf5725c, 0xc53b6644, 0x347efb5b, 0x7629438b, 0xdcc623cb,
+    0x68fcedb6, 0x63f1e4b8, 0xcadc31d7, 0x10856342, 0x40229713, 0x2011c684,
+    0x7d244a85, 0xf83dbbd2, 0x1132f9ae, 0x6da129c7, 0x4b2f9e1d, 0xf330b2dc,
+    0xec52860d, 0xd0e3c177, 0x6c16b32b, 0x99b970a9, 0xfa489411, 0x2264e947,
+    0xc48cfca8, 0x1a3ff0a0, 0xd82c7d56, 0xef903322, 0xc74e4987, 0xc1d138d9,
+    0xfea2ca8c, 0x360bd498, 0xcf81f5a6, 0x28de7aa5, 0x268eb7da, 0xa4bfad3f,
+    0xe49d3a2c, 0x0d927850, 0x9bcc5f6a, 0x62467e54, 0xc2138df6, 0xe8b8d890,
+    0x5ef7392e, 0xf5afc382, 0xbe805d9f, 0x7c93d069, 0xa92dd56f, 0xb31225cf,
+    0x3b99acc8, 0xa77d1810, 0x6e639ce8, 0x7bbb3bdb, 0x097826cd, 0xf418596e,
+    0x01b79aec, 0xa89a4f83, 0x656e95e6, 0x7ee6ffaa, 0x08cfbc21, 0xe6e815ef,
+    0xd99be7ba, 0xce366f4a, 0xd4099fea, 0xd67cb029, 0xafb2a431, 0x31233f2a,
+    0x3094a5c6, 0xc066a235, 0x37bc4e74, 0xa6ca82fc, 0xb0d090e0, 0x15d8a733,
+    0x4a9804f1, 0xf7daec41, 0x0e50cd7f, 0x2ff69117, 0x8dd64d76, 0x4db0ef43,
+    0x544daacc, 0xdf0496e4, 0xe3b5d19e, 0x1b886a4c, 0xb81f2cc1, 0x7f516546,
+    0x04ea5e9d, 0x5d358c01, 0x737487fa, 0x2e410bfb, 0x5a1d67b3, 0x52d2db92,
+    0x335610e9, 0x1347d66d, 0x8c61d79a, 0x7a0ca137, 0x8e14f859, 0x893c13eb,
+    0xee27a9ce, 0x35c961b7, 0xede51ce1, 0x3cb1477a, 0x59dfd29c, 0x3f73f255,
+    0x79ce1418, 0xbf37c773, 0xeacdf753, 0x5baafd5f, 0x146f3ddf, 0x86db4478,
+    0x81f3afca, 0x3ec468b9, 0x2c342438, 0x5f40a3c2, 0x72c31d16, 0x0c25e2bc,
+    0x8b493c28, 0x41950dff, 0x7101a839, 0xdeb30c08, 0x9ce4b4d8, 0x90c15664,
+    0x6184cb7b, 0x70b632d5, 0x745c6c48, 0x4257b8d0
+};
+
+static const uint32_t aes_td1[256] = {
+    0xa7f45150, 0x65417e53, 0xa4171ac3, 0x5e273a96, 0x6bab3bcb, 0x459d1ff1,
+    0x58faacab, 0x03e34b93, 0xfa302055, 0x6d76adf6, 0x76cc8891, 0x4c02f525,
+    0xd7e54ffc, 0xcb2ac5d7, 0x44352680, 0xa362b58f, 0x5ab1de49, 0x1bba2567,
+    0x0eea4598, 0xc0fe5de1, 0x752fc302, 0xf04c8112, 0x97468da3, 0xf9d36bc6,
+    0x5f8f03e7, 0x9c921595, 0x7a6dbfeb, 0x595295da, 0x83bed42d, 0x217458d3,
+    0x69e04929, 0xc8c98e44, 0x89c2756a, 0x798ef478, 0x3e58996b, 0x71b927dd,
+    0x4fe1beb6, 0xad88f017, 0xac20c966, 0x3ace7db4, 0x4adf6318, 0x311ae582,
+    0x33519760, 0x7f536245, 0x7764b1e0, 0xae6bbb84, 0xa081fe1c, 0x2b08f994,
+    0x68487058, 0xfd458f19, 0x6cde9487, 0xf87b52b7, 0xd373ab23, 0x024b72e2,
+    0x8f1fe357, 0xab55662a, 0x28ebb207, 0xc2b52f03, 0x7bc5869a, 0x0837d3a5,
+    0x872830f2, 0xa5bf23b2, 0x6a0302ba, 0x8216ed5c, 0x1ccf8a2b, 0xb479a792,
+    0xf207f3f0, 0xe2694ea1, 0xf4da65cd, 0xbe0506d5, 0x6234d11f, 0xfea6c48a,
+    0x532e349d, 0x55f3a2a0, 0xe18a0532, 0xebf6a475, 0xec830b39, 0xef6040aa,
+    0x9f715e06, 0x106ebd51, 0x8a213ef9, 0x06dd963d, 0x053eddae, 0xbde64d46,
+    0x8d5491b5, 0x5dc47105, 0xd406046f, 0x155060ff, 0xfb981924, 0xe9bdd697,
+    0x434089cc, 0x9ed96777, 0x42e8b0bd, 0x8b890788, 0x5b19e738, 0xeec879db,
+    0x0a7ca147, 0x0f427ce9, 0x1e84f8c9, 0x00000000, 0x86800983, 0xed2b3248,
+    0x70111eac, 0x725a6c4e, 0xff0efdfb, 0x38850f56, 0xd5ae3d1e, 0x392d3627,
+    0xd90f0a64, 0xa65c6821, 0x545b9bd1, 0x2e36243a, 0x670a0cb1, 0xe757930f,
+    0x96eeb4d2, 0x919b1b9e, 0xc5c0804f, 0x20dc61a2, 0x4b775a69, 0x1a121c16,
+    0xba93e20a, 0x2aa0c0e5, 0xe0223c43, 0x171b121d, 0x0d090e0b, 0xc78bf2ad,
+    0xa8b62db9, 0xa91e14c8, 0x19f15785, 0x0775af4c, 0xdd99eebb, 0x607fa3fd,
+    0x2601f79f, 0xf5725cbc, 0x3b6644c5, 0x7efb5b34, 0x29438b76, 0xc623cbdc,
+    0xfcedb668, 0xf1e4b863, 0xdc31d7ca, 0x85634210, 0x22971340, 0x11c68420,
+    0x244a857d, 0x3dbbd2f8, 0x32f9ae11, 0xa129c76d, 0x2f9e1d4b, 0x30b2dcf3,
+    0x52860dec, 0xe3c177d0, 0x16b32b6c, 0xb970a999, 0x489411fa, 0x64e94722,
+    0x8cfca8c4, 0x3ff0a01a, 0x2c7d56d8, 0x903322ef, 0x4e4987c7, 0xd138d9c1,
+    0xa2ca8cfe, 0x0bd49836, 0x81f5a6cf, 0xde7aa528, 0x8eb7da26, 0xbfad3fa4,
+    0x9d3a2ce4, 0x9278500d, 0xcc5f6a9b, 0x467e5462, 0x138df6c2, 0xb8d890e8,
+    0xf7392e5e, 0xafc382f5, 0x805d9fbe, 0x93d0697c, 0x2dd56fa9, 0x1225cfb3,
+    0x99acc83b, 0x7d1810a7, 0x639ce86e, 0xbb3bdb7b, 0x7826cd09, 0x18596ef4,
+    0xb79aec01, 0x9a4f83a8, 0x6e95e665, 0xe6ffaa7e, 0xcfbc2108, 0xe815efe6,
+    0x9be7bad9, 0x366f4ace, 0x099fead4, 0x7cb029d6, 0xb2a431af, 0x233f2a31,
+    0x94a5c630, 0x66a235c0, 0xbc4e7437, 0xca82fca6, 0xd090e0b0, 0xd8a73315,
+    0x9804f14a, 0xdaec41f7, 0x50cd7f0e, 0xf691172f, 0xd64d768d, 0xb0ef434d,
+    0x4daacc54, 0x0496e4df, 0xb5d19ee3, 0x886a4c1b, 0x1f2cc1b8, 0x5165467f,
+    0xea5e9d04, 0x358c015d, 0x7487fa73, 0x410bfb2e, 0x1d67b35a, 0xd2db9252,
+    0x5610e933, 0x47d66d13, 0x61d79a8c, 0x0ca1377a, 0x14f8598e, 0x3c13eb89,
+    0x27a9ceee, 0xc961b735, 0xe51ce1ed, 0xb1477a3c, 0xdfd29c59, 0x73f2553f,
+    0xce141879, 0x37c773bf, 0xcdf753ea, 0xaafd5f5b, 0x6f3ddf14, 0xdb447886,
+    0xf3afca81, 0xc468b93e, 0x3424382c, 0x40a3c25f, 0xc31d1672, 0x25e2bc0c,
+    0x493c288b, 0x950dff41, 0x01a83971, 0xb30c08de, 0xe4b4d89c, 0xc1566490,
+    0x84cb7b61, 0xb632d570, 0x5c6c4874, 0x57b8d042
+};
+
+static const uint32_t aes_td2[256] = {
+    0xf45150a7, 0x417e5365, 0x171ac3a4, 0x273a965e, 0xab3bcb6b, 0x9d1ff145,
+    0xfaacab58, 0xe34b9303, 0x302055fa, 0x76adf66d, 0xcc889176, 0x02f5254c,
+    0xe54ffcd7, 0x2ac5d7cb, 0x35268044, 0x62b58fa3, 0xb1de495a, 0xba25671b,
+    0xea45980e, 0xfe5de1c0, 0x2fc30275, 0x4c8112f0, 0x468da397, 0xd36bc6f9,
+    0x8f03e75f, 0x9215959c, 0x6dbfeb7a, 0x5295da59, 0xbed42d83, 0x7458d321,
+    0xe0492969, 0xc98e44c8, 0xc2756a89, 0x8ef47879, 0x58996b3e, 0xb927dd71,
+    0xe1beb64f, 0x88f017ad, 0x20c966ac, 0xce7db43a, 0xdf63184a, 0x1ae58231,
+    0x51976033, 0x5362457f, 0x64b1e077, 0x6bbb84ae, 0x81fe1ca0, 0x08f9942b,
+    0x48705868, 0x458f19fd, 0xde94876c, 0x7b52b7f8, 0x73ab23d3, 0x4b72e202,
+    0x1fe3578f, 0x55662aab, 0xebb20728, 0xb52f03c2, 0xc5869a7b, 0x37d3a508,
+    0x2830f287, 0xbf23b2a5, 0x0302ba6a, 0x16ed5c82, 0xcf8a2b1c, 0x79a792b4,
+    0x07f3f0f2, 0x694ea1e2, 0xda65cdf4, 0x0506d5be, 0x34d11f62, 0xa6c48afe,
+    0x2e349d53, 0xf3a2a055, 0x8a0532e1, 0xf6a475eb, 0x830b39ec, 0x6040aaef,
+    0x715e069f, 0x6ebd5110, 0x213ef98a, 0xdd963d06, 0x3eddae05, 0xe64d46bd,
+    0x5491b58d, 0xc471055d, 0x06046fd4, 0x5060ff15, 0x981924fb, 0xbdd697e9,
+    0x4089cc43, 0xd967779e, 0xe8b0bd42, 0x8907888b, 0x19e7385b, 0xc879dbee,
+    0x7ca1470a, 0x427ce90f, 0x84f8c91e, 0x00000000, 0x80098386, 0x2b3248ed,
+    0x111eac70, 0x5a6c4e72, 0x0efdfbff, 0x850f5638, 0xae3d1ed5, 0x2d362739,
+    0x0f0a64d9, 0x5c6821a6, 0x5b9bd154, 0x36243a2e, 0x0a0cb167, 0x57930fe7,
+    0xeeb4d296, 0x9b1b9e91, 0xc0804fc5, 0xdc61a220, 0x775a694b, 0x121c161a,
+    0x93e20aba, 0xa0c0e52a, 0x223c43e0, 0x1b121d17, 0x090e0b0d, 0x8bf2adc7,
+    0xb62db9a8, 0x1e14c8a9, 0xf1578519, 0x75af4c07, 0x99eebbdd, 0x7fa3fd60,
+    0x01f79f26, 0x725cbcf5, 0x6644c53b, 0xfb5b347e, 0x438b7629, 0x23cbdcc6,
+    0xedb668fc, 0xe4b863f1, 0x31d7cadc, 0x63421085, 0x97134022, 0xc6842011,
+    0x4a857d24, 0xbbd2f83d, 0xf9ae1132, 0x29c76da1, 0x9e1d4b2f, 0xb2dcf330,
+    0x860dec52, 0xc177d0e3, 0xb32b6c16, 0x70a999b9, 0x9411fa48, 0xe9472264,
+    0xfca8c48c, 0xf0a01a3f, 0x7d56d82c, 0x3322ef90, 0x4987c74e, 0x38d9c1d1,
+    0xca8cfea2, 0xd498360b, 0xf5a6cf81, 0x7aa528de, 0xb7da268e, 0xad3fa4bf,
+    0x3a2ce49d, 0x78500d92, 0x5f6a9bcc, 0x7e546246, 0x8df6c213, 0xd890e8b8,
+    0x392e5ef7, 0xc382f5af, 0x5d9fbe80, 0xd0697c93, 0xd56fa92d, 0x25cfb312,
+    0xacc83b99, 0x1810a77d, 0x9ce86e63, 0x3bdb7bbb, 0x26cd0978, 0x596ef418,
+    0x9aec01b7, 0x4f83a89a, 0x95e6656e, 0xffaa7ee6, 0xbc2108cf, 0x15efe6e8,
+    0xe7bad99b, 0x6f4ace36, 0x9fead409, 0xb029d67c, 0xa431afb2, 0x3f2a3123,
+    0xa5c63094, 0xa235c066, 0x4e7437bc, 0x82fca6ca, 0x90e0b0d0, 0xa73315d8,
+    0x04f14a98, 0xec41f7da, 0xcd7f0e50, 0x91172ff6, 0x4d768dd6, 0xef434db0,
+    0xaacc544d, 0x96e4df04, 0xd19ee3b5, 0x6a4c1b88, 0x2cc1b81f, 0x65467f51,
+    0x5e9d04ea, 0x8c015d35, 0x87fa7374, 0x0bfb2e41, 0x67b35a1d, 0xdb9252d2,
+    0x10e93356, 0xd66d1347, 0xd79a8c61, 0xa1377a0c, 0xf8598e14, 0x13eb893c,
+    0xa9ceee27, 0x61b735c9, 0x1ce1ede5, 0x477a3cb1, 0xd29c59df, 0xf2553f73,
+    0x141879ce, 0xc773bf37, 0xf753eacd, 0xfd5f5baa, 0x3ddf146f, 0x447886db,
+    0xafca81f3, 0x68b93ec4, 0x24382c34, 0xa3c25f40, 0x1d1672c3, 0xe2bc0c25,
+    0x3c288b49, 0x0dff4195, 0xa8397101, 0x0c08deb3, 0xb4d89ce4, 0x566490c1,
+    0xcb7b6184, 0x32d570b6, 0x6c48745c, 0xb8d04257
+};
+
+static const uint32_t aes_td3[256] = {
+    0x5150a7f4, 0x7e536541, 0x1ac3a417, 0x3a965e27, 0x3bcb6bab, 0x1ff1459d,
+    0xacab58fa, 0x4b9303e3, 0x2055fa30, 0xadf66d76, 0x889176cc, 0xf5254c02,
+    0x4ffcd7e5, 0xc5d7cb2a, 0x26804435, 0xb58fa362, 0xde495ab1, 0x25671bba,
+    0x45980eea, 0x5de1c0fe, 0xc302752f, 0x8112f04c, 0x8da39746, 0x6bc6f9d3,
+    0x03e75f8f, 0x15959c92, 0xbfeb7a6d, 0x95da5952, 0xd42d83be, 0x58d32174,
+    0x492969e0, 0x8e44c8c9, 0x756a89c2, 0xf478798e, 0x996b3e58, 0x27dd71b9,
+    0xbeb64fe1, 0xf017ad88, 0xc966ac20, 0x7db43ace, 0x63184adf, 0xe582311a,
+    0x97603351, 0x62457f53, 0xb1e07764, 0xbb84ae6b, 0xfe1ca081, 0xf9942b08,
+    0x70586848, 0x8f19fd45, 0x94876cde, 0x52b7f87b, 0xab23d373, 0x72e2024b,
+    0xe3578f1f, 0x662aab55, 0xb20728eb, 0x2f03c2b5, 0x869a7bc5, 0xd3a50837,
+    0x30f28728, 0x23b2a5bf, 0x02ba6a03, 0xed5c8216, 0x8a2b1ccf, 0xa792b479,
+    0xf3f0f207, 0x4ea1e269, 0x65cdf4da, 0x06d5be05, 0xd11f6234, 0xc48afea6,
+    0x349d532e, 0xa2a055f3, 0x0532e18a, 0xa475ebf6, 0x0b39ec83, 0x40aaef60,
+    0x5e069f71, 0xbd51106e, 0x3ef98a21, 0x963d06dd, 0xddae053e, 0x4d46bde6,
+    0x91b58d54, 0x71055dc4, 0x046fd406, 0x60ff1550, 0x1924fb98, 0xd697e9bd,
+    0x89cc4340, 0x67779ed9, 0xb0bd42e8, 0x07888b89, 0xe7385b19, 0x79dbeec8,
+    0xa1470a7c, 0x7ce90f42, 0xf8c91e84, 0x00000000, 0x09838680, 0x3248ed2b,
+    0x1eac7011, 0x6c4e725a, 0xfdfbff0e, 0x0f563885, 0x3d1ed5ae, 0x3627392d,
+    0x0a64d90f, 0x6821a65c, 0x9bd1545b, 0x243a2e36, 0x0cb1670a, 0x930fe757,
+    0xb4d296ee, 0x1b9e919b, 0x804fc5c0, 0x61a220dc, 0x5a694b77, 0x1c161a12,
+    0xe20aba93, 0xc0e52aa0, 0x3c43e022, 0x121d171b, 0x0e0b0d09, 0xf2adc78b,
+    0x2db9a8b6, 0x14c8a91e, 0x578519f1, 0xaf4c0775, 0xeebbdd99, 0xa3fd607f,
+    0xf79f2601, 0x5cbcf572, 0x44c53b66, 0x5b347efb, 0x8b762943, 0xcbdcc623,
+    0xb668fced, 0xb863f1e4, 0xd7cadc31, 0x42108563, 0x13402297, 0x842011c6,
+    0x857d244a, 0xd2f83dbb, 0xae1132f9, 0xc76da129, 0x1d4b2f9e, 0xdcf330b2,
+    0x0dec5286, 0x77d0e3c1, 0x2b6c16b3, 0xa999b970, 0x11fa4894, 0x472264e9,
+    0xa8c48cfc, 0xa01a3ff0, 0x56d82c7d, 0x22ef9033, 0x87c74e49, 0xd9c1d138,
+    0x8cfea2ca, 0x98360bd4, 0xa6cf81f5, 0xa528de7a, 0xda268eb7, 0x3fa4bfad,
+    0x2ce49d3a, 0x500d9278, 0x6a9bcc5f, 0x5462467e, 0xf6c2138d, 0x90e8b8d8,
+    0x2e5ef739, 0x82f5afc3, 0x9fbe805d, 0x697c93d0, 0x6fa92dd5, 0xcfb31225,
+    0xc83b99ac, 0x10a77d18, 0xe86e639c, 0xdb7bbb3b, 0xcd097826, 0x6ef41859,
+    0xec01b79a, 0x83a89a4f, 0xe6656e95, 0xaa7ee6ff, 0x2108cfbc, 0xefe6e815,
+    0xbad99be7, 0x4ace366f, 0xead4099f, 0x29d67cb0, 0x31afb2a4, 0x2a31233f,
+    0xc63094a5, 0x35c066a2, 0x7437bc4e, 0xfca6ca82, 0xe0b0d090, 0x3315d8a7,
+    0xf14a9804, 0x41f7daec, 0x7f0e50cd, 0x172ff691, 0x768dd64d, 0x434db0ef,
+    0xcc544daa, 0xe4df0496, 0x9ee3b5d1, 0x4c1b886a, 0xc1b81f2c, 0x467f5165,
+    0x9d04ea5e, 0x015d358c, 0xfa737487, 0xfb2e410b, 0xb35a1d67, 0x9252d2db,
+    0xe9335610, 0x6d1347d6, 0x9a8c61d7, 0x377a0ca1, 0x598e14f8, 0xeb893c13,
+    0xceee27a9, 0xb735c961, 0xe1ede51c, 0x7a3cb147, 0x9c59dfd2, 0x553f73f2,
+    0x1879ce14, 0x73bf37c7, 0x53eacdf7, 0x5f5baafd, 0xdf146f3d, 0x7886db44,
+    0xca81f3af, 0xb93ec468, 0x382c3424, 0xc25f40a3, 0x1672c31d, 0xbc0c25e2,
+    0x288b493c, 0xff41950d, 0x397101a8, 0x08deb30c, 0xd89ce4b4, 0x6490c156,
+    0x7b6184cb, 0xd570b632, 0x48745c6c, 0xd04257b8
+};
+
+#define AES_TD_COLUMN(s0, s1, s2, s3, k) \
+    (aes_td0[(s0) & 0xff] ^ aes_td1[((s1) >> 8) & 0xff] ^ \
+     aes_td2[((s2) >> 16) & 0xff] ^ aes_td3[(s3) >> 24] ^ (k))
+
+/** One AES decryption round on four column words (x86 AESDEC). */
+static inline void aes_dec_round_tt(uint32_t s[4], const uint32_t k[4]) {
+    uint32_t t0 = AES_TD_COLUMN(s[0], s[3], s[2], s[1], k[0]);
+    uint32_t t1 = AES_TD_COLUMN(s[1], s[0], s[3], s[2], k[1]);
+    uint32_t t2 = AES_TD_COLUMN(s[2], s[1], s[0], s[3], k[2]);
+    uint32_t t3 = AES_TD_COLUMN(s[3], s[2], s[1], s[0], k[3]);
+    s[0] = t0; s[1] = t1; s[2] = t2; s[3] = t3;
+}
+
+/* GF(2^8) multiply, for the byte-wise InvMixColumns */
+static inline uint8_t rx_gmul(uint8_t a, uint8_t b) {
+    uint8_t p = 0;
+    while (b) {
+        if (b & 1) p ^= a;
+        a = xtime(a);
+        b >>= 1;
+    }
+    return p;
+}
+
+/**
+ * Byte-wise AES decryption round: InvShiftRows → InvSubBytes →
+ * InvMixColumns → AddRoundKey.  Reference for aes_dec_round_tt().
+ */
+static inline void aes_dec_single_round(uint8_t *out, const uint8_t *in, const uint8_t *key) {
+    uint8_t s[16];
+
+    /* InvShiftRows + InvSubBytes: row r of column c comes from column c - r */
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+            s[c * 4 + r] = rx_aes_inv_sbox[in[((c - r + 4) % 4) * 4 + r]];
+
+    /* InvMixColumns: [14 11 13 9] rotated per row */
+    for (int c = 0; c < 4; c++) {
+        uint8_t a0 = s[c*4+0], a1 = s[c*4+1], a2 = s[c*4+2], a3 = s[c*4+3];
+        out[c*4+0] = rx_gmul(a0, 14) ^ rx_gmul(a1, 11) ^ rx_gmul(a2, 13) ^ rx_gmul(a3, 9)  ^ key[c*4+0];
+        out[c*4+1] = rx_gmul(a0, 9)  ^ rx_gmul(a1, 14) ^ rx_gmul(a2, 11) ^ rx_gmul(a3, 13) ^ key[c*4+1];
+        out[c*4+2] = rx_gmul(a0, 13) ^ rx_gmul(a1, 9)  ^ rx_gmul(a2, 14) ^ rx_gmul(a3, 11) ^ key[c*4+2];
+        out[c*4+3] = rx_gmul(a0, 11) ^ rx_gmul(a1, 13) ^ rx_gmul(a2, 9)  ^ rx_gmul(a3, 14) ^ key[c*4+3];
+    }
+}
+
+/* The generators' rounds on column words: T-tables by default, the
+ * byte-wise rounds with -DCN_AES_TTABLE=0 */
+static inline void rx_aesenc(uint32_t s[4], const uint32_t k[4]) {
+#if CN_AES_TTABLE || CN_SIMD128
+    aes_round_tt(s, k);
+#else
+    uint8_t b[16];
+    memcpy(b, s, 16);
+    aes_single_round(b, b, (const uint8_t *)k);
+    memcpy(s, b, 16);
+#endif
+}
+
+static inline void rx_aesdec(uint32_t s[4], const uint32_t k[4]) {
+#if CN_AES_TTABLE || CN_SIMD128
+    aes_dec_round_tt(s, k);
+#else
+    uint8_t b[16];
+    memcpy(b, s, 16);
+    aes_dec_single_round(b, b, (const uint8_t *)k);
+    memcpy(s, b, 16);
+#endif
+}
+
+/* Keys as RandomX writes them (most significant word first), stored as
+ * the four little-endian column words the rounds take */
+#define RX_AES_KEY(w3, w2, w1, w0) { w0, w1, w2, w3 }
+
+static const uint32_t rx_aes_gen1r_keys[4][4] = {
+    RX_AES_KEY(0xb4f44917, 0xdbb5552b, 0x62716609, 0x6daca553),
+    RX_AES_KEY(0x0da1dc4e, 0x1725d378, 0x846a710d, 0x6d7caf07),
+    RX_AES_KEY(0x3e20e345, 0xf4c0794f, 0x9f947ec6, 0x3f1262f1),
+    RX_AES_KEY(0x49169154, 0x16314c88, 0xb1ba317c, 0x6aef8135)
+};
+
+static const uint32_t rx_aes_gen4r_keys[8][4] = {
+    RX_AES_KEY(0x99e5d23f, 0x2f546d2b, 0xd1833ddb, 0x6421aadd),
+    RX_AES_KEY(0xa5dfcde5, 0x06f79d53, 0xb6913f55, 0xb20e3450),
+    RX_AES_KEY(0x171c02bf, 0x0aa4679f, 0x515e7baf, 0x5c3ed904),
+    RX_AES_KEY(0xd8ded291, 0xcd673785, 0xe78f5d08, 0x85623763),
+    RX_AES_KEY(0x229effb4, 0x3d518b6d, 0xe3d6a7a6, 0xb5826f73),
+    RX_AES_KEY(0xb272b7d2, 0xe9024d4e, 0x9c10b3d9, 0xc7566bf3),
+    RX_AES_KEY(0xf63befa7, 0x2ba9660a, 0xf765a38b, 0xf273c9e7),
+    RX_AES_KEY(0xc0b0762d, 0x0c06d1fd, 0x915839de, 0x7a7cd609)
+};
+
+static const uint32_t rx_aes_hash1r_state[4][4] = {
+    RX_AES_KEY(0xd7983aad, 0xcc82db47, 0x9fa856de, 0x92b52c0d),
+    RX_AES_KEY(0xace78057, 0xf59e125a, 0x15c7b798, 0x338d996e),
+    RX_AES_KEY(0xe8a07ce4, 0x5079506b, 0xae62c7d0, 0x6a770017),
+    RX_AES_KEY(0x7e994948, 0x79a10005, 0x07ad828d, 0x630a240c)
+};
+
+static const uint32_t rx_aes_hash1r_xkeys[2][4] = {
+    RX_AES_KEY(0x06890201, 0x90dc56bf, 0x8b24949f, 0xf6fa8389),
+    RX_AES_KEY(0xed18f99b, 0xee1043c6, 0x51f4e03c, 0x61b263d1)
+};
+
+/**
+ * The scratchpad functions of one AES implementation:
+ *   fill1r - AesGenerator1R: `size` bytes from the 64-byte state, which is
+ *            updated (the scratchpad fill)
+ *   fill4r - AesGenerator4R: 4 rounds per 64 bytes (program generation)
+ *   hash1r - AesHash1R: 64-byte fingerprint of `size` bytes
+ */
+struct rx_aes_backend {
+    const char *name;
+    void (*fill1r)(uint8_t state[64], size_t size, uint8_t *out);
+    void (*fill4r)(const uint8_t state[64], size_t size, uint8_t *out);
+    void (*hash1r)(const uint8_t *in, size_t size, uint8_t out[64]);
+};
+
+static void rx_fill_aes1r_portable(uint8_t state[64], size_t size, uint8_t *out) {
+    uint32_t s[4][4];
+    memcpy(s, state, 64);
+    for (size_t i = 0; i < size; i += 64) {
+        rx_aesdec(s[0], rx_aes_gen1r_keys[0]);
+        rx_aesenc(s[1], rx_aes_gen1r_keys[1]);
+        rx_aesdec(s[2], rx_aes_gen1r_keys[2]);
+        rx_aesenc(s[3], rx_aes_gen1r_keys[3]);
+        memcpy(out + i, s, 64);
+    }
+    memcpy(state, s, 64);
+}
+
+static void rx_fill_aes4r_portable(const uint8_t state[64], size_t size, uint8_t *out) {
+    uint32_t s[4][4];
+    memcpy(s, state, 64);
+    for (size_t i = 0; i < size; i += 64) {
+        for (int r = 0; r < 4; r++) {
+            rx_aesdec(s[0], rx_aes_gen4r_keys[r]);
+            rx_aesenc(s[1], rx_aes_gen4r_keys[r]);
+            rx_aesdec(s[2], rx_aes_gen4r_keys[4 + r]);
+            rx_aesenc(s[3], rx_aes_gen4r_keys[4 + r]);
+        }
+        memcpy(out + i, s, 64);
+    }
+}
+
+static void rx_hash_aes1r_portable(const uint8_t *in, size_t size, uint8_t out[64]) {
+    uint32_t s[4][4], k[4][4];
+    memcpy(s, rx_aes_hash1r_state, 64);
+    for (size_t i = 0; i < size; i += 64) {
+        memcpy(k, in + i, 64);
+        rx_aesenc(s[0], k[0]);
+        rx_aesdec(s[1], k[1]);
+        rx_aesenc(s[2], k[2]);
+        rx_aesdec(s[3], k[3]);
+    }
+    for (int x = 0; x < 2; x++) {
+        rx_aesenc(s[0], rx_aes_hash1r_xkeys[x]);
+        rx_aesdec(s[1], rx_aes_hash1r_xkeys[x]);
+        rx_aesenc(s[2], rx_aes_hash1r_xkeys[x]);
+        rx_aesdec(s[3], rx_aes_hash1r_xkeys[x]);
+    }
+    memcpy(out, s, 64);
+}
+
+static const struct rx_aes_backend rx_aes_portable = {
+    "portable", rx_fill_aes1r_portable, rx_fill_aes4r_portable, rx_hash_aes1r_portable
+};
+
+#if CN_X86_AESNI
+#define RX_AESNI_LOAD4(v, p)                                                \
+    __m128i v##0 = _mm_loadu_si128((const __m128i *)(p) + 0);               \
+    __m128i v##1 = _mm_loadu_si128((const __m128i *)(p) + 1);               \
+    __m128i v##2 = _mm_loadu_si128((const __m128i *)(p) + 2);               \
+    __m128i v##3 = _mm_loadu_si128((const __m128i *)(p) + 3)
+
+#define RX_AESNI_STORE4(p, v) do {                                          \
+        _mm_storeu_si128((__m128i *)(p) + 0, v##0);                         \
+        _mm_storeu_si128((__m128i *)(p) + 1, v##1);                         \
+        _mm_storeu_si128((__m128i *)(p) + 2, v##2);                         \
+        _mm_storeu_si128((__m128i *)(p) + 3, v##3);                         \
+    } while (0)
+
+CN_AESNI_FN
+static void rx_fill_aes1r_aesni(uint8_t state[64], size_t size, uint8_t *out) {
+    RX_AESNI_LOAD4(s, state);
+    RX_AESNI_LOAD4(k, rx_aes_gen1r_keys);
+    for (size_t i = 0; i < size; i += 64) {
+        s0 = _mm_aesdec_si128(s0, k0);
+        s1 = _mm_aesenc_si128(s1, k1);
+        s2 = _mm_aesdec_si128(s2, k2);
+        s3 = _mm_aesenc_si128(s3, k3);
+        RX_AESNI_STORE4(out + i, s);
+    }
+    RX_AESNI_STORE4(state, s);
+}
+
+CN_AESNI_FN
+static void rx_fill_aes4r_aesni(const uint8_t state[64], size_t size, uint8_t *out) {
+    RX_AESNI_LOAD4(s, state);
+    RX_AESNI_LOAD4(k, rx_aes_gen4r_keys[0]);
+    RX_AESNI_LOAD4(j, rx_aes_gen4r_keys[4]);
+    for (size_t i = 0; i < size; i += 64) {
+        s0 = _mm_aesdec_si128(s0, k0); s1 = _mm_aesenc_si128(s1, k0);
+        s2 = _mm_aesdec_si128(s2, j0); s3 = _mm_aesenc_si128(s3, j0);
+        s0 = _mm_aesdec_si128(s0, k1); s1 = _mm_aesenc_si128(s1, k1);
+        s2 = _mm_aesdec_si128(s2, j1); s3 = _mm_aesenc_si128(s3, j1);
+        s0 = _mm_aesdec_si128(s0, k2); s1 = _mm_aesenc_si128(s1, k2);
+        s2 = _mm_aesdec_si128(s2, j2); s3 = _mm_aesenc_si128(s3, j2);
+        s0 = _mm_aesdec_si128(s0, k3); s1 = _mm_aesenc_si128(s1, k3);
+        s2 = _mm_aesdec_si128(s2, j3); s3 = _mm_aesenc_si128(s3, j3);
+        RX_AESNI_STORE4(out + i, s);
+    }
+}
+
+CN_AESNI_FN
+static void rx_hash_aes1r_aesni(const uint8_t *in, size_t size, uint8_t out[64]) {
+    RX_AESNI_LOAD4(s, rx_aes_hash1r_state);
+    for (size_t i = 0; i < size; i += 64) {
+        RX_AESNI_LOAD4(k, in + i);
+        s0 = _mm_aesenc_si128(s0, k0);
+        s1 = _mm_aesdec_si128(s1, k1);
+        s2 = _mm_aesenc_si128(s2, k2);
+        s3 = _mm_aesdec_si128(s3, k3);
+    }
+    for (int x = 0; x < 2; x++) {
+        const __m128i xk = _mm_loadu_si128((const __m128i *)rx_aes_hash1r_xkeys[x]);
+        s0 = _mm_aesenc_si128(s0, xk);
+        s1 = _mm_aesdec_si128(s1, xk);
+        s2 = _mm_aesenc_si128(s2, xk);
+        s3 = _mm_aesdec_si128(s3, xk);
+    }
+    RX_AESNI_STORE4(out, s);
+}
+
+static const struct rx_aes_backend rx_aes_aesni = {
+    "aesni", rx_fill_aes1r_aesni, rx_fill_aes4r_aesni, rx_hash_aes1r_aesni
+};
+#endif
+
+/** AES implementation for this CPU (cpuid on x86-64), as cn_select_backend(). */
+static const struct rx_aes_backend *rx_select_aes(void) {
+#if CN_X86_AESNI
+    if (__builtin_cpu_supports("aes"))
+        return &rx_aes_aesni;
+#endif
+    return &rx_aes_portable;
+}
+
+/* ======================= Blake2Generator ======================= */
+/*
+ * Byte stream for the superscalar generator: BLAKE2b-512 of the seed
+ * (first 60 bytes) and a 32-bit nonce, rehashed in place whenever the
+ * 64 bytes run out.
+ */
+
+struct rx_blake2_gen {
+    uint8_t  data[64];
+    uint32_t index;
+};
+
+static void rx_blake2_gen_init(struct rx_blake2_gen *g, const uint8_t *seed, uint32_t seed_len,
+                               uint32_t nonce) {
+    memset(g->data, 0, sizeof(g->data));
+    memcpy(g->data, seed, seed_len > 60 ? 60 : seed_len);
+    g->data[60] = (uint8_t)nonce;
+    g->data[61] = (uint8_t)(nonce >> 8);
+    g->data[62] = (uint8_t)(nonce >> 16);
+    g->data[63] = (uint8_t)(nonce >> 24);
+    g->index = sizeof(g->data);
+}
+
+static inline void rx_blake2_gen_need(struct rx_blake2_gen *g, uint32_t n) {
+    if (g->index + n > sizeof(g->data)) {
+        rx_blake2b(g->data, sizeof(g->data), g->data, sizeof(g->data));
+        g->index = 0;
+    }
+}
+
+static uint8_t rx_blake2_gen_byte(struct rx_blake2_gen *g) {
+    rx_blake2_gen_need(g, 1);
+    return g->data[g->index++];
+}
+
+static uint32_t rx_blake2_gen_u32(struct rx_blake2_gen *g) {
+    rx_blake2_gen_need(g, 4);
+    const uint8_t *p = g->data + g->index;
+    g->index += 4;
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ======================== SuperscalarHash ======================== */
+/*
+ * Dataset items are produced by eight random programs of 64-bit integer
+ * ops per cache.  The generator simulates an x86 core (16-byte decode
+ * buffers, ports P0/P1/P5) and emits instructions until the ports are
+ * saturated for RX_SUPERSCALAR_LATENCY cycles, so every choice it makes,
+ * including retries, has to follow the reference exactly.
+ */
+
+enum rx_ss_type {
+    RX_SS_ISUB_R, RX_SS_IXOR_R, RX_SS_IADD_RS, RX_SS_IMUL_R, RX_SS_IROR_C,
+    RX_SS_IADD_C7, RX_SS_IXOR_C7, RX_SS_IADD_C8, RX_SS_IXOR_C8, RX_SS_IADD_C9,
+    RX_SS_IXOR_C9, RX_SS_IMULH_R, RX_SS_ISMULH_R, RX_SS_IMUL_RCP,
+    RX_SS_COUNT,
+    RX_SS_INVALID = -1
+};
+
+/* execution ports a uop may issue on */
+#define RX_P0   1
+#define RX_P1   2
+#define RX_P5   4
+#define RX_P01  (RX_P0 | RX_P1)
+#define RX_P05  (RX_P0 | RX_P5)
+#define RX_P015 (RX_P0 | RX_P1 | RX_P5)
+
+/** An x86 macro-op: latency, one or two uops (0: eliminated mov). */
+struct rx_macro_op {
+    uint8_t latency;
+    uint8_t uop1, uop2;
+    uint8_t dependent;                      /* waits for the previous macro-op */
+};
+
+static const struct rx_macro_op
+    rx_mop_add_rr   = { 1, RX_P015, 0, 0 },
+    rx_mop_imul_r   = { 4, RX_P1, RX_P5, 0 },
+    rx_mop_mov_rr   = { 0, 0, 0, 0 },
+    rx_mop_lea_sib  = { 1, RX_P01, 0, 0 },
+    rx_mop_imul_rr  = { 3, RX_P1, 0, 0 },
+    rx_mop_imul_rr_dep = { 3, RX_P1, 0, 1 },
+    rx_mop_ror_ri   = { 1, RX_P05, 0, 0 },
+    rx_mop_add_ri   = { 1, RX_P015, 0, 0 },
+    rx_mop_mov_ri64 = { 1, RX_P015, 0, 0 };
+
+/** Macro-ops of one instruction; which of them reads src / writes dst. */
+struct rx_ss_info {
+    uint8_t nops;
+    int8_t  result_op, dst_op, src_op;      /* -1: none */
+    const struct rx_macro_op *ops[3];
+};
+
+static const struct rx_ss_info rx_ss_infos[RX_SS_COUNT] = {
+    [RX_SS_ISUB_R]   = { 1, 0, 0, 0,  { &rx_mop_add_rr } },
+    [RX_SS_IXOR_R]   = { 1, 0, 0, 0,  { &rx_mop_add_rr } },
+    [RX_SS_IADD_RS]  = { 1, 0, 0, 0,  { &rx_mop_lea_sib } },
+    [RX_SS_IMUL_R]   = { 1, 0, 0, 0,  { &rx_mop_imul_rr } },
+    [RX_SS_IROR_C]   = { 1, 0, 0, -1, { &rx_mop_ror_ri } },
+    [RX_SS_IADD_C7]  = { 1, 0, 0, -1, { &rx_mop_add_ri } },
+    [RX_SS_IXOR_C7]  = { 1, 0, 0, -1, { &rx_mop_add_ri } },
+    [RX_SS_IADD_C8]  = { 1, 0, 0, -1, { &rx_mop_add_ri } },
+    [RX_SS_IXOR_C8]  = { 1, 0, 0, -1, { &rx_mop_add_ri } },
+    [RX_SS_IADD_C9]  = { 1, 0, 0, -1, { &rx_mop_add_ri } },
+    [RX_SS_IXOR_C9]  = { 1, 0, 0, -1, { &rx_mop_add_ri } },
+    [RX_SS_IMULH_R]  = { 3, 1, 0, 1,  { &rx_mop_mov_rr, &rx_mop_imul_r, &rx_mop_mov_rr } },
+    [RX_SS_ISMULH_R] = { 3, 1, 0, 1,  { &rx_mop_mov_rr, &rx_mop_imul_r, &rx_mop_mov_rr } },
+    [RX_SS_IMUL_RCP] = { 2, 1, 1, -1, { &rx_mop_mov_ri64, &rx_mop_imul_rr_dep } },
+};
+
+static const struct rx_ss_info rx_ss_null_info = { 0, -1, -1, -1, { NULL } };
+
+/** A 16-byte decode cycle: the sizes of its instruction slots. */
+struct rx_decoder_buffer {
+    int index;                              /* fetch type, -1 for the initial one */
+    int size;
+    uint8_t counts[4];
+};
+
+static const struct rx_decoder_buffer rx_decoder_buffers[6] = {
+    { 0, 3, { 4, 8, 4 } },
+    { 1, 4, { 7, 3, 3, 3 } },
+    { 2, 4, { 3, 7, 3, 3 } },
+    { 3, 3, { 4, 9, 3 } },
+    { 4, 4, { 4, 4, 4, 4 } },
+    { 5, 3, { 3, 3, 10 } }
+};
+
+static const struct rx_decoder_buffer rx_decoder_default = { -1, 1, { 16 } };
+
+static inline int rx_ss_is_mul(int type) {
+    return type == RX_SS_IMUL_R || type == RX_SS_IMULH_R || type == RX_SS_ISMULH_R ||
+           type == RX_SS_IMUL_RCP;
+}
+
+static const struct rx_decoder_buffer *rx_ss_fetch_next(int type, int cycle, int mul_count,
+                                                       struct rx_blake2_gen *gen) {
+    if (type == RX_SS_IMULH_R || type == RX_SS_ISMULH_R)
+        return &rx_decoder_buffers[5];      /* 3-3-10 after a high multiply */
+    if (mul_count < cycle + 1)
+        return &rx_decoder_buffers[4];      /* 4-4-4-4 keeps the multiplier busy */
+    if (type == RX_SS_IMUL_RCP)
+        return (rx_blake2_gen_byte(gen) & 1) ? &rx_decoder_buffers[0] : &rx_decoder_buffers[3];
+    return &rx_decoder_buffers[rx_blake2_gen_byte(gen) & 3];
+}
+
+static inline int rx_is_zero_or_pow2(uint64_t x) {
+    return (x & (x - 1)) == 0;
+}
+
+/**
+ * 2^x / divisor for the highest x that keeps the result in 64 bits
+ * (divisor not 0 nor a power of two): IMUL_RCP multiplies by it.
+ */
+static uint64_t rx_reciprocal(uint64_t divisor) {
+    const uint64_t p2exp63 = 1ULL << 63;
+    uint64_t quotient = p2exp63 / divisor, remainder = p2exp63 % divisor;
+    unsigned bsr = 0;
+    for (uint64_t bit = divisor; bit > 0; bit >>= 1)
+        bsr++;
+    for (unsigned shift = 0; shift < bsr; shift++) {
+        if (remainder >= divisor - remainder) {
+            quotient = quotient * 2 + 1;
+            remainder = remainder * 2 - divisor;
+        } else {
+            quotient = quotient * 2;
+            remainder = remainder * 2;
+        }
+    }
+    return quotient;
+}
+
+/** Instruction being issued, with the generator's register constraints. */
+struct rx_ss_instr {
+    int      type;                          /* enum rx_ss_type */
+    int      src, dst;                      /* -1: not selected yet */
+    uint32_t mod, imm32;
+    int      group;
+    int32_t  group_par;
+    int      can_reuse;                     /* dst may equal src */
+    int      group_par_is_source;
+};
+
+struct rx_ss_reg {
+    int     latency;                        /* cycle its value is ready */
+    int     last_group;
+    int32_t last_par;
+};
+
+static const struct rx_ss_info *rx_ss_info_of(const struct rx_ss_instr *ins) {
+    return ins->type == RX_SS_INVALID ? &rx_ss_null_info : &rx_ss_infos[ins->type];
+}
+
+static void rx_ss_create(struct rx_ss_instr *ins, int type, struct rx_blake2_gen *gen) {
+    ins->type = type;
+    ins->src = ins->dst = -1;
+    ins->mod = ins->imm32 = 0;
+    ins->can_reuse = ins->group_par_is_source = 0;
+    ins->group = type;
+    ins->group_par = -1;
+    switch (type) {
+    case RX_SS_ISUB_R:
+        ins->group = RX_SS_IADD_RS;
+        ins->group_par_is_source = 1;
+        break;
+    case RX_SS_IXOR_R:
+    case RX_SS_IMUL_R:
+        ins->group_par_is_source = 1;
+        break;
+    case RX_SS_IADD_RS:
+        ins->mod = rx_blake2_gen_byte(gen);
+        ins->group_par_is_source = 1;
+        break;
+    case RX_SS_IROR_C:
+        do {
+            ins->imm32 = rx_blake2_gen_byte(gen) & 63;
+        } while (ins->imm32 == 0);
+        break;
+    case RX_SS_IADD_C7: case RX_SS_IADD_C8: case RX_SS_IADD_C9:
+        ins->imm32 = rx_blake2_gen_u32(gen);
+        ins->group = RX_SS_IADD_C7;
+        break;
+    case RX_SS_IXOR_C7: case RX_SS_IXOR_C8: case RX_SS_IXOR_C9:
+        ins->imm32 = rx_blake2_gen_u32(gen);
+        ins->group = RX_SS_IXOR_C7;
+        break;
+    case RX_SS_IMULH_R:
+    case RX_SS_ISMULH_R:
+        ins->can_reuse = 1;
+        ins->group_par = (int32_t)rx_blake2_gen_u32(gen);
+        break;
+    case RX_SS_IMUL_RCP:
+        do {
+            ins->imm32 = rx_blake2_gen_u32(gen);
+        } while (rx_is_zero_or_pow2(ins->imm32));
+        break;
+    }
+}
+
+/* Picks an instruction whose first macro-op fits a `size`-byte slot */
+static void rx_ss_create_for_slot(struct rx_ss_instr *ins, struct rx_blake2_gen *gen, int size,
+                                  int fetch_type, int is_last) {
+    static const int slot3[2] = { RX_SS_ISUB_R, RX_SS_IXOR_R };
+    static const int slot3l[4] = { RX_SS_ISUB_R, RX_SS_IXOR_R, RX_SS_IMULH_R, RX_SS_ISMULH_R };
+    static const int slot4[2] = { RX_SS_IROR_C, RX_SS_IADD_RS };
+    static const int slot7[2] = { RX_SS_IXOR_C7, RX_SS_IADD_C7 };
+    static const int slot8[2] = { RX_SS_IXOR_C8, RX_SS_IADD_C8 };
+    static const int slot9[2] = { RX_SS_IXOR_C9, RX_SS_IADD_C9 };
+
+    switch (size) {
+    case 3:
+        if (is_last)
+            rx_ss_create(ins, slot3l[rx_blake2_gen_byte(gen) & 3], gen);
+        else
+            rx_ss_create(ins, slot3[rx_blake2_gen_byte(gen) & 1], gen);
+        break;
+    case 4:
+        /* the 4-4-4-4 buffer issues multiplications in its first 3 slots */
+        if (fetch_type == 4 && !is_last)
+            rx_ss_create(ins, RX_SS_IMUL_R, gen);
+        else
+            rx_ss_create(ins, slot4[rx_blake2_gen_byte(gen) & 1], gen);
+        break;
+    case 7: rx_ss_create(ins, slot7[rx_blake2_gen_byte(gen) & 1], gen); break;
+    case 8: rx_ss_create(ins, slot8[rx_blake2_gen_byte(gen) & 1], gen); break;
+    case 9: rx_ss_create(ins, slot9[rx_blake2_gen_byte(gen) & 1], gen); break;
+    case 10: rx_ss_create(ins, RX_SS_IMUL_RCP, gen); break;
+    }
+}
+
+static int rx_ss_select_register(const int *available, int count, struct rx_blake2_gen *gen,
+                                  int *reg) {
+    if (count == 0) return 0;
+    *reg = available[count > 1 ? rx_blake2_gen_u32(gen) % (uint32_t)count : 0];
+    return 1;
+}
+
+#define RX_REG_NEEDS_DISPLACEMENT 5         /* r5 can't be an IADD_RS destination */
+
+static int rx_ss_select_destination(struct rx_ss_instr *ins, int cycle, int allow_chained_mul,
+                                     const struct rx_ss_reg *regs, struct rx_blake2_gen *gen) {
+    int available[8], n = 0;
+    for (int i = 0; i < 8; i++) {
+        if (regs[i].latency <= cycle &&
+            (ins->can_reuse || i != ins->src) &&
+            (allow_chained_mul || ins->group != RX_SS_IMUL_R || regs[i].last_group != RX_SS_IMUL_R) &&
+            (regs[i].last_group != ins->group || regs[i].last_par != ins->group_par) &&
+            (ins->type != RX_SS_IADD_RS || i != RX_REG_NEEDS_DISPLACEMENT))
+            available[n++] = i;
+    }
+    return rx_ss_select_register(available, n, gen, &ins->dst);
+}
+
+static int rx_ss_select_source(struct rx_ss_instr *ins, int cycle, const struct rx_ss_reg *regs,
+                                struct rx_blake2_gen *gen) {
+    int available[8], n = 0;
+    for (int i = 0; i < 8; i++)
+        if (regs[i].latency <= cycle)
+            available[n++] = i;
+    /* with only two candidates for IADD_RS and one of them r5, r5 must be the source */
+    if (n == 2 && ins->type == RX_SS_IADD_RS &&
+        (available[0] == RX_REG_NEEDS_DISPLACEMENT || available[1] == RX_REG_NEEDS_DISPLACEMENT)) {
+        ins->group_par = ins->src = RX_REG_NEEDS_DISPLACEMENT;
+        return 1;
+    }
+    if (rx_ss_select_register(available, n, gen, &ins->src)) {
+        if (ins->group_par_is_source)
+            ins->group_par = ins->src;
+        return 1;
+    }
+    return 0;
+}
+
+#define RX_SS_CYCLE_MAP_SIZE (RX_SUPERSCALAR_LATENCY + 4)
+#define RX_SS_LOOK_FORWARD   4
+#define RX_SS_MAX_THROWAWAY  256
+
+/* Earliest cycle >= `cycle` with a free port for `uop` (P5, then P0, then P1) */
+static int rx_ss_schedule_uop(uint8_t uop, uint8_t (*busy)[3], int cycle, int commit) {
+    for (; cycle < RX_SS_CYCLE_MAP_SIZE; cycle++) {
+        if ((uop & RX_P5) && !busy[cycle][2]) {
+            if (commit) busy[cycle][2] = uop;
+            return cycle;
+        }
+        if ((uop & RX_P0) && !busy[cycle][0]) {
+            if (commit) busy[cycle][0] = uop;
+            return cycle;
+        }
+        if ((uop & RX_P1) && !busy[cycle][1]) {
+            if (commit) busy[cycle][1] = uop;
+            return cycle;
+        }
+    }
+    return -1;
+}
+
+static int rx_ss_schedule_mop(const struct rx_macro_op *mop, uint8_t (*busy)[3], int cycle,
+                              int dep_cycle, int commit) {
+    if (mop->dependent && dep_cycle > cycle)
+        cycle = dep_cycle;
+    if (!mop->uop1)
+        return cycle;                       /* eliminated */
+    if (!mop->uop2)
+        return rx_ss_schedule_uop(mop->uop1, busy, cycle, commit);
+    /* both uops of a two-uop macro-op must issue in the same cycle */
+    for (; cycle < RX_SS_CYCLE_MAP_SIZE; cycle++) {
+        int c1 = rx_ss_schedule_uop(mop->uop1, busy, cycle, 0);
+        int c2 = rx_ss_schedule_uop(mop->uop2, busy, cycle, 0);
+        if (c1 >= 0 && c1 == c2) {
+            if (commit) {
+                rx_ss_schedule_uop(mop->uop1, busy, c1, 1);
+                rx_ss_schedule_uop(mop->uop2, busy, c2, 1);
+            }
+            return c1;
+        }
+    }
+    return -1;
+}
+
+/** A superscalar instruction ready to execute. */
+struct rx_ss_op {
+    uint8_t  type;                          /* enum rx_ss_type */
+    uint8_t  dst, src;
+    uint8_t  shift;                         /* IADD_RS */
+    uint64_t imm;                           /* sign-extended constant, rotation
+                                               count or reciprocal */
+};
+
+struct rx_ss_program {
+    uint32_t size;
+    uint32_t address_reg;                   /* selects the next cache line */
+    struct rx_ss_op code[RX_SUPERSCALAR_MAX_SIZE];
+};
+
+static void rx_ss_emit(struct rx_ss_program *prog, const struct rx_ss_instr *ins) {
+    struct rx_ss_op *op = &prog->code[prog->size++];
+    op->type = (uint8_t)ins->type;
+    op->dst = (uint8_t)ins->dst;
+    op->src = (uint8_t)(ins->src >= 0 ? ins->src : ins->dst);
+    op->shift = (uint8_t)((ins->mod >> 2) % 4);
+    switch (ins->type) {
+    case RX_SS_IROR_C:   op->imm = ins->imm32; break;
+    case RX_SS_IMUL_RCP: op->imm = rx_reciprocal(ins->imm32); break;
+    default:             op->imm = rx_sign_extend(ins->imm32); break;
+    }
+}
+
+/** Generates one SuperscalarHash program from `gen` (RandomX generateSuperscalar). */
+static void rx_ss_generate(struct rx_ss_program *prog, struct rx_blake2_gen *gen) {
+    uint8_t busy[RX_SS_CYCLE_MAP_SIZE][3];
+    struct rx_ss_reg regs[8];
+    struct rx_ss_instr ins = { RX_SS_INVALID, -1, -1, 0, 0, RX_SS_INVALID, -1, 0, 0 };
+    const struct rx_decoder_buffer *buf = &rx_decoder_default;
+    int mop_index = 0, cycle = 0, dep_cycle = 0, mul_count = 0, throw_away = 0;
+    int ports_saturated = 0;
+
+    memset(busy, 0, sizeof(busy));
+    for (int i = 0; i < 8; i++) {
+        regs[i].latency = 0;
+        regs[i].last_group = RX_SS_INVALID;
+        regs[i].last_par = -1;
+    }
+    prog->size = 0;
+
+    for (int decode_cycle = 0;
+         decode_cycle < RX_SUPERSCALAR_LATENCY && !ports_saturated &&
+         prog->size < RX_SUPERSCALAR_MAX_SIZE;
+         decode_cycle++) {
+        buf = rx_ss_fetch_next(ins.type, decode_cycle, mul_count, gen);
+        int buffer_index = 0;
+
+        while (buffer_index < buf->size) {
+            const int top_cycle = cycle;
+            const struct rx_ss_info *info = rx_ss_info_of(&ins);
+
+            if (mop_index >= info->nops) {
+                if (ports_saturated || prog->size >= RX_SUPERSCALAR_MAX_SIZE)
+                    break;
+                rx_ss_create_for_slot(&ins, gen, buf->counts[buffer_index], buf->index,
+                                      buf->size == buffer_index + 1);
+                info = rx_ss_info_of(&ins);
+                mop_index = 0;
+            }
+
+            const struct rx_macro_op *mop = info->ops[mop_index];
+            int schedule_cycle = rx_ss_schedule_mop(mop, busy, cycle, dep_cycle, 0);
+            if (schedule_cycle < 0) {
+                ports_saturated = 1;
+                break;
+            }
+
+            /* operands must be ready by then; look a few cycles ahead,
+             * otherwise throw the instruction away and try another */
+            if (mop_index == info->src_op) {
+                int forward;
+                for (forward = 0; forward < RX_SS_LOOK_FORWARD &&
+                     !rx_ss_select_source(&ins, schedule_cycle, regs, gen); forward++) {
+                    schedule_cycle++;
+                    cycle++;
+                }
+                if (forward == RX_SS_LOOK_FORWARD) {
+                    if (throw_away < RX_SS_MAX_THROWAWAY) {
+                        throw_away++;
+                        mop_index = info->nops;
+                        continue;
+                    }
+                    ins.type = RX_SS_INVALID;
+                    break;
+                }
+            }
+            if (mop_index == info->dst_op) {
+                int forward;
+                for (forward = 0; forward < RX_SS_LOOK_FORWARD &&
+                     !rx_ss_select_destination(&ins, schedule_cycle, throw_away > 0, regs, gen);
+                     forward++) {
+                    schedule_cycle++;
+                    cycle++;
+                }
+                if (forward == RX_SS_LOOK_FORWARD) {
+                    if (throw_away < RX_SS_MAX_THROWAWAY) {
+                        throw_away++;
+                        mop_index = info->nops;
+                        continue;
+                    }
+                    ins.type = RX_SS_INVALID;
+                    break;
+                }
+            }
+            throw_away = 0;
+
+            schedule_cycle = rx_ss_schedule_mop(mop, busy, schedule_cycle, schedule_cycle, 1);
+            if (schedule_cycle < 0) {
+                ports_saturated = 1;
+                break;
+            }
+            dep_cycle = schedule_cycle + mop->latency;
+
+            if (mop_index == info->result_op) {
+                struct rx_ss_reg *ri = &regs[ins.dst];
+                ri->latency = dep_cycle;
+                ri->last_group = ins.group;
+                ri->last_par = ins.group_par;
+            }
+
+            buffer_index++;
+            mop_index++;
+            if (schedule_cycle >= RX_SUPERSCALAR_LATENCY)
+                ports_saturated = 1;
+            cycle = top_cycle;
+
+            if (mop_index >= info->nops) {
+                rx_ss_emit(prog, &ins);
+                mul_count += rx_ss_is_mul(ins.type);
+            }
+        }
+        cycle++;
+    }
+
+    /* the address register is the one with the longest dependency chain */
+    int latency[8] = { 0 }, max_latency = 0;
+    prog->address_reg = 0;
+    for (uint32_t i = 0; i < prog->size; i++) {
+        const struct rx_ss_op *op = &prog->code[i];
+        int lat_dst = latency[op->dst] + 1;
+        int lat_src = op->dst != op->src ? latency[op->src] + 1 : 0;
+        latency[op->dst] = lat_dst > lat_src ? lat_dst : lat_src;
+    }
+    for (int i = 0; i < 8; i++) {
+        if (latency[i] > max_latency) {
+            max_latency = latency[i];
+            prog->address_reg = (uint32_t)i;
+        }
+    }
+}
+
+static inline void rx_ss_execute(uint64_t r[8], const struct rx_ss_program *prog) {
+    for (uint32_t i = 0; i < prog->size; i++) {
+        const struct rx_ss_op *op = &prog->code[i];
+        uint64_t *dst = &r[op->dst];
+        switch (op->type) {
+        case RX_SS_ISUB_R:   *dst -= r[op->src]; break;
+        case RX_SS_IXOR_R:   *dst ^= r[op->src]; break;
+        case RX_SS_IADD_RS:  *dst += r[op->src] << op->shift; break;
+        case RX_SS_IMUL_R:   *dst *= r[op->src]; break;
+        case RX_SS_IROR_C:   *dst = rx_rotr64(*dst, (unsigned)op->imm); break;
+        case RX_SS_IADD_C7: case RX_SS_IADD_C8: case RX_SS_IADD_C9:
+            *dst += op->imm;
+            break;
+        case RX_SS_IXOR_C7: case RX_SS_IXOR_C8: case RX_SS_IXOR_C9:
+            *dst ^= op->imm;
+            break;
+        case RX_SS_IMULH_R:  *dst = rx_mulh(*dst, r[op->src]); break;
+        case RX_SS_ISMULH_R: *dst = rx_smulh(*dst, r[op->src]); break;
+        case RX_SS_IMUL_RCP: *dst *= op->imm; break;
+        }
+    }
+}
+
+/* ============================= Cache ============================= */
+
+struct rx_cache {
+    uint8_t *memory;                        /* RX_CACHE_SIZE bytes of Argon2d output */
+    size_t   memory_size;                   /* bytes reserved at `memory` */
+    uint32_t memory_kind;                   /* enum cn_mem_kind */
+    uint32_t seed_len;                      /* 0: not initialised */
+    uint8_t  seed[RX_MAX_SEED];
+    struct rx_ss_program programs[RX_CACHE_ACCESSES];
+};
+
+typedef struct rx_cache rx_cache;
+
+/** A cache with memory reserved but no seed yet; NULL when out of memory. */
+EMSCRIPTEN_KEEPALIVE
+rx_cache *rx_cache_create(void) {
+    rx_cache *cache = (rx_cache *)calloc(1, sizeof(*cache));
+    if (!cache) return NULL;
+    cache->memory = cn_mem_alloc(RX_CACHE_SIZE, &cache->memory_size, &cache->memory_kind);
+    if (!cache->memory) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static void rx_cache_set_seed(rx_cache *cache, const uint8_t *seed, uint32_t seed_len) {
+    struct rx_blake2_gen gen;
+    rx_blake2_gen_init(&gen, seed, seed_len, 0);
+    for (int i = 0; i < RX_CACHE_ACCESSES; i++)
+        rx_ss_generate(&cache->programs[i], &gen);
+    memcpy(cache->seed, seed, seed_len);
+    cache->seed_len = seed_len;
+}
+
+static int rx_cache_has_seed(const rx_cache *cache, const uint8_t *seed, uint32_t seed_len) {
+    return cache->seed_len == seed_len && !memcmp(cache->seed, seed, seed_len);
+}
+
+/**
+ * Fills the cache for `seed` (1..RX_MAX_SEED bytes): Argon2d over 256 MB,
+ * then the superscalar programs.  Seconds of work, so a cache already
+ * holding `seed` is left as is.  Contexts using the cache must not hash
+ * while it is rebuilt.  Returns 0 for an unusable seed length.
+ */
+EMSCRIPTEN_KEEPALIVE
+int rx_cache_init(rx_cache *cache, const uint8_t *seed, uint32_t seed_len) {
+    if (seed_len == 0 || seed_len > RX_MAX_SEED) return 0;
+    if (rx_cache_has_seed(cache, seed, seed_len)) return 1;
+    cache->seed_len = 0;
+    rx_argon2d((uint64_t *)cache->memory, RX_ARGON_MEMORY, RX_ARGON_ITERATIONS, RX_ARGON_LANES,
+               seed, seed_len, RX_ARGON_SALT, sizeof(RX_ARGON_SALT) - 1,
+               NULL, 0, NULL, 0, NULL, 0);
+    rx_cache_set_seed(cache, seed, seed_len);
+    return 1;
+}
+
+/**
+ * Adopts memory filled elsewhere: the caller has copied the Argon2d output
+ * of another cache initialised with `seed` into rx_cache_memory().  Only
+ * the superscalar programs (milliseconds) are regenerated.
+ */
+EMSCRIPTEN_KEEPALIVE
+int rx_cache_import(rx_cache *cache, const uint8_t *seed, uint32_t seed_len) {
+    if (seed_len == 0 || seed_len > RX_MAX_SEED) return 0;
+    rx_cache_set_seed(cache, seed, seed_len);
+    return 1;
+}
+
+/** The cache's Argon2d memory (rx_cache_size() bytes), for copying between instances. */
+EMSCRIPTEN_KEEPALIVE
+uint8_t *rx_cache_memory(rx_cache *cache) {
+    return cache->memory;
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint32_t rx_cache_size(void) {
+    return (uint32_t)RX_CACHE_SIZE;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void rx_cache_destroy(rx_cache *cache) {
+    if (!cache) return;
+    cn_mem_free(cache->memory, cache->memory_size, cache->memory_kind);
+    free(cache);
+}
+
+static const uint64_t rx_ss_mul0 = 6364136223846793005ULL;
+static const uint64_t rx_ss_add[8] = {
+    0, 9298411001130361340ULL, 12065312585734608966ULL, 9306329213124626780ULL,
+    5281919268842080866ULL, 10536153434571861004ULL, 3398623926847679864ULL,
+    9549104520008361294ULL
+};
+
+/** Dataset item `item` (64 bytes) computed from the cache. */
+static void rx_dataset_item(const rx_cache *cache, uint64_t item, uint64_t out[8]) {
+    uint64_t r[8];
+    uint64_t reg_value = item;
+
+    r[0] = (item + 1) * rx_ss_mul0;
+    for (int i = 1; i < 8; i++)
+        r[i] = r[0] ^ rx_ss_add[i];
+    for (int i = 0; i < RX_CACHE_ACCESSES; i++) {
+        const uint8_t *mix = cache->memory + (reg_value & RX_CACHE_LINE_MASK) * RX_CACHE_LINE_SIZE;
+        const struct rx_ss_program *prog = &cache->programs[i];
+        rx_ss_execute(r, prog);
+        for (int q = 0; q < 8; q++)
+            r[q] ^= rx_load64(mix + 8 * q);
+        reg_value = r[prog->address_reg];
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+/* ====================== Dataset (full mode) ====================== */
+/*
+ * Full mode computes all RX_DATASET_ITEMS items (2080 MB) up front, so the
+ * VM reads one cache line per iteration instead of running the eight
+ * SuperscalarHash programs behind rx_dataset_item().  Items only depend on
+ * the cache, so after the (single-lane, sequential) Argon2d fill they are
+ * computed in contiguous ranges, one per thread.  The memory comes from
+ * cn_mem_alloc(): hugetlb or THP pages when available, which matter more
+ * here than for scratchpads since every VM iteration reads a random line
+ * of the 2 GB.
+ *
+ * rx_full double-buffers datasets across seed-hash changes: its builder
+ * thread fills the spare dataset while contexts keep hashing with the
+ * current one, and they move over with rx_full_acquire() once it is ready.
+ */
+#if RX_FULL_MODE
+
+#define RX_DATASET_SIZE      ((size_t)RX_DATASET_ITEMS * RX_CACHE_LINE_SIZE)
+#define RX_MAX_INIT_THREADS  256
+
+struct rx_dataset {
+    uint8_t  *memory;                       /* RX_DATASET_SIZE bytes */
+    size_t    memory_size;                  /* bytes reserved at `memory` */
+    uint32_t  memory_kind;                  /* enum cn_mem_kind */
+    uint32_t  ready;                        /* items match cache's seed */
+    rx_cache *cache;                        /* the items' source */
+};
+
+typedef struct rx_dataset rx_dataset;
+
+struct rx_fill_range {
+    pthread_t       thread;
+    const rx_cache *cache;
+    uint8_t        *memory;                 /* where item `start` goes */
+    uint64_t        start;
+    uint64_t        count;
+};
+
+static void *rx_fill_thread(void *arg) {
+    const struct rx_fill_range *fr = (const struct rx_fill_range *)arg;
+    for (uint64_t i = 0; i < fr->count; i++)
+        rx_dataset_item(fr->cache, fr->start + i,
+                        (uint64_t *)(fr->memory + i * RX_CACHE_LINE_SIZE));
+    return NULL;
+}
+
+/* Items [start, start + count) into `memory`, split into `threads` ranges.
+ * The calling thread computes the last range, and any range whose thread
+ * could not be started. */
+static void rx_dataset_fill(const rx_cache *cache, uint8_t *memory, uint64_t start,
+                            uint64_t count, uint32_t threads) {
+    struct rx_fill_range ranges[RX_MAX_INIT_THREADS];
+    int started[RX_MAX_INIT_THREADS];
+    uint64_t begin = 0;
+
+    if (threads == 0) threads = 1;
+    if (threads > RX_MAX_INIT_THREADS) threads = RX_MAX_INIT_THREADS;
+    for (uint32_t t = 0; t < threads; t++) {
+        const uint64_t end = count * (t + 1) / threads;
+        ranges[t].cache = cache;
+        ranges[t].memory = memory + begin * RX_CACHE_LINE_SIZE;
+        ranges[t].start = start + begin;
+        ranges[t].count = end - begin;
+        begin = end;
+        started[t] = t + 1 < threads &&
+                     pthread_create(&ranges[t].thread, NULL, rx_fill_thread, &ranges[t]) == 0;
+        if (!started[t] && t + 1 < threads)
+            rx_fill_thread(&ranges[t]);
+    }
+    rx_fill_thread(&ranges[threads - 1]);
+    for (uint32_t t = 0; t + 1 < threads; t++)
+        if (started[t])
+            pthread_join(ranges[t].thread, NULL);
+}
+
+/* 0 → one thread per online CPU */
+static uint32_t rx_init_threads(uint32_t threads) {
+    if (threads == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t)online : 1;
+    }
+    return threads < RX_MAX_INIT_THREADS ? threads : RX_MAX_INIT_THREADS;
+}
+
+/** A dataset with its memory and cache reserved; NULL when out of memory. */
+rx_dataset *rx_dataset_create(void) {
+    rx_dataset *ds = (rx_dataset *)calloc(1, sizeof(*ds));
+    if (!ds) return NULL;
+    ds->cache = rx_cache_create();
+    if (ds->cache)
+        ds->memory = cn_mem_alloc(RX_DATASET_SIZE, &ds->memory_size, &ds->memory_kind);
+    if (!ds->memory) {
+        rx_cache_destroy(ds->cache);
+        free(ds);
+        return NULL;
+    }
+    return ds;
+}
+
+/**
+ * Builds the dataset for `seed`: the cache, then every item split over
+ * `threads` threads (0: one per online CPU).  A dataset already holding
+ * `seed` is left as is.  Contexts using the dataset must not hash while
+ * it is rebuilt (rx_full rebuilds a spare one instead).  Returns 0 for an
+ * unusable seed length.
+ */
+int rx_dataset_init(rx_dataset *ds, const uint8_t *seed, uint32_t seed_len, uint32_t threads) {
+    if (seed_len == 0 || seed_len > RX_MAX_SEED) return 0;
+    if (ds->ready && rx_cache_has_seed(ds->cache, seed, seed_len)) return 1;
+    ds->ready = 0;
+    rx_cache_init(ds->cache, seed, seed_len);
+    rx_dataset_fill(ds->cache, ds->memory, 0, RX_DATASET_ITEMS, rx_init_threads(threads));
+    ds->ready = 1;
+    return 1;
+}
+
+uint64_t rx_dataset_size(void) {
+    return RX_DATASET_SIZE;
+}
+
+/** Backing of the dataset's memory: "hugetlb", "thp" or "aligned". */
+const char *rx_dataset_memory_kind(const rx_dataset *ds) {
+    return cn_mem_kind_names[ds->memory_kind];
+}
+
+void rx_dataset_destroy(rx_dataset *ds) {
+    if (!ds) return;
+    cn_mem_free(ds->memory, ds->memory_size, ds->memory_kind);
+    rx_cache_destroy(ds->cache);
+    free(ds);
+}
+
+static double rx_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+struct rx_full_slot {
+    rx_dataset *ds;                         /* allocated by its first build */
+    uint32_t    ready;                      /* ds may be acquired */
+    uint32_t    readers;                    /* rx_full_acquire() holds on ds */
+};
+
+/** Two datasets: the one contexts hash with, and the spare the builder fills. */
+struct rx_full {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;                   /* build requested/finished, dataset released */
+    pthread_t       builder;
+    uint32_t        threads;                /* dataset init threads (0: all CPUs) */
+    struct rx_full_slot slot[2];
+    int             current;                /* slot built last, -1: none yet */
+    uint32_t        want_len;               /* seed requested of the builder, 0: none */
+    uint8_t         want[RX_MAX_SEED];
+    uint32_t        building_len;           /* seed being built, 0: idle */
+    uint8_t         building[RX_MAX_SEED];
+    uint32_t        failed;                 /* last build ran out of memory */
+    uint32_t        quit;
+    double          init_seconds;           /* last build, cache included */
+};
+
+typedef struct rx_full rx_full;
+
+static struct rx_full_slot *rx_full_find(rx_full *f, const uint8_t *seed, uint32_t seed_len) {
+    for (int s = 0; s < 2; s++)
+        if (f->slot[s].ready && rx_cache_has_seed(f->slot[s].ds->cache, seed, seed_len))
+            return &f->slot[s];
+    return NULL;
+}
+
+static void *rx_full_builder(void *arg) {
+    rx_full *f = (rx_full *)arg;
+
+    pthread_mutex_lock(&f->lock);
+    for (;;) {
+        while (!f->quit && !f->want_len)
+            pthread_cond_wait(&f->cond, &f->lock);
+        if (f->quit) break;
+        memcpy(f->building, f->want, f->want_len);
+        f->building_len = f->want_len;
+        f->want_len = 0;
+
+        /* Rebuild the slot not serving the newest seed, once contexts
+         * still on it (the seed before last) have released it */
+        struct rx_full_slot *s = &f->slot[f->current == 0];
+        s->ready = 0;
+        while (!f->quit && s->readers)
+            pthread_cond_wait(&f->cond, &f->lock);
+        if (f->quit) break;
+        pthread_mutex_unlock(&f->lock);
+
+        const double t0 = rx_seconds();
+        if (!s->ds) s->ds = rx_dataset_create();
+        const int ok = s->ds && rx_dataset_init(s->ds, f->building, f->building_len, f->threads);
+        const double seconds = rx_seconds() - t0;
+
+        pthread_mutex_lock(&f->lock);
+        f->building_len = 0;
+        f->failed = !ok;
+        if (ok) {
+            s->ready = 1;
+            f->current = (int)(s - f->slot);
+            f->init_seconds = seconds;
+        }
+        pthread_cond_broadcast(&f->cond);
+    }
+    f->building_len = 0;
+    pthread_mutex_unlock(&f->lock);
+    return NULL;
+}
+
+/**
+ * A full-mode dataset holder whose builder thread initialises datasets
+ * with `threads` threads (0: one per online CPU).  No memory is reserved
+ * until the first rx_full_prepare(); the second dataset only when the
+ * seed hash first changes.  NULL when out of memory or threads.
+ */
+rx_full *rx_full_create(uint32_t threads) {
+    rx_full *f = (rx_full *)calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->threads = threads;
+    f->current = -1;
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->cond, NULL);
+    if (pthread_create(&f->builder, NULL, rx_full_builder, f)) {
+        pthread_cond_destroy(&f->cond);
+        pthread_mutex_destroy(&f->lock);
+        free(f);
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * Starts building the dataset for `seed` in the background, unless it is
+ * built or being built already.  A newer request replaces one the builder
+ * has not started yet.  Returns 0 for an unusable seed length.
+ */
+int rx_full_prepare(rx_full *f, const uint8_t *seed, uint32_t seed_len) {
+    if (seed_len == 0 || seed_len > RX_MAX_SEED) return 0;
+    pthread_mutex_lock(&f->lock);
+    const int building = f->building_len == seed_len && !memcmp(f->building, seed, seed_len);
+    if (!building && !rx_full_find(f, seed, seed_len)) {
+        memcpy(f->want, seed, seed_len);
+        f->want_len = seed_len;
+        pthread_cond_broadcast(&f->cond);
+    }
+    pthread_mutex_unlock(&f->lock);
+    return 1;
+}
+
+/** Blocks until the builder is idle; 0 when its last build ran out of memory. */
+int rx_full_wait(rx_full *f) {
+    pthread_mutex_lock(&f->lock);
+    while (f->want_len || f->building_len)
+        pthread_cond_wait(&f->cond, &f->lock);
+    const int ok = !f->failed;
+    pthread_mutex_unlock(&f->lock);
+    return ok;
+}
+
+/**
+ * The built dataset for `seed`, held until rx_full_release(), or NULL
+ * when it is not ready (see rx_full_prepare).  A held dataset is never
+ * rebuilt, so contexts can hash with it while its successor is built.
+ */
+const rx_dataset *rx_full_acquire(rx_full *f, const uint8_t *seed, uint32_t seed_len) {
+    pthread_mutex_lock(&f->lock);
+    struct rx_full_slot *s = rx_full_find(f, seed, seed_len);
+    if (s) s->readers++;
+    pthread_mutex_unlock(&f->lock);
+    return s ? s->ds : NULL;
+}
+
+void rx_full_release(rx_full *f, const rx_dataset *ds) {
+    pthread_mutex_lock(&f->lock);
+    for (int s = 0; s < 2; s++) {
+        if (f->slot[s].ds == ds && f->slot[s].readers && --f->slot[s].readers == 0)
+            pthread_cond_broadcast(&f->cond);
+    }
+    pthread_mutex_unlock(&f->lock);
+}
+
+/** Seconds the last completed build took (cache and dataset), 0 before the first. */
+double rx_full_init_seconds(rx_full *f) {
+    pthread_mutex_lock(&f->lock);
+    const double seconds = f->init_seconds;
+    pthread_mutex_unlock(&f->lock);
+    return seconds;
+}
+
+/** Stops the builder (waiting for a build in progress) and frees both datasets. */
+void rx_full_destroy(rx_full *f) {
+    if (!f) return;
+    pthread_mutex_lock(&f->lock);
+    f->quit = 1;
+    pthread_cond_broadcast(&f->cond);
+    pthread_mutex_unlock(&f->lock);
+    pthread_join(f->builder, NULL);
+    for (int s = 0; s < 2; s++)
+        rx_dataset_destroy(f->slot[s].ds);
+    pthread_cond_destroy(&f->cond);
+    pthread_mutex_destroy(&f->lock);
+    free(f);
+}
+
+#endif /* RX_FULL_MODE */
+
+/* ====================== Floating-point rounding ====================== */
+/*
+ * CFROUND selects one of RandomX's rounding modes for FADD/FSUB/FMUL/FDIV
+ * and FSQRT.  Without hardware control the round-to-nearest result is
+ * corrected with its exact error (TwoSum, Dekker's TwoProduct, residuals
+ * for division and square root): a nonzero error says which side of the
+ * result the exact value lies on, so directed modes move one ulp.  E
+ * registers do overflow (FMUL_R and FDIV_M grow them without bound): the
+ * directed modes then stop at the largest finite value, and huge operands
+ * are scaled by a power of two so Dekker's splitting stays finite.  They
+ * never get small enough for the error terms to underflow.
+ */
+
+enum rx_rounding { RX_ROUND_NEAREST, RX_ROUND_DOWN, RX_ROUND_UP, RX_ROUND_ZERO };
+
+static inline uint64_t rx_dbits(double x) {
+    uint64_t u;
+    memcpy(&u, &x, 8);
+    return u;
+}
+
+static inline double rx_dfrom(uint64_t u) {
+    double x;
+    memcpy(&x, &u, 8);
+    return x;
+}
+
+static inline double rx_next_up(double x) {
+    if (x == 0) return rx_dfrom(1);
+    return rx_dfrom(x > 0 ? rx_dbits(x) + 1 : rx_dbits(x) - 1);
+}
+
+static inline double rx_next_down(double x) {
+    if (x == 0) return -rx_dfrom(1);
+    return rx_dfrom(x > 0 ? rx_dbits(x) - 1 : rx_dbits(x) + 1);
+}
+
+/* RN(exact) overflowed to +-inf: where the directed modes stop instead */
+static inline double rx_round_overflow(double p, uint32_t mode) {
+    if (mode == RX_ROUND_ZERO || (mode == RX_ROUND_DOWN && p > 0) || (mode == RX_ROUND_UP && p < 0))
+        return p > 0 ? DBL_MAX : -DBL_MAX;
+    return p;
+}
+
+/* p = RN(exact) and `err` has the sign of exact - p */
+static inline double rx_round_directed(double p, double err, uint32_t mode) {
+    if (err == 0) return p;
+    switch (mode) {
+    case RX_ROUND_DOWN: return err < 0 ? rx_next_down(p) : p;
+    case RX_ROUND_UP:   return err > 0 ? rx_next_up(p) : p;
+    case RX_ROUND_ZERO:
+        if (p > 0 && err < 0) return rx_next_down(p);
+        if (p < 0 && err > 0) return rx_next_up(p);
+        return p;
+    default:            return p;
+    }
+}
+
+/* Dekker's exact product: a * b = *p + *e */
+static inline void rx_two_product(double a, double b, double *p, double *e) {
+    const double split = 134217729.0;       /* 2^27 + 1 */
+    double t = a * split, ah = t - (t - a), al = a - ah;
+    t = b * split;
+    double bh = t - (t - b), bl = b - bh;
+    *p = a * b;
+    *e = ((ah * bh - *p) + ah * bl + al * bh) + al * bl;
+}
+
+static inline double rx_fadd_soft(double a, double b, uint32_t mode) {
+    const double s = a + b;
+    if (mode == RX_ROUND_NEAREST) return s;
+    if (s == 0) {
+        /* exact zero: -0 when rounding down, unless both addends are +0 */
+        if (mode == RX_ROUND_DOWN && !(a == 0 && b == 0 && !signbit(a) && !signbit(b)))
+            return -0.0;
+        return s;
+    }
+    if (isinf(s))
+        return isinf(a) || isinf(b) ? s : rx_round_overflow(s, mode);
+    const double bb = s - a;
+    const double err = (a - (s - bb)) + (b - bb);   /* TwoSum */
+    return rx_round_directed(s, err, mode);
+}
+
+static inline double rx_fsub_soft(double a, double b, uint32_t mode) {
+    return rx_fadd_soft(a, -b, mode);
+}
+
+static inline double rx_fmul_soft(double a, double b, uint32_t mode) {
+    const double p = a * b;
+    if (mode == RX_ROUND_NEAREST) return p;
+    if (isinf(p))
+        return isinf(a) || isinf(b) ? p : rx_round_overflow(p, mode);
+    /* scaling by 2^-64 is exact and leaves the error's sign alone */
+    double ps, e;
+    rx_two_product(fabs(a) > 0x1p995 ? a * 0x1p-64 : a,
+                   fabs(b) > 0x1p995 ? b * 0x1p-64 : b, &ps, &e);
+    return rx_round_directed(p, e, mode);
+}
+
+static inline double rx_fdiv_soft(double a, double b, uint32_t mode) {
+    const double q = a / b;
+    if (mode == RX_ROUND_NEAREST) return q;
+    if (isinf(q))
+        return isinf(a) || b == 0 ? q : rx_round_overflow(q, mode);
+    /* divisors are E-group values (|b| < 2): only q and a need scaling */
+    double as = a, qs = q, p, e;
+    if (fabs(q) > 0x1p995 || fabs(a) > 0x1p995) {
+        as = a * 0x1p-128;
+        qs = q * 0x1p-128;
+    }
+    rx_two_product(qs, b, &p, &e);
+    const double rem = (as - p) - e;        /* a - q*b (scaled), exact */
+    return rx_round_directed(q, b < 0 ? -rem : rem, mode);
+}
+
+static inline double rx_fsqrt_soft(double x, uint32_t mode) {
+    const double s = sqrt(x);
+    if (mode == RX_ROUND_NEAREST) return s;
+    /* s * s must stay finite: scale both sides by even powers of two */
+    const double xs = x > 0x1p995 ? x * 0x1p-512 : x;
+    const double ss = x > 0x1p995 ? s * 0x1p-256 : s;
+    double p, e;
+    rx_two_product(ss, ss, &p, &e);
+    return rx_round_directed(s, (xs - p) - e, mode);
+}
+
+#if RX_HW_ROUNDING
+static inline void rx_set_rounding(uint32_t mode) {
+    static const int fe_modes[4] = { FE_TONEAREST, FE_DOWNWARD, FE_UPWARD, FE_TOWARDZERO };
+    fesetround(fe_modes[mode]);
+}
+
+static inline double rx_fadd(double a, double b, uint32_t mode)  { (void)mode; return a + b; }
+static inline double rx_fsub(double a, double b, uint32_t mode)  { (void)mode; return a - b; }
+static inline double rx_fmul(double a, double b, uint32_t mode)  { (void)mode; return a * b; }
+static inline double rx_fdiv(double a, double b, uint32_t mode)  { (void)mode; return a / b; }
+static inline double rx_fsqrt(double x, uint32_t mode)           { (void)mode; return sqrt(x); }
+#else
+static inline void rx_set_rounding(uint32_t mode) { (void)mode; }
+
+#define rx_fadd  rx_fadd_soft
+#define rx_fsub  rx_fsub_soft
+#define rx_fmul  rx_fmul_soft
+#define rx_fdiv  rx_fdiv_soft
+#define rx_fsqrt rx_fsqrt_soft
+#endif
+
+/* ============================ VM ============================ */
+
+/* Instruction types as decoded: register/immediate forms of one RandomX
+ * instruction are split so the interpreter never tests src == dst */
+enum rx_op {
+    RX_OP_IADD_RS, RX_OP_IADD_M, RX_OP_ISUB_R, RX_OP_ISUB_I, RX_OP_ISUB_M,
+    RX_OP_IMUL_R, RX_OP_IMUL_I, RX_OP_IMUL_M, RX_OP_IMULH_R, RX_OP_IMULH_M,
+    RX_OP_ISMULH_R, RX_OP_ISMULH_M, RX_OP_INEG_R, RX_OP_IXOR_R, RX_OP_IXOR_I,
+    RX_OP_IXOR_M, RX_OP_IROR_R, RX_OP_IROR_I, RX_OP_IROL_R, RX_OP_IROL_I,
+    RX_OP_ISWAP_R, RX_OP_FSWAP_R, RX_OP_FADD_R, RX_OP_FADD_M, RX_OP_FSUB_R,
+    RX_OP_FSUB_M, RX_OP_FSCAL_R, RX_OP_FMUL_R, RX_OP_FDIV_M, RX_OP_FSQRT_R,
+    RX_OP_CBRANCH, RX_OP_CFROUND, RX_OP_ISTORE, RX_OP_NOP
+};
+
+/* Cumulative opcode frequencies (out of 256), in RandomX's order */
+enum {
+    RX_CEIL_IADD_RS  = 16,
+    RX_CEIL_IADD_M   = RX_CEIL_IADD_RS + 7,
+    RX_CEIL_ISUB_R   = RX_CEIL_IADD_M + 16,
+    RX_CEIL_ISUB_M   = RX_CEIL_ISUB_R + 7,
+    RX_CEIL_IMUL_R   = RX_CEIL_ISUB_M + 16,
+    RX_CEIL_IMUL_M   = RX_CEIL_IMUL_R + 4,
+    RX_CEIL_IMULH_R  = RX_CEIL_IMUL_M + 4,
+    RX_CEIL_IMULH_M  = RX_CEIL_IMULH_R + 1,
+    RX_CEIL_ISMULH_R = RX_CEIL_IMULH_M + 4,
+    RX_CEIL_ISMULH_M = RX_CEIL_ISMULH_R + 1,
+    RX_CEIL_IMUL_RCP = RX_CEIL_ISMULH_M + 8,
+    RX_CEIL_INEG_R   = RX_CEIL_IMUL_RCP + 2,
+    RX_CEIL_IXOR_R   = RX_CEIL_INEG_R + 15,
+    RX_CEIL_IXOR_M   = RX_CEIL_IXOR_R + 5,
+    RX_CEIL_IROR_R   = RX_CEIL_IXOR_M + 8,
+    RX_CEIL_IROL_R   = RX_CEIL_IROR_R + 2,
+    RX_CEIL_ISWAP_R  = RX_CEIL_IROL_R + 4,
+    RX_CEIL_FSWAP_R  = RX_CEIL_ISWAP_R + 4,
+    RX_CEIL_FADD_R   = RX_CEIL_FSWAP_R + 16,
+    RX_CEIL_FADD_M   = RX_CEIL_FADD_R + 5,
+    RX_CEIL_FSUB_R   = RX_CEIL_FADD_M + 16,
+    RX_CEIL_FSUB_M   = RX_CEIL_FSUB_R + 5,
+    RX_CEIL_FSCAL_R  = RX_CEIL_FSUB_M + 6,
+    RX_CEIL_FMUL_R   = RX_CEIL_FSCAL_R + 32,
+    RX_CEIL_FDIV_M   = RX_CEIL_FMUL_R + 4,
+    RX_CEIL_FSQRT_R  = RX_CEIL_FDIV_M + 6,
+    RX_CEIL_CBRANCH  = RX_CEIL_FSQRT_R + 25,
+    RX_CEIL_CFROUND  = RX_CEIL_CBRANCH + 1,
+    RX_CEIL_ISTORE   = RX_CEIL_CFROUND + 16
+};
+
+/**
+ * A decoded instruction.  Integer operands index r[0..8], r[8] being a
+ * constant zero (memory operands with src == dst use an absolute
+ * address); float operands index fp[0..11] (f0-3, e0-3, a0-3).
+ */
+struct rx_vm_op {
+    uint8_t  type;                          /* enum rx_op */
+    uint8_t  dst, src;
+    uint8_t  shift;                         /* IADD_RS */
+    int32_t  target;                        /* CBRANCH: jump to target + 1 */
+    uint32_t mask;                          /* scratchpad or branch condition mask */
+    uint64_t imm;
+};
+
+/**
+ * The register file as RandomX hashes it between programs: r0-r7, then
+ * f0-f3, e0-e3 and a0-a3 as {lo, hi} pairs of doubles (256 bytes).
+ */
+struct rx_regfile {
+    uint64_t r[8];
+    double   fp[12][2];
+};
+
+struct rx_vm {
+    union {
+        uint8_t  b[RX_PROGRAM_BYTES];
+        uint64_t entropy[16];               /* followed by 256 8-byte instructions */
+    } program;
+    struct rx_vm_op code[RX_PROGRAM_SIZE];
+    struct rx_regfile reg;
+    uint64_t emask[2];                      /* E-group exponent/mantissa bits */
+    uint64_t dataset_offset;
+    uint32_t ma, mx;
+    uint32_t read_reg[4];
+    uint32_t rounding;                      /* enum rx_rounding set by CFROUND */
+};
+
+static uint64_t rx_small_positive_float_bits(uint64_t entropy) {
+    uint64_t exponent = ((entropy >> 59) + 1023) & 2047;
+    return (exponent << 52) | (entropy & ((1ULL << 52) - 1));
+}
+
+static uint64_t rx_float_mask(uint64_t entropy) {
+    const uint64_t exponent = 0x300 | ((entropy >> 60) << 4);
+    return (entropy & ((1ULL << 22) - 1)) | (exponent << 52);
+}
+
+/* Program entropy → a registers, memory registers and E masks (RandomX initialize()) */
+static void rx_vm_init(struct rx_vm *vm) {
+    const uint64_t *entropy = vm->program.entropy;
+    for (int i = 0; i < 4; i++) {
+        vm->reg.fp[8 + i][0] = rx_dfrom(rx_small_positive_float_bits(entropy[2 * i]));
+        vm->reg.fp[8 + i][1] = rx_dfrom(rx_small_positive_float_bits(entropy[2 * i + 1]));
+    }
+    vm->ma = (uint32_t)(entropy[8] & RX_CACHE_LINE_ALIGN_MASK);
+    vm->mx = (uint32_t)entropy[10];
+    uint64_t address_regs = entropy[12];
+    for (uint32_t i = 0; i < 4; i++) {
+        vm->read_reg[i] = 2 * i + (uint32_t)(address_regs & 1);
+        address_regs >>= 1;
+    }
+    vm->dataset_offset = (entropy[13] % (RX_DATASET_EXTRA_ITEMS + 1)) * RX_CACHE_LINE_SIZE;
+    vm->emask[0] = rx_float_mask(entropy[14]);
+    vm->emask[1] = rx_float_mask(entropy[15]);
+}
+
+/* Decodes the program bytes into vm->code (RandomX's bytecode compiler) */
+static void rx_vm_compile(struct rx_vm *vm) {
+    int reg_usage[8];
+    for (int i = 0; i < 8; i++)
+        reg_usage[i] = -1;
+
+    for (int i = 0; i < RX_PROGRAM_SIZE; i++) {
+        const uint8_t *raw = vm->program.b + 128 + 8 * i;
+        const uint32_t opcode = raw[0], mod = raw[3];
+        const uint32_t imm32 = (uint32_t)raw[4] | ((uint32_t)raw[5] << 8) |
+                               ((uint32_t)raw[6] << 16) | ((uint32_t)raw[7] << 24);
+        const uint8_t dst = raw[1] % 8, src = raw[2] % 8;
+        const uint32_t mem_mask = (mod % 4) ? RX_SCRATCHPAD_L1_MASK : RX_SCRATCHPAD_L2_MASK;
+        struct rx_vm_op *op = &vm->code[i];
+
+        op->dst = dst;
+        op->src = src;
+        op->shift = 0;
+        op->target = 0;
+        op->mask = 0;
+        op->imm = rx_sign_extend(imm32);
+
+        if (opcode < RX_CEIL_IADD_RS) {
+            op->type = RX_OP_IADD_RS;
+            op->shift = (uint8_t)((mod >> 2) % 4);
+            if (dst != RX_REG_NEEDS_DISPLACEMENT)
+                op->imm = 0;
+            reg_usage[dst] = i;
+        } else if (opcode < RX_CEIL_ISMULH_M || (opcode >= RX_CEIL_INEG_R && opcode < RX_CEIL_IROL_R)) {
+            /* integer ops on dst: register, immediate (src == dst) or memory form */
+            static const struct { uint8_t ceil, r, i, m; } forms[] = {
+                { RX_CEIL_IADD_M,   RX_OP_NOP,      RX_OP_NOP,    RX_OP_IADD_M },
+                { RX_CEIL_ISUB_R,   RX_OP_ISUB_R,   RX_OP_ISUB_I, RX_OP_NOP },
+                { RX_CEIL_ISUB_M,   RX_OP_NOP,      RX_OP_NOP,    RX_OP_ISUB_M },
+                { RX_CEIL_IMUL_R,   RX_OP_IMUL_R,   RX_OP_IMUL_I, RX_OP_NOP },
+                { RX_CEIL_IMUL_M,   RX_OP_NOP,      RX_OP_NOP,    RX_OP_IMUL_M },
+                { RX_CEIL_IMULH_R,  RX_OP_IMULH_R,  RX_OP_IMULH_R, RX_OP_NOP },
+                { RX_CEIL_IMULH_M,  RX_OP_NOP,      RX_OP_NOP,    RX_OP_IMULH_M },
+                { RX_CEIL_ISMULH_R, RX_OP_ISMULH_R, RX_OP_ISMULH_R, RX_OP_NOP },
+                { RX_CEIL_ISMULH_M, RX_OP_NOP,      RX_OP_NOP,    RX_OP_ISMULH_M },
+                { RX_CEIL_INEG_R,   0, 0, 0 },      /* IMUL_RCP: handled below */
+                { RX_CEIL_IXOR_R,   RX_OP_IXOR_R,   RX_OP_IXOR_I, RX_OP_NOP },
+                { RX_CEIL_IXOR_M,   RX_OP_NOP,      RX_OP_NOP,    RX_OP_IXOR_M },
+                { RX_CEIL_IROR_R,   RX_OP_IROR_R,   RX_OP_IROR_I, RX_OP_NOP },
+                { RX_CEIL_IROL_R,   RX_OP_IROL_R,   RX_OP_IROL_I, RX_OP_NOP },
+            };
+            int f = 0;
+            while (opcode >= forms[f].ceil)
+                f++;
+            if (forms[f].m != RX_OP_NOP) {
+                op->type = forms[f].m;
+                if (src != dst) {
+                    op->mask = mem_mask;
+                } else {
+                    op->src = 8;
+                    op->mask = RX_SCRATCHPAD_L3_MASK;
+                }
+            } else if (src != dst) {
+                op->type = forms[f].r;
+            } else {
+                op->type = forms[f].i;
+                if (op->type == RX_OP_IROR_I || op->type == RX_OP_IROL_I)
+                    op->imm = imm32 & 63;
+            }
+            reg_usage[dst] = i;
+        } else if (opcode < RX_CEIL_IMUL_RCP) {
+            if (rx_is_zero_or_pow2(imm32)) {
+                op->type = RX_OP_NOP;
+            } else {
+                op->type = RX_OP_IMUL_I;
+                op->imm = rx_reciprocal(imm32);
+                reg_usage[dst] = i;
+            }
+        } else if (opcode < RX_CEIL_INEG_R) {
+            op->type = RX_OP_INEG_R;
+            reg_usage[dst] = i;
+        } else if (opcode < RX_CEIL_ISWAP_R) {
+            if (src != dst) {
+                op->type = RX_OP_ISWAP_R;
+                reg_usage[dst] = i;
+                reg_usage[src] = i;
+            } else {
+                op->type = RX_OP_NOP;
+            }
+        } else if (opcode < RX_CEIL_FSWAP_R) {
+            op->type = RX_OP_FSWAP_R;                       /* f0-3 or e0-3 */
+        } else if (opcode < RX_CEIL_FADD_R) {
+            op->type = RX_OP_FADD_R;
+            op->dst = dst % 4;
+            op->src = 8 + src % 4;
+        } else if (opcode < RX_CEIL_FADD_M) {
+            op->type = RX_OP_FADD_M;
+            op->dst = dst % 4;
+            op->mask = mem_mask;
+        } else if (opcode < RX_CEIL_FSUB_R) {
+            op->type = RX_OP_FSUB_R;
+            op->dst = dst % 4;
+            op->src = 8 + src % 4;
+        } else if (opcode < RX_CEIL_FSUB_M) {
+            op->type = RX_OP_FSUB_M;
+            op->dst = dst % 4;
+            op->mask = mem_mask;
+        } else if (opcode < RX_CEIL_FSCAL_R) {
+            op->type = RX_OP_FSCAL_R;
+            op->dst = dst % 4;
+        } else if (opcode < RX_CEIL_FMUL_R) {
+            op->type = RX_OP_FMUL_R;
+            op->dst = 4 + dst % 4;
+            op->src = 8 + src % 4;
+        } else if (opcode < RX_CEIL_FDIV_M) {
+            op->type = RX_OP_FDIV_M;
+            op->dst = 4 + dst % 4;
+            op->mask = mem_mask;
+        } else if (opcode < RX_CEIL_FSQRT_R) {
+            op->type = RX_OP_FSQRT_R;
+            op->dst = 4 + dst % 4;
+        } else if (opcode < RX_CEIL_CBRANCH) {
+            /* r[dst] += imm; jump back past the last write to r[dst] when
+             * the RX_JUMP_BITS condition bits come out zero */
+            const int shift = (int)(mod >> 4) + RX_JUMP_OFFSET;
+            op->type = RX_OP_CBRANCH;
+            op->target = reg_usage[dst];
+            op->imm = (op->imm | (1ULL << shift)) & ~(1ULL << (shift - 1));
+            op->mask = RX_CONDITION_MASK << shift;
+            for (int j = 0; j < 8; j++)
+                reg_usage[j] = i;
+        } else if (opcode < RX_CEIL_CFROUND) {
+            op->type = RX_OP_CFROUND;
+            op->imm = imm32 & 63;
+        } else if (opcode < RX_CEIL_ISTORE) {
+            op->type = RX_OP_ISTORE;
+            op->mask = (mod >> 4) < RX_STORE_L3_CONDITION ? mem_mask : RX_SCRATCHPAD_L3_MASK;
+        } else {
+            op->type = RX_OP_NOP;
+        }
+    }
+}
+
+/* Two int32 → {lo, hi} doubles (RandomX load_cvt_i32x2) */
+static inline void rx_load_cvt(const uint8_t *p, double out[2]) {
+    int32_t v[2];
+    memcpy(v, p, 8);
+    out[0] = (double)v[0];
+    out[1] = (double)v[1];
+}
+
+/* E-group value: converted pair with fixed exponent/mantissa bits */
+static inline void rx_load_cvt_e(const uint8_t *p, double out[2], const uint64_t emask[2]) {
+    const uint64_t mantissa = (1ULL << 56) - 1;
+    rx_load_cvt(p, out);
+    out[0] = rx_dfrom((rx_dbits(out[0]) & mantissa) | emask[0]);
+    out[1] = rx_dfrom((rx_dbits(out[1]) & mantissa) | emask[1]);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RX_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define RX_PREFETCH(p) ((void)(p))
+#endif
+
+/* Fold dataset item `address` into r: read from the dataset in full mode,
+ * computed from the cache in light mode (dataset NULL) */
+static inline void rx_dataset_read(const rx_cache *cache, const uint8_t *dataset,
+                                   uint64_t address, uint64_t r[8]) {
+    uint64_t item[8];
+    if (dataset)
+        memcpy(item, dataset + address, sizeof(item));
+    else
+        rx_dataset_item(cache, address / RX_CACHE_LINE_SIZE, item);
+    for (int i = 0; i < 8; i++)
+        r[i] ^= item[i];
+}
+
+/*
+ * Runs the decoded program RX_PROGRAM_ITERATIONS times over the
+ * scratchpad; 0 when `control` moved on first (checked every
+ * RX_CONTROL_INTERVAL iterations), leaving vm and the rounding mode as
+ * they were mid-program.
+ */
+static int rx_vm_execute(struct rx_vm *vm, const rx_cache *cache, const uint8_t *dataset,
+                         uint8_t *sp, const struct cn_control *control) {
+    uint64_t r[9] = { 0 };                  /* r[8]: constant zero */
+    double fp[12][2];
+    uint32_t mode = vm->rounding;
+    uint32_t sp0 = vm->mx, sp1 = vm->ma;
+    uint32_t ma = vm->ma, mx = vm->mx;
+    const uint32_t rr0 = vm->read_reg[0], rr1 = vm->read_reg[1];
+    const uint32_t rr2 = vm->read_reg[2], rr3 = vm->read_reg[3];
+
+    memcpy(fp[8], vm->reg.fp[8], 4 * sizeof(fp[0]));
+
+    for (int ic = 0; ic < RX_PROGRAM_ITERATIONS; ic++) {
+        if (!(ic & (RX_CONTROL_INTERVAL - 1)) && cn_control_changed(control))
+            return 0;
+
+        const uint64_t sp_mix = r[rr0] ^ r[rr1];
+        sp0 = (sp0 ^ (uint32_t)sp_mix) & RX_SCRATCHPAD_L3_MASK64;
+        sp1 = (sp1 ^ (uint32_t)(sp_mix >> 32)) & RX_SCRATCHPAD_L3_MASK64;
+
+        for (int i = 0; i < 8; i++)
+            r[i] ^= rx_load64(sp + sp0 + 8 * i);
+        for (int i = 0; i < 4; i++)
+            rx_load_cvt(sp + sp1 + 8 * i, fp[i]);
+        for (int i = 0; i < 4; i++)
+            rx_load_cvt_e(sp + sp1 + 32 + 8 * i, fp[4 + i], vm->emask);
+
+        for (int pc = 0; pc < RX_PROGRAM_SIZE; pc++) {
+            const struct rx_vm_op *op = &vm->code[pc];
+            uint64_t *dst = &r[op->dst];
+            double *fd = fp[op->dst];
+            double m[2];
+
+            switch (op->type) {
+            case RX_OP_IADD_RS:  *dst += (r[op->src] << op->shift) + op->imm; break;
+            case RX_OP_IADD_M:   *dst += rx_load64(sp + ((r[op->src] + op->imm) & op->mask)); break;
+            case RX_OP_ISUB_R:   *dst -= r[op->src]; break;
+            case RX_OP_ISUB_I:   *dst -= op->imm; break;
+            case RX_OP_ISUB_M:   *dst -= rx_load64(sp + ((r[op->src] + op->imm) & op->mask)); break;
+            case RX_OP_IMUL_R:   *dst *= r[op->src]; break;
+            case RX_OP_IMUL_I:   *dst *= op->imm; break;
+            case RX_OP_IMUL_M:   *dst *= rx_load64(sp + ((r[op->src] + op->imm) & op->mask)); break;
+            case RX_OP_IMULH_R:  *dst = rx_mulh(*dst, r[op->src]); break;
+            case RX_OP_IMULH_M:
+                *dst = rx_mulh(*dst, rx_load64(sp + ((r[op->src] + op->imm) & op->mask)));
+                break;
+            case RX_OP_ISMULH_R: *dst = rx_smulh(*dst, r[op->src]); break;
+            case RX_OP_ISMULH_M:
+                *dst = rx_smulh(*dst, rx_load64(sp + ((r[op->src] + op->imm) & op->mask)));
+                break;
+            case RX_OP_INEG_R:   *dst = 0 - *dst; break;
+            case RX_OP_IXOR_R:   *dst ^= r[op->src]; break;
+            case RX_OP_IXOR_I:   *dst ^= op->imm; break;
+            case RX_OP_IXOR_M:   *dst ^= rx_load64(sp + ((r[op->src] + op->imm) & op->mask)); break;
+            case RX_OP_IROR_R:   *dst = rx_rotr64(*dst, (unsigned)r[op->src]); break;
+            case RX_OP_IROR_I:   *dst = rx_rotr64(*dst, (unsigned)op->imm); break;
+            case RX_OP_IROL_R:   *dst = rx_rotl64(*dst, (unsigned)r[op->src]); break;
+            case RX_OP_IROL_I:   *dst = rx_rotl64(*dst, (unsigned)op->imm); break;
+            case RX_OP_ISWAP_R: {
+                const uint64_t t = r[op->src];
+                r[op->src] = *dst;
+                *dst = t;
+                break;
+            }
+            case RX_OP_FSWAP_R: {
+                const double t = fd[0];
+                fd[0] = fd[1];
+                fd[1] = t;
+                break;
+            }
+            case RX_OP_FADD_R:
+                fd[0] = rx_fadd(fd[0], fp[op->src][0], mode);
+                fd[1] = rx_fadd(fd[1], fp[op->src][1], mode);
+                break;
+            case RX_OP_FADD_M:
+                rx_load_cvt(sp + ((r[op->src] + op->imm) & op->mask), m);
+                fd[0] = rx_fadd(fd[0], m[0], mode);
+                fd[1] = rx_fadd(fd[1], m[1], mode);
+                break;
+            case RX_OP_FSUB_R:
+                fd[0] = rx_fsub(fd[0], fp[op->src][0], mode);
+                fd[1] = rx_fsub(fd[1], fp[op->src][1], mode);
+                break;
+            case RX_OP_FSUB_M:
+                rx_load_cvt(sp + ((r[op->src] + op->imm) & op->mask), m);
+                fd[0] = rx_fsub(fd[0], m[0], mode);
+                fd[1] = rx_fsub(fd[1], m[1], mode);
+                break;
+            case RX_OP_FSCAL_R:
+                fd[0] = rx_dfrom(rx_dbits(fd[0]) ^ 0x80F0000000000000ULL);
+                fd[1] = rx_dfrom(rx_dbits(fd[1]) ^ 0x80F0000000000000ULL);
+                break;
+            case RX_OP_FMUL_R:
+                fd[0] = rx_fmul(fd[0], fp[op->src][0], mode);
+                fd[1] = rx_fmul(fd[1], fp[op->src][1], mode);
+                break;
+            case RX_OP_FDIV_M:
+                rx_load_cvt_e(sp + ((r[op->src] + op->imm) & op->mask), m, vm->emask);
+                fd[0] = rx_fdiv(fd[0], m[0], mode);
+                fd[1] = rx_fdiv(fd[1], m[1], mode);
+                break;
+            case RX_OP_FSQRT_R:
+                fd[0] = rx_fsqrt(fd[0], mode);
+                fd[1] = rx_fsqrt(fd[1], mode);
+                break;
+            case RX_OP_CBRANCH:
+                *dst += op->imm;
+                if ((*dst & op->mask) == 0)
+                    pc = op->target;
+                break;
+            case RX_OP_CFROUND:
+                mode = (uint32_t)rx_rotr64(r[op->src], (unsigned)op->imm) % 4;
+                rx_set_rounding(mode);
+                break;
+            case RX_OP_ISTORE:
+                rx_store64(sp + ((*dst + op->imm) & op->mask), r[op->src]);
+                break;
+            default:
+                break;
+            }
+        }
+
+        mx = (mx ^ (uint32_t)(r[rr2] ^ r[rr3])) & (uint32_t)RX_CACHE_LINE_ALIGN_MASK;
+        if (dataset)                        /* next iteration's line */
+            RX_PREFETCH(dataset + vm->dataset_offset + mx);
+        rx_dataset_read(cache, dataset, vm->dataset_offset + ma, r);
+        const uint32_t t = mx;
+        mx = ma;
+        ma = t;
+
+        for (int i = 0; i < 8; i++)
+            rx_store64(sp + sp1 + 8 * i, r[i]);
+        for (int i = 0; i < 4; i++) {
+            fp[i][0] = rx_dfrom(rx_dbits(fp[i][0]) ^ rx_dbits(fp[4 + i][0]));
+            fp[i][1] = rx_dfrom(rx_dbits(fp[i][1]) ^ rx_dbits(fp[4 + i][1]));
+            rx_store64(sp + sp0 + 16 * i, rx_dbits(fp[i][0]));
+            rx_store64(sp + sp0 + 16 * i + 8, rx_dbits(fp[i][1]));
+        }
+        sp0 = sp1 = 0;
+    }
+
+    memcpy(vm->reg.r, r, sizeof(vm->reg.r));
+    memcpy(vm->reg.fp, fp, 8 * sizeof(fp[0]));
+    vm->rounding = mode;
+    return 1;
+}
+
+/* ========================= Hashing context ========================= */
+
+typedef struct rx_ctx rx_ctx;
+
+/** Per-thread hashing state; the cache it reads is shared. */
+struct rx_ctx {
+    const rx_cache *cache;
+    const uint8_t *dataset;                 /* full mode: rx_ctx_set_dataset(), else NULL */
+    const struct rx_aes_backend *aes;
+    uint8_t *scratchpad;                    /* RX_SCRATCHPAD_L3 bytes */
+    size_t   scratchpad_size;               /* bytes reserved at `scratchpad` */
+    uint32_t scratchpad_kind;               /* enum cn_mem_kind */
+    uint32_t blob_len;                      /* job set by rx_ctx_set_job(), 0: none */
+    uint8_t  blob[CN_MAX_BLOB];
+    struct cn_control control;              /* see rx_ctx_set_control() */
+    struct cn_stats_sink stats;             /* see rx_ctx_set_stats() */
+    uint32_t scanned;                       /* nonces the last rx_ctx_scan() covered */
+    struct rx_vm vm;
+};
+
+/**
+ * A context hashing against `cache` (which must outlive it), or NULL for
+ * one that gets a dataset before hashing; NULL when out of memory.
+ */
+EMSCRIPTEN_KEEPALIVE
+rx_ctx *rx_ctx_create(const rx_cache *cache) {
+    rx_ctx *ctx = (rx_ctx *)calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+    ctx->scratchpad = cn_mem_alloc(RX_SCRATCHPAD_L3, &ctx->scratchpad_size, &ctx->scratchpad_kind);
+    if (!ctx->scratchpad) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->cache = cache;
+    ctx->aes = rx_select_aes();
+    return ctx;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void rx_ctx_destroy(rx_ctx *ctx) {
+    if (!ctx) return;
+    cn_mem_free(ctx->scratchpad, ctx->scratchpad_size, ctx->scratchpad_kind);
+    free(ctx);
+}
+
+#if RX_FULL_MODE
+/**
+ * Hashes in full mode with `ds` (and its cache) from now on; `ds` must
+ * stay built until the context moves to another one or is destroyed.
+ */
+void rx_ctx_set_dataset(rx_ctx *ctx, const rx_dataset *ds) {
+    ctx->dataset = ds->memory;
+    ctx->cache = ds->cache;
+}
+#endif
+
+/** AES implementation the context uses ("aesni" or "portable"). */
+EMSCRIPTEN_KEEPALIVE
+const char *rx_ctx_backend_name(const rx_ctx *ctx) {
+    return ctx->aes->name;
+}
+
+/* One program of the chain: generate it from `seed`, then run it; 0 when
+ * the control word abandoned it */
+static int rx_vm_run(rx_ctx *ctx, const uint8_t seed[64]) {
+    struct rx_vm *vm = &ctx->vm;
+    ctx->aes->fill4r(seed, sizeof(vm->program.b), vm->program.b);
+    rx_vm_init(vm);
+    rx_vm_compile(vm);
+    return rx_vm_execute(vm, ctx->cache, ctx->dataset, ctx->scratchpad, &ctx->control);
+}
+
+/* rx_ctx_hash(), or 0 with `output` untouched when the control word
+ * abandoned the hash */
+static int rx_hash(rx_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    uint64_t seed[8];
+
+    rx_blake2b(seed, sizeof(seed), input, input_len);
+    rx_set_rounding(RX_ROUND_NEAREST);
+    ctx->aes->fill1r((uint8_t *)seed, RX_SCRATCHPAD_L3, ctx->scratchpad);
+    ctx->vm.rounding = RX_ROUND_NEAREST;
+    for (int chain = 0; chain < RX_PROGRAM_COUNT; chain++) {
+        if (!rx_vm_run(ctx, (const uint8_t *)seed)) {
+            rx_set_rounding(RX_ROUND_NEAREST);
+            return 0;
+        }
+        if (chain < RX_PROGRAM_COUNT - 1)
+            rx_blake2b(seed, sizeof(seed), &ctx->vm.reg, sizeof(ctx->vm.reg));
+    }
+    rx_set_rounding(RX_ROUND_NEAREST);
+    ctx->aes->hash1r(ctx->scratchpad, RX_SCRATCHPAD_L3, (uint8_t *)ctx->vm.reg.fp[8]);
+    rx_blake2b(output, 32, &ctx->vm.reg, sizeof(ctx->vm.reg));
+    return 1;
+}
+
+/**
+ * RandomX hash of `input` (32 bytes at `output`) with the context's
+ * cache; zeros when its control word (rx_ctx_set_control()) moved on
+ * mid-hash.
+ */
+EMSCRIPTEN_KEEPALIVE
+void rx_ctx_hash(rx_ctx *ctx, const uint8_t *input, uint32_t input_len, uint8_t *output) {
+    if (!rx_hash(ctx, input, input_len, output))
+        memset(output, 0, 32);
+}
+
+/** Same contract as cn_ctx_set_job(): blobs of 43..CN_MAX_BLOB bytes. */
+EMSCRIPTEN_KEEPALIVE
+int rx_ctx_set_job(rx_ctx *ctx, const uint8_t *blob, uint32_t blob_len) {
+    if (blob_len < CN_NONCE_OFFSET + 4 || blob_len > CN_MAX_BLOB) {
+        ctx->blob_len = 0;
+        return 0;
+    }
+    memcpy(ctx->blob, blob, blob_len);
+    ctx->blob_len = blob_len;
+    return 1;
+}
+
+/**
+ * Batch nonce search over the context's job with cn_ctx_scan()'s result
+ * records, early stop and control word.  Returns the number of records
+ * written.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t rx_ctx_scan(rx_ctx *ctx, uint32_t nonce_start, uint32_t count, uint64_t target,
+                     uint8_t *out_results)
+{
+    uint8_t  hash[32];
+    uint32_t found = 0;
+
+    ctx->scanned = 0;
+    if (!ctx->blob_len) return 0;
+
+    const uint64_t start = cn_stats_begin(&ctx->stats);
+    for (uint32_t done = 0; done < count && found < CN_SCAN_MAX_RESULTS;
+         done++, ctx->scanned = done) {
+        if (cn_control_changed(&ctx->control)) break;
+        const uint32_t nonce = nonce_start + done;
+        cn_set_nonce(ctx->blob, ctx->blob_len, nonce);
+        if (!rx_hash(ctx, ctx->blob, ctx->blob_len, hash))
+            break;                              /* abandoned: not scanned */
+        if (!cn_hash_meets_target(hash, target))
+            continue;
+        uint8_t *rec = out_results + found * CN_SCAN_RESULT_SIZE;
+        rec[0] = (uint8_t)(nonce & 0xFF);
+        rec[1] = (uint8_t)((nonce >> 8)  & 0xFF);
+        rec[2] = (uint8_t)((nonce >> 16) & 0xFF);
+        rec[3] = (uint8_t)((nonce >> 24) & 0xFF);
+        memcpy(rec + 4, hash, 32);
+        found++;
+    }
+    cn_stats_end(&ctx->stats, start, ctx->scanned, found);
+    return found;
+}
+
+/**
+ * cn_ctx_set_control() for RandomX: checked before every hash and every
+ * RX_CONTROL_INTERVAL VM iterations, abandoning the hash in flight.
+ */
+EMSCRIPTEN_KEEPALIVE
+void rx_ctx_set_control(rx_ctx *ctx, const uint32_t *word, uint32_t expect) {
+    cn_control_arm(&ctx->control, word, expect, 0);
+}
+
+/** cn_ctx_set_host_control() for RandomX scans. */
+EMSCRIPTEN_KEEPALIVE
+void rx_ctx_set_host_control(rx_ctx *ctx, uint32_t expect) {
+    cn_control_arm(&ctx->control, NULL, expect, 1);
+}
+
+/** cn_ctx_set_stats() for RandomX scans. */
+EMSCRIPTEN_KEEPALIVE
+void rx_ctx_set_stats(rx_ctx *ctx, cn_stats *stats) {
+    cn_stats_arm(&ctx->stats, stats, -1);
+}
+
+/** cn_ctx_set_host_stats() for RandomX scans. */
+EMSCRIPTEN_KEEPALIVE
+void rx_ctx_set_host_stats(rx_ctx *ctx, uint32_t slot) {
+    cn_stats_arm(&ctx->stats, NULL, (int32_t)(slot & 0x7FFFFFFF));
+}
+
+/** Same as cn_ctx_scanned(). */
+EMSCRIPTEN_KEEPALIVE
+uint32_t rx_ctx_scanned(const rx_ctx *ctx) {
+    return ctx->scanned;
+}
+
+/* Cache and context behind rx_slow_hash(), created on first use per thread */
+static _Thread_local rx_cache *rx_default_cache;
+static _Thread_local rx_ctx *rx_default_ctx;
+
+/**
+ * Monero's rx_slow_hash() interface: RandomX hash of `data` under the
+ * 32-byte `seedhash`, hashing to zeros when memory runs out.  Changing the
+ * seed hash rebuilds the per-thread cache.
+ */
+EMSCRIPTEN_KEEPALIVE
+void rx_slow_hash(const char *seedhash, const void *data, size_t length, char *hash) {
+    memset(hash, 0, 32);
+    if (length > UINT32_MAX) return;
+    if (!rx_default_cache && !(rx_default_cache = rx_cache_create())) return;
+    if (!rx_default_ctx && !(rx_default_ctx = rx_ctx_create(rx_default_cache))) return;
+    rx_cache_init(rx_default_cache, (const uint8_t *)seedhash, 32);
+    rx_ctx_hash(rx_default_ctx, (const uint8_t *)data, (uint32_t)length, (uint8_t *)hash);
+}